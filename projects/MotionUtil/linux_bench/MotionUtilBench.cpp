@@ -0,0 +1,2283 @@
+﻿/**
+ * MotionUtilのコアアルゴリズムのベンチマーク.
+ * 合成したグリッドメッシュ(1k - 2M頂点)に対して処理時間を計測し、JSON形式で出力する.
+ * 入力は固定のシードから生成するため、結果のチェックサムは実行ごとに一致する.
+ *
+ * 使い方 : motionutil_bench [--quick] [--sizes 1000,10000,...] [--repeat N] [--threads N] [--seed N] [--output file.json] [--profile file.json] [--trace file.json]
+ */
+#include "GlobalHeader.h"
+#include "BSPPoint.h"
+#include "BoneSkeleton.h"
+#include "BoneUtil.h"
+#include "CalcMeshTransform.h"
+#include "MathUtil.h"
+#include "MeshUtil.h"
+#include "MorphTargetsCtrl.h"
+#include "MorphTargetsRegistry.h"
+#include "MorphTargetsRemap.h"
+#include "MorphTargetsSceneEval.h"
+#include "MorphTargetsTransfer.h"
+#include "MorphTargetsUndo.h"
+#include "MotionBlend.h"
+#include "MotionFK.h"
+#include "MotionIK.h"
+#include "MotionReduce.h"
+#include "MotionRetarget.h"
+#include "ParallelUtil.h"
+#include "ProfileUtil.h"
+#include "SkinDeform.h"
+#include "SkinWeights.h"
+#include "StreamCodec.h"
+#include "StreamCtrl.h"
+#include "TraceUtil.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace {
+	const int BENCH_TARGETS_COUNT = 8;			// 1つのメッシュに割り当てるMorph Targetsの数.
+	const int BENCH_TARGETS_STRIDE = 16;		// Target tは、頂点インデックスが (i % 16 == t) の頂点を移動する.
+	const int BENCH_MAX_SEARCH_COUNT = 200000;	// 近傍検索の最大回数.
+	const int BENCH_SCENE_SHAPES_COUNT = 10000;	// pushAllWeightの計測用に追加する、Morph Targets情報を持たない形状の数.
+	const float BENCH_BLEND_TOLERANCE = 0.005f;	// 許容誤差を指定したブレンドでの、頂点位置の許容誤差.
+	const int BENCH_TRANSFER_MAX_VERTICES = 100000;	// Morph Targetsの転送の計測での、転送元の頂点数の上限.
+	const int BENCH_TRANSFER_TARGETS_COUNT = 16;	// Morph Targetsの転送の計測で、転送元に作成するTarget数 (すべての頂点を移動する).
+	const float BENCH_TRANSFER_GRID_SIZE = 0.8f;	// Morph Targetsの転送の計測での、転送先のグリッドの頂点の間隔 (転送元は1.0).
+	const int BENCH_REMAP_MAX_VERTICES = 250000;	// 頂点の対応付け直しの計測での、メッシュの頂点数の上限.
+	const int BENCH_SCENE_EVAL_SHAPES_COUNT = 16;	// シーン全体の更新の計測用に作成する、Morph Targets情報を持つ形状の数.
+	const int BENCH_BONE_CHAIN_LENGTH = 32;		// ボーン操作の計測用に作成する、髪や布のようなボーンの連なりの長さ.
+	const int BENCH_SKIN_JOINTS_COUNT = 16;		// スキン変形の計測用に、メッシュのX方向に並べるボーンの数.
+	const int BENCH_FK_JOINTS_COUNT = 200;		// ポーズの計算の計測用に作成するボーン数.
+	const int BENCH_FK_KEYS_COUNT = 60;			// ポーズの計算の計測用に、ジョイントごとに作成するキーフレーム数 (1/30秒間隔).
+	const int BENCH_MOCAP_MORPH_TRACKS_COUNT = 32;	// 毎フレームにキーフレームを持つMotionGroupに作成する、Morph Targetsのウエイト値のトラック数.
+	const int BENCH_BLEND_FRAMES_COUNT = 30;	// レイヤーのブレンドの計測で、キャラクタごとに計算するフレーム数.
+	const int BENCH_BLEND_MASK_JOINT = 100;		// レイヤーのブレンドの計測で、この番号以降のジョイントのみ2番目のレイヤー(上書き)を適用する.
+	const int BENCH_IK_CHAIN_JOINTS = 8;		// IKの計測で、ボーンの連なりの先端から使用するジョイント数 (指のような短いチェイン).
+	const float BENCH_IK_LIMIT_ANGLE = 0.2f;	// IKの計測で、回転角度を制限する場合の最大 (ラジアン).
+	const float BENCH_RETARGET_SCALE = 1.25f;	// リターゲットの計測で、移し先のボーン階層のボーンの長さの倍率.
+	const int BENCH_RETARGET_UNNAMED_STRIDE = 10;	// リターゲットの計測で、この数ごとに移し元のジョイントの名前を重複させる (階層で対応させる).
+
+	/**
+	 * ベンチマークの設定.
+	 */
+	class CBenchSettings
+	{
+	public:
+		std::vector<int> sizes;					// 頂点数.
+		int repeat;								// 計測の繰り返し回数.
+		int threads;							// スレッド数 (0の場合はCPUのコア数).
+		unsigned int seed;						// 乱数のシード.
+		std::string outputFile;					// 出力ファイル (空の場合は標準出力).
+		std::string profileFile;				// ProfileUtilの集計の出力ファイル.
+		std::string traceFile;					// TraceUtilのタイムラインの出力ファイル.
+
+	public:
+		CBenchSettings () : repeat(3), threads(0), seed(12345) {
+			const int defaultSizes[] = {1000, 10000, 100000, 1000000, 2000000};
+			sizes.assign(defaultSizes, defaultSizes + 5);
+		}
+	};
+
+	/**
+	 * 1つの計測結果.
+	 */
+	class CBenchResult
+	{
+	public:
+		std::string caseName;					// 計測の種類.
+		int verticesCount;						// メッシュの頂点数.
+		std::vector<double> times;				// 繰り返しごとの処理時間 (ミリ秒).
+		long long bytes;						// 入出力のバイト数.
+		unsigned int checksum;					// 結果のチェックサム.
+		bool valid;								// 結果の検証に成功したか.
+		long long itemsCount;					// 1回の計測で処理した数 (0より大きい場合は、1秒あたりの処理数を出力する).
+
+	public:
+		CBenchResult () : verticesCount(0), bytes(0), checksum(0), valid(true), itemsCount(0) { }
+
+		double getMinTime () const {
+			return times.empty() ? 0.0 : *std::min_element(times.begin(), times.end());
+		}
+		double getMedianTime () const {
+			if (times.empty()) return 0.0;
+			std::vector<double> t = times;
+			std::sort(t.begin(), t.end());
+			return t[t.size() / 2];
+		}
+	};
+
+	/**
+	 * 再現性のある乱数 (xorshift32).
+	 */
+	class CBenchRandom
+	{
+	private:
+		unsigned int m_state;
+
+	public:
+		CBenchRandom (const unsigned int seed) : m_state(seed ? seed : 1) { }
+
+		unsigned int next () {
+			m_state ^= m_state << 13;
+			m_state ^= m_state >> 17;
+			m_state ^= m_state << 5;
+			return m_state;
+		}
+
+		/**
+		 * -1.0 - 1.0の値を取得.
+		 */
+		float nextSigned () {
+			return (float)((double)(next() & 0xffffff) / (double)0xffffff) * 2.0f - 1.0f;
+		}
+	};
+
+	/**
+	 * チェックサム (FNV-1a).
+	 */
+	unsigned int calcChecksum (const void* data, const size_t size, unsigned int hash = 2166136261u)
+	{
+		const unsigned char* p = (const unsigned char *)data;
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= p[i];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	unsigned int calcChecksum (const std::vector<sxsdk::vec3>& vertices, unsigned int hash = 2166136261u)
+	{
+		for (size_t i = 0; i < vertices.size(); ++i) {
+			const float v[3] = {vertices[i].x, vertices[i].y, vertices[i].z};
+			hash = calcChecksum(v, sizeof(v), hash);
+		}
+		return hash;
+	}
+
+	unsigned int calcChecksum (const std::vector<sxsdk::mat4>& matrices, unsigned int hash = 2166136261u)
+	{
+		for (size_t i = 0; i < matrices.size(); ++i) {
+			for (int j = 0; j < 4; ++j) {
+				const float v[4] = {matrices[i][j][0], matrices[i][j][1], matrices[i][j][2], matrices[i][j][3]};
+				hash = calcChecksum(v, sizeof(v), hash);
+			}
+		}
+		return hash;
+	}
+
+	/**
+	 * 処理時間(ミリ秒)を計測.
+	 */
+	double measureTime (const std::function<void ()>& func)
+	{
+		const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		func();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+	/**
+	 * 頂点数がverticesCount以上となる、凹凸のあるグリッドメッシュを作成.
+	 * @param[out] gridSize  頂点の間隔.
+	 */
+	sxsdk::polygon_mesh_class* createGridMesh (sxsdk::scene_interface& scene, const int verticesCount, const unsigned int seed, float& gridSize)
+	{
+		const int divX = std::max(2, (int)std::ceil(std::sqrt((double)verticesCount)));
+		const int divY = std::max(2, (verticesCount + divX - 1) / divX);
+		gridSize = 1.0f;
+
+		sxsdk::polygon_mesh_class* pMesh = scene.append_polygon_mesh(scene.get_shape(), "bench_mesh");
+		pMesh->vertices.reserve((size_t)divX * divY);
+		pMesh->faces.reserve((size_t)(divX - 1) * (divY - 1));
+
+		CBenchRandom random(seed);
+		for (int y = 0; y < divY; ++y) {
+			for (int x = 0; x < divX; ++x) {
+				const float h = std::sin((float)x * 0.05f) * std::cos((float)y * 0.05f) * 4.0f + random.nextSigned() * 0.1f;
+				pMesh->append_point(sxsdk::vec3((float)x * gridSize, h, (float)y * gridSize));
+			}
+		}
+		for (int y = 0; y < divY - 1; ++y) {
+			for (int x = 0; x < divX - 1; ++x) {
+				const int i0 = y * divX + x;
+				const int indices[4] = {i0, i0 + 1, i0 + divX + 1, i0 + divX};
+				pMesh->append_face(4, indices);
+			}
+		}
+		return pMesh;
+	}
+
+	/**
+	 * ポリゴンメッシュの頂点座標を取得.
+	 */
+	void getMeshVertices (sxsdk::polygon_mesh_class& pMesh, std::vector<sxsdk::vec3>& vertices)
+	{
+		const int versCou = pMesh.get_total_number_of_control_points();
+		vertices.resize(versCou);
+		sxsdk::polygon_mesh_saver_class* pMeshSaver = pMesh.get_polygon_mesh_saver();
+		for (int i = 0; i < versCou; ++i) vertices[i] = pMeshSaver->get_point(i);
+		pMeshSaver->release();
+	}
+
+	/**
+	 * Morph Targetsを割り当てる.
+	 */
+	void setupMorphTargets (sxsdk::polygon_mesh_class& pMesh, const unsigned int seed, CMorphTargetsCtrl& morphCtrl)
+	{
+		morphCtrl.clear();
+		morphCtrl.setupShape(&pMesh);
+		const std::vector<sxsdk::vec3>& orgVertices = morphCtrl.getOrgVertices();
+		const int versCou = (int)orgVertices.size();
+
+		CBenchRandom random(seed ^ 0x9e3779b9u);
+		std::vector<int> indices;
+		std::vector<sxsdk::vec3> vertices;
+		for (int loop = 0; loop < BENCH_TARGETS_COUNT; ++loop) {
+			indices.clear();
+			vertices.clear();
+			for (int i = loop; i < versCou; i += BENCH_TARGETS_STRIDE) {
+				indices.push_back(i);
+				vertices.push_back(orgVertices[i] + sxsdk::vec3(random.nextSigned(), random.nextSigned(), random.nextSigned()) * 0.25f);
+			}
+			char szName[64];
+			snprintf(szName, sizeof(szName), "target_%d", loop);
+			const int tIndex = morphCtrl.appendTargetVertices(szName, indices, vertices);
+			morphCtrl.setTargetWeight(tIndex, (float)(loop + 1) / (float)(BENCH_TARGETS_COUNT + 1));
+		}
+	}
+
+	/**
+	 * ボーンルートの下に、長さBENCH_BONE_CHAIN_LENGTHのボーンの連なりを並べたボーン階層を作成.
+	 * シーケンスOffとして、ボーンの変換行列と形状の変換行列は同じとする.
+	 */
+	sxsdk::part_class* createBoneRig (sxsdk::scene_interface& scene, const int bonesCount, const unsigned int seed, std::vector<sxsdk::part_class *>& bones)
+	{
+		CBenchRandom random(seed ^ 0x85ebca6bu);
+		sxsdk::part_class* pRoot = scene.append_part(scene.get_shape(), "bench_bone_root", sxsdk::enums::bone_joint);
+		pRoot->bone.matrix = sxsdk::mat4::rotate(sxsdk::vec3(0, 0, 1), 0.2f) * sxsdk::mat4::translate(sxsdk::vec3(0.0f, 10.0f, 0.0f));
+		pRoot->transformation = pRoot->bone.matrix;
+		bones.clear();
+		bones.push_back(pRoot);
+
+		sxsdk::part_class* pParent = pRoot;
+		for (int i = 1; i < bonesCount; ++i) {
+			if ((i - 1) % BENCH_BONE_CHAIN_LENGTH == 0) pParent = pRoot;
+			sxsdk::part_class* pBone = scene.append_part(*pParent, "bench_bone", sxsdk::enums::bone_joint);
+			const sxsdk::vec3 offset(random.nextSigned() * 0.5f, -1.0f + random.nextSigned() * 0.2f, random.nextSigned() * 0.5f);
+			pBone->bone.matrix = sxsdk::mat4::rotate(sxsdk::vec3(1, 0, 0), random.nextSigned() * 0.3f) * sxsdk::mat4::translate(offset);
+			pBone->transformation = pBone->bone.matrix;
+			pBone->bone.auto_direction = (i % 7 == 0);
+			bones.push_back(pBone);
+			pParent = pBone;
+		}
+		return pRoot;
+	}
+
+	/**
+	 * 移し元のボーン階層と同じ階層で、ボーンの長さとシーケンスOff時の向きが異なるボーン階層を作成 (リターゲットの計測用).
+	 * ジョイントの名前は、名前空間の接頭辞を付け大文字とした "rig:JOINT_番号" とする.
+	 */
+	sxsdk::part_class* createRetargetRig (sxsdk::scene_interface& scene, const CBoneSkeleton& sourceSkeleton, const unsigned int seed, std::vector<sxsdk::part_class *>& bones)
+	{
+		CBenchRandom random(seed ^ 0x165667b1u);
+		bones.clear();
+		for (int i = 0; i < sourceSkeleton.getBonesCount(); ++i) {
+			char szName[64];
+			snprintf(szName, sizeof(szName), "rig:JOINT_%d", i);
+			const int parentIndex = sourceSkeleton.getParents()[i];
+			sxsdk::part_class* pBone = scene.append_part((parentIndex >= 0) ? *bones[parentIndex] : scene.get_shape(), szName, sxsdk::enums::bone_joint);
+			const sxsdk::mat4& srcMatrix = sourceSkeleton.getLocalMatrices()[i];
+			sxsdk::vec3 offset(srcMatrix[3][0], srcMatrix[3][1], srcMatrix[3][2]);
+			if (parentIndex >= 0) offset = offset * BENCH_RETARGET_SCALE;
+			const sxsdk::vec3 axis = normalize(sxsdk::vec3(random.nextSigned(), random.nextSigned(), random.nextSigned() + 0.5f));
+			pBone->bone.matrix = sxsdk::mat4::rotate(axis, random.nextSigned() * 0.5f) * sxsdk::mat4::translate(offset);
+			pBone->transformation = pBone->bone.matrix;
+			bones.push_back(pBone);
+		}
+		return bones.empty() ? NULL : bones[0];
+	}
+
+	/**
+	 * 形状ごとにBoneUtil::getBoneCenterを呼ぶ、ボーンの向きをそろえる再帰 (結果の検証用).
+	 */
+	void adjustBonesDirectionRecursive (sxsdk::shape_class& shape)
+	{
+		if (!BoneUtil::isBone(shape)) return;
+		const sxsdk::mat4 wlMat = inv(shape.get_transformation() * shape.get_local_to_world_matrix());
+		if (!shape.has_son()) return;
+		bool firstF = true;
+		sxsdk::shape_class* pShape = shape.get_son();
+		while (pShape->has_bro()) {
+			pShape = pShape->get_bro();
+			if (firstF) {
+				firstF = false;
+				if (BoneUtil::isBone(*pShape) && !shape.get_bone_joint_interface()->get_auto_direction()) {
+					const sxsdk::vec3 v0 = BoneUtil::getBoneCenter(shape, NULL) * wlMat;
+					const sxsdk::vec3 v1 = BoneUtil::getBoneCenter(*pShape, NULL) * wlMat;
+					shape.get_bone_joint_interface()->set_axis_dir(normalize(v1 - v0));
+				}
+			}
+			adjustBonesDirectionRecursive(*pShape);
+		}
+	}
+
+	/**
+	 * 形状ごとにBoneUtil::getBoneCenterを呼ぶ、ボーンの大きさを調整する再帰 (結果の検証用).
+	 */
+	void resizeBonesRecursive (sxsdk::shape_class& shape, sxsdk::shape_class* prevShape)
+	{
+		if (!BoneUtil::isBone(shape)) return;
+		const sxsdk::vec3 center = BoneUtil::getBoneCenter(shape, NULL);
+		if (prevShape) {
+			const float dist = sxsdk::distance3(BoneUtil::getBoneCenter(*prevShape, NULL), center);
+			if (dist > 0.0f) {
+				shape.get_bone_joint_interface()->set_size(dist / 8.0f);
+				prevShape->get_bone_joint_interface()->set_size(dist / 8.0f);
+			}
+		}
+		if (!shape.has_son()) return;
+		sxsdk::shape_class* pShape = shape.get_son();
+		while (pShape->has_bro()) {
+			pShape = pShape->get_bro();
+			resizeBonesRecursive(*pShape, &shape);
+		}
+	}
+
+	/**
+	 * メッシュのX方向に並べたボーンの連なりと、頂点ごとのボーンの影響を作成.
+	 * 多くの頂点は隣り合う2つのボーン、5頂点ごとに4つのボーン、13頂点ごとに1つのボーンの影響を持ち、97頂点ごとに影響を持たない.
+	 * ボーンの変換行列(バインドポーズ)に対して、形状の変換行列(現在のポーズ)はZ軸とX軸回りに回転させる.
+	 */
+	sxsdk::part_class* createSkinRig (sxsdk::scene_interface& scene, const std::vector<sxsdk::vec3>& vertices, CSkinInfluences& influences)
+	{
+		float maxX = 1.0f;
+		for (size_t i = 0; i < vertices.size(); ++i) maxX = std::max(maxX, vertices[i].x);
+		const float segLen = maxX / (float)(BENCH_SKIN_JOINTS_COUNT - 1);
+
+		sxsdk::part_class* pRoot = NULL;
+		sxsdk::shape_class* pParent = &scene.get_shape();
+		for (int i = 0; i < BENCH_SKIN_JOINTS_COUNT; ++i) {
+			sxsdk::part_class* pBone = scene.append_part(*pParent, "bench_skin_bone", sxsdk::enums::bone_joint);
+			const sxsdk::mat4 m = sxsdk::mat4::translate(sxsdk::vec3((i == 0) ? 0.0f : segLen, 0.0f, 0.0f));
+			pBone->bone.matrix = m;
+			pBone->transformation = sxsdk::mat4::rotate(sxsdk::vec3(0, 0, 1), 0.08f) * sxsdk::mat4::rotate(sxsdk::vec3(1, 0, 0), 0.05f * (float)(i % 3)) * m;
+			if (!pRoot) pRoot = pBone;
+			pParent = pBone;
+		}
+
+		influences.clear();
+		const int lastJoint = BENCH_SKIN_JOINTS_COUNT - 1;
+		for (int i = 0; i < (int)vertices.size(); ++i) {
+			const float u = std::min((float)lastJoint, std::max(0.0f, vertices[i].x / segLen));
+			const int j0 = std::min(lastJoint - 1, (int)u);
+			const float t = u - (float)j0;
+			if (i % 97 == 0) {
+				influences.appendVertex(0, NULL, NULL);
+			} else if (i % 13 == 0) {
+				const int jointIndices[1] = {(t < 0.5f) ? j0 : j0 + 1};
+				const float weights[1] = {1.0f};
+				influences.appendVertex(1, jointIndices, weights);
+			} else if (i % 5 == 0) {
+				const int jointIndices[4] = {std::max(0, j0 - 1), j0, j0 + 1, std::min(lastJoint, j0 + 2)};
+				const float weights[4] = {0.1f, (1.0f - t) * 0.8f, t * 0.8f, 0.1f};
+				influences.appendVertex(4, jointIndices, weights);
+			} else {
+				const int jointIndices[2] = {j0, j0 + 1};
+				const float weights[2] = {1.0f - t, t};
+				influences.appendVertex(2, jointIndices, weights);
+			}
+		}
+		return pRoot;
+	}
+
+	/**
+	 * 指定の頂点数のメッシュで、各処理を計測.
+	 */
+	void runBenchmarks (const CBenchSettings& settings, const int verticesCount, std::vector<CBenchResult>& results)
+	{
+		sxsdk::scene_interface scene;
+		float gridSize = 1.0f;
+		sxsdk::polygon_mesh_class* pMesh = createGridMesh(scene, verticesCount, settings.seed, gridSize);
+
+		// シーンが変わるため、Morph Targets情報を持つ形状の一覧を作り直す (ウィンドウのactive_scene_changedと同じ).
+		MorphTargetsRegistry::getRegistry().invalidate();
+		const int versCou = pMesh->get_total_number_of_control_points();
+
+		std::vector<sxsdk::vec3> meshVertices;
+		getMeshVertices(*pMesh, meshVertices);
+
+		// 空間分割.
+		{
+			CBenchResult result;
+			result.caseName = "bsp_build";
+			result.verticesCount = versCou;
+			for (int loop = 0; loop < settings.repeat; ++loop) {
+				CBSPPoint bsp(meshVertices);
+				result.times.push_back(measureTime([&]() { bsp.build(); }));
+				const int nodesCou = bsp.getNodesCount();
+				result.checksum = calcChecksum(&nodesCou, sizeof(nodesCou));
+				if (nodesCou <= 0) result.valid = false;
+			}
+			results.push_back(result);
+		}
+
+		// 近傍頂点の検索 (頂点位置をずらした位置から、頂点間隔の半分の範囲を検索).
+		{
+			CBenchResult result;
+			result.caseName = "bsp_search";
+			result.verticesCount = versCou;
+
+			CBSPPoint bsp(meshVertices);
+			bsp.build();
+			const int searchCou = std::min(versCou, BENCH_MAX_SEARCH_COUNT);
+			const int step = std::max(1, versCou / searchCou);
+			CBenchRandom random(settings.seed + 1);
+			std::vector<sxsdk::vec3> searchPoints(searchCou);
+			for (int i = 0; i < searchCou; ++i) {
+				searchPoints[i] = meshVertices[i * step] + sxsdk::vec3(random.nextSigned(), random.nextSigned(), random.nextSigned()) * (gridSize * 0.1f);
+			}
+
+			std::vector<int> indices;
+			for (int loop = 0; loop < settings.repeat; ++loop) {
+				unsigned int hash = 2166136261u;
+				bool valid = true;
+				result.times.push_back(measureTime([&]() {
+					for (int i = 0; i < searchCou; ++i) {
+						const int cou = bsp.searchVertices(searchPoints[i], gridSize * 0.5f, indices);
+						hash = calcChecksum(&cou, sizeof(cou), hash);
+						if (std::find(indices.begin(), indices.begin() + cou, i * step) == indices.begin() + cou) valid = false;
+					}
+				}));
+				result.checksum = hash;
+				if (!valid) result.valid = false;
+			}
+			results.push_back(result);
+		}
+
+		// Morph Targetsの割り当て.
+		CMorphTargetsCtrl morphCtrl;
+		setupMorphTargets(*pMesh, settings.seed, morphCtrl);
+
+		// ウエイト値によるブレンド (streamへの保存や姿勢の補正を行わない、メッシュの更新のみ).
+		{
+			CBenchResult result;
+			result.caseName = "morph_blend";
+			result.verticesCount = versCou;
+			for (int loop = 0; loop < settings.repeat; ++loop) {
+				result.times.push_back(measureTime([&]() { morphCtrl.updateMesh(&scene, false); }));
+			}
+			std::vector<sxsdk::vec3> vertices;
+			getMeshVertices(*pMesh, vertices);
+			result.checksum = calcChecksum(vertices);
+
+			// Target 0の頂点が、ウエイト値分だけ移動しているか.
+			const CMorphTargetsData& targetD = morphCtrl.getMorphTargetData(0);
+			const std::vector<sxsdk::vec3>& orgVertices = morphCtrl.getOrgVertices();
+			for (size_t i = 0; i < targetD.vIndices.size(); ++i) {
+				const int vIndex = targetD.vIndices[i];
+				const sxsdk::vec3 v = orgVertices[vIndex] + (targetD.vertices[i] - orgVertices[vIndex]) * targetD.weight;
+				if (!MathUtil::isZero(vertices[vIndex] - v, 1e-4f)) {
+					result.valid = false;
+					break;
+				}
+			}
+			results.push_back(result);
+		}
+
+		// 許容誤差を指定したブレンド.
+		// 半数のTargetを小さいウエイト値にして、省略したTargetによる誤差が上限以下となるかを確認する.
+		{
+			CBenchResult result;
+			result.caseName = "morph_blend_adaptive";
+			result.verticesCount = versCou;
+
+			std::vector<sxsdk::vec3> exactVertices;
+			getMeshVertices(*pMesh, exactVertices);
+			const unsigned int exactChecksum = calcChecksum(exactVertices);
+
+			const int targetsCou = morphCtrl.getTargetsCount();
+			std::vector<float> weights(targetsCou);
+			for (int i = 0; i < targetsCou; ++i) {
+				weights[i] = morphCtrl.getTargetWeight(i);
+				if ((i & 1) == 0) morphCtrl.setTargetWeight(i, 0.001f * (float)(i + 1));
+			}
+
+			// 省略しない場合の頂点座標.
+			std::vector<sxsdk::vec3> refVertices = morphCtrl.getOrgVertices();
+			for (int i = 0; i < targetsCou; ++i) {
+				const CMorphTargetsData& targetD = morphCtrl.getMorphTargetData(i);
+				for (size_t j = 0; j < targetD.vIndices.size(); ++j) {
+					const int vIndex = targetD.vIndices[j];
+					refVertices[vIndex] += (targetD.vertices[j] - morphCtrl.getOrgVertices()[vIndex]) * targetD.weight;
+				}
+			}
+
+			morphCtrl.setBlendTolerance(BENCH_BLEND_TOLERANCE);
+			for (int loop = 0; loop < settings.repeat; ++loop) {
+				result.times.push_back(measureTime([&]() { morphCtrl.updateMesh(&scene, false); }));
+			}
+			std::vector<sxsdk::vec3> vertices;
+			getMeshVertices(*pMesh, vertices);
+			result.checksum = calcChecksum(vertices);
+
+			const float errorBound = morphCtrl.getBlendErrorBound();
+			if (morphCtrl.getBlendCulledCount() <= 0 || errorBound > BENCH_BLEND_TOLERANCE) result.valid = false;
+			for (int i = 0; i < versCou && result.valid; ++i) {
+				const sxsdk::vec3 d = vertices[i] - refVertices[i];
+				if (std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z) > errorBound + 1e-5f) result.valid = false;
+			}
+
+			// ウエイト値と許容誤差を戻すと、省略しない場合と一致するか.
+			morphCtrl.setBlendTolerance(0.0f);
+			for (int i = 0; i < targetsCou; ++i) morphCtrl.setTargetWeight(i, weights[i]);
+			morphCtrl.updateMesh(&scene, false);
+			getMeshVertices(*pMesh, vertices);
+			if (calcChecksum(vertices) != exactChecksum || morphCtrl.getBlendCulledCount() != 0) result.valid = false;
+			results.push_back(result);
+		}
+
+		// 頂点数/トポロジの異なるメッシュへのMorph Targetsの転送.
+		// 転送元のTargetは頂点位置の1次式の移動量とし、転送先の移動量が投影位置での1次式の値 (転送先の頂点との差は投影距離分の誤差) となるかを確認する.
+		{
+			sxsdk::scene_interface transferScene;
+			float srcGridSize = 1.0f;
+			sxsdk::polygon_mesh_class* pSrcMesh = createGridMesh(transferScene, std::min(versCou, BENCH_TRANSFER_MAX_VERTICES), settings.seed, srcGridSize);
+			std::vector<sxsdk::vec3> srcVertices;
+			std::vector<int> srcTriangles;
+			getMeshVertices(*pSrcMesh, srcVertices);
+			MeshUtil::getMeshTriangles(*pSrcMesh, srcTriangles);
+			const int srcCou = (int)srcVertices.size();
+
+			// Targetごとの移動量の係数 (移動量 = x * axes[0] + y * axes[1] + z * axes[2]).
+			CBenchRandom random(settings.seed ^ 0x3c6ef372u);
+			std::vector<sxsdk::vec3> targetAxes(BENCH_TRANSFER_TARGETS_COUNT * 3);
+			std::vector<CMorphTargetsData> srcTargets(BENCH_TRANSFER_TARGETS_COUNT);
+			for (int t = 0; t < BENCH_TRANSFER_TARGETS_COUNT; ++t) {
+				for (int k = 0; k < 3; ++k) targetAxes[t * 3 + k] = sxsdk::vec3(random.nextSigned(), random.nextSigned(), random.nextSigned()) * 0.01f;
+				CMorphTargetsData& targetD = srcTargets[t];
+				char szName[64];
+				snprintf(szName, sizeof(szName), "transfer_%d", t);
+				targetD.name = szName;
+				targetD.vIndices.resize(srcCou);
+				targetD.vertices.resize(srcCou);
+				for (int i = 0; i < srcCou; ++i) {
+					const sxsdk::vec3& v = srcVertices[i];
+					targetD.vIndices[i] = i;
+					targetD.vertices[i] = v + targetAxes[t * 3 + 0] * v.x + targetAxes[t * 3 + 1] * v.y + targetAxes[t * 3 + 2] * v.z;
+				}
+			}
+
+			// 転送先は、転送元と同じ範囲を異なる間隔で分割し、凹凸の小さな乱数を除いた頂点.
+			sxsdk::vec3 bbMin, bbMax;
+			MathUtil::calcBoundingBox(srcVertices, bbMin, bbMax);
+			const int dstDivX = (int)((bbMax.x - bbMin.x) / BENCH_TRANSFER_GRID_SIZE) + 1;
+			const int dstDivY = (int)((bbMax.z - bbMin.z) / BENCH_TRANSFER_GRID_SIZE) + 1;
+			std::vector<sxsdk::vec3> dstVertices;
+			dstVertices.reserve((size_t)dstDivX * dstDivY);
+			for (int y = 0; y < dstDivY; ++y) {
+				for (int x = 0; x < dstDivX; ++x) {
+					const float px = bbMin.x + (float)x * BENCH_TRANSFER_GRID_SIZE;
+					const float pz = bbMin.z + (float)y * BENCH_TRANSFER_GRID_SIZE;
+					dstVertices.push_back(sxsdk::vec3(px, std::sin(px * 0.05f) * std::cos(pz * 0.05f) * 4.0f, pz));
+				}
+			}
+			const int dstCou = (int)dstVertices.size();
+
+			CBenchResult result;
+			result.caseName = "morph_transfer";
+			result.verticesCount = dstCou;
+			result.itemsCount = (long long)dstCou * BENCH_TRANSFER_TARGETS_COUNT;
+
+			std::vector<CMorphTargetsData> dstTargets;
+			CMorphTargetsTransferStats stats;
+			bool ret = true;
+			for (int loop = 0; loop < settings.repeat; ++loop) {
+				result.times.push_back(measureTime([&]() {
+					if (!MorphTargetsTransfer::transferMorphTargets(srcVertices, srcTriangles, srcTargets, dstVertices, sxsdk::mat4::identity, srcGridSize, dstTargets, stats)) ret = false;
+				}));
+			}
+			if ((int)dstTargets.size() != BENCH_TRANSFER_TARGETS_COUNT || stats.unmatchedCount != 0 || stats.targetsCount != BENCH_TRANSFER_TARGETS_COUNT) ret = false;
+			for (int t = 0; t < (int)dstTargets.size() && ret; ++t) {
+				const CMorphTargetsData& targetD = dstTargets[t];
+				const sxsdk::vec3* axes = &targetAxes[t * 3];
+				const float tolerance = (sxsdk::absolute(axes[0]) + sxsdk::absolute(axes[1]) + sxsdk::absolute(axes[2])) * stats.maxDistance + 2e-4f;
+				if ((int)targetD.vIndices.size() != dstCou || targetD.name != srcTargets[t].name || targetD.weight != 0.0f) ret = false;
+				for (int i = 0; i < (int)targetD.vIndices.size() && ret; ++i) {
+					const sxsdk::vec3& v = dstVertices[ targetD.vIndices[i] ];
+					const sxsdk::vec3 refDelta = axes[0] * v.x + axes[1] * v.y + axes[2] * v.z;
+					if (sxsdk::absolute(targetD.vertices[i] - v - refDelta) > tolerance) ret = false;
+				}
+				result.checksum = calcChecksum(targetD.vertices, result.checksum);
+			}
+			result.bytes = result.itemsCount * (long long)(sizeof(int) + sizeof(sxsdk::vec3));
+			if (!ret) result.valid = false;
+			results.push_back(result);
+		}
+
+		// 頂点の追加/削除後のMorph Targetsの対応付け直し.
+		// 先頭の行の頂点を削除し、次の行の四角形の中心に頂点を追加して4つの三角形に分割する.
+		// 残った頂点の移動量が変更前と一致し、追加された頂点の移動量が変更前の移動量の範囲内となるかを確認する.
+		{
+			sxsdk::scene_interface remapScene;
+			float remapGridSize = 1.0f;
+			sxsdk::polygon_mesh_class* pRemapMesh = createGridMesh(remapScene, std::min(versCou, BENCH_REMAP_MAX_VERTICES), settings.seed, remapGridSize);
+			CMorphTargetsCtrl remapCtrl;
+			setupMorphTargets(*pRemapMesh, settings.seed, remapCtrl);
+
+			// 先頭の行 (z = 0) の頂点のみを移動するTarget (削除後は移動する頂点がなくなる).
+			const std::vector<sxsdk::vec3>& oldOrgVertices = remapCtrl.getOrgVertices();
+			const int oldCou = (int)oldOrgVertices.size();
+			int rowCou = 0;
+			while (rowCou < oldCou && oldOrgVertices[rowCou].z == 0.0f) rowCou++;
+			{
+				std::vector<int> indices(rowCou);
+				std::vector<sxsdk::vec3> vertices(rowCou);
+				for (int i = 0; i < rowCou; ++i) {
+					indices[i]  = i;
+					vertices[i] = oldOrgVertices[i] + sxsdk::vec3(0.0f, 0.5f, 0.0f);
+				}
+				const int tIndex = remapCtrl.appendTargetVertices("remap_removed", indices, vertices);
+				remapCtrl.setTargetWeight(tIndex, 0.5f);
+			}
+			const int remapTargetsCou = remapCtrl.getTargetsCount();
+			const CMorphTargetsCtrl oldCtrl = remapCtrl;
+
+			// ウエイト値を反映した状態で、トポロジを変更する.
+			remapCtrl.updateMesh(&remapScene, false);
+			pRemapMesh->begin_removing_control_points();
+			for (int i = 0; i < rowCou; ++i) pRemapMesh->remove_control_point(i);
+			pRemapMesh->end_removing_control_points();
+			{
+				std::vector<sxsdk::face_class> faces;
+				for (size_t i = 0; i < pRemapMesh->faces.size(); ++i) {
+					const std::vector<int>& indices = pRemapMesh->faces[i].indices;
+					if (std::find(indices.begin(), indices.end(), -1) == indices.end()) faces.push_back(pRemapMesh->faces[i]);
+				}
+				pRemapMesh->faces.swap(faces);
+			}
+			const int keptCou = pRemapMesh->get_total_number_of_control_points();
+			for (int i = 0; i < rowCou - 1; ++i) {
+				const std::vector<int> quad = pRemapMesh->faces[i].indices;
+				sxsdk::vec3 center(0, 0, 0);
+				for (int j = 0; j < 4; ++j) center += pRemapMesh->vertex(quad[j]).position * 0.25f;
+				const int cIndex = pRemapMesh->get_total_number_of_control_points();
+				pRemapMesh->append_point(center);
+				for (int j = 0; j < 4; ++j) {
+					const int tri[3] = {quad[j], quad[(j + 1) % 4], cIndex};
+					if (j == 0) pRemapMesh->faces[i].set_vertex_indices(3, tri);
+					else pRemapMesh->append_face(3, tri);
+				}
+			}
+			const int newCou = pRemapMesh->get_total_number_of_control_points();
+			std::vector<sxsdk::vec3> remapMeshVertices;
+			getMeshVertices(*pRemapMesh, remapMeshVertices);
+
+			CBenchResult result;
+			result.caseName = "morph_remap";
+			result.verticesCount = newCou;
+			result.itemsCount = newCou;
+
+			bool ret = remapCtrl.isVerticesCountChanged();
+			CMorphTargetsCtrl newCtrl;
+			CMorphTargetsRemapStats stats;
+			for (int loop = 0; loop < settings.repeat; ++loop) {
+				newCtrl = remapCtrl;
+				result.times.push_back(measureTime([&]() {
+					if (!newCtrl.remapMeshVertices(&stats)) ret = false;
+				}));
+			}
+			if (stats.matchedCount != keptCou || stats.removedCount != rowCou || stats.interpolatedCount != newCou - keptCou) ret = false;
+			if (newCtrl.getTargetsCount() != remapTargetsCou || newCtrl.getOrgVerticesCount() != newCou || newCtrl.isVerticesCountChanged()) ret = false;
+
+			// Targetの番号と名前は変わらず、移動する頂点がなくなったTargetも残る.
+			const std::vector<sxsdk::vec3>& newOrgVertices = newCtrl.getOrgVertices();
+			for (int t = 0; t < remapTargetsCou && ret; ++t) {
+				const CMorphTargetsData& oldTarget = oldCtrl.getMorphTargetData(t);
+				const CMorphTargetsData& newTarget = newCtrl.getMorphTargetData(t);
+				if (newTarget.name != oldTarget.name || newTarget.weight != oldTarget.weight) ret = false;
+				if (t == remapTargetsCou - 1 && !newTarget.vIndices.empty()) ret = false;
+
+				std::vector<sxsdk::vec3> oldDeltas(oldCou, sxsdk::vec3(0, 0, 0));
+				std::vector<char> oldMoved(oldCou, 0);
+				float maxDelta = 0.0f;
+				for (size_t i = 0; i < oldTarget.vIndices.size(); ++i) {
+					const int vIndex = oldTarget.vIndices[i];
+					oldDeltas[vIndex] = oldTarget.vertices[i] - oldOrgVertices[vIndex];
+					oldMoved[vIndex]  = 1;
+					maxDelta = std::max(maxDelta, sxsdk::absolute(oldDeltas[vIndex]));
+				}
+				int keptMovedCou = 0;
+				for (int i = rowCou; i < oldCou; ++i) keptMovedCou += oldMoved[i];
+				for (size_t i = 0; i < newTarget.vIndices.size() && ret; ++i) {
+					const int vIndex = newTarget.vIndices[i];
+					const sxsdk::vec3 delta = newTarget.vertices[i] - newOrgVertices[vIndex];
+					if (vIndex < keptCou) {
+						if (!oldMoved[vIndex + rowCou] || sxsdk::absolute(delta - oldDeltas[vIndex + rowCou]) > 1e-5f) ret = false;
+						keptMovedCou--;
+					} else {
+						if (sxsdk::absolute(delta) > maxDelta + 1e-5f) ret = false;
+					}
+				}
+				if (keptMovedCou != 0) ret = false;
+			}
+
+			// 対応付け後のベースとウエイト値から、現在のメッシュの頂点が求まる.
+			if (ret) {
+				std::vector<sxsdk::vec3> vertices;
+				std::vector<char> useVertices;
+				if (!newCtrl.prepareUpdateMesh(false) || !newCtrl.calcMeshVertices(vertices, useVertices) || (int)vertices.size() != newCou) ret = false;
+				for (int i = 0; i < (int)vertices.size() && ret; ++i) {
+					if (sxsdk::absolute(vertices[i] - remapMeshVertices[i]) > 1e-4f) ret = false;
+				}
+			}
+
+			// streamに保存して読み込み直しても、移動する頂点がなくなったTargetが残る.
+			if (ret) {
+				StreamCtrl::writeMorphTargetsData(*pRemapMesh, newCtrl);
+				CMorphTargetsCtrl readCtrl;
+				if (!StreamCtrl::readMorphTargetsData(*pRemapMesh, readCtrl, true) || readCtrl.getTargetsCount() != remapTargetsCou) ret = false;
+				else if (readCtrl.getMorphTargetData(remapTargetsCou - 1).name != "remap_removed" || !readCtrl.getMorphTargetData(remapTargetsCou - 1).vIndices.empty()) ret = false;
+			}
+
+			// UNDOで、対応付け前のベースとTargetに戻る.
+			if (ret) {
+				CMorphTargetsUndoJournal journal;
+				journal.recordRemap(pRemapMesh->get_handle(), oldCtrl, newCtrl);
+				CMorphTargetsCtrl undoCtrl = newCtrl;
+				if (journal.undo(&remapScene, undoCtrl) != morph_undo_remap || undoCtrl.getOrgVerticesCount() != oldCou || undoCtrl.getMorphTargetData(remapTargetsCou - 1).vIndices.size() != (size_t)rowCou) ret = false;
+
+				// ウエイト値の変更でREDOの履歴が破棄され、メモリの上限を下げると古いものから破棄される.
+				journal.recordWeight(pRemapMesh->get_handle(), 0, 0.0f, 0.5f);
+				journal.recordWeight(pRemapMesh->get_handle(), 1, 0.0f, 0.5f);
+				const size_t weightsMemorySize = journal.getMemorySize();
+				journal.recordWeight(pRemapMesh->get_handle(), 1, 0.5f, 0.8f, true);
+				if (journal.canRedo() || journal.getMemorySize() != weightsMemorySize) ret = false;
+				journal.setMaxMemorySize(weightsMemorySize - 1);
+				if (!journal.canUndo() || journal.getMemorySize() > journal.getMaxMemorySize() || journal.getMemorySize() * 2 != weightsMemorySize) ret = false;
+			}
+
+			result.checksum = calcChecksum(newOrgVertices);
+			result.bytes = (long long)newCou * (long long)sizeof(sxsdk::vec3);
+			if (!ret) result.valid = false;
+			results.push_back(result);
+		}
+
+		// streamへの保存と読み込み (無圧縮/圧縮).
+		for (int encLoop = 0; encLoop < 2; ++encLoop) {
+			const MORPH_TARGETS_STREAM_ENCODING encoding = (encLoop == 0) ? morph_stream_encoding_raw : morph_stream_encoding_delta;
+			const char* caseSuffix = (encLoop == 0) ? "" : "_delta";
+			morphCtrl.setStreamEncoding(encoding);
+
+			// streamへの保存.
+			{
+				CBenchResult result;
+				result.caseName = std::string("stream_write") + caseSuffix;
+				result.verticesCount = versCou;
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					result.times.push_back(measureTime([&]() { StreamCtrl::writeMorphTargetsData(*pMesh, morphCtrl); }));
+				}
+				sxsdk::stream_interface* stream = pMesh->get_attribute_stream_interface_with_uuid(MORPH_TARGETS_STREAM_ID);
+				if (stream) {
+					result.bytes = stream->get_size();
+					std::vector<unsigned char> buff(stream->get_size());
+					stream->set_pointer(0);
+					if (!buff.empty()) stream->read((int)buff.size(), &buff[0]);
+
+					// 保存ごとに変わる値(ヘッダの2番目)は除外する.
+					if (buff.size() >= sizeof(int) * 2) memset(&buff[sizeof(int)], 0, sizeof(int));
+					result.checksum = calcChecksum(buff.empty() ? NULL : &buff[0], buff.size());
+				} else {
+					result.valid = false;
+				}
+				results.push_back(result);
+			}
+
+			// streamからの読み込み (すべての頂点を読み込む).
+			{
+				CBenchResult result;
+				result.caseName = std::string("stream_read") + caseSuffix;
+				result.verticesCount = versCou;
+				CMorphTargetsCtrl readCtrl;
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					result.times.push_back(measureTime([&]() { StreamCtrl::readMorphTargetsData(*pMesh, readCtrl, true); }));
+				}
+				sxsdk::stream_interface* stream = pMesh->get_attribute_stream_interface_with_uuid(MORPH_TARGETS_STREAM_ID);
+				if (stream) result.bytes = stream->get_size();
+
+				unsigned int hash = calcChecksum(readCtrl.getOrgVertices());
+				const int targetsCou = readCtrl.getTargetsCount();
+				for (int i = 0; i < targetsCou; ++i) {
+					const CMorphTargetsData& targetD = readCtrl.getMorphTargetData(i);
+					hash = calcChecksum(targetD.vertices, hash);
+					if (targetD.vIndices != morphCtrl.getMorphTargetData(i).vIndices) result.valid = false;
+					if (calcChecksum(targetD.vertices) != calcChecksum(morphCtrl.getMorphTargetData(i).vertices)) result.valid = false;
+				}
+				if (calcChecksum(readCtrl.getOrgVertices()) != calcChecksum(morphCtrl.getOrgVertices())) result.valid = false;
+				if (readCtrl.getStreamEncoding() != encoding) result.valid = false;
+				result.checksum = hash;
+				if (targetsCou != morphCtrl.getTargetsCount() || readCtrl.getOrgVertices().size() != morphCtrl.getOrgVertices().size()) result.valid = false;
+				results.push_back(result);
+			}
+		}
+
+		// streamからの読み込み (名前とウエイト値のみ。頂点は遅延読み込み).
+		{
+			CBenchResult result;
+			result.caseName = "stream_read_layout";
+			result.verticesCount = versCou;
+			CMorphTargetsCtrl readCtrl;
+			for (int loop = 0; loop < settings.repeat; ++loop) {
+				result.times.push_back(measureTime([&]() { StreamCtrl::readMorphTargetsData(*pMesh, readCtrl); }));
+			}
+			sxsdk::stream_interface* stream = pMesh->get_attribute_stream_interface_with_uuid(MORPH_TARGETS_STREAM_ID);
+			if (stream) result.bytes = stream->get_size();
+
+			const int targetsCou = readCtrl.getTargetsCount();
+			if (targetsCou != morphCtrl.getTargetsCount() || readCtrl.getOrgVerticesCount() != versCou) result.valid = false;
+			unsigned int hash = calcChecksum(&targetsCou, sizeof(targetsCou));
+			for (int i = 0; i < targetsCou && result.valid; ++i) {
+				if (readCtrl.getTargetName(i) != morphCtrl.getTargetName(i)) result.valid = false;
+				if (readCtrl.getTargetWeight(i) != morphCtrl.getTargetWeight(i)) result.valid = false;
+				if (readCtrl.getTargetVerticesCount(i) != morphCtrl.getTargetVerticesCount(i)) result.valid = false;
+				const float weight = readCtrl.getTargetWeight(i);
+				hash = calcChecksum(&weight, sizeof(float), hash);
+			}
+			if (!readCtrl.isLazyLoading()) result.valid = false;
+
+			// 遅延読み込みした頂点が、保存前と一致するか.
+			for (int i = 0; i < targetsCou && result.valid; ++i) {
+				const CMorphTargetsData& targetD = readCtrl.getMorphTargetData(i);
+				const CMorphTargetsData& srcTargetD = morphCtrl.getMorphTargetData(i);
+				if (targetD.vIndices != srcTargetD.vIndices || calcChecksum(targetD.vertices) != calcChecksum(srcTargetD.vertices)) result.valid = false;
+			}
+			if (calcChecksum(readCtrl.getOrgVertices()) != calcChecksum(morphCtrl.getOrgVertices()) || readCtrl.isLazyLoading()) result.valid = false;
+			result.checksum = hash;
+			results.push_back(result);
+		}
+
+		// Targetごとの移動量の統計の計算 (ベースの頂点座標を変更した後の、すべてのTargetの再計算).
+		// streamから遅延読み込み中の場合は、頂点を読み込まずに配置表の統計を参照できることも確認する.
+		{
+			CBenchResult result;
+			result.caseName = "morph_delta_stats";
+			result.verticesCount = versCou;
+			CMorphTargetsCtrl calcCtrl;
+			if (!StreamCtrl::readMorphTargetsData(*pMesh, calcCtrl, true)) result.valid = false;
+			const std::vector<sxsdk::vec3> orgVertices = morphCtrl.getOrgVertices();
+			const int targetsCou = calcCtrl.getTargetsCount();
+			for (int loop = 0; loop < settings.repeat; ++loop) {
+				result.times.push_back(measureTime([&]() {
+					calcCtrl.setOrgVertices(orgVertices);
+					for (int i = 0; i < targetsCou; ++i) calcCtrl.getTargetDeltaStats(i);
+				}));
+			}
+
+			CMorphTargetsCtrl readCtrl;
+			if (!StreamCtrl::readMorphTargetsData(*pMesh, readCtrl) || readCtrl.getTargetsCount() != targetsCou) result.valid = false;
+			unsigned int hash = calcChecksum(&targetsCou, sizeof(targetsCou));
+			for (int i = 0; i < targetsCou && result.valid; ++i) {
+				// 1頂点ずつ求めた値と一致するか.
+				const CMorphTargetsData& targetD = morphCtrl.getMorphTargetData(i);
+				sxsdk::vec3 dMin(0, 0, 0), dMax(0, 0, 0);
+				float maxLen2 = 0.0f;
+				int nonZeroCou = 0;
+				for (size_t j = 0; j < targetD.vIndices.size(); ++j) {
+					const sxsdk::vec3 d = targetD.vertices[j] - orgVertices[ targetD.vIndices[j] ];
+					if (j == 0) dMin = dMax = d;
+					dMin = sxsdk::vec3(std::min(dMin.x, d.x), std::min(dMin.y, d.y), std::min(dMin.z, d.z));
+					dMax = sxsdk::vec3(std::max(dMax.x, d.x), std::max(dMax.y, d.y), std::max(dMax.z, d.z));
+					maxLen2 = std::max(maxLen2, d.x * d.x + d.y * d.y + d.z * d.z);
+					if (d.x != 0.0f || d.y != 0.0f || d.z != 0.0f) nonZeroCou++;
+				}
+				const CMorphTargetsDeltaStats& stats = calcCtrl.getTargetDeltaStats(i);
+				if (stats.nonZeroCount != nonZeroCou || stats.deltaMin != dMin || stats.deltaMax != dMax) result.valid = false;
+				if (std::abs(stats.maxDeltaLength - std::sqrt(maxLen2)) > 1e-6f) result.valid = false;
+
+				// streamに保存された統計と一致するか.
+				const CMorphTargetsDeltaStats& layoutStats = readCtrl.getTargetDeltaStats(i);
+				if (layoutStats.nonZeroCount != stats.nonZeroCount || layoutStats.maxDeltaLength != stats.maxDeltaLength) result.valid = false;
+				if (layoutStats.deltaMin != stats.deltaMin || layoutStats.deltaMax != stats.deltaMax) result.valid = false;
+
+				hash = calcChecksum(&stats.deltaMin, sizeof(sxsdk::vec3), hash);
+				hash = calcChecksum(&stats.deltaMax, sizeof(sxsdk::vec3), hash);
+				hash = calcChecksum(&stats.maxDeltaLength, sizeof(float), hash);
+				hash = calcChecksum(&stats.nonZeroCount, sizeof(int), hash);
+			}
+			if (!readCtrl.isLazyLoading() || readCtrl.getTargetVerticesCount(0) <= 0) result.valid = false;
+			result.checksum = hash;
+			results.push_back(result);
+		}
+
+		// stream全体のCRC32Cの計算と、破損したstreamの検出.
+		{
+			CBenchResult result;
+			result.caseName = "stream_crc32c";
+			result.verticesCount = versCou;
+			sxsdk::stream_interface* stream = pMesh->get_attribute_stream_interface_with_uuid(MORPH_TARGETS_STREAM_ID);
+			std::vector<unsigned char> buff;
+			if (stream) {
+				buff.resize(stream->get_size());
+				stream->set_pointer(0);
+				if (!buff.empty()) stream->read((int)buff.size(), &buff[0]);
+
+				// 保存ごとに変わる値(ヘッダの2番目)は除外する.
+				if (buff.size() >= sizeof(int) * 2) memset(&buff[sizeof(int)], 0, sizeof(int));
+			}
+			result.bytes = (long long)buff.size();
+			unsigned int crc = 0;
+			for (int loop = 0; loop < settings.repeat; ++loop) {
+				result.times.push_back(measureTime([&]() { crc = buff.empty() ? 0 : StreamCodec::calcCRC32C(&buff[0], buff.size()); }));
+			}
+			result.checksum = crc;
+
+			// 最後のTargetの頂点座標を1バイト書き換えると、読み込みに失敗するか.
+			CMorphTargetsStreamLayout layout;
+			if (stream && StreamCtrl::readMorphTargetsLayout(*pMesh, layout) && layout.hasChecksum && layout.getTargetsCount() > 0) {
+				const int offset = layout.verticesOffsets.back() + layout.verticesSizes.back() / 2;
+				unsigned char c;
+				stream->set_pointer(offset);
+				stream->read(1, &c);
+				c ^= 0x01;
+				stream->set_pointer(offset);
+				stream->write(1, &c);
+
+				CMorphTargetsCtrl readCtrl;
+				if (!StreamCtrl::readMorphTargetsData(*pMesh, readCtrl) || readCtrl.loadAllVertices()) result.valid = false;
+
+				c ^= 0x01;
+				stream->set_pointer(offset);
+				stream->write(1, &c);
+				if (!StreamCtrl::readMorphTargetsData(*pMesh, readCtrl, true)) result.valid = false;
+			} else {
+				result.valid = false;
+			}
+			results.push_back(result);
+		}
+
+		// シーンのすべてのMorph Targetsのウエイト値の一時保持と復帰.
+		// Morph Targets情報を持たない形状を追加し、一覧からの取得でシーン全体を走査しないことを確認する.
+		{
+			CBenchResult result;
+			result.caseName = "morph_push_all_weight";
+			result.verticesCount = versCou;
+
+			sxsdk::part_class* pPart = scene.append_part(scene.get_shape(), "bench_shapes");
+			for (int i = 0; i < BENCH_SCENE_SHAPES_COUNT; ++i) {
+				sxsdk::polygon_mesh_class* pShape = scene.append_polygon_mesh(*pPart, "bench_shape");
+				pShape->append_point(sxsdk::vec3((float)i, 0.0f, 0.0f));
+			}
+
+			CMorphTargetsRegistry& registry = MorphTargetsRegistry::getRegistry();
+			registry.invalidate();
+			const int rescanCount = registry.getRescanCount();
+			for (int loop = 0; loop < settings.repeat; ++loop) {
+				result.times.push_back(measureTime([&]() {
+					morphCtrl.pushAllWeight(&scene, true);
+					morphCtrl.popAllWeight(&scene);
+				}));
+			}
+
+			// 一覧の走査は最初の1回のみで、Morph Targets情報を持つ形状のみが含まれるか.
+			if (registry.getRescanCount() != rescanCount + 1) result.valid = false;
+			const std::vector<CMorphTargetsShapeSummary>& shapes = registry.getShapes(&scene);
+			if (shapes.size() != 1 || shapes[0].shapeHandle != pMesh->get_handle()) {
+				result.valid = false;
+			} else {
+				if (shapes[0].targetsCount != morphCtrl.getTargetsCount() || shapes[0].orgVerticesCount != versCou) result.valid = false;
+				result.checksum = calcChecksum(&shapes[0].targetsCount, sizeof(int));
+				result.checksum = calcChecksum(&shapes[0].orgVerticesCount, sizeof(int), result.checksum);
+			}
+
+			// ウエイト値が元に戻っているか.
+			CMorphTargetsCtrl readCtrl;
+			if (!StreamCtrl::readMorphTargetsData(*pMesh, readCtrl) || readCtrl.getTargetsCount() != morphCtrl.getTargetsCount()) {
+				result.valid = false;
+			} else {
+				for (int i = 0; i < readCtrl.getTargetsCount(); ++i) {
+					if (readCtrl.getTargetWeight(i) != morphCtrl.getTargetWeight(i)) result.valid = false;
+				}
+			}
+
+			// 一覧にあるがstreamを読み込めない形状(壊れたstream、削除されたstream)は、上書きせずに一覧から除かれるか.
+			{
+				sxsdk::polygon_mesh_class* pBrokenShape  = scene.append_polygon_mesh(*pPart, "bench_broken_shape");
+				sxsdk::polygon_mesh_class* pRemovedShape = scene.append_polygon_mesh(*pPart, "bench_removed_shape");
+				const std::vector<unsigned char> brokenBuff(64, 0xff);
+				sxsdk::stream_interface* brokenStream = pBrokenShape->create_attribute_stream_interface_with_uuid(MORPH_TARGETS_STREAM_ID);
+				brokenStream->set_pointer(0);
+				brokenStream->write((int)brokenBuff.size(), &brokenBuff[0]);
+				registry.updateShape(*pBrokenShape, 1, 1);
+				registry.updateShape(*pRemovedShape, 1, 1);
+
+				morphCtrl.pushAllWeight(&scene, true);
+				morphCtrl.popAllWeight(&scene);
+
+				std::vector<unsigned char> buff(brokenStream->get_size());
+				brokenStream->set_pointer(0);
+				if (!buff.empty()) brokenStream->read((int)buff.size(), &buff[0]);
+				if (buff != brokenBuff || pRemovedShape->get_attribute_stream_interface_with_uuid(MORPH_TARGETS_STREAM_ID)) result.valid = false;
+				if (registry.getShapes(&scene).size() != 1) result.valid = false;
+				pBrokenShape->delete_attribute_with_uuid(MORPH_TARGETS_STREAM_ID);
+			}
+			results.push_back(result);
+		}
+
+		// 剛体変形したメッシュからの変換の推定.
+		{
+			CBenchResult result;
+			result.caseName = "calc_mesh_transform";
+			result.verticesCount = versCou;
+
+			const sxsdk::mat4 m = sxsdk::mat4::rotate(sxsdk::vec3(0, 1, 0), 0.3f) * sxsdk::mat4::translate(sxsdk::vec3(5.0f, 2.0f, -3.0f));
+			std::vector<sxsdk::vec3> vertices;
+			getMeshVertices(*pMesh, vertices);
+			for (int i = 0; i < versCou; ++i) pMesh->vertex(i).set_position(vertices[i] * m);
+
+			CCalcMeshTransform meshTransC;
+			bool ret = false;
+			for (int loop = 0; loop < settings.repeat; ++loop) {
+				result.times.push_back(measureTime([&]() { ret = meshTransC.calcMeshTransform(pMesh); }));
+			}
+
+			// Targetに含まれない頂点が、変換後の位置と一致するか.
+			const std::vector<sxsdk::vec3>& orgVertices = morphCtrl.getOrgVertices();
+			// calcMeshTransformでの回転角の収束判定(0.1度)に合わせて、メッシュの対角線長に比例した許容誤差とする.
+			const float diagonalLength = (float)std::sqrt(2.0 * (double)versCou) * gridSize;
+			const float tolerance = diagonalLength * (0.1f * sx::pi / 180.0f);
+			std::vector<sxsdk::vec3> transVertices;
+			for (int i = BENCH_TARGETS_COUNT; i < versCou; i += BENCH_TARGETS_STRIDE) {
+				const sxsdk::vec3 v = meshTransC.calcMeshPos(orgVertices[i]);
+				transVertices.push_back(v);
+				if (!MathUtil::isZero(v - orgVertices[i] * m, tolerance)) ret = false;
+			}
+			result.checksum = calcChecksum(transVertices);
+			if (!ret || !meshTransC.hasTransform()) result.valid = false;
+			results.push_back(result);
+		}
+
+		// シーン内のMorph Targets情報を持つ形状の一括更新 (スレッド数ごと).
+		// 頂点数を分割した複数の形状を別のシーンに作成し、形状ごとに順にupdateMeshした結果と一致するかを確認する.
+		{
+			sxsdk::scene_interface evalScene;
+			const int shapeVersCou = std::max(64, verticesCount / BENCH_SCENE_EVAL_SHAPES_COUNT);
+			std::vector<sxsdk::polygon_mesh_class *> meshes;
+			std::vector< std::vector<sxsdk::vec3> > orgVerticesList;
+			for (int i = 0; i < BENCH_SCENE_EVAL_SHAPES_COUNT; ++i) {
+				float size;
+				sxsdk::polygon_mesh_class* pShape = createGridMesh(evalScene, shapeVersCou, settings.seed + (unsigned int)i, size);
+				CMorphTargetsCtrl shapeCtrl;
+				setupMorphTargets(*pShape, settings.seed + (unsigned int)i, shapeCtrl);
+				StreamCtrl::writeMorphTargetsData(*pShape, shapeCtrl);
+				meshes.push_back(pShape);
+				orgVerticesList.push_back(shapeCtrl.getOrgVertices());
+			}
+			CMorphTargetsRegistry& registry = MorphTargetsRegistry::getRegistry();
+			registry.invalidate();
+
+			// ベースの頂点座標に戻す.
+			std::function<void ()> resetMeshes = [&]() {
+				for (size_t i = 0; i < meshes.size(); ++i) {
+					const std::vector<sxsdk::vec3>& vertices = orgVerticesList[i];
+					for (size_t j = 0; j < vertices.size(); ++j) meshes[i]->vertex((int)j).set_position(vertices[j]);
+				}
+			};
+			std::function<unsigned int ()> calcMeshesChecksum = [&]() {
+				unsigned int hash = 2166136261u;
+				std::vector<sxsdk::vec3> vertices;
+				for (size_t i = 0; i < meshes.size(); ++i) {
+					getMeshVertices(*meshes[i], vertices);
+					hash = calcChecksum(vertices, hash);
+				}
+				return hash;
+			};
+
+			// 形状ごとに順に更新した結果.
+			resetMeshes();
+			for (size_t i = 0; i < meshes.size(); ++i) {
+				CMorphTargetsCtrl shapeCtrl;
+				StreamCtrl::readMorphTargetsData(*meshes[i], shapeCtrl);
+				shapeCtrl.updateMesh(&evalScene, false);
+			}
+			const unsigned int refChecksum = calcMeshesChecksum();
+
+			const int maxThreadsCou = ParallelUtil::getThreadsCount();
+			for (int threadsCou = 1; ; threadsCou = std::min(threadsCou * 2, maxThreadsCou)) {
+				ParallelUtil::setMaxThreadsCount(threadsCou);
+
+				CBenchResult result;
+				char szName[64];
+				snprintf(szName, sizeof(szName), "morph_scene_eval_t%d", threadsCou);
+				result.caseName = szName;
+				result.verticesCount = versCou;
+
+				CMorphTargetsSceneEvalStats stats;
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					resetMeshes();
+					result.times.push_back(measureTime([&]() { MorphTargetsSceneEval::updateSceneMeshes(&evalScene, false, &stats); }));
+				}
+				result.checksum = calcMeshesChecksum();
+				if (result.checksum != refChecksum) result.valid = false;
+				if (stats.shapesCount != BENCH_SCENE_EVAL_SHAPES_COUNT || stats.updatedCount != BENCH_SCENE_EVAL_SHAPES_COUNT) result.valid = false;
+				if (stats.threadsCount != std::min(threadsCou, BENCH_SCENE_EVAL_SHAPES_COUNT)) result.valid = false;
+				results.push_back(result);
+
+				if (threadsCou >= maxThreadsCou) break;
+			}
+			ParallelUtil::setMaxThreadsCount(settings.threads);
+			registry.invalidate();
+		}
+
+		// ボーンサイズの自動調整とボーンの向きをそろえる処理 (頂点数の1/10のボーン数).
+		// 形状ごとにBoneUtil::getBoneCenterを呼ぶ再帰での結果と一致するかを確認する.
+		{
+			sxsdk::scene_interface boneScene;
+			std::vector<sxsdk::part_class *> bones;
+			const int bonesCou = std::max(64, std::min(verticesCount / 10, 20000));
+			sxsdk::part_class* pBoneRoot = createBoneRig(boneScene, bonesCou, settings.seed, bones);
+
+			std::vector<float> refSizes(bonesCou);
+			std::vector<sxsdk::vec3> refAxisDirs(bonesCou);
+			std::function<void ()> resetBones = [&]() {
+				for (int i = 0; i < bonesCou; ++i) {
+					bones[i]->bone.size = 1.0f;
+					bones[i]->bone.axis_dir = sxsdk::vec3(1, 0, 0);
+				}
+			};
+			resetBones();
+			resizeBonesRecursive(*pBoneRoot, NULL);
+			adjustBonesDirectionRecursive(*pBoneRoot);
+			for (int i = 0; i < bonesCou; ++i) {
+				refSizes[i] = bones[i]->bone.size;
+				refAxisDirs[i] = bones[i]->bone.axis_dir;
+			}
+
+			// 行列の掛ける順が異なるため、誤差を許容して比較する.
+			const float tolerance = 1e-4f;
+			{
+				CBenchResult result;
+				result.caseName = "bone_resize";
+				result.verticesCount = bonesCou;
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					resetBones();
+					result.times.push_back(measureTime([&]() { BoneUtil::resizeBones(pBoneRoot); }));
+				}
+				for (int i = 0; i < bonesCou; ++i) {
+					const float size = bones[i]->bone.size;
+					if (std::abs(size - refSizes[i]) > tolerance * std::max(1.0f, std::abs(refSizes[i]))) result.valid = false;
+					result.checksum = calcChecksum(&size, sizeof(size), result.checksum);
+				}
+				results.push_back(result);
+			}
+			{
+				CBenchResult result;
+				result.caseName = "bone_adjust_direction";
+				result.verticesCount = bonesCou;
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					resetBones();
+					result.times.push_back(measureTime([&]() { BoneUtil::adjustBonesDirection(pBoneRoot); }));
+				}
+				std::vector<sxsdk::vec3> axisDirs(bonesCou);
+				for (int i = 0; i < bonesCou; ++i) {
+					axisDirs[i] = bones[i]->bone.axis_dir;
+					if (!MathUtil::isZero(axisDirs[i] - refAxisDirs[i], tolerance)) result.valid = false;
+				}
+				result.checksum = calcChecksum(axisDirs);
+				results.push_back(result);
+			}
+
+			// ボーン階層の一括取得 (作成順が親から子の順と同じため、形状ごとのgetBoneCenterと比較する).
+			{
+				CBenchResult result;
+				result.caseName = "bone_hierarchy_query";
+				result.verticesCount = bonesCou;
+
+				std::vector<void *> handles(bonesCou);
+				std::vector<int> parents(bonesCou);
+				std::vector<sxsdk::vec3> centers(bonesCou);
+				std::vector<float> sizes(bonesCou);
+				std::vector<sxsdk::vec3> axisDirs(bonesCou);
+				int retCou = 0;
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					result.times.push_back(measureTime([&]() {
+						retCou = BoneUtil::getBonesHierarchy(pBoneRoot, bonesCou, &handles[0], &parents[0], &centers[0], &sizes[0], &axisDirs[0]);
+					}));
+				}
+				if (retCou != bonesCou || BoneUtil::getBonesHierarchy(pBoneRoot, 0, NULL, NULL, NULL, NULL, NULL) != bonesCou) result.valid = false;
+				for (int i = 0; i < bonesCou && result.valid; ++i) {
+					float size = 0.0f;
+					const sxsdk::vec3 center = BoneUtil::getBoneCenter(*bones[i], &size);
+					const sxsdk::shape_class* pParent = bones[i]->get_dad();
+					if (handles[i] != bones[i]->get_handle()) result.valid = false;
+					if (i == 0 ? (parents[i] != -1) : (parents[i] < 0 || bones[parents[i]] != pParent)) result.valid = false;
+					if (!MathUtil::isZero(centers[i] - center, tolerance * std::max(1.0f, absolute(center)))) result.valid = false;
+					if (sizes[i] != size || !MathUtil::isZero(absolute(axisDirs[i]) - 1.0f, tolerance)) result.valid = false;
+				}
+				result.checksum = calcChecksum(centers);
+				result.checksum = calcChecksum(axisDirs, result.checksum);
+				results.push_back(result);
+			}
+		}
+
+		// スキン変形 (Morph Targetsで変形した頂点座標を入力とする).
+		// 行列の線形補間は頂点ごとに行列を掛けて合計した結果、デュアルクォータニオンは1つのボーンの影響のみを持つ頂点で行列を掛けた結果と比較する.
+		{
+			std::vector<sxsdk::vec3> morphVertices;
+			std::vector<char> useVertices;
+			const bool morphF = morphCtrl.prepareUpdateMesh(false) && morphCtrl.calcMeshVertices(morphVertices, useVertices) && (int)morphVertices.size() == versCou;
+			if (!morphF) morphVertices = meshVertices;
+
+			sxsdk::scene_interface skinScene;
+			CSkinInfluences influences;
+			sxsdk::part_class* pSkinRoot = createSkinRig(skinScene, morphVertices, influences);
+			CBoneSkeleton skeleton;
+			skeleton.build(pSkinRoot);
+			std::vector<sxsdk::mat4> skinMatrices;
+			SkinDeform::calcSkinningMatrices(skeleton, skinMatrices);
+
+			const std::vector<sxsdk::vec3> normals(versCou, sxsdk::vec3(0, 1, 0));
+			const float tolerance = 1e-3f;
+			std::vector<sxsdk::vec3> linearVertices;
+
+			const SKIN_DEFORM_TYPE types[3] = {skin_deform_linear, skin_deform_dual_quaternion, skin_deform_linear};
+			const char* caseNames[3] = {"skin_lbs", "skin_dqs", "skin_lbs_fixed4"};
+			CSkinInfluences fixedInfluences;
+			influences.toFixed(4, fixedInfluences);
+			for (int loop2 = 0; loop2 < 3; ++loop2) {
+				CBenchResult result;
+				result.caseName = caseNames[loop2];
+				result.verticesCount = versCou;
+				const CSkinInfluences& srcInfluences = (loop2 == 2) ? fixedInfluences : influences;
+
+				std::vector<sxsdk::vec3> dstVertices, dstNormals;
+				bool ret = morphF && skeleton.getBonesCount() == BENCH_SKIN_JOINTS_COUNT;
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					result.times.push_back(measureTime([&]() {
+						if (!SkinDeform::deformVertices(types[loop2], skinMatrices, srcInfluences, morphVertices, dstVertices, &normals, &dstNormals)) ret = false;
+					}));
+				}
+				// 行列の線形補間での頂点の位置.
+				auto calcLinearPosition = [&](const sxsdk::vec3& v, const int iBegin, const int iEnd) -> sxsdk::vec3 {
+					float rest = 1.0f;
+					sxsdk::vec3 pos(0, 0, 0);
+					for (int j = iBegin; j < iEnd; ++j) {
+						pos = pos + (v * skinMatrices[ influences.jointIndices[j] ]) * influences.weights[j];
+						rest -= influences.weights[j];
+					}
+					return pos + v * rest;
+				};
+				for (int i = 0; i < versCou && ret; ++i) {
+					const sxsdk::vec3& v = morphVertices[i];
+					const int iBegin = influences.getBegin(i);
+					const int iEnd   = influences.getEnd(i);
+					sxsdk::vec3 refV = v;
+					if (types[loop2] == skin_deform_linear) {
+						refV = calcLinearPosition(v, iBegin, iEnd);
+
+						// 法線は、面に沿った2方向(X/Z)を変形した向きと垂直であるか.
+						const sxsdk::vec3 tangentX = calcLinearPosition(v + sxsdk::vec3(1, 0, 0), iBegin, iEnd) - refV;
+						const sxsdk::vec3 tangentZ = calcLinearPosition(v + sxsdk::vec3(0, 0, 1), iBegin, iEnd) - refV;
+						if (std::abs(sx::inner_product(dstNormals[i], tangentX)) > tolerance * std::max(1.0f, absolute(tangentX))) ret = false;
+						if (std::abs(sx::inner_product(dstNormals[i], tangentZ)) > tolerance * std::max(1.0f, absolute(tangentZ))) ret = false;
+					} else if (iEnd - iBegin == 1) {
+						refV = v * skinMatrices[ influences.jointIndices[iBegin] ];
+					} else if (iEnd - iBegin > 1) {
+						refV = dstVertices[i];
+					}
+					if (!MathUtil::isZero(dstVertices[i] - refV, tolerance * std::max(1.0f, absolute(refV)))) ret = false;
+					if (!MathUtil::isZero(absolute(dstNormals[i]) - 1.0f, tolerance)) ret = false;
+				}
+
+				// 固定形式(4影響)での結果は、CSR形式と一致するか.
+				if (loop2 == 0) linearVertices = dstVertices;
+
+				// 不均一なスケールを持つ行列の線形補間で、法線が面に沿った2方向(X/Z)を変形した向きと垂直であるか.
+				if (loop2 == 0 && ret) {
+					std::vector<sxsdk::mat4> scaleMatrices;
+					scaleMatrices.push_back(sxsdk::mat4::scale(sxsdk::vec3(2.0f, 0.5f, 1.0f)) * sxsdk::mat4::rotate(sxsdk::vec3(1, 0, 0), 0.7f));
+					scaleMatrices.push_back(sxsdk::mat4::scale(sxsdk::vec3(0.5f, 1.5f, 3.0f)) * sxsdk::mat4::rotate(sxsdk::vec3(0, 0, 1), -0.4f));
+					const int scaleJoints[2] = {0, 1};
+					const float scaleWeights[2] = {0.6f, 0.4f};
+					CSkinInfluences scaleInfluences;
+					for (int i = 0; i < 3; ++i) scaleInfluences.appendVertex(2, scaleJoints, scaleWeights);
+
+					std::vector<sxsdk::vec3> scaleVertices, scaleDstVertices, scaleDstNormals;
+					scaleVertices.push_back(sxsdk::vec3(0, 0, 0));
+					scaleVertices.push_back(sxsdk::vec3(1, 0, 0));
+					scaleVertices.push_back(sxsdk::vec3(0, 0, 1));
+					const std::vector<sxsdk::vec3> scaleNormals(3, sxsdk::vec3(0, 1, 0));
+					if (!SkinDeform::deformVertices(skin_deform_linear, scaleMatrices, scaleInfluences, scaleVertices, scaleDstVertices, &scaleNormals, &scaleDstNormals)) {
+						ret = false;
+					} else {
+						const sxsdk::vec3 tangentX = normalize(scaleDstVertices[1] - scaleDstVertices[0]);
+						const sxsdk::vec3 tangentZ = normalize(scaleDstVertices[2] - scaleDstVertices[0]);
+						if (std::abs(sx::inner_product(scaleDstNormals[0], tangentX)) > tolerance) ret = false;
+						if (std::abs(sx::inner_product(scaleDstNormals[0], tangentZ)) > tolerance) ret = false;
+					}
+				}
+				if (loop2 == 2 && dstVertices != linearVertices) ret = false;
+
+				result.checksum = calcChecksum(dstVertices);
+				result.checksum = calcChecksum(dstNormals, result.checksum);
+				if (!ret) result.valid = false;
+				results.push_back(result);
+			}
+
+			// スキンのウエイト値の読み込みと、4影響への制限/正規化/セットの共有.
+			// 4つのボーンの影響を持つ頂点には、ウエイト値0.02のバインドを2つ追加して省かれることを確認する.
+			{
+				CBenchResult result;
+				result.caseName = "skin_weights_read";
+				result.verticesCount = versCou;
+
+				sxsdk::polygon_mesh_class* pSkinMesh = skinScene.append_polygon_mesh(skinScene.get_shape(), "bench_skin_mesh");
+				pSkinMesh->skinType = sxsdk::enums::classic_skin;
+				const float extraWeight = 0.02f;
+				for (int i = 0; i < versCou; ++i) {
+					pSkinMesh->append_point(morphVertices[i]);
+					sxsdk::skin_class& skin = pSkinMesh->vertex(i).get_skin();
+					const int iEnd = influences.getEnd(i);
+					for (int j = influences.getBegin(i); j < iEnd; ++j) {
+						sxsdk::skin_bind_class bind;
+						bind.shape  = skeleton.getShape(influences.jointIndices[j]);
+						bind.weight = influences.weights[j] * ((iEnd - influences.getBegin(i) == 4) ? (1.0f - extraWeight * 2.0f) : 1.0f);
+						skin.binds.push_back(bind);
+					}
+					if (iEnd - influences.getBegin(i) == 4) {
+						for (int j = 0; j < 2; ++j) {
+							sxsdk::skin_bind_class bind;
+							bind.shape  = skeleton.getShape((i + j * 7) % BENCH_SKIN_JOINTS_COUNT);
+							bind.weight = extraWeight;
+							skin.binds.push_back(bind);
+						}
+					}
+				}
+
+				CSkinWeightOptions options;
+				options.maxInfluences  = 4;
+				options.normalizeToOne = true;
+				options.mergeTolerance = 0.001f;
+				CSkinWeightTable table;
+				CSkinWeightStats stats;
+				bool ret = true;
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					result.times.push_back(measureTime([&]() {
+						if (!SkinWeights::readSkinWeights(*pSkinMesh, options, table, &stats, &skeleton)) ret = false;
+					}));
+				}
+				result.bytes = stats.tableBytes;
+
+				// ボーン番号はスナップショットと同じで、省いたウエイト値(0.02 x 2 を4影響に割り振った分を含む)以内の誤差となるか.
+				if (stats.verticesCount != versCou || stats.jointsCount != BENCH_SKIN_JOINTS_COUNT || stats.prunedCount <= 0) ret = false;
+				if (stats.setsCount >= versCou || stats.tableBytes >= stats.sourceBytes) ret = false;
+				if (stats.maxWeightError <= 0.0f || stats.maxWeightError > extraWeight * 2.0f + options.mergeTolerance) ret = false;
+				CSkinInfluences tableInfluences;
+				table.toInfluences(tableInfluences);
+				for (int i = 0; i < versCou && ret; ++i) {
+					float sumW = 0.0f;
+					const int iEnd = tableInfluences.getEnd(i);
+					for (int j = tableInfluences.getBegin(i); j < iEnd; ++j) sumW += tableInfluences.weights[j];
+					if ((iEnd - tableInfluences.getBegin(i)) > options.maxInfluences) ret = false;
+					if (i % 97 == 0 ? (iEnd != tableInfluences.getBegin(i)) : !MathUtil::isZero(sumW - 1.0f, 1e-4f)) ret = false;
+				}
+				result.checksum = calcChecksum(&table.jointIndices[0], table.jointIndices.size() * sizeof(unsigned short));
+				result.checksum = calcChecksum(&table.weights[0], table.weights.size() * sizeof(unsigned short), result.checksum);
+				result.checksum = calcChecksum(&table.vertexSets[0], table.vertexSets.size() * sizeof(int), result.checksum);
+				if (!ret) result.valid = false;
+				results.push_back(result);
+			}
+		}
+
+		// キーフレームからのポーズの計算 (頂点数の1/100の時間の数).
+		// キーフレーム位置ではmat4::rotateで計算した変換行列を親から掛けた結果、ベイクは1つずつ計算した結果と比較する.
+		{
+			sxsdk::scene_interface fkScene;
+			std::vector<sxsdk::part_class *> bones;
+			createBoneRig(fkScene, BENCH_FK_JOINTS_COUNT, settings.seed, bones);
+			CBoneSkeleton skeleton;
+			skeleton.build(bones[0]);
+
+			// 最後のジョイントはキーフレームを持たない (シーケンスOff時の姿勢のまま).
+			CBenchRandom random(settings.seed ^ 0x27d4eb2fu);
+			MotionUtil::CMotionGroup motionGroup;
+			std::vector<sxsdk::vec3> keyAxes(BENCH_FK_JOINTS_COUNT * BENCH_FK_KEYS_COUNT);
+			std::vector<float> keyAngles(BENCH_FK_JOINTS_COUNT * BENCH_FK_KEYS_COUNT);
+			for (int i = 0; i < BENCH_FK_JOINTS_COUNT - 1; ++i) {
+				motionGroup.shapes.push_back(bones[i]);
+				motionGroup.jointKeyFrames.push_back(std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>());
+				for (int k = 0; k < BENCH_FK_KEYS_COUNT; ++k) {
+					const int keyIndex = i * BENCH_FK_KEYS_COUNT + k;
+					keyAxes[keyIndex] = normalize(sxsdk::vec3(random.nextSigned(), random.nextSigned(), 1.0f));
+					keyAngles[keyIndex] = random.nextSigned() * 0.8f;
+					const float s = std::sin(keyAngles[keyIndex] * 0.5f);
+					MotionUtil::CMotionGroupKeyFrameBallBoneJoint key;
+					key.type = MotionUtil::keyframe_type_ball_bone_joint;
+					key.timeSec = (float)k / 30.0f;
+					key.offset = sxsdk::vec3(random.nextSigned(), random.nextSigned(), random.nextSigned()) * 0.1f;
+					key.rotation.x = keyAxes[keyIndex].x * s;
+					key.rotation.y = keyAxes[keyIndex].y * s;
+					key.rotation.z = keyAxes[keyIndex].z * s;
+					key.rotation.w = std::cos(keyAngles[keyIndex] * 0.5f);
+					motionGroup.jointKeyFrames.back().push_back(key);
+				}
+			}
+			CMotionFKTracks tracks;
+			const int keyJointsCou = MotionFK::setupTracks(motionGroup, skeleton, tracks);
+
+			const int framesCou = std::max(60, std::min(verticesCount / 100, 5000));
+			std::vector<float> times(framesCou);
+			const float endTime = (float)(BENCH_FK_KEYS_COUNT - 1) / 30.0f;
+			for (int f = 0; f < framesCou; ++f) times[f] = endTime * (float)f / (float)(framesCou - 1);
+
+			const float tolerance = 1e-4f;
+			std::function<bool (const sxsdk::mat4&, const sxsdk::mat4&)> isSameMatrix = [&](const sxsdk::mat4& a, const sxsdk::mat4& b) {
+				for (int i = 0; i < 4; ++i) {
+					for (int j = 0; j < 4; ++j) {
+						if (std::abs(a[i][j] - b[i][j]) > tolerance * std::max(1.0f, std::abs(b[i][j]))) return false;
+					}
+				}
+				return true;
+			};
+
+			std::vector<sxsdk::mat4> evalMatrices((size_t)framesCou * BENCH_FK_JOINTS_COUNT);
+			{
+				CBenchResult result;
+				result.caseName = "motion_fk_eval";
+				result.verticesCount = framesCou;
+				result.bytes = (long long)tracks.keyTimes.size() * (long long)(sizeof(float) * 8);
+				bool ret = (keyJointsCou == BENCH_FK_JOINTS_COUNT - 1);
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					CMotionFKPose pose;
+					result.times.push_back(measureTime([&]() {
+						for (int f = 0; f < framesCou; ++f) {
+							MotionFK::evaluate(tracks, times[f], pose);
+							std::copy(pose.worldMatrices.begin(), pose.worldMatrices.end(), evalMatrices.begin() + (size_t)f * BENCH_FK_JOINTS_COUNT);
+						}
+					}));
+				}
+
+				// キーフレーム位置では、補間方法によらずキーフレームの値となる.
+				const int checkKeys[3] = {0, BENCH_FK_KEYS_COUNT / 3, BENCH_FK_KEYS_COUNT - 1};
+				for (int loop2 = 0; loop2 < 2 && ret; ++loop2) {
+					CMotionFKPose pose;
+					for (int c = 0; c < 3 && ret; ++c) {
+						const int k = checkKeys[c];
+						MotionFK::evaluate(tracks, (float)k / 30.0f, pose, (loop2 == 0) ? motion_rotation_nlerp : motion_rotation_slerp);
+						std::vector<sxsdk::mat4> refWorldMatrices(BENCH_FK_JOINTS_COUNT);
+						for (int i = 0; i < BENCH_FK_JOINTS_COUNT && ret; ++i) {
+							sxsdk::mat4 m = skeleton.getLocalMatrices()[i];
+							if (i < BENCH_FK_JOINTS_COUNT - 1) {
+								const int keyIndex = i * BENCH_FK_KEYS_COUNT + k;
+								m = sxsdk::mat4::rotate(keyAxes[keyIndex], keyAngles[keyIndex]) * sxsdk::mat4::translate(motionGroup.jointKeyFrames[i][k].offset) * m;
+							}
+							const int parentIndex = skeleton.getParents()[i];
+							refWorldMatrices[i] = m * ((parentIndex >= 0) ? refWorldMatrices[parentIndex] : skeleton.getRootLocalToWorldMatrix());
+							if (!isSameMatrix(pose.worldMatrices[i], refWorldMatrices[i])) ret = false;
+						}
+					}
+
+					// キーフレームの間では、補間したRotation値は正規化されている.
+					MotionFK::evaluate(tracks, 0.5f / 30.0f, pose, (loop2 == 0) ? motion_rotation_nlerp : motion_rotation_slerp);
+					for (int i = 0; i < BENCH_FK_JOINTS_COUNT && ret; ++i) {
+						const sxsdk::quaternion_class& q = pose.rotations[i];
+						if (std::abs(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w - 1.0f) > tolerance) ret = false;
+					}
+				}
+				result.checksum = calcChecksum(evalMatrices);
+				if (!ret) result.valid = false;
+				results.push_back(result);
+			}
+			{
+				CBenchResult result;
+				result.caseName = "motion_fk_bake";
+				result.verticesCount = framesCou;
+				std::vector<sxsdk::mat4> bakeMatrices;
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					result.times.push_back(measureTime([&]() { MotionFK::evaluateFrames(tracks, times, bakeMatrices); }));
+				}
+				result.bytes = (long long)bakeMatrices.size() * (long long)sizeof(sxsdk::mat4);
+				result.checksum = calcChecksum(bakeMatrices);
+				if (bakeMatrices.size() != evalMatrices.size() || result.checksum != calcChecksum(evalMatrices)) result.valid = false;
+				results.push_back(result);
+			}
+
+			// モーションキャプチャのように、毎フレーム(1/30秒間隔)にキーフレームを持つMotionGroup.
+			sxsdk::polygon_mesh_class* pMotionMesh = fkScene.append_polygon_mesh(fkScene.get_shape(), "bench_motion_mesh");
+			MotionUtil::CMotionGroup mocapGroup;
+			for (int i = 0; i < BENCH_FK_JOINTS_COUNT; ++i) {
+				mocapGroup.shapes.push_back(bones[i]);
+				mocapGroup.jointKeyFrames.push_back(std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>(framesCou));
+				for (int f = 0; f < framesCou; ++f) {
+					const float t = (float)f / 30.0f;
+					const float angle = 0.6f * std::sin(t * (0.5f + 0.1f * (float)(i % 5)) + (float)i) + random.nextSigned() * 1e-4f;
+					const sxsdk::vec3 axis = normalize(sxsdk::vec3(std::sin(t * 0.3f + (float)i), 1.0f, std::cos(t * 0.2f)));
+					MotionUtil::CMotionGroupKeyFrameBallBoneJoint& key = mocapGroup.jointKeyFrames[i][f];
+					key.type = MotionUtil::keyframe_type_ball_bone_joint;
+					key.timeSec = t;
+					key.offset = sxsdk::vec3(0.05f * std::sin(t * 2.0f + (float)i), 0.0f, (i % 3 == 0) ? 0.02f : random.nextSigned() * 1e-4f);
+					key.rotation.x = axis.x * std::sin(angle * 0.5f);
+					key.rotation.y = axis.y * std::sin(angle * 0.5f);
+					key.rotation.z = axis.z * std::sin(angle * 0.5f);
+					key.rotation.w = std::cos(angle * 0.5f);
+				}
+			}
+			for (int i = 0; i < BENCH_MOCAP_MORPH_TRACKS_COUNT; ++i) {
+				mocapGroup.morphShapes.push_back(pMotionMesh);
+				mocapGroup.morphTargetIndices.push_back(i);
+				mocapGroup.morphKeyFrames.push_back(std::vector<MotionUtil::CMotionGroupKeyFrameMorphTargets>(framesCou));
+				for (int f = 0; f < framesCou; ++f) {
+					MotionUtil::CMotionGroupKeyFrameMorphTargets& key = mocapGroup.morphKeyFrames[i][f];
+					key.type = MotionUtil::keyframe_type_morph_targets;
+					key.timeSec = (float)f / 30.0f;
+					key.weight = (i % 4 == 0) ? ((f / 45) % 2 ? 1.0f : 0.0f) : (0.5f + 0.5f * std::sin(key.timeSec * (0.5f + 0.1f * (float)i)));
+				}
+			}
+
+			// キーフレームの削減.
+			// 削減前のキーフレームの時間で、削減後のトラックからの値が許容誤差以内となるかを確認する.
+			{
+				CBenchResult result;
+				result.caseName = "motion_reduce";
+				result.verticesCount = framesCou;
+
+				CMotionReduceOptions options;
+				options.offsetTolerance   = 0.001f;
+				options.rotationTolerance = 0.005f;
+				options.weightTolerance   = 0.002f;
+				MotionUtil::CMotionGroup group;
+				CMotionReduceReport report;
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					group = mocapGroup;
+					result.times.push_back(measureTime([&]() { MotionReduce::reduceKeyFrames(group, options, &report); }));
+				}
+				result.bytes = (long long)report.keysCount * (long long)sizeof(MotionUtil::CMotionGroupKeyFrameBallBoneJoint);
+
+				const int srcKeysCou = (BENCH_FK_JOINTS_COUNT + BENCH_MOCAP_MORPH_TRACKS_COUNT) * framesCou;
+				bool ret = (report.sourceKeysCount == srcKeysCou && report.keysCount * 2 < srcKeysCou);
+				if (report.maxOffsetError > options.offsetTolerance || report.maxRotationError > options.rotationTolerance || report.maxWeightError > options.weightTolerance) ret = false;
+
+				// MotionFK::evaluateと同じ計算で再現されるため、計算順の違いによる誤差のみを許容する.
+				CMotionFKTracks srcTracks, reducedTracks;
+				MotionFK::setupTracks(mocapGroup, skeleton, srcTracks);
+				MotionFK::setupTracks(group, skeleton, reducedTracks);
+				CMotionFKPose srcPose, reducedPose;
+				for (int f = 0; f < framesCou && ret; ++f) {
+					const float t = (float)f / 30.0f;
+					MotionFK::evaluate(srcTracks, t, srcPose);
+					MotionFK::evaluate(reducedTracks, t, reducedPose);
+					for (int i = 0; i < BENCH_FK_JOINTS_COUNT && ret; ++i) {
+						if (sxsdk::distance3(srcPose.offsets[i], reducedPose.offsets[i]) > options.offsetTolerance + 1e-5f) ret = false;
+						if (MathUtil::getRotationAngle(srcPose.rotations[i], reducedPose.rotations[i]) > options.rotationTolerance + 1e-5f) ret = false;
+					}
+					for (int i = 0; i < BENCH_MOCAP_MORPH_TRACKS_COUNT && ret; ++i) {
+						const float w = MotionUtil::evaluateMorphWeight(group.morphKeyFrames[i], t);
+						if (std::abs(w - mocapGroup.morphKeyFrames[i][f].weight) > options.weightTolerance + 1e-5f) ret = false;
+					}
+				}
+
+				result.checksum = calcChecksum(&report.keysCount, sizeof(report.keysCount));
+				for (int i = 0; i < BENCH_FK_JOINTS_COUNT; ++i) {
+					for (size_t k = 0; k < group.jointKeyFrames[i].size(); ++k) result.checksum = calcChecksum(&group.jointKeyFrames[i][k].timeSec, sizeof(float), result.checksum);
+				}
+				if (!ret) result.valid = false;
+				results.push_back(result);
+			}
+
+			// MotionGroup情報のstreamへの保存と読み込み.
+			// 量子化の誤差(Offset値とウエイト値はトラックの範囲の1/65535、Rotation値は15bit)以内で復元されるかを確認する.
+			{
+				CBenchResult writeResult, readResult;
+				writeResult.caseName = "motion_stream_write";
+				readResult.caseName  = "motion_stream_read";
+				writeResult.verticesCount = readResult.verticesCount = framesCou;
+
+				int writeBytes = 0;
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					writeResult.times.push_back(measureTime([&]() { writeBytes = StreamCtrl::writeMotionData(*bones[0], mocapGroup); }));
+				}
+				MotionUtil::CMotionGroup group;
+				bool ret = (writeBytes > 0);
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					readResult.times.push_back(measureTime([&]() { if (!StreamCtrl::readMotionData(*bones[0], group)) ret = false; }));
+				}
+				writeResult.bytes = readResult.bytes = writeBytes;
+
+				// floatのまま保存した場合(時間4バイト、Offset値12バイト、Rotation値16バイト、ウエイト値4バイト)の1/3以下となるか.
+				const long long rawBytes = (long long)framesCou * (BENCH_FK_JOINTS_COUNT * 32 + BENCH_MOCAP_MORPH_TRACKS_COUNT * 8);
+				if ((long long)writeBytes * 3 > rawBytes) ret = false;
+				if (group.shapes.size() != mocapGroup.shapes.size() || group.morphKeyFrames.size() != mocapGroup.morphKeyFrames.size()) ret = false;
+
+				const float offsetTolerance = 0.1f / 65535.0f;
+				const float rotationTolerance = 2e-4f;
+				for (int i = 0; i < BENCH_FK_JOINTS_COUNT && ret; ++i) {
+					const std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>& srcKeys = mocapGroup.jointKeyFrames[i];
+					const std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>& keys = group.jointKeyFrames[i];
+					if (group.shapes[i] != mocapGroup.shapes[i] || keys.size() != srcKeys.size()) ret = false;
+					for (size_t k = 0; k < keys.size() && ret; ++k) {
+						if (std::abs(keys[k].timeSec - srcKeys[k].timeSec) > 1e-5f) ret = false;
+						if (!MathUtil::isZero(keys[k].offset - srcKeys[k].offset, offsetTolerance)) ret = false;
+						if (MathUtil::getRotationAngle(keys[k].rotation, srcKeys[k].rotation) > rotationTolerance) ret = false;
+					}
+				}
+				for (int i = 0; i < BENCH_MOCAP_MORPH_TRACKS_COUNT && ret; ++i) {
+					const std::vector<MotionUtil::CMotionGroupKeyFrameMorphTargets>& srcKeys = mocapGroup.morphKeyFrames[i];
+					const std::vector<MotionUtil::CMotionGroupKeyFrameMorphTargets>& keys = group.morphKeyFrames[i];
+					if (group.morphShapes[i] != pMotionMesh || group.morphTargetIndices[i] != i || keys.size() != srcKeys.size()) ret = false;
+					for (size_t k = 0; k < keys.size() && ret; ++k) {
+						if (std::abs(keys[k].weight - srcKeys[k].weight) > 1.0f / 65535.0f) ret = false;
+					}
+				}
+
+				// 同じ名前のポリゴンメッシュが複数ある場合は、Morph Targetsのトラックの対象形状はNULLとなるか.
+				if (ret) {
+					sxsdk::polygon_mesh_class* pDupMesh = fkScene.append_polygon_mesh(fkScene.get_shape(), pMotionMesh->get_name());
+					MotionUtil::CMotionGroup dupGroup;
+					if (!StreamCtrl::readMotionData(*bones[0], dupGroup) || dupGroup.morphShapes.size() != mocapGroup.morphShapes.size()) ret = false;
+					for (size_t i = 0; i < dupGroup.morphShapes.size() && ret; ++i) {
+						if (dupGroup.morphShapes[i] != NULL) ret = false;
+					}
+					pDupMesh->set_name("bench_motion_mesh_dup");
+				}
+
+				// 全トラックのキーフレーム数がヘッダと一致しない場合は、読み込みに失敗するか.
+				if (ret) {
+					compointer<sxsdk::stream_interface> stream(bones[0]->get_attribute_stream_interface_with_uuid(MOTION_DATA_STREAM_ID));
+					int keysCou = 0;
+					stream->set_pointer(sizeof(int) * 3);
+					stream->read_int(keysCou);
+					stream->set_pointer(sizeof(int) * 3);
+					stream->write_int(keysCou + 1);
+					MotionUtil::CMotionGroup badGroup;
+					if (StreamCtrl::readMotionData(*bones[0], badGroup)) ret = false;
+					stream->set_pointer(sizeof(int) * 3);
+					stream->write_int(keysCou);
+				}
+
+				// 保存後にボーンを追加してジョイントの番号が変わった場合も、ジョイント名で同じジョイントに対応するか.
+				// 最初のボーンの連なりの根元に子を追加し、以降の連なりの番号を1つずらす.
+				if (ret) {
+					sxsdk::scene_interface rebindScene;
+					std::vector<sxsdk::part_class *> rigBones;
+					createRetargetRig(rebindScene, skeleton, settings.seed, rigBones);
+					MotionUtil::CMotionGroup rigGroup;
+					for (int i = 0; i < BENCH_FK_JOINTS_COUNT; ++i) {
+						rigGroup.shapes.push_back(rigBones[i]);
+						rigGroup.jointKeyFrames.push_back(mocapGroup.jointKeyFrames[i]);
+					}
+					if (StreamCtrl::writeMotionData(*rigBones[0], rigGroup) <= 0) ret = false;
+					rebindScene.append_part(*rigBones[1], "rig:INSERTED", sxsdk::enums::bone_joint);
+
+					MotionUtil::CMotionGroup rebindGroup;
+					if (!StreamCtrl::readMotionData(*rigBones[0], rebindGroup) || rebindGroup.shapes.size() != rigGroup.shapes.size()) ret = false;
+					for (size_t i = 0; i < rebindGroup.shapes.size() && ret; ++i) {
+						if (rebindGroup.shapes[i] != rigGroup.shapes[i] || rebindGroup.jointKeyFrames[i].size() != rigGroup.jointKeyFrames[i].size()) ret = false;
+					}
+				}
+
+				compointer<sxsdk::stream_interface> stream(bones[0]->get_attribute_stream_interface_with_uuid(MOTION_DATA_STREAM_ID));
+				if (stream && stream->get_size() > 0) {
+					std::vector<unsigned char> buff(stream->get_size());
+					stream->set_pointer(0);
+					stream->read((int)buff.size(), &buff[0]);
+					writeResult.checksum = calcChecksum(&buff[0], buff.size());
+				}
+				readResult.checksum = writeResult.checksum;
+				if (!ret) writeResult.valid = readResult.valid = false;
+				results.push_back(writeResult);
+				results.push_back(readResult);
+			}
+
+			// 複数キャラクタのレイヤーのブレンド (頂点数の1/5000のキャラクタ数).
+			// キャラクタごとに、毎フレームのMotionGroup(上書き)、ジョイントのマスクを持つMotionGroup(上書き)、呼吸のような小さな動き(加算)を重ねる.
+			{
+				// 加算用の、3つに1つのジョイントとMorph Targetsの4つのチャンネルに差分を持つMotionGroup.
+				const float blendEndTime = (float)(framesCou - 1) / 30.0f;
+				MotionUtil::CMotionGroup additiveGroup;
+				for (int i = 0; i < BENCH_FK_JOINTS_COUNT - 1; i += 3) {
+					additiveGroup.shapes.push_back(bones[i]);
+					additiveGroup.jointKeyFrames.push_back(std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>(2));
+					for (int k = 0; k < 2; ++k) {
+						const float angle = (k == 0) ? 0.1f : -0.1f;
+						const sxsdk::vec3 axis = normalize(sxsdk::vec3(1.0f, (float)(i % 7) * 0.2f, 0.5f));
+						MotionUtil::CMotionGroupKeyFrameBallBoneJoint& key = additiveGroup.jointKeyFrames.back()[k];
+						key.type = MotionUtil::keyframe_type_ball_bone_joint;
+						key.timeSec = (k == 0) ? 0.0f : blendEndTime;
+						key.offset = sxsdk::vec3(0.0f, (k == 0) ? 0.01f : -0.01f, 0.0f);
+						key.rotation.x = axis.x * std::sin(angle * 0.5f);
+						key.rotation.y = axis.y * std::sin(angle * 0.5f);
+						key.rotation.z = axis.z * std::sin(angle * 0.5f);
+						key.rotation.w = std::cos(angle * 0.5f);
+					}
+				}
+				for (int i = 0; i < 4; ++i) {
+					additiveGroup.morphShapes.push_back(pMotionMesh);
+					additiveGroup.morphTargetIndices.push_back(i);
+					additiveGroup.morphKeyFrames.push_back(std::vector<MotionUtil::CMotionGroupKeyFrameMorphTargets>(2));
+					for (int k = 0; k < 2; ++k) {
+						MotionUtil::CMotionGroupKeyFrameMorphTargets& key = additiveGroup.morphKeyFrames.back()[k];
+						key.type = MotionUtil::keyframe_type_morph_targets;
+						key.timeSec = (k == 0) ? 0.0f : blendEndTime;
+						key.weight = (k == 0) ? 0.2f : 0.0f;
+					}
+				}
+
+				CMotionBlendMorphChannels morphChannels;
+				CMotionBlendClip baseClip, upperClip, additiveClip;
+				MotionBlend::setupClip(mocapGroup, skeleton, morphChannels, baseClip);
+				MotionBlend::setupClip(motionGroup, skeleton, morphChannels, upperClip);
+				MotionBlend::setupClip(additiveGroup, skeleton, morphChannels, additiveClip);
+				const int channelsCou = morphChannels.getChannelsCount();
+
+				const int charactersCou = std::max(8, std::min(verticesCount / 5000, 64));
+				std::vector<CMotionBlendCharacter> characters(charactersCou);
+				for (int c = 0; c < charactersCou; ++c) {
+					std::vector<CMotionBlendLayer>& layers = characters[c].layers;
+					layers.resize(3);
+					layers[0].clip = &baseClip;
+					layers[1].clip = &upperClip;
+					layers[1].weight = 0.7f;
+					layers[1].jointMask.resize(BENCH_FK_JOINTS_COUNT);
+					for (int i = 0; i < BENCH_FK_JOINTS_COUNT; ++i) layers[1].jointMask[i] = (i >= BENCH_BLEND_MASK_JOINT) ? 1.0f : 0.0f;
+					layers[2].clip = &additiveClip;
+					layers[2].mode = motion_blend_additive;
+					layers[2].weight = 0.5f + 0.5f * (float)(c % 2);
+				}
+				std::function<void (const int)> setTimes = [&](const int f) {
+					for (int c = 0; c < charactersCou; ++c) {
+						const float t = std::fmod((float)(f + c * 7) / 30.0f, blendEndTime);
+						for (size_t li = 0; li < characters[c].layers.size(); ++li) characters[c].layers[li].timeSec = t;
+					}
+				};
+
+				CBenchResult result;
+				result.caseName = "motion_blend";
+				result.verticesCount = charactersCou;
+				bool ret = (channelsCou == BENCH_MOCAP_MORPH_TRACKS_COUNT);
+
+				// 2回目以降の計算では、作業用の配列を確保し直さない.
+				setTimes(0);
+				MotionBlend::evaluateCharacters(characters, channelsCou);
+				const float* pValues = &characters[0].pose.values[0];
+				const sxsdk::mat4* pMatrices = &characters[0].pose.pose.worldMatrices[0];
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					result.times.push_back(measureTime([&]() {
+						for (int f = 0; f < BENCH_BLEND_FRAMES_COUNT; ++f) {
+							setTimes(f);
+							if (MotionBlend::evaluateCharacters(characters, channelsCou) != charactersCou) ret = false;
+						}
+					}));
+				}
+				if (&characters[0].pose.values[0] != pValues || &characters[0].pose.pose.worldMatrices[0] != pMatrices) ret = false;
+				result.bytes = (long long)charactersCou * BENCH_FK_JOINTS_COUNT * (long long)sizeof(sxsdk::mat4);
+				for (int c = 0; c < charactersCou; ++c) {
+					result.checksum = calcChecksum(characters[c].pose.pose.worldMatrices, result.checksum);
+				}
+
+				// ウエイト値1.0の上書きの1つのレイヤーは、MotionFK::evaluateと一致する.
+				{
+					std::vector<CMotionBlendLayer> layers(1);
+					layers[0].clip = &upperClip;
+					layers[0].timeSec = 0.7f;
+					CMotionBlendPose blendPose;
+					CMotionFKPose pose;
+					MotionBlend::evaluate(layers, channelsCou, blendPose);
+					MotionFK::evaluate(tracks, 0.7f, pose);
+					for (int i = 0; i < BENCH_FK_JOINTS_COUNT && ret; ++i) {
+						if (!isSameMatrix(blendPose.pose.worldMatrices[i], pose.worldMatrices[i])) ret = false;
+					}
+				}
+
+				// マスクしたジョイントは下のレイヤーの値、加算は下のレイヤーからレイヤーの回転の角度だけ回転し、Offset値とウエイト値は加わる.
+				{
+					const float t = 1.3f;
+					std::vector<CMotionBlendLayer> layers = characters[1].layers;
+					for (size_t li = 0; li < layers.size(); ++li) layers[li].timeSec = t;
+					layers[1].weight = 1.0f;
+					layers[2].weight = 1.0f;
+					CMotionBlendPose blendPose, addPose;
+					MotionBlend::evaluate(layers, channelsCou, addPose);
+					layers[2].weight = 0.0f;
+					MotionBlend::evaluate(layers, channelsCou, blendPose);
+
+					CMotionFKPose basePose, upperPose, additivePose;
+					MotionFK::sampleKeyFrames(baseClip.tracks, t, basePose);
+					MotionFK::sampleKeyFrames(upperClip.tracks, t, upperPose);
+					MotionFK::sampleKeyFrames(additiveClip.tracks, t, additivePose);
+					for (int i = 0; i < BENCH_FK_JOINTS_COUNT && ret; ++i) {
+						const CMotionFKPose& refPose = (i >= BENCH_BLEND_MASK_JOINT && i < BENCH_FK_JOINTS_COUNT - 1) ? upperPose : basePose;
+						if (!MathUtil::isZero(blendPose.pose.offsets[i] - refPose.offsets[i], 1e-5f)) ret = false;
+						if (MathUtil::getRotationAngle(blendPose.pose.rotations[i], refPose.rotations[i]) > 1e-3f) ret = false;
+
+						const float addAngle = MathUtil::getRotationAngle(sxsdk::quaternion_class::identity, additivePose.rotations[i]);
+						if (std::abs(MathUtil::getRotationAngle(addPose.pose.rotations[i], blendPose.pose.rotations[i]) - addAngle) > 1e-3f) ret = false;
+						if (!MathUtil::isZero(addPose.pose.offsets[i] - (blendPose.pose.offsets[i] + additivePose.offsets[i]), 1e-5f)) ret = false;
+					}
+					for (int ch = 0; ch < channelsCou && ret; ++ch) {
+						const float w = MotionUtil::evaluateMorphWeight(mocapGroup.morphKeyFrames[ch], t);
+						const float addW = (ch < 4) ? MotionUtil::evaluateMorphWeight(additiveGroup.morphKeyFrames[ch], t) : 0.0f;
+						if (std::abs(blendPose.morphWeights[ch] - w) > 1e-5f || std::abs(addPose.morphWeights[ch] - (w + addW)) > 1e-5f) ret = false;
+					}
+				}
+				if (!ret) result.valid = false;
+				results.push_back(result);
+			}
+
+			// 毎フレームのMotionGroupを、ボーンの長さとシーケンスOff時の向きが異なるボーン階層に移し替え.
+			// 移し元のジョイントは "src:Joint_番号" (一定数ごとに名前が重複)、移し先の最後のジョイントは指定で対応させない.
+			{
+				for (int i = 0; i < BENCH_FK_JOINTS_COUNT; ++i) {
+					char szName[64];
+					if (i % BENCH_RETARGET_UNNAMED_STRIDE == 3) snprintf(szName, sizeof(szName), "bench_bone");
+					else snprintf(szName, sizeof(szName), "src:Joint_%d", i);
+					bones[i]->set_name(szName);
+				}
+				CBoneSkeleton sourceSkeleton, targetSkeleton;
+				sourceSkeleton.build(bones[0]);
+				std::vector<sxsdk::part_class *> targetBones;
+				createRetargetRig(fkScene, sourceSkeleton, settings.seed, targetBones);
+				targetSkeleton.build(targetBones[0]);
+
+				std::vector<CMotionRetargetOverride> overrides;
+				overrides.push_back(CMotionRetargetOverride(targetBones.back()->get_name(), ""));
+				CMotionRetargetMap map;
+				const int mappedCou = MotionRetarget::buildMapping(sourceSkeleton, targetSkeleton, overrides, map);
+				bool mapRet = (mappedCou == BENCH_FK_JOINTS_COUNT - 1 && map.getMappedCount() == mappedCou);
+				for (int i = 0; i < BENCH_FK_JOINTS_COUNT && mapRet; ++i) {
+					if (map.sourceIndices[i] != ((i < BENCH_FK_JOINTS_COUNT - 1) ? i : -1)) mapRet = false;
+				}
+				if (std::abs(map.offsetScale - BENCH_RETARGET_SCALE) > 1e-3f) mapRet = false;
+
+				// 対応と補正のstreamへの保存と、同じボーン階層での読み込み.
+				{
+					CBenchResult result;
+					result.caseName = "motion_retarget_mapping";
+					result.verticesCount = BENCH_FK_JOINTS_COUNT;
+
+					StreamCtrl::removeRetargetMapping(*targetBones[0]);
+					CMotionRetargetMap cachedMap;
+					bool cachedF = true;
+					bool ret = mapRet;
+					if (MotionRetarget::setupMapping(sourceSkeleton, targetSkeleton, overrides, cachedMap, &cachedF) != mappedCou || cachedF) ret = false;
+					if (!StreamCtrl::hasRetargetMapping(*targetBones[0])) ret = false;
+					for (int loop = 0; loop < settings.repeat; ++loop) {
+						result.times.push_back(measureTime([&]() { MotionRetarget::setupMapping(sourceSkeleton, targetSkeleton, overrides, cachedMap, &cachedF); }));
+						if (!cachedF) ret = false;
+					}
+
+					// 補正の回転は計算時に保存する形式で量子化しているため、計算したものと同じ値が復元される.
+					if (cachedMap.sourceIndices != map.sourceIndices || cachedMap.offsetScale != map.offsetScale) ret = false;
+					if (cachedMap.sourceSignature != map.sourceSignature || cachedMap.targetSignature != map.targetSignature) ret = false;
+					for (int i = 0; i < BENCH_FK_JOINTS_COUNT && ret; ++i) {
+						const sxsdk::quaternion_class& q0 = cachedMap.corrections[i];
+						const sxsdk::quaternion_class& q1 = map.corrections[i];
+						if (q0.x != q1.x || q0.y != q1.y || q0.z != q1.z || q0.w != q1.w) ret = false;
+					}
+
+					// 指定が変わった場合は計算し直す.
+					{
+						std::vector<CMotionRetargetOverride> overrides2;
+						CMotionRetargetMap map2;
+						if (MotionRetarget::setupMapping(sourceSkeleton, targetSkeleton, overrides2, map2, &cachedF) != BENCH_FK_JOINTS_COUNT || cachedF) ret = false;
+						MotionRetarget::setupMapping(sourceSkeleton, targetSkeleton, overrides, cachedMap, &cachedF);
+					}
+
+					compointer<sxsdk::stream_interface> stream(targetBones[0]->get_attribute_stream_interface_with_uuid(MOTION_RETARGET_STREAM_ID));
+					if (stream && stream->get_size() > 0) {
+						result.bytes = stream->get_size();
+						std::vector<unsigned char> buff(stream->get_size());
+						stream->set_pointer(0);
+						stream->read((int)buff.size(), &buff[0]);
+						result.checksum = calcChecksum(&buff[0], buff.size());
+					}
+					if (!ret) result.valid = false;
+					results.push_back(result);
+				}
+
+				// 全フレームの移し替え.
+				// 対応するジョイントは、シーケンスOff時の姿勢からのワールドでの回転が移し元と同じで、移動はボーンの長さの比の倍となる.
+				{
+					std::vector<float> frameTimes(framesCou);
+					for (int f = 0; f < framesCou; ++f) frameTimes[f] = (float)f / 30.0f;
+					CMotionFKTracks sourceTracks;
+					MotionFK::setupTracks(mocapGroup, sourceSkeleton, sourceTracks);
+
+					CBenchResult result;
+					result.caseName = "motion_retarget";
+					result.verticesCount = framesCou;
+					result.itemsCount = framesCou;
+					bool ret = mapRet;
+					MotionUtil::CMotionGroup group;
+					for (int loop = 0; loop < settings.repeat; ++loop) {
+						result.times.push_back(measureTime([&]() {
+							if (MotionRetarget::transferMotionGroup(map, sourceTracks, targetSkeleton, frameTimes, group) != mappedCou) ret = false;
+						}));
+					}
+					result.bytes = (long long)framesCou * mappedCou * (long long)(sizeof(sxsdk::vec3) + sizeof(sxsdk::quaternion_class));
+
+					// シーケンスOff時のワールドでの向き.
+					std::vector<sxsdk::quaternion_class> srcBindRotations(BENCH_FK_JOINTS_COUNT), dstBindRotations(BENCH_FK_JOINTS_COUNT);
+					{
+						std::vector<sxsdk::mat4> srcWorldMatrices(BENCH_FK_JOINTS_COUNT), dstWorldMatrices(BENCH_FK_JOINTS_COUNT);
+						for (int i = 0; i < BENCH_FK_JOINTS_COUNT; ++i) {
+							const int parentIndex = sourceSkeleton.getParents()[i];
+							srcWorldMatrices[i] = sourceSkeleton.getLocalMatrices()[i] * ((parentIndex >= 0) ? srcWorldMatrices[parentIndex] : sourceSkeleton.getRootLocalToWorldMatrix());
+							dstWorldMatrices[i] = targetSkeleton.getLocalMatrices()[i] * ((parentIndex >= 0) ? dstWorldMatrices[parentIndex] : targetSkeleton.getRootLocalToWorldMatrix());
+							srcBindRotations[i] = MathUtil::matrixToQuaternion(srcWorldMatrices[i]);
+							dstBindRotations[i] = MathUtil::matrixToQuaternion(dstWorldMatrices[i]);
+						}
+					}
+
+					CMotionFKTracks targetTracks;
+					MotionFK::setupTracks(group, targetSkeleton, targetTracks);
+					CMotionFKPose srcPose, dstPose;
+					const int checkFrames[3] = {0, framesCou / 2, framesCou - 1};
+					for (int c = 0; c < 3 && ret; ++c) {
+						const float t = frameTimes[ checkFrames[c] ];
+						MotionFK::evaluate(sourceTracks, t, srcPose);
+						MotionFK::evaluate(targetTracks, t, dstPose);
+						for (int i = 0; i < BENCH_FK_JOINTS_COUNT - 1 && ret; ++i) {
+							// ワールドでの回転 (シーケンスOff時の向きの逆を掛けたもの).
+							const sxsdk::mat4 srcDelta = inv(MathUtil::quaternionToMatrix(srcBindRotations[i])) * MathUtil::quaternionToMatrix(MathUtil::matrixToQuaternion(srcPose.worldMatrices[i]));
+							const sxsdk::mat4 dstDelta = inv(MathUtil::quaternionToMatrix(dstBindRotations[i])) * MathUtil::quaternionToMatrix(MathUtil::matrixToQuaternion(dstPose.worldMatrices[i]));
+							if (MathUtil::getRotationAngle(MathUtil::matrixToQuaternion(srcDelta), MathUtil::matrixToQuaternion(dstDelta)) > 1e-3f) ret = false;
+
+							const sxsdk::vec3 srcMove = srcPose.offsets[i] * MathUtil::quaternionToMatrix(srcBindRotations[i]);
+							const sxsdk::vec3 dstMove = dstPose.offsets[i] * MathUtil::quaternionToMatrix(dstBindRotations[i]);
+							if (!MathUtil::isZero(dstMove - srcMove * BENCH_RETARGET_SCALE, 1e-4f)) ret = false;
+						}
+						if (!MathUtil::isZero(dstPose.offsets[BENCH_FK_JOINTS_COUNT - 1], 1e-6f)) ret = false;
+					}
+
+					for (size_t i = 0; i < group.jointKeyFrames.size(); ++i) {
+						const std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>& keyFrames = group.jointKeyFrames[i];
+						for (size_t k = 0; k < keyFrames.size(); ++k) {
+							result.checksum = calcChecksum(&keyFrames[k].offset, sizeof(sxsdk::vec3), result.checksum);
+							result.checksum = calcChecksum(&keyFrames[k].rotation, sizeof(sxsdk::quaternion_class), result.checksum);
+						}
+					}
+					if (!ret) result.valid = false;
+					results.push_back(result);
+				}
+			}
+		}
+
+		// 複数のチェインのIK (頂点数の1/1000のチェイン数).
+		// ボーンの連なりの先端のジョイントをランダムに回転した位置を目標位置とし、シーケンスOff時の姿勢から計算する.
+		{
+			const int chainsCou = std::max(16, std::min(verticesCount / 1000, 1000));
+			sxsdk::scene_interface ikScene;
+			std::vector<sxsdk::part_class *> bones;
+			createBoneRig(ikScene, 1 + chainsCou * BENCH_BONE_CHAIN_LENGTH, settings.seed, bones);
+			CBoneSkeleton skeleton;
+			skeleton.build(bones[0]);
+			CMotionFKTracks tracks;
+			MotionFK::setupTracks(MotionUtil::CMotionGroup(), skeleton, tracks);
+			CMotionFKPose basePose;
+			MotionIK::readJointValues(skeleton, tracks, basePose);
+
+			// ボーンルートの子から先端までが、枝分かれのない連なりとなる.
+			CMotionIKChains leafChains;
+			bool leafF = (MotionIK::appendLeafChains(tracks, 0, leafChains) == chainsCou);
+			for (int c = 0; c < leafChains.getChainsCount() && leafF; ++c) {
+				if (leafChains.chainOffsets[c + 1] - leafChains.chainOffsets[c] != BENCH_BONE_CHAIN_LENGTH) leafF = false;
+			}
+
+			CMotionIKChains chains, limitChains;
+			CMotionFKPose targetPose = basePose;
+			CBenchRandom random(settings.seed ^ 0x165667b1u);
+			for (int c = 0; c < leafChains.getChainsCount(); ++c) {
+				const int endJoint = leafChains.jointIndices[ leafChains.chainOffsets[c + 1] - 1 ];
+				const int startJoint = leafChains.jointIndices[ leafChains.chainOffsets[c + 1] - BENCH_IK_CHAIN_JOINTS ];
+				MotionIK::appendChain(tracks, startJoint, endJoint, chains);
+				MotionIK::appendChain(tracks, startJoint, endJoint, limitChains, BENCH_IK_LIMIT_ANGLE);
+				for (int j = startJoint; j < endJoint; ++j) {
+					const sxsdk::vec3 axis = normalize(sxsdk::vec3(random.nextSigned(), random.nextSigned(), random.nextSigned()) + sxsdk::vec3(0.0f, 0.0f, 0.5f));
+					const float angle = random.nextSigned() * 0.4f;
+					targetPose.rotations[j].x = axis.x * std::sin(angle * 0.5f);
+					targetPose.rotations[j].y = axis.y * std::sin(angle * 0.5f);
+					targetPose.rotations[j].z = axis.z * std::sin(angle * 0.5f);
+					targetPose.rotations[j].w = std::cos(angle * 0.5f);
+				}
+			}
+			MotionFK::calcMatrices(tracks, targetPose);
+			for (int c = 0; c < chains.getChainsCount(); ++c) {
+				const sxsdk::mat4& m = targetPose.worldMatrices[ chains.jointIndices[chains.chainOffsets[c + 1] - 1] ];
+				chains.targets[c] = limitChains.targets[c] = sxsdk::vec3(m[3][0], m[3][1], m[3][2]);
+			}
+
+			for (int loop2 = 0; loop2 < 3; ++loop2) {
+				const bool limitF = (loop2 == 2);
+				const CMotionIKChains& solveChains = limitF ? limitChains : chains;
+				CMotionIKOptions options;
+				options.solver = (loop2 == 1) ? motion_ik_ccd : motion_ik_fabrik;
+				options.iterationsCount = 32;
+
+				CBenchResult result;
+				result.caseName = (loop2 == 0) ? "motion_ik_fabrik" : ((loop2 == 1) ? "motion_ik_ccd" : "motion_ik_fabrik_limit");
+				result.verticesCount = chainsCou;
+				result.itemsCount = chainsCou;
+				bool ret = leafF && chains.getChainsCount() == chainsCou;
+
+				CMotionFKPose pose;
+				CMotionIKReport report;
+				for (int loop = 0; loop < settings.repeat; ++loop) {
+					pose = basePose;
+					result.times.push_back(measureTime([&]() { MotionIK::solveChains(tracks, solveChains, options, pose, &report); }));
+				}
+				result.bytes = (long long)solveChains.jointIndices.size() * (long long)sizeof(sxsdk::quaternion_class);
+
+				// 制限がない場合、FABRIKはほとんどのチェインが目標位置に届く.
+				// CCDは収束が遅いため届くチェインは少ないが、先端と目標位置の距離は計算前より大きくならない.
+				// どの計算方法でも、ジョイントの間の距離は変わらない.
+				if (loop2 == 0 && report.reachedCount * 10 < chainsCou * 9) ret = false;
+				if (loop2 == 1 && report.reachedCount * 10 < chainsCou * 4) ret = false;
+				for (int c = 0; c < chainsCou && ret; ++c) {
+					const int jBegin = solveChains.chainOffsets[c];
+					const int jEnd = solveChains.chainOffsets[c + 1];
+					for (int i = jBegin; i + 1 < jEnd && ret; ++i) {
+						const int j0 = solveChains.jointIndices[i];
+						const int j1 = solveChains.jointIndices[i + 1];
+						const sxsdk::mat4& a0 = basePose.worldMatrices[j0];
+						const sxsdk::mat4& a1 = basePose.worldMatrices[j1];
+						const sxsdk::mat4& b0 = pose.worldMatrices[j0];
+						const sxsdk::mat4& b1 = pose.worldMatrices[j1];
+						const float len0 = sxsdk::distance3(sxsdk::vec3(a0[3][0], a0[3][1], a0[3][2]), sxsdk::vec3(a1[3][0], a1[3][1], a1[3][2]));
+						const float len1 = sxsdk::distance3(sxsdk::vec3(b0[3][0], b0[3][1], b0[3][2]), sxsdk::vec3(b1[3][0], b1[3][1], b1[3][2]));
+						if (std::abs(len0 - len1) > 1e-4f * std::max(1.0f, len0)) ret = false;
+						if (limitF && MathUtil::getRotationAngle(basePose.rotations[j0], pose.rotations[j0]) > BENCH_IK_LIMIT_ANGLE + 1e-4f) ret = false;
+					}
+					const sxsdk::mat4& m = pose.worldMatrices[ solveChains.jointIndices[jEnd - 1] ];
+					const sxsdk::mat4& m0 = basePose.worldMatrices[ solveChains.jointIndices[jEnd - 1] ];
+					const float error = sxsdk::distance3(sxsdk::vec3(m[3][0], m[3][1], m[3][2]), solveChains.targets[c]);
+					const float error0 = sxsdk::distance3(sxsdk::vec3(m0[3][0], m0[3][1], m0[3][2]), solveChains.targets[c]);
+					if (error > report.maxError + 1e-5f) ret = false;
+					if (loop2 == 1 && error > error0 + 1e-5f) ret = false;
+				}
+
+				// 計算したRotation値をボーンジョイントに反映.
+				if (loop2 == 0) {
+					const int jointsCou = MotionIK::commitRotations(skeleton, chains, pose);
+					if (jointsCou != chainsCou * (BENCH_IK_CHAIN_JOINTS - 1)) ret = false;
+					CMotionFKPose readPose;
+					MotionIK::readJointValues(skeleton, tracks, readPose);
+					for (size_t i = 0; i < chains.jointIndices.size() && ret; ++i) {
+						const int j = chains.jointIndices[i];
+						if (MathUtil::getRotationAngle(readPose.rotations[j], pose.rotations[j]) > 1e-6f) ret = false;
+					}
+				}
+
+				// 3つのジョイントのチェインで、1回の反復で目標位置に届くか.
+				// 中間のジョイントを根元を中心に回転した位置p1とし、p1から元の位置と反対の向きに先端までの長さ離れた位置を目標位置とすると、
+				// FABRIKで求める位置は反復の1回目で確定するため、根元を回転した後の変換行列から先端を合わせることで届く.
+				if (loop2 == 0 && ret) {
+					const int jEnd = leafChains.chainOffsets[1];
+					const sxsdk::mat4& m0 = basePose.worldMatrices[ leafChains.jointIndices[jEnd - 3] ];
+					const sxsdk::mat4& m1 = basePose.worldMatrices[ leafChains.jointIndices[jEnd - 2] ];
+					const sxsdk::mat4& m2 = basePose.worldMatrices[ leafChains.jointIndices[jEnd - 1] ];
+					const sxsdk::vec3 p0(m0[3][0], m0[3][1], m0[3][2]);
+					const sxsdk::vec3 p1(m1[3][0], m1[3][1], m1[3][2]);
+					const float len1 = sxsdk::distance3(p1, sxsdk::vec3(m2[3][0], m2[3][1], m2[3][2]));
+					const sxsdk::vec3 newP1 = p0 + (p1 - p0) * sxsdk::mat4::rotate(sxsdk::vec3(0.3f, 1.0f, 0.2f), 0.5f);
+
+					CMotionIKChains shortChains;
+					MotionIK::appendChain(tracks, leafChains.jointIndices[jEnd - 3], leafChains.jointIndices[jEnd - 1], shortChains);
+					shortChains.targets[0] = newP1 + normalize(newP1 - p1) * len1;
+					CMotionIKOptions shortOptions;
+					shortOptions.iterationsCount = 1;
+					shortOptions.tolerance = 1e-4f * std::max(1.0f, len1);
+					CMotionFKPose shortPose = basePose;
+					CMotionIKReport shortReport;
+					MotionIK::solveChains(tracks, shortChains, shortOptions, shortPose, &shortReport);
+					if (shortChains.getChainsCount() != 1 || shortReport.reachedCount != 1 || shortReport.iterationsCount != 1) ret = false;
+				}
+
+				// 腕と指のように、一方のチェインが回転するジョイントの子孫を根元とするチェインは、親側のチェインを計算した後の姿勢から計算するため、両方が目標位置に届く.
+				// 子側のチェインを先に追加しても親側から計算し、届いたかどうかは最後の姿勢での先端の位置で判定する.
+				if (loop2 == 0 && ret) {
+					const int jBegin = leafChains.chainOffsets[0];
+					const int jMid = jBegin + BENCH_BONE_CHAIN_LENGTH / 2;
+					const int jEnd = leafChains.chainOffsets[1];
+					CMotionFKPose nestedTargetPose = basePose;
+					for (int i = jBegin; i + 1 < jEnd; ++i) {
+						const sxsdk::vec3 axis = normalize(sxsdk::vec3(random.nextSigned(), random.nextSigned(), random.nextSigned()) + sxsdk::vec3(0.0f, 0.0f, 0.5f));
+						const float angle = random.nextSigned() * 0.2f;
+						sxsdk::quaternion_class& q = nestedTargetPose.rotations[ leafChains.jointIndices[i] ];
+						q.x = axis.x * std::sin(angle * 0.5f);
+						q.y = axis.y * std::sin(angle * 0.5f);
+						q.z = axis.z * std::sin(angle * 0.5f);
+						q.w = std::cos(angle * 0.5f);
+					}
+					MotionFK::calcMatrices(tracks, nestedTargetPose);
+
+					CMotionIKChains nestedChains;
+					MotionIK::appendChain(tracks, leafChains.jointIndices[jMid], leafChains.jointIndices[jEnd - 1], nestedChains);
+					MotionIK::appendChain(tracks, leafChains.jointIndices[jBegin], leafChains.jointIndices[jMid], nestedChains);
+					for (int c = 0; c < nestedChains.getChainsCount(); ++c) {
+						nestedChains.targets[c] = MathUtil::getMatrixPosition(nestedTargetPose.worldMatrices[ nestedChains.jointIndices[nestedChains.chainOffsets[c + 1] - 1] ]);
+					}
+					CMotionIKOptions nestedOptions;
+					nestedOptions.iterationsCount = 64;
+					CMotionFKPose nestedPose = basePose;
+					CMotionIKReport nestedReport;
+					MotionIK::solveChains(tracks, nestedChains, nestedOptions, nestedPose, &nestedReport);
+					if (nestedChains.getChainsCount() != 2 || nestedReport.reachedCount != 2) ret = false;
+					for (int c = 0; c < nestedChains.getChainsCount() && ret; ++c) {
+						const float error = sxsdk::distance3(MathUtil::getMatrixPosition(nestedPose.worldMatrices[ nestedChains.jointIndices[nestedChains.chainOffsets[c + 1] - 1] ]), nestedChains.targets[c]);
+						if (error > nestedOptions.tolerance || error > nestedReport.maxError + 1e-6f) ret = false;
+					}
+				}
+
+				// ボーンルートに非均等スケールがある場合も、ワールドの向きを逆行列でローカルに戻して回転を求めるため、CCDでほとんどのチェインが目標位置に届く.
+				if (loop2 == 1 && ret) {
+					CMotionFKTracks scaledTracks = tracks;
+					scaledTracks.rootMatrix = sxsdk::mat4::scale(sxsdk::vec3(1.0f, 2.5f, 0.4f)) * tracks.rootMatrix;
+					CMotionFKPose scaledPose = basePose;
+					CMotionFKPose scaledTargetPose = targetPose;
+					MotionFK::calcMatrices(scaledTracks, scaledPose);
+					MotionFK::calcMatrices(scaledTracks, scaledTargetPose);
+					CMotionIKChains scaledChains = chains;
+					for (int c = 0; c < scaledChains.getChainsCount(); ++c) {
+						scaledChains.targets[c] = MathUtil::getMatrixPosition(scaledTargetPose.worldMatrices[ scaledChains.jointIndices[scaledChains.chainOffsets[c + 1] - 1] ]);
+					}
+					CMotionIKOptions scaledOptions = options;
+					scaledOptions.iterationsCount = 128;
+					CMotionIKReport scaledReport;
+					MotionIK::solveChains(scaledTracks, scaledChains, scaledOptions, scaledPose, &scaledReport);
+					if (scaledReport.reachedCount * 10 < chainsCou * 9) ret = false;
+				}
+
+				for (int c = 0; c < chainsCou; ++c) {
+					const int j = solveChains.jointIndices[solveChains.chainOffsets[c + 1] - 1];
+					result.checksum = calcChecksum(&pose.worldMatrices[j], sizeof(sxsdk::mat4), result.checksum);
+				}
+				if (!ret) result.valid = false;
+				results.push_back(result);
+			}
+		}
+	}
+
+	/**
+	 * 計測結果をJSON形式で出力.
+	 */
+	void writeResults (FILE* fp, const CBenchSettings& settings, const std::vector<CBenchResult>& results)
+	{
+		fprintf(fp, "{\n");
+		fprintf(fp, "  \"benchmark\": \"motionutil_bench\",\n");
+		fprintf(fp, "  \"version\": 1,\n");
+		fprintf(fp, "  \"threads\": %d,\n", ParallelUtil::getThreadsCount());
+		fprintf(fp, "  \"repeat\": %d,\n", settings.repeat);
+		fprintf(fp, "  \"seed\": %u,\n", settings.seed);
+		fprintf(fp, "  \"results\": [\n");
+		for (size_t i = 0; i < results.size(); ++i) {
+			const CBenchResult& r = results[i];
+			char szItems[64];
+			szItems[0] = '\0';
+			if (r.itemsCount > 0 && r.getMinTime() > 0.0) snprintf(szItems, sizeof(szItems), ", \"items_per_sec\": %.1f", (double)r.itemsCount * 1000.0 / r.getMinTime());
+			fprintf(fp, "    {\"case\": \"%s\", \"vertices\": %d, \"min_ms\": %.4f, \"median_ms\": %.4f, \"bytes\": %lld, \"checksum\": \"%08x\", \"valid\": %s%s}%s\n",
+				r.caseName.c_str(), r.verticesCount, r.getMinTime(), r.getMedianTime(), r.bytes, r.checksum, r.valid ? "true" : "false", szItems,
+				(i + 1 < results.size()) ? "," : "");
+		}
+		fprintf(fp, "  ]\n");
+		fprintf(fp, "}\n");
+	}
+
+	/**
+	 * "1000,10000"形式の頂点数を取得.
+	 */
+	bool parseSizes (const char* str, std::vector<int>& sizes)
+	{
+		sizes.clear();
+		std::string s(str);
+		size_t pos = 0;
+		while (pos <= s.size()) {
+			size_t next = s.find(',', pos);
+			if (next == std::string::npos) next = s.size();
+			const int v = atoi(s.substr(pos, next - pos).c_str());
+			if (v <= 0) return false;
+			sizes.push_back(v);
+			pos = next + 1;
+		}
+		return !sizes.empty();
+	}
+
+	/**
+	 * コマンドライン引数を取得.
+	 */
+	bool parseArgs (const int argc, char** argv, CBenchSettings& settings)
+	{
+		for (int i = 1; i < argc; ++i) {
+			const std::string arg(argv[i]);
+			const bool hasValue = (i + 1 < argc);
+			if (arg == "--quick") {
+				settings.sizes.clear();
+				settings.sizes.push_back(1000);
+				settings.sizes.push_back(10000);
+				settings.repeat = 1;
+			} else if (arg == "--sizes" && hasValue) {
+				if (!parseSizes(argv[++i], settings.sizes)) return false;
+			} else if (arg == "--repeat" && hasValue) {
+				settings.repeat = std::max(1, atoi(argv[++i]));
+			} else if (arg == "--threads" && hasValue) {
+				settings.threads = std::max(0, atoi(argv[++i]));
+			} else if (arg == "--seed" && hasValue) {
+				settings.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+			} else if (arg == "--output" && hasValue) {
+				settings.outputFile = argv[++i];
+			} else if (arg == "--profile" && hasValue) {
+				settings.profileFile = argv[++i];
+			} else if (arg == "--trace" && hasValue) {
+				settings.traceFile = argv[++i];
+			} else {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main (int argc, char** argv)
+{
+	CBenchSettings settings;
+	if (!parseArgs(argc, argv, settings)) {
+		fprintf(stderr, "usage: %s [--quick] [--sizes 1000,10000,...] [--repeat N] [--threads N] [--seed N] [--output file.json] [--profile file.json] [--trace file.json]\n", argv[0]);
+		return 2;
+	}
+	ParallelUtil::setMaxThreadsCount(settings.threads);
+	if (!settings.profileFile.empty()) ProfileUtil::setEnabled(true);
+	if (!settings.traceFile.empty()) TraceUtil::setEnabled(true);
+
+	std::vector<CBenchResult> results;
+	for (size_t i = 0; i < settings.sizes.size(); ++i) {
+		fprintf(stderr, "vertices %d ...\n", settings.sizes[i]);
+		runBenchmarks(settings, settings.sizes[i], results);
+	}
+
+	if (settings.outputFile.empty()) {
+		writeResults(stdout, settings, results);
+	} else {
+		FILE* fp = fopen(settings.outputFile.c_str(), "wb");
+		if (!fp) {
+			fprintf(stderr, "cannot open %s\n", settings.outputFile.c_str());
+			return 1;
+		}
+		writeResults(fp, settings, results);
+		fclose(fp);
+	}
+	if (!settings.profileFile.empty()) ProfileUtil::writeJSON(settings.profileFile.c_str());
+	if (!settings.traceFile.empty()) TraceUtil::writeJSON(settings.traceFile.c_str());
+
+	// 結果の検証に失敗したものがあればエラーとする.
+	int invalidCou = 0;
+	for (size_t i = 0; i < results.size(); ++i) {
+		if (!results[i].valid) {
+			fprintf(stderr, "invalid result : %s (%d vertices)\n", results[i].caseName.c_str(), results[i].verticesCount);
+			invalidCou++;
+		}
+	}
+	return (invalidCou > 0) ? 1 : 0;
+}
@@ -0,0 +1,568 @@
+﻿/**
+ * Shade3D SDK(sxsdk.cxx)の最小限の代替ヘッダ.
+ * Linux上でMotionUtilのコアアルゴリズムをビルドしてベンチマークするためのもの.
+ * プラグインとしてのビルドでは使用しない.
+ * 形状/streamはメモリ上に保持し、MotionUtilのsource内で使用しているAPIのみを用意している.
+ */
+#ifndef _SXSDK_SHIM_CXX
+#define _SXSDK_SHIM_CXX
+
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#define SHADE_BUILD_NUMBER 0
+#define SXSDKEXPORT
+#define STDCALL
+
+namespace sx {
+	const float pi = 3.14159265358979323846f;
+
+	inline bool zero (const float v) { return std::abs(v) < 1e-6f; }
+
+	class uuid_class {
+	public:
+		unsigned int d[4];
+		uuid_class () { d[0] = d[1] = d[2] = d[3] = 0; }
+		uuid_class (unsigned int a, unsigned int b, unsigned int c, unsigned int e) { d[0] = a; d[1] = b; d[2] = c; d[3] = e; }
+		explicit uuid_class (const char* str) {
+			d[0] = d[1] = d[2] = d[3] = 0;
+			int i = 0;
+			for (const char* p = str; *p; ++p) {
+				int v = -1;
+				if (*p >= '0' && *p <= '9') v = *p - '0';
+				else if (*p >= 'A' && *p <= 'F') v = *p - 'A' + 10;
+				else if (*p >= 'a' && *p <= 'f') v = *p - 'a' + 10;
+				if (v < 0) continue;
+				if (i < 32) d[i / 8] = (d[i / 8] << 4) | (unsigned int)v;
+				i++;
+			}
+		}
+		bool operator == (const uuid_class& v) const { return std::memcmp(d, v.d, sizeof(d)) == 0; }
+		bool operator != (const uuid_class& v) const { return !(*this == v); }
+		bool operator < (const uuid_class& v) const { return std::memcmp(d, v.d, sizeof(d)) < 0; }
+	};
+}
+
+namespace sxsdk {
+	class vec2 {
+	public:
+		float x, y;
+		vec2 () : x(0), y(0) { }
+		vec2 (const float x, const float y) : x(x), y(y) { }
+		vec2 operator + (const vec2& v) const { return vec2(x + v.x, y + v.y); }
+		vec2 operator - (const vec2& v) const { return vec2(x - v.x, y - v.y); }
+		vec2 operator * (const float f) const { return vec2(x * f, y * f); }
+	};
+
+	class vec3 {
+	public:
+		float x, y, z;
+		vec3 () : x(0), y(0), z(0) { }
+		vec3 (const float x, const float y, const float z) : x(x), y(y), z(z) { }
+		vec3 operator + (const vec3& v) const { return vec3(x + v.x, y + v.y, z + v.z); }
+		vec3 operator - (const vec3& v) const { return vec3(x - v.x, y - v.y, z - v.z); }
+		vec3 operator - () const { return vec3(-x, -y, -z); }
+		vec3 operator * (const float f) const { return vec3(x * f, y * f, z * f); }
+		vec3 operator / (const float f) const { return vec3(x / f, y / f, z / f); }
+		vec3& operator += (const vec3& v) { x += v.x; y += v.y; z += v.z; return *this; }
+		vec3& operator -= (const vec3& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+		vec3& operator *= (const float f) { x *= f; y *= f; z *= f; return *this; }
+		vec3& operator /= (const float f) { x /= f; y /= f; z /= f; return *this; }
+		bool operator == (const vec3& v) const { return x == v.x && y == v.y && z == v.z; }
+		bool operator != (const vec3& v) const { return !(*this == v); }
+	};
+	inline vec3 operator * (const float f, const vec3& v) { return v * f; }
+
+	class vec4 {
+	public:
+		float x, y, z, w;
+		vec4 () : x(0), y(0), z(0), w(0) { }
+		vec4 (const float x, const float y, const float z, const float w) : x(x), y(y), z(z), w(w) { }
+		float& operator [] (const int i) { return (&x)[i]; }
+		const float& operator [] (const int i) const { return (&x)[i]; }
+	};
+
+	class rgb_class {
+	public:
+		float red, green, blue;
+		rgb_class () : red(0), green(0), blue(0) { }
+		rgb_class (const float r, const float g, const float b) : red(r), green(g), blue(b) { }
+	};
+
+	class rgba_class {
+	public:
+		float red, green, blue, alpha;
+		rgba_class () : red(0), green(0), blue(0), alpha(0) { }
+		rgba_class (const float r, const float g, const float b, const float a) : red(r), green(g), blue(b), alpha(a) { }
+	};
+
+	inline float absolute (const vec3& v) { return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z); }
+	inline float distance3 (const vec3& a, const vec3& b) { return absolute(a - b); }
+	inline vec3 normalize (const vec3& v) {
+		const float len = absolute(v);
+		if (len <= 0.0f) return vec3(0, 0, 0);
+		return v / len;
+	}
+
+	/**
+	 * 行ベクトル形式の4x4行列 (v * m).
+	 */
+	class mat4 {
+	public:
+		vec4 r[4];
+		static const mat4 identity;
+
+		mat4 () { }
+		mat4 (const vec4& a, const vec4& b, const vec4& c, const vec4& d) { r[0] = a; r[1] = b; r[2] = c; r[3] = d; }
+
+		vec4& operator [] (const int i) { return r[i]; }
+		const vec4& operator [] (const int i) const { return r[i]; }
+
+		mat4 operator * (const mat4& m) const {
+			mat4 ret;
+			for (int i = 0; i < 4; ++i) {
+				for (int j = 0; j < 4; ++j) {
+					float s = 0.0f;
+					for (int k = 0; k < 4; ++k) s += r[i][k] * m.r[k][j];
+					ret.r[i][j] = s;
+				}
+			}
+			return ret;
+		}
+
+		static mat4 translate (const vec3& t) {
+			mat4 m = identity;
+			m.r[3] = vec4(t.x, t.y, t.z, 1.0f);
+			return m;
+		}
+		static mat4 scale (const vec3& s) {
+			mat4 m = identity;
+			m.r[0][0] = s.x;  m.r[1][1] = s.y;  m.r[2][2] = s.z;
+			return m;
+		}
+		static mat4 rotate (const vec3& axis, const float angle) {
+			const vec3 a = normalize(axis);
+			const float c = std::cos(angle), s = std::sin(angle), t = 1.0f - c;
+			mat4 m = identity;
+			m.r[0] = vec4(t * a.x * a.x + c,       t * a.x * a.y + s * a.z, t * a.x * a.z - s * a.y, 0);
+			m.r[1] = vec4(t * a.x * a.y - s * a.z, t * a.y * a.y + c,       t * a.y * a.z + s * a.x, 0);
+			m.r[2] = vec4(t * a.x * a.z + s * a.y, t * a.y * a.z - s * a.x, t * a.z * a.z + c,       0);
+			return m;
+		}
+		static mat4 rotate (const vec3& v0, const vec3& v1) {
+			const vec3 a = normalize(v0), b = normalize(v1);
+			const vec3 axis(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+			const float s = absolute(axis);
+			const float c = a.x * b.x + a.y * b.y + a.z * b.z;
+			if (s < 1e-7f) {
+				if (c > 0.0f) return identity;
+				vec3 perp = (std::abs(a.x) < 0.9f) ? vec3(1, 0, 0) : vec3(0, 1, 0);
+				perp = normalize(vec3(a.y * perp.z - a.z * perp.y, a.z * perp.x - a.x * perp.z, a.x * perp.y - a.y * perp.x));
+				return rotate(perp, pi_value());
+			}
+			return rotate(axis, std::atan2(s, c));
+		}
+	private:
+		static float pi_value () { return 3.14159265358979323846f; }
+	};
+
+	inline vec3 operator * (const vec3& v, const mat4& m) {
+		return vec3(v.x * m[0][0] + v.y * m[1][0] + v.z * m[2][0] + m[3][0],
+					v.x * m[0][1] + v.y * m[1][1] + v.z * m[2][1] + m[3][1],
+					v.x * m[0][2] + v.y * m[1][2] + v.z * m[2][2] + m[3][2]);
+	}
+
+	inline mat4 inv (const mat4& m) {
+		float a[4][8];
+		for (int i = 0; i < 4; ++i) {
+			for (int j = 0; j < 4; ++j) {
+				a[i][j] = m[i][j];
+				a[i][j + 4] = (i == j) ? 1.0f : 0.0f;
+			}
+		}
+		for (int c = 0; c < 4; ++c) {
+			int p = c;
+			for (int i = c + 1; i < 4; ++i) if (std::abs(a[i][c]) > std::abs(a[p][c])) p = i;
+			if (p != c) for (int j = 0; j < 8; ++j) std::swap(a[p][j], a[c][j]);
+			const float d = a[c][c];
+			if (std::abs(d) < 1e-12f) return mat4::identity;
+			for (int j = 0; j < 8; ++j) a[c][j] /= d;
+			for (int i = 0; i < 4; ++i) {
+				if (i == c) continue;
+				const float f = a[i][c];
+				for (int j = 0; j < 8; ++j) a[i][j] -= f * a[c][j];
+			}
+		}
+		mat4 ret;
+		for (int i = 0; i < 4; ++i) for (int j = 0; j < 4; ++j) ret[i][j] = a[i][j + 4];
+		return ret;
+	}
+
+	class quaternion_class {
+	public:
+		float x, y, z, w;
+		static const quaternion_class identity;
+		quaternion_class () : x(0), y(0), z(0), w(1) { }
+	};
+}
+
+namespace sx {
+	inline sxsdk::vec3 product (const sxsdk::vec3& a, const sxsdk::vec3& b) {
+		return sxsdk::vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+	inline float inner_product (const sxsdk::vec3& a, const sxsdk::vec3& b) {
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+}
+
+//------------------------------------------------------------------.
+/**
+ * 参照カウンタを持つインターフェイスのラッパー.
+ * シム内のオブジェクトは所有者が解放するため、ここでは解放しない.
+ */
+template<class T> class compointer {
+private:
+	T* m_p;
+public:
+	compointer (T* p = 0) : m_p(p) { }
+	T* operator -> () const { return m_p; }
+	T& operator * () const { return *m_p; }
+	operator T* () const { return m_p; }
+	T* get () const { return m_p; }
+};
+
+namespace sxsdk {
+	namespace enums {
+		enum shape_type { none = 0, part = 1, polygon_mesh = 2, line = 3, disk = 4, sphere = 5 };
+		enum part_type { simple_part = 0, ball_joint = 1, bone_joint = 2 };
+		enum selection_mode { vertex_selection_mode = 0, edge_selection_mode = 1, face_selection_mode = 2 };
+		enum skin_type { no_skin = 0, classic_skin = 1, vertex_blend_skin = 2 };
+	}
+
+	class shape_class;
+	class scene_interface;
+
+	/**
+	 * メモリ上で読み書きするstream.
+	 */
+	class stream_interface {
+	private:
+		std::vector<unsigned char> m_buffer;
+		int m_pointer;
+
+	public:
+		stream_interface () : m_pointer(0) { }
+
+		int get_size () const { return (int)m_buffer.size(); }
+		void set_size (const int size) { m_buffer.resize(size); if (m_pointer > size) m_pointer = size; }
+		int get_pointer () const { return m_pointer; }
+		void set_pointer (const int p) { m_pointer = p; }
+
+		void write (const int size, const void* data) {
+			if (size <= 0) return;
+			if ((int)m_buffer.size() < m_pointer + size) m_buffer.resize(m_pointer + size);
+			std::memcpy(&m_buffer[m_pointer], data, size);
+			m_pointer += size;
+		}
+		void read (const int size, void* data) {
+			if (size <= 0) return;
+			if (m_pointer < 0 || m_pointer + size > (int)m_buffer.size()) throw "stream_interface::read : out of range";
+			std::memcpy(data, &m_buffer[m_pointer], size);
+			m_pointer += size;
+		}
+		void write_int (const int v) { write(sizeof(int), &v); }
+		void write_float (const float v) { write(sizeof(float), &v); }
+		void write_uchar (const unsigned char v) { write(1, &v); }
+		void read_int (int& v) { read(sizeof(int), &v); }
+		void read_float (float& v) { read(sizeof(float), &v); }
+		void read_uchar (unsigned char& v) { read(1, &v); }
+	};
+
+	class skin_bind_class {
+	public:
+		shape_class* shape;
+		float weight;
+		skin_bind_class () : shape(0), weight(0.0f) { }
+		shape_class* get_shape () const { return shape; }
+		float get_weight () const { return weight; }
+	};
+
+	class skin_class {
+	public:
+		std::vector<skin_bind_class> binds;
+		int get_number_of_binds () const { return (int)binds.size(); }
+		skin_bind_class& get_bind (const int i) { return binds[i]; }
+		const skin_bind_class& get_bind (const int i) const { return binds[i]; }
+	};
+
+	class vertex_class {
+	public:
+		vec3 position;
+		bool active;
+		skin_class skin;
+		vertex_class () : active(false) { }
+		const vec3& get_position () const { return position; }
+		void set_position (const vec3& v) { position = v; }
+		bool get_active () const { return active; }
+		void set_active (const bool f) { active = f; }
+		skin_class& get_skin () { return skin; }
+	};
+
+	class face_class {
+	public:
+		std::vector<int> indices;
+		int get_number_of_vertices () const { return (int)indices.size(); }
+		void get_vertex_indices (int* list) const { for (size_t i = 0; i < indices.size(); ++i) list[i] = indices[i]; }
+		void set_vertex_indices (const int n, const int* list) { indices.assign(list, list + n); }
+	};
+
+	class bone_joint_interface {
+	public:
+		mat4 matrix;
+		vec3 offset;
+		quaternion_class rotation;
+		vec3 axis_dir;
+		float size;
+		bool auto_direction;
+
+		bone_joint_interface () : matrix(mat4::identity), axis_dir(1, 0, 0), size(1.0f), auto_direction(false) { }
+		mat4 get_matrix () const { return matrix; }
+		float get_size () const { return size; }
+		void set_size (const float s) { size = s; }
+		bool get_auto_direction () const { return auto_direction; }
+		void set_auto_direction (const bool f) { auto_direction = f; }
+		vec3 get_axis_dir () const { return axis_dir; }
+		void set_axis_dir (const vec3& v) { axis_dir = v; }
+		vec3 get_offset () const { return offset; }
+		void set_offset (const vec3& v) { offset = v; }
+		quaternion_class get_rotation () const { return rotation; }
+		void set_rotation (const quaternion_class& q) { rotation = q; }
+	};
+
+	class polygon_mesh_class;
+	class part_class;
+	class polygon_mesh_saver_class;
+
+	/**
+	 * 形状クラス.
+	 * get_son()は先頭のダミー形状を返し、get_bro()で子形状をたどる (Shade3Dのリンク構造と同じ).
+	 */
+	class shape_class {
+	public:
+		int type;
+		int partType;
+		std::string name;
+		mat4 transformation;
+		shape_class* dad;
+		shape_class* son;
+		shape_class* bro;
+		scene_interface* scene;
+
+		std::vector<vertex_class> vertices;
+		std::vector<face_class> faces;
+		std::vector<int> removeFlags;
+		int skinType;
+		bone_joint_interface bone;
+		std::map<sx::uuid_class, stream_interface*> streams;
+
+		shape_class () : type(enums::none), partType(enums::simple_part), transformation(mat4::identity), dad(0), son(0), bro(0), scene(0), skinType(enums::no_skin) { }
+		virtual ~shape_class () {
+			for (std::map<sx::uuid_class, stream_interface*>::iterator it = streams.begin(); it != streams.end(); ++it) delete it->second;
+			shape_class* p = son;
+			while (p) { shape_class* n = p->bro; delete p; p = n; }
+		}
+
+		int get_type () const { return type; }
+		void* get_handle () const { return (void *)this; }
+		const char* get_name () const { return name.c_str(); }
+		void set_name (const char* n) { name = n; }
+
+		bool has_son () const { return son != 0; }
+		shape_class* get_son () const { return son; }
+		bool has_bro () const { return bro != 0; }
+		shape_class* get_bro () const { return bro; }
+		bool has_dad () const { return dad != 0; }
+		shape_class* get_dad () const { return dad; }
+
+		scene_interface* get_scene_interface () const { return scene; }
+
+		mat4 get_transformation () const { return transformation; }
+		mat4 get_local_to_world_matrix () const {
+			mat4 m = mat4::identity;
+			for (const shape_class* p = dad; p; p = p->dad) {
+				if (p->type == enums::none) continue;
+				m = m * p->transformation;
+			}
+			return m;
+		}
+
+		int get_total_number_of_control_points () const { return (int)vertices.size(); }
+
+		polygon_mesh_class& get_polygon_mesh ();
+		part_class& get_part ();
+		bone_joint_interface* get_bone_joint_interface () { return &bone; }
+
+		stream_interface* create_attribute_stream_interface_with_uuid (const sx::uuid_class& uuid) {
+			std::map<sx::uuid_class, stream_interface*>::iterator it = streams.find(uuid);
+			if (it != streams.end()) return it->second;
+			stream_interface* s = new stream_interface();
+			streams[uuid] = s;
+			return s;
+		}
+		stream_interface* get_attribute_stream_interface_with_uuid (const sx::uuid_class& uuid) {
+			std::map<sx::uuid_class, stream_interface*>::iterator it = streams.find(uuid);
+			if (it == streams.end()) return 0;
+			return it->second;
+		}
+		void delete_attribute_with_uuid (const sx::uuid_class& uuid) {
+			std::map<sx::uuid_class, stream_interface*>::iterator it = streams.find(uuid);
+			if (it == streams.end()) return;
+			delete it->second;
+			streams.erase(it);
+		}
+	};
+
+	class part_class : public shape_class {
+	public:
+		int get_part_type () const { return partType; }
+	};
+
+	/**
+	 * 頂点座標を効率よく取得するためのクラス.
+	 */
+	class polygon_mesh_saver_class {
+	private:
+		const shape_class* m_shape;
+	public:
+		explicit polygon_mesh_saver_class (const shape_class* shape) : m_shape(shape) { }
+		vec3 get_point (const int i) const { return m_shape->vertices[i].position; }
+		void release () { delete this; }
+	};
+
+	class polygon_mesh_class : public shape_class {
+	public:
+		vertex_class& vertex (const int i) { return vertices[i]; }
+		face_class& face (const int i) { return faces[i]; }
+		int get_number_of_faces () const { return (int)faces.size(); }
+		int get_skin_type () const { return skinType; }
+		polygon_mesh_saver_class* get_polygon_mesh_saver () { return new polygon_mesh_saver_class(this); }
+
+		int get_number_of_active_control_points () const {
+			int cou = 0;
+			for (size_t i = 0; i < vertices.size(); ++i) if (vertices[i].active) cou++;
+			return cou;
+		}
+		void get_active_vertex_indices (int* list) const {
+			int iPos = 0;
+			for (size_t i = 0; i < vertices.size(); ++i) if (vertices[i].active) list[iPos++] = (int)i;
+		}
+		void select_all (const bool f) { for (size_t i = 0; i < vertices.size(); ++i) vertices[i].active = f; }
+
+		void append_point (const vec3& v) { vertices.push_back(vertex_class()); vertices.back().position = v; }
+		void append_face (const int n, const int* list) { faces.push_back(face_class()); faces.back().set_vertex_indices(n, list); }
+
+		void begin_removing_control_points () { removeFlags.assign(vertices.size(), 0); }
+		void remove_control_point (const int i) { removeFlags[i] = 1; }
+		void end_removing_control_points () {
+			std::vector<int> newIndex(vertices.size(), -1);
+			std::vector<vertex_class> vers;
+			for (size_t i = 0; i < vertices.size(); ++i) {
+				if (removeFlags[i]) continue;
+				newIndex[i] = (int)vers.size();
+				vers.push_back(vertices[i]);
+			}
+			vertices.swap(vers);
+			for (size_t i = 0; i < faces.size(); ++i) {
+				std::vector<int>& ind = faces[i].indices;
+				for (size_t j = 0; j < ind.size(); ++j) ind[j] = (ind[j] >= 0) ? newIndex[ind[j]] : -1;
+			}
+			removeFlags.clear();
+		}
+		void cleanup_redundant_vertices () { }
+		void update () { }
+		void make_edges () { }
+	};
+
+	inline polygon_mesh_class& shape_class::get_polygon_mesh () { return static_cast<polygon_mesh_class&>(*this); }
+	inline part_class& shape_class::get_part () { return static_cast<part_class&>(*this); }
+
+	/**
+	 * シーン.
+	 */
+	class scene_interface {
+	private:
+		part_class m_root;
+		shape_class* m_active;
+
+	public:
+		scene_interface () : m_active(0) {
+			m_root.type = enums::part;
+			m_root.scene = this;
+		}
+
+		shape_class& get_shape () { return m_root; }
+		shape_class& active_shape () { return m_active ? *m_active : (shape_class &)m_root; }
+		void set_active_shape (shape_class* s) { m_active = s; }
+
+		shape_class* get_shape_by_handle (void* handle) { return m_find(&m_root, handle); }
+
+		/**
+		 * 親形状の末尾に形状を追加 (シム独自).
+		 */
+		template<class T> T* append_shape (shape_class& parent, const int type, const char* name) {
+			T* s = new T();
+			s->type  = type;
+			s->name  = name ? name : "";
+			s->scene = this;
+			s->dad   = &parent;
+			if (!parent.son) {
+				parent.son = new shape_class();
+				parent.son->dad = &parent;
+				parent.son->scene = this;
+			}
+			shape_class* p = parent.son;
+			while (p->bro) p = p->bro;
+			p->bro = s;
+			return s;
+		}
+		polygon_mesh_class* append_polygon_mesh (shape_class& parent, const char* name) {
+			return append_shape<polygon_mesh_class>(parent, enums::polygon_mesh, name);
+		}
+		part_class* append_part (shape_class& parent, const char* name, const int partType = enums::simple_part) {
+			part_class* p = append_shape<part_class>(parent, enums::part, name);
+			p->partType = partType;
+			return p;
+		}
+
+	private:
+		shape_class* m_find (shape_class* s, void* handle) {
+			if (s->get_handle() == handle && s->type != enums::none) return s;
+			for (shape_class* p = s->son; p; p = p->bro) {
+				shape_class* r = m_find(p, handle);
+				if (r) return r;
+			}
+			return 0;
+		}
+	};
+
+	class shade_interface {
+	public:
+		scene_interface* m_scene;
+		shade_interface () : m_scene(NULL) { }
+		const char* gettext (const char* id) { return id; }
+		scene_interface* get_scene_interface () { return m_scene; }
+	};
+
+	class attribute_interface {
+	public:
+		virtual ~attribute_interface () { }
+	};
+}
+
+#endif
@@ -0,0 +1,7 @@
+﻿/**
+ * Shade3D SDKの代替ヘッダの静的メンバの定義.
+ */
+#include "sxsdk.cxx"
+
+const sxsdk::mat4 sxsdk::mat4::identity(sxsdk::vec4(1, 0, 0, 0), sxsdk::vec4(0, 1, 0, 0), sxsdk::vec4(0, 0, 1, 0), sxsdk::vec4(0, 0, 0, 1));
+const sxsdk::quaternion_class sxsdk::quaternion_class::identity;
@@ -4,6 +4,7 @@
  */
 
 #include "BSPPoint.h"
+#include "ProfileUtil.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -75,6 +76,8 @@ int CBSPPoint::m_selectAxis (const sxsdk::vec3& bbMin, const sxsdk::vec3& bbMax)
  */
 void CBSPPoint::build ()
 {
+	CProfileScope profileScope(profile_bsp_build);
+
 	if (m_vertices.size() == 0) return;
 
 	m_clear();
@@ -192,6 +195,8 @@ void CBSPPoint::m_build (const int depth, const int index)
  */
 int CBSPPoint::searchVertices (const sxsdk::vec3& v, const float distance, std::vector<int>& indices)
 {
+	CProfileScope profileScope(profile_bsp_search);
+
 	sxsdk::vec3 v2 = v;
 	{
 		const BSP_POINT_NODE& node = m_nodes[0];
@@ -0,0 +1,286 @@
+﻿/**
+ *  @file   BVHTriangle.cpp
+ *  @brief  三角形のBVH(Bounding Volume Hierarchy)。指定位置に最も近い三角形を検索する.
+ */
+
+#include "BVHTriangle.h"
+
+#include <algorithm>
+
+namespace {
+	/**
+	 * 点とバウンディングボックスの距離の2乗.
+	 */
+	inline float calcBoxDistance2 (const sxsdk::vec3& p, const sxsdk::vec3& bbMin, const sxsdk::vec3& bbMax) {
+		const float dx = std::max(0.0f, std::max(bbMin.x - p.x, p.x - bbMax.x));
+		const float dy = std::max(0.0f, std::max(bbMin.y - p.y, p.y - bbMax.y));
+		const float dz = std::max(0.0f, std::max(bbMin.z - p.z, p.z - bbMax.z));
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	inline float dot3 (const sxsdk::vec3& a, const sxsdk::vec3& b) {
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	/**
+	 * 三角形の中心の指定軸の値で比較.
+	 */
+	class CCenterCompare {
+	private:
+		const std::vector<sxsdk::vec3>& m_centers;
+		int m_axis;
+	public:
+		CCenterCompare (const std::vector<sxsdk::vec3>& centers, const int axis) : m_centers(centers), m_axis(axis) { }
+		bool operator () (const int a, const int b) const {
+			const sxsdk::vec3& ca = m_centers[a];
+			const sxsdk::vec3& cb = m_centers[b];
+			if (m_axis == 0) return ca.x < cb.x;
+			if (m_axis == 1) return ca.y < cb.y;
+			return ca.z < cb.z;
+		}
+	};
+}
+
+CBVHTriangle::CBVHTriangle (const std::vector<sxsdk::vec3>& vertices, const std::vector<int>& triangles)
+{
+	m_vertices  = vertices;
+	m_triangles.clear();
+	m_maxLeafTriangles = 4;
+
+	// 頂点インデックスが範囲外の三角形は除外.
+	const int vCou   = (int)vertices.size();
+	const int triCou = (int)(triangles.size() / 3);
+	m_triangles.reserve(triCou * 3);
+	for (int i = 0; i < triCou; ++i) {
+		const int* tri = &triangles[i * 3];
+		if (tri[0] < 0 || tri[0] >= vCou || tri[1] < 0 || tri[1] >= vCou || tri[2] < 0 || tri[2] >= vCou) continue;
+		m_triangles.push_back(tri[0]);
+		m_triangles.push_back(tri[1]);
+		m_triangles.push_back(tri[2]);
+	}
+}
+
+CBVHTriangle::~CBVHTriangle ()
+{
+}
+
+/**
+ * 空間分割.
+ */
+void CBVHTriangle::build ()
+{
+	m_nodes.clear();
+	const int triCou = getTrianglesCount();
+	if (triCou == 0) return;
+
+	m_triIndices.resize(triCou);
+	m_centers.resize(triCou);
+	for (int i = 0; i < triCou; ++i) {
+		const int* tri = getTriangle(i);
+		m_triIndices[i] = i;
+		m_centers[i] = (m_vertices[tri[0]] + m_vertices[tri[1]] + m_vertices[tri[2]]) * (1.0f / 3.0f);
+	}
+
+	m_nodes.reserve((triCou / m_maxLeafTriangles + 1) * 2);
+	m_nodes.push_back(BVH_TRIANGLE_NODE());
+	m_build(0, 0, triCou);
+
+	m_centers.clear();
+}
+
+void CBVHTriangle::m_build (const int index, const int triStart, const int triCount)
+{
+	// 三角形を内包するバウンディングボックスと、中心のバウンディングボックスを計算.
+	sxsdk::vec3 bbMin, bbMax, cMin, cMax;
+	for (int i = 0; i < triCount; ++i) {
+		const int triIndex = m_triIndices[triStart + i];
+		const int* tri = getTriangle(triIndex);
+		for (int j = 0; j < 3; ++j) {
+			const sxsdk::vec3& v = m_vertices[tri[j]];
+			if (i == 0 && j == 0) {
+				bbMin = bbMax = v;
+			} else {
+				bbMin.x = std::min(bbMin.x, v.x);
+				bbMin.y = std::min(bbMin.y, v.y);
+				bbMin.z = std::min(bbMin.z, v.z);
+				bbMax.x = std::max(bbMax.x, v.x);
+				bbMax.y = std::max(bbMax.y, v.y);
+				bbMax.z = std::max(bbMax.z, v.z);
+			}
+		}
+		const sxsdk::vec3& c = m_centers[triIndex];
+		if (i == 0) {
+			cMin = cMax = c;
+		} else {
+			cMin.x = std::min(cMin.x, c.x);
+			cMin.y = std::min(cMin.y, c.y);
+			cMin.z = std::min(cMin.z, c.z);
+			cMax.x = std::max(cMax.x, c.x);
+			cMax.y = std::max(cMax.y, c.y);
+			cMax.z = std::max(cMax.z, c.z);
+		}
+	}
+	{
+		BVH_TRIANGLE_NODE& node = m_nodes[index];
+		node.bbMin     = bbMin;
+		node.bbMax     = bbMax;
+		node.left_node = -1;
+		node.tri_start = triStart;
+		node.tri_count = triCount;
+	}
+	if (triCount <= m_maxLeafTriangles) return;
+
+	// 中心が最も広がっている軸で、中央値で分割.
+	const sxsdk::vec3 cSize = cMax - cMin;
+	int axis = 0;
+	if (cSize.y > cSize.x && cSize.y >= cSize.z) axis = 1;
+	else if (cSize.z > cSize.x && cSize.z > cSize.y) axis = 2;
+
+	const int halfCount = triCount / 2;
+	std::nth_element(m_triIndices.begin() + triStart, m_triIndices.begin() + triStart + halfCount, m_triIndices.begin() + triStart + triCount, CCenterCompare(m_centers, axis));
+
+	const int index_left = (int)m_nodes.size();
+	m_nodes.resize(m_nodes.size() + 2);
+	m_nodes[index].left_node = index_left;
+	m_nodes[index].tri_count = 0;
+
+	m_build(index_left, triStart, halfCount);
+	m_build(index_left + 1, triStart + halfCount, triCount - halfCount);
+}
+
+/**
+ * 三角形の最近接点を計算.
+ * (Real-Time Collision Detection, Christer Ericson の手法).
+ */
+void CBVHTriangle::m_closestPointOnTriangle (const int triIndex, const sxsdk::vec3& p, sxsdk::vec3& closestP, float bary[3]) const
+{
+	const int* tri = getTriangle(triIndex);
+	const sxsdk::vec3& a = m_vertices[tri[0]];
+	const sxsdk::vec3& b = m_vertices[tri[1]];
+	const sxsdk::vec3& c = m_vertices[tri[2]];
+
+	const sxsdk::vec3 ab = b - a;
+	const sxsdk::vec3 ac = c - a;
+	const sxsdk::vec3 ap = p - a;
+	const float d1 = dot3(ab, ap);
+	const float d2 = dot3(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) {
+		bary[0] = 1.0f; bary[1] = 0.0f; bary[2] = 0.0f;
+		closestP = a;
+		return;
+	}
+
+	const sxsdk::vec3 bp = p - b;
+	const float d3 = dot3(ab, bp);
+	const float d4 = dot3(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) {
+		bary[0] = 0.0f; bary[1] = 1.0f; bary[2] = 0.0f;
+		closestP = b;
+		return;
+	}
+
+	const float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		const float v = (d1 - d3 != 0.0f) ? d1 / (d1 - d3) : 0.0f;
+		bary[0] = 1.0f - v; bary[1] = v; bary[2] = 0.0f;
+		closestP = a + ab * v;
+		return;
+	}
+
+	const sxsdk::vec3 cp = p - c;
+	const float d5 = dot3(ab, cp);
+	const float d6 = dot3(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) {
+		bary[0] = 0.0f; bary[1] = 0.0f; bary[2] = 1.0f;
+		closestP = c;
+		return;
+	}
+
+	const float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		const float w = (d2 - d6 != 0.0f) ? d2 / (d2 - d6) : 0.0f;
+		bary[0] = 1.0f - w; bary[1] = 0.0f; bary[2] = w;
+		closestP = a + ac * w;
+		return;
+	}
+
+	const float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		const float dd = (d4 - d3) + (d5 - d6);
+		const float w = (dd != 0.0f) ? (d4 - d3) / dd : 0.0f;
+		bary[0] = 0.0f; bary[1] = 1.0f - w; bary[2] = w;
+		closestP = b + (c - b) * w;
+		return;
+	}
+
+	const float sum = va + vb + vc;
+	if (sum == 0.0f) {
+		// 縮退した三角形.
+		bary[0] = 1.0f; bary[1] = 0.0f; bary[2] = 0.0f;
+		closestP = a;
+		return;
+	}
+	const float denom = 1.0f / sum;
+	const float v = vb * denom;
+	const float w = vc * denom;
+	bary[0] = 1.0f - v - w; bary[1] = v; bary[2] = w;
+	closestP = a + ab * v + ac * w;
+}
+
+/**
+ * 指定位置に最も近い三角形上の点を検索.
+ */
+bool CBVHTriangle::searchClosestPoint (const sxsdk::vec3& p, const float maxDistance, BVH_TRIANGLE_HIT& hit) const
+{
+	hit = BVH_TRIANGLE_HIT();
+	if (m_nodes.empty()) return false;
+
+	float minDist2 = (maxDistance > 0.0f) ? (maxDistance * maxDistance) : -1.0f;
+	sxsdk::vec3 closestP;
+	float bary[3];
+
+	// ノードを近い順に、スタックを使ってたどる.
+	int stack[128];
+	int stackCou = 0;
+	stack[stackCou++] = 0;
+	while (stackCou > 0) {
+		const BVH_TRIANGLE_NODE& node = m_nodes[ stack[--stackCou] ];
+		if (minDist2 >= 0.0f && calcBoxDistance2(p, node.bbMin, node.bbMax) > minDist2) continue;
+
+		if (node.left_node < 0) {
+			for (int i = 0; i < node.tri_count; ++i) {
+				const int triIndex = m_triIndices[node.tri_start + i];
+				m_closestPointOnTriangle(triIndex, p, closestP, bary);
+				const sxsdk::vec3 dd = closestP - p;
+				const float dist2 = dot3(dd, dd);
+				if (minDist2 < 0.0f || dist2 <= minDist2) {
+					minDist2 = dist2;
+					hit.triIndex = triIndex;
+					hit.position = closestP;
+					hit.bary[0]  = bary[0];
+					hit.bary[1]  = bary[1];
+					hit.bary[2]  = bary[2];
+				}
+			}
+			continue;
+		}
+
+		// 遠い子ノードを先に積み、近い子ノードを先に処理する.
+		if (stackCou + 2 > 128) continue;
+		const int index_left  = node.left_node;
+		const int index_right = node.left_node + 1;
+		const float distL = calcBoxDistance2(p, m_nodes[index_left].bbMin, m_nodes[index_left].bbMax);
+		const float distR = calcBoxDistance2(p, m_nodes[index_right].bbMin, m_nodes[index_right].bbMax);
+		if (distL <= distR) {
+			stack[stackCou++] = index_right;
+			stack[stackCou++] = index_left;
+		} else {
+			stack[stackCou++] = index_left;
+			stack[stackCou++] = index_right;
+		}
+	}
+
+	if (hit.triIndex < 0) return false;
+	hit.distance = std::sqrt(minDist2);
+	return true;
+}
@@ -0,0 +1,100 @@
+﻿/**
+ *  @file   BVHTriangle.h
+ *  @brief  三角形のBVH(Bounding Volume Hierarchy)。指定位置に最も近い三角形を検索する.
+ */
+
+#ifndef _BVHTRIANGLE_H
+#define _BVHTRIANGLE_H
+
+#include "GlobalHeader.h"
+
+#include <vector>
+
+class BVH_TRIANGLE_NODE {
+public:
+	sxsdk::vec3 bbMin, bbMax;
+	int left_node;						// 子ノード (右の子はleft_node + 1)。末端の場合は-1.
+	int tri_start;						// 末端の場合の、三角形インデックスの開始位置.
+	int tri_count;						// 末端の場合の、三角形数.
+
+public:
+	BVH_TRIANGLE_NODE () {
+		left_node = -1;
+		tri_start = 0;
+		tri_count = 0;
+	}
+};
+
+/**
+ * 最近接点の検索結果.
+ */
+class BVH_TRIANGLE_HIT {
+public:
+	int triIndex;						// 三角形番号 (見つからない場合は-1).
+	sxsdk::vec3 position;				// 三角形上の最近接点.
+	float bary[3];						// 最近接点の三角形上での重心座標.
+	float distance;						// 指定位置との距離.
+
+public:
+	BVH_TRIANGLE_HIT () {
+		triIndex = -1;
+		bary[0] = 1.0f;
+		bary[1] = bary[2] = 0.0f;
+		distance = 0.0f;
+	}
+};
+
+class CBVHTriangle {
+private:
+	std::vector<sxsdk::vec3> m_vertices;
+	std::vector<int> m_triangles;			// 三角形ごとの3つの頂点インデックス.
+	std::vector<int> m_triIndices;			// ノードから参照する三角形番号.
+	std::vector<sxsdk::vec3> m_centers;		// 三角形の中心 (構築時のみ使用).
+
+	std::vector<BVH_TRIANGLE_NODE> m_nodes;
+
+	int m_maxLeafTriangles;					// 末端のノードが持つ三角形の最大数.
+
+	void m_build (const int index, const int triStart, const int triCount);
+
+	/**
+	 * 三角形の最近接点を計算.
+	 */
+	void m_closestPointOnTriangle (const int triIndex, const sxsdk::vec3& p, sxsdk::vec3& closestP, float bary[3]) const;
+
+public:
+	CBVHTriangle (const std::vector<sxsdk::vec3>& vertices, const std::vector<int>& triangles);
+	~CBVHTriangle ();
+
+	/**
+	 * 三角形数を取得.
+	 */
+	int getTrianglesCount () const { return (int)(m_triangles.size() / 3); }
+
+	/**
+	 * ノード数を取得.
+	 */
+	int getNodesCount () const { return (int)m_nodes.size(); }
+
+	/**
+	 * 三角形の頂点インデックスを取得.
+	 */
+	inline const int* getTriangle (const int triIndex) const { return &m_triangles[triIndex * 3]; }
+
+	/**
+	 * 空間分割.
+	 */
+	void build ();
+
+	/**
+	 * 指定位置に最も近い三角形上の点を検索.
+	 * 構築後は読み込みのみのため、複数スレッドから同時に呼び出せる.
+	 * @param[in]  p            検索位置.
+	 * @param[in]  maxDistance  検索する最大距離 (0以下の場合は制限なし).
+	 * @param[out] hit          検索結果.
+	 * @return 見つかった場合はtrue.
+	 */
+	bool searchClosestPoint (const sxsdk::vec3& p, const float maxDistance, BVH_TRIANGLE_HIT& hit) const;
+};
+
+#endif
@@ -0,0 +1,148 @@
+﻿/**
+ * ボーン階層のスナップショット.
+ */
+#include "BoneSkeleton.h"
+#include "BoneUtil.h"
+#include "ProfileUtil.h"
+#include "TraceUtil.h"
+
+CBoneSkeleton::CBoneSkeleton ()
+{
+	clear();
+}
+
+void CBoneSkeleton::clear ()
+{
+	m_shapes.clear();
+	m_parents.clear();
+	m_firstChildren.clear();
+	m_localMatrices.clear();
+	m_worldMatrices.clear();
+	m_centers.clear();
+	m_sizes.clear();
+	m_axisDirs.clear();
+	m_flags.clear();
+	m_rootLWMatrix = sxsdk::mat4::identity;
+}
+
+/**
+ * ボーンルート以下のボーン階層を取得.
+ * ボーン以外の形状とその子は含まない.
+ * @param[in] boneRoot  対象のボーンルート.
+ * @return ボーン数.
+ */
+int CBoneSkeleton::build (sxsdk::shape_class* boneRoot)
+{
+	CProfileScope profileScope(profile_bone_skeleton_build);
+	CTraceScope traceScope("CBoneSkeleton::build");
+
+	clear();
+	if (!boneRoot || !BoneUtil::isBone(*boneRoot)) return 0;
+
+	try {
+		// ボーンルートの親までの変換行列のみを取得し、子はそれぞれの親の変換行列から計算する.
+		m_rootLWMatrix = boneRoot->get_local_to_world_matrix();
+
+		// 再帰と同じ順(親、子の先頭から順)となるように、子は逆順にスタックに積む.
+		std::vector< std::pair<sxsdk::shape_class *, int> > stack;
+		std::vector<sxsdk::shape_class *> children;
+		stack.push_back(std::make_pair(boneRoot, -1));
+		while (!stack.empty()) {
+			sxsdk::shape_class* shape = stack.back().first;
+			const int parentIndex     = stack.back().second;
+			stack.pop_back();
+
+			const int index = (int)m_shapes.size();
+			compointer<sxsdk::bone_joint_interface> bone(shape->get_bone_joint_interface());
+			const sxsdk::mat4 m = bone->get_matrix();
+			const sxsdk::mat4 lwMat = (parentIndex >= 0) ? m_worldMatrices[parentIndex] : m_rootLWMatrix;
+
+			m_shapes.push_back(shape);
+			m_parents.push_back(parentIndex);
+			m_firstChildren.push_back(-1);
+			m_localMatrices.push_back(m);
+			m_worldMatrices.push_back(shape->get_transformation() * lwMat);
+
+			// シーケンスOff時の中心位置 (sxsdk::vec3(0, 0, 0) * m * lwMat と同じ).
+			m_centers.push_back(sxsdk::vec3(m[3][0], m[3][1], m[3][2]) * lwMat);
+			m_sizes.push_back(bone->get_size());
+			m_axisDirs.push_back(bone->get_axis_dir());
+			m_flags.push_back(bone->get_auto_direction() ? (unsigned char)bone_flag_auto_direction : (unsigned char)0);
+
+			if (!shape->has_son()) continue;
+			children.clear();
+			sxsdk::shape_class* pShape = shape->get_son();
+			while (pShape->has_bro()) {
+				pShape = pShape->get_bro();
+				children.push_back(pShape);
+			}
+			if (children.empty()) continue;
+
+			// 先頭の子形状がボーンの場合は、スタックの最後に積むため次のインデックスとなる.
+			if (BoneUtil::isBone(*children[0])) m_firstChildren[index] = index + 1;
+			for (int i = (int)children.size() - 1; i >= 0; --i) {
+				if (BoneUtil::isBone(*children[i])) stack.push_back(std::make_pair(children[i], index));
+			}
+		}
+	} catch (...) {
+		clear();
+	}
+
+	traceScope.setEndArg("bones", (long long)m_shapes.size());
+	return (int)m_shapes.size();
+}
+
+/**
+ * 変更されたサイズと向きを形状に反映.
+ * @return 変更したボーン数.
+ */
+int CBoneSkeleton::commit ()
+{
+	CProfileScope profileScope(profile_bone_skeleton_commit);
+
+	const unsigned char modifiedFlags = (unsigned char)(bone_flag_size_modified | bone_flag_axis_dir_modified);
+	int modifiedCou = 0;
+	const int bonesCou = (int)m_shapes.size();
+	for (int i = 0; i < bonesCou; ++i) {
+		if ((m_flags[i] & modifiedFlags) == 0) continue;
+		try {
+			compointer<sxsdk::bone_joint_interface> bone(m_shapes[i]->get_bone_joint_interface());
+			if (m_flags[i] & bone_flag_size_modified) bone->set_size(m_sizes[i]);
+			if (m_flags[i] & bone_flag_axis_dir_modified) bone->set_axis_dir(m_axisDirs[i]);
+			modifiedCou++;
+		} catch (...) { }
+		m_flags[i] &= (unsigned char)~modifiedFlags;
+	}
+	return modifiedCou;
+}
+
+/**
+ * ボーンサイズを変更 (commitで形状に反映).
+ */
+void CBoneSkeleton::setSize (const int index, const float size)
+{
+	m_sizes[index] = size;
+	m_flags[index] |= (unsigned char)bone_flag_size_modified;
+}
+
+/**
+ * ボーンの向きを変更 (commitで形状に反映).
+ */
+void CBoneSkeleton::setAxisDir (const int index, const sxsdk::vec3& dir)
+{
+	m_axisDirs[index] = dir;
+	m_flags[index] |= (unsigned char)bone_flag_axis_dir_modified;
+}
+
+/**
+ * ワールド座標でのボーンの向きを取得 (正規化済み).
+ * ボーンの向きはボーンのローカル座標のため、ワールド変換行列の回転/スケール部分のみを掛ける.
+ */
+sxsdk::vec3 CBoneSkeleton::getWorldAxisDir (const int index) const
+{
+	const sxsdk::mat4& m = m_worldMatrices[index];
+	const sxsdk::vec3& v = m_axisDirs[index];
+	return normalize(sxsdk::vec3(v.x * m[0][0] + v.y * m[1][0] + v.z * m[2][0],
+								 v.x * m[0][1] + v.y * m[1][1] + v.z * m[2][1],
+								 v.x * m[0][2] + v.y * m[1][2] + v.z * m[2][2]));
+}
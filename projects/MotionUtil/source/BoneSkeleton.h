@@ -0,0 +1,96 @@
+﻿/**
+ * ボーン階層のスナップショット.
+ * ボーンルート以下のボーンを親から子の順(深さ優先)に1度だけたどり、.
+ * 親のインデックス/行列/中心位置/サイズ/向きを配列で保持する.
+ * 変更はスナップショット上で行い、commitでまとめて形状に反映する.
+ */
+#ifndef _BONESKELETON_H
+#define _BONESKELETON_H
+
+#include "GlobalHeader.h"
+
+#include <vector>
+
+/**
+ * ボーンごとのフラグ.
+ */
+enum BONE_SKELETON_FLAG {
+	bone_flag_auto_direction    = 0x01,		// ボーンの向きを自動で決める.
+	bone_flag_size_modified     = 0x02,		// サイズが変更された (commitで反映).
+	bone_flag_axis_dir_modified = 0x04,		// 向きが変更された (commitで反映).
+};
+
+/**
+ * ボーン階層のスナップショット.
+ * 配列のインデックスは親から子の順(深さ優先)で、親のインデックスは常に子より小さい.
+ */
+class CBoneSkeleton
+{
+private:
+	std::vector<sxsdk::shape_class *> m_shapes;		// ボーン形状.
+	std::vector<int> m_parents;						// 親ボーンのインデックス (ボーンルートの場合は-1).
+	std::vector<int> m_firstChildren;				// 先頭の子形状がボーンの場合はそのインデックス (それ以外は-1).
+	std::vector<sxsdk::mat4> m_localMatrices;		// シーケンスOff時のボーンの変換行列 (bone->get_matrix()).
+	std::vector<sxsdk::mat4> m_worldMatrices;		// 形状の変換行列を含めたローカルからワールドへの変換行列.
+	std::vector<sxsdk::vec3> m_centers;				// シーケンスOff時のワールド座標での中心位置.
+	std::vector<float> m_sizes;						// ボーンサイズ.
+	std::vector<sxsdk::vec3> m_axisDirs;			// ボーンの向き.
+	std::vector<unsigned char> m_flags;				// BONE_SKELETON_FLAGの組み合わせ.
+	sxsdk::mat4 m_rootLWMatrix;						// ボーンルートの親までのローカルからワールドへの変換行列.
+
+public:
+	CBoneSkeleton ();
+
+	void clear ();
+
+	/**
+	 * ボーンルート以下のボーン階層を取得.
+	 * ボーン以外の形状とその子は含まない.
+	 * @param[in] boneRoot  対象のボーンルート.
+	 * @return ボーン数.
+	 */
+	int build (sxsdk::shape_class* boneRoot);
+
+	/**
+	 * 変更されたサイズと向きを形状に反映.
+	 * @return 変更したボーン数.
+	 */
+	int commit ();
+
+	/**
+	 * ボーン数.
+	 */
+	int getBonesCount () const { return (int)m_shapes.size(); }
+
+	/**
+	 * ボーンを取得.
+	 */
+	sxsdk::shape_class* getShape (const int index) const { return m_shapes[index]; }
+
+	const std::vector<int>& getParents () const { return m_parents; }
+	const std::vector<int>& getFirstChildren () const { return m_firstChildren; }
+	const std::vector<sxsdk::mat4>& getLocalMatrices () const { return m_localMatrices; }
+	const std::vector<sxsdk::mat4>& getWorldMatrices () const { return m_worldMatrices; }
+	const std::vector<sxsdk::vec3>& getCenters () const { return m_centers; }
+	const std::vector<float>& getSizes () const { return m_sizes; }
+	const std::vector<sxsdk::vec3>& getAxisDirs () const { return m_axisDirs; }
+	const std::vector<unsigned char>& getFlags () const { return m_flags; }
+	const sxsdk::mat4& getRootLocalToWorldMatrix () const { return m_rootLWMatrix; }
+
+	/**
+	 * ワールド座標でのボーンの向きを取得 (正規化済み).
+	 */
+	sxsdk::vec3 getWorldAxisDir (const int index) const;
+
+	/**
+	 * ボーンサイズを変更 (commitで形状に反映).
+	 */
+	void setSize (const int index, const float size);
+
+	/**
+	 * ボーンの向きを変更 (commitで形状に反映).
+	 */
+	void setAxisDir (const int index, const sxsdk::vec3& dir);
+};
+
+#endif
@@ -2,87 +2,11 @@
  * ボーン操作関数.
  */
 #include "BoneUtil.h"
+#include "BoneSkeleton.h"
+#include "MathUtil.h"
 
-namespace {
-	/**
-	 * ボーンの向きをそろえる再帰.
-	 */
-	void adjustBonesDirectionLoop (sxsdk::shape_class& shape) {
-		if (!BoneUtil::isBone(shape)) return;
-
-		const sxsdk::mat4 lwMat = shape.get_transformation() * shape.get_local_to_world_matrix();
-		const sxsdk::mat4 wlMat = inv(lwMat);
-
-		bool firstF = true;
-		if (shape.has_son()) {
-			sxsdk::part_class* pPart   = &shape.get_part();
-			sxsdk::shape_class* pShape = shape.get_son();
-			while (pShape->has_bro()) {
-				pShape = pShape->get_bro();
-
-				if (firstF) {
-					firstF = false;
-					if (BoneUtil::isBone(*pShape)) {
-						const sxsdk::vec3 v0 = BoneUtil::getBoneCenter(shape, NULL) * wlMat;
-						const sxsdk::vec3 v1 = BoneUtil::getBoneCenter(*pShape, NULL) * wlMat;
-
-						const sxsdk::vec3 vDir = normalize(v1 - v0);
-						try {
-							compointer<sxsdk::bone_joint_interface> bone(shape.get_bone_joint_interface());
-							if (!(bone->get_auto_direction())) {
-								bone->set_axis_dir(vDir);
-							}
-						} catch (...) { }
-					}
-				}
-				adjustBonesDirectionLoop(*pShape);
-			}
-		}
-	}
-
-	/**
-	 * ボーンの大きさを調整する再帰.
-	 */
-	void resizeBonesLoop (sxsdk::shape_class& shape, sxsdk::shape_class* prevShape) {
-		if (!BoneUtil::isBone(shape)) return;
-
-		float size = 0.0f;
-
-		sxsdk::vec3 center = BoneUtil::getBoneCenter(shape, &size);
-
-		{
-			const float scale = 1.0f;
-			float dist = 0.0f;
-			float sizePrev = size;
-			sxsdk::vec3 centerPrev = center;
-			if (prevShape) {
-				centerPrev = BoneUtil::getBoneCenter(*prevShape, &sizePrev);
-				dist = sxsdk::distance3(centerPrev, center);
-			}
-			if (dist > 0.0f) {
-				size = (dist / 8.0f) * scale;
-				try {
-					compointer<sxsdk::bone_joint_interface> bone(shape.get_bone_joint_interface());
-					bone->set_size(size);
-				} catch (...) { }
-				if (prevShape) {
-					try {
-						compointer<sxsdk::bone_joint_interface> bone(prevShape->get_bone_joint_interface());
-						bone->set_size(size);
-					} catch (...) { }
-				}
-			}
-		}
-
-		if (shape.has_son()) {
-			sxsdk::shape_class* pShape = shape.get_son();
-			while (pShape->has_bro()) {
-				pShape = pShape->get_bro();
-				resizeBonesLoop(*pShape, &shape);
-			}
-		}
-	}
-}
+#include <algorithm>
+#include <cmath>
 
 /**
  * 指定の形状がボーンかどうか.
@@ -127,7 +51,33 @@ sxsdk::vec3 BoneUtil::getBoneCenter (sxsdk::shape_class& shape, float *size)
  */
 void BoneUtil::adjustBonesDirection (sxsdk::shape_class* boneRoot)
 {
-	::adjustBonesDirectionLoop(*boneRoot);
+	CBoneSkeleton skeleton;
+	if (skeleton.build(boneRoot) <= 0) return;
+	BoneUtil::adjustBonesDirection(skeleton);
+	skeleton.commit();
+}
+
+/**
+ * ボーンの向きをそろえる (スナップショット上で変更し、形状には反映しない).
+ * 先頭の子形状がボーンの場合に、その中心位置への向きとする.
+ * ボーンの向きの変更では、ボーンの中心位置は変わらない.
+ */
+void BoneUtil::adjustBonesDirection (CBoneSkeleton& skeleton)
+{
+	const int bonesCou = skeleton.getBonesCount();
+	const std::vector<int>& firstChildren = skeleton.getFirstChildren();
+	const std::vector<sxsdk::mat4>& worldMatrices = skeleton.getWorldMatrices();
+	const std::vector<sxsdk::vec3>& centers = skeleton.getCenters();
+	const std::vector<unsigned char>& flags = skeleton.getFlags();
+
+	for (int i = 0; i < bonesCou; ++i) {
+		const int childIndex = firstChildren[i];
+		if (childIndex < 0 || (flags[i] & bone_flag_auto_direction)) continue;
+
+		// ボーンのローカル座標での、子ボーンの中心位置への向き.
+		const sxsdk::vec3 vDir = normalize(MathUtil::transformDirByInverse(centers[childIndex] - centers[i], worldMatrices[i]));
+		skeleton.setAxisDir(i, vDir);
+	}
 }
 
 /**
@@ -136,5 +86,56 @@ void BoneUtil::adjustBonesDirection (sxsdk::shape_class* boneRoot)
  */
 void BoneUtil::resizeBones (sxsdk::shape_class* boneRoot)
 {
-	::resizeBonesLoop(*boneRoot, NULL);
+	CBoneSkeleton skeleton;
+	if (skeleton.build(boneRoot) <= 0) return;
+	BoneUtil::resizeBones(skeleton);
+	skeleton.commit();
+}
+
+/**
+ * ボーンサイズの自動調整 (スナップショット上で変更し、形状には反映しない).
+ * 親ボーンとの距離の1/8を、ボーンと親ボーンのサイズとする.
+ * 複数の子を持つ場合は、親から子の順で最後に処理した子の距離となる.
+ */
+void BoneUtil::resizeBones (CBoneSkeleton& skeleton)
+{
+	const int bonesCou = skeleton.getBonesCount();
+	const std::vector<int>& parents = skeleton.getParents();
+	const std::vector<sxsdk::vec3>& centers = skeleton.getCenters();
+
+	const float scale = 1.0f;
+	for (int i = 0; i < bonesCou; ++i) {
+		const int parentIndex = parents[i];
+		if (parentIndex < 0) continue;
+
+		const float dist = sxsdk::distance3(centers[parentIndex], centers[i]);
+		if (dist > 0.0f) {
+			const float size = (dist / 8.0f) * scale;
+			skeleton.setSize(i, size);
+			skeleton.setSize(parentIndex, size);
+		}
+	}
+}
+
+/**
+ * ボーンルート以下のすべてのボーンの情報を、親から子の順(深さ優先)で取得.
+ * @return ボーン数 (maxCountより多い場合も、ボーン数を返す).
+ */
+int BoneUtil::getBonesHierarchy (sxsdk::shape_class* boneRoot, const int maxCount, void** shapeHandles, int* parentIndices, sxsdk::vec3* centers, float* sizes, sxsdk::vec3* axisDirs)
+{
+	CBoneSkeleton skeleton;
+	const int bonesCou = skeleton.build(boneRoot);
+	const int cou = std::min(bonesCou, std::max(0, maxCount));
+	if (cou <= 0) return bonesCou;
+
+	if (shapeHandles) {
+		for (int i = 0; i < cou; ++i) shapeHandles[i] = skeleton.getShape(i)->get_handle();
+	}
+	if (parentIndices) std::copy(skeleton.getParents().begin(), skeleton.getParents().begin() + cou, parentIndices);
+	if (centers) std::copy(skeleton.getCenters().begin(), skeleton.getCenters().begin() + cou, centers);
+	if (sizes) std::copy(skeleton.getSizes().begin(), skeleton.getSizes().begin() + cou, sizes);
+	if (axisDirs) {
+		for (int i = 0; i < cou; ++i) axisDirs[i] = skeleton.getWorldAxisDir(i);
+	}
+	return bonesCou;
 }
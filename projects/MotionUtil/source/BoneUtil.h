@@ -6,6 +6,8 @@
 
 #include "GlobalHeader.h"
 
+class CBoneSkeleton;
+
 namespace BoneUtil
 {
 	/**
@@ -24,11 +26,35 @@ namespace BoneUtil
 	 */
 	void adjustBonesDirection (sxsdk::shape_class* boneRoot);
 
+	/**
+	 * ボーンの向きをそろえる (スナップショット上で変更し、形状にはcommitで反映).
+	 */
+	void adjustBonesDirection (CBoneSkeleton& skeleton);
+
 	/**
 	 * ボーンサイズの自動調整.
 	 * @param[in] boneRoot  対象のボーンルート.
 	 */
 	void resizeBones (sxsdk::shape_class* boneRoot);
+
+	/**
+	 * ボーンサイズの自動調整 (スナップショット上で変更し、形状にはcommitで反映).
+	 */
+	void resizeBones (CBoneSkeleton& skeleton);
+
+	/**
+	 * ボーンルート以下のすべてのボーンの情報を、親から子の順(深さ優先)で取得.
+	 * 各配列はmaxCount以上の要素数を確保し、NULLの場合は返さない.
+	 * @param[in]  boneRoot       対象のボーンルート.
+	 * @param[in]  maxCount       配列に格納する最大数 (0の場合はボーン数のみを返す).
+	 * @param[out] shapeHandles   形状のハンドル.
+	 * @param[out] parentIndices  親ボーンの番号 (ボーンルートの場合は-1).
+	 * @param[out] centers        シーケンスOff時のワールド座標での中心位置.
+	 * @param[out] sizes          ボーンサイズ.
+	 * @param[out] axisDirs       ワールド座標でのボーンの向き (正規化済み).
+	 * @return ボーン数 (maxCountより多い場合も、ボーン数を返す).
+	 */
+	int getBonesHierarchy (sxsdk::shape_class* boneRoot, const int maxCount, void** shapeHandles, int* parentIndices, sxsdk::vec3* centers, float* sizes, sxsdk::vec3* axisDirs);
 }
 
 #endif
@@ -6,6 +6,8 @@
 #include "MorphTargetsCtrl.h"
 #include "StreamCtrl.h"
 #include "MathUtil.h"
+#include "MeshUtil.h"
+#include "ProfileUtil.h"
 
 CCalcMeshTransform::CCalcMeshTransform ()
 {
@@ -16,6 +18,8 @@ CCalcMeshTransform::CCalcMeshTransform ()
  */
 bool CCalcMeshTransform::calcMeshTransform (sxsdk::shape_class* shape)
 {
+	CProfileScope profileScope(profile_calc_mesh_transform);
+
 	if (shape->get_type() != sxsdk::enums::polygon_mesh) return false;
 	CMorphTargetsCtrl morphCtrl;
 	if (!StreamCtrl::readMorphTargetsData(*shape, morphCtrl)) return false;
@@ -43,15 +47,16 @@ bool CCalcMeshTransform::calcMeshTransform (sxsdk::shape_class* shape)
 		}
 
 		// サンプリング用の頂点座標.
-		sxsdk::polygon_mesh_saver_class* pMeshSaver = pMesh.get_polygon_mesh_saver();
+		// 現在のメッシュの頂点座標は、対象の頂点インデックスでまとめて取得する.
+		std::vector<int> tIndices;
 		std::vector<sxsdk::vec3> tSrcVertices, tDstVertices;
 		for (int i = 0; i < versCou; ++i) {
 			if (useIList[i]) {
+				tIndices.push_back(i);
 				tSrcVertices.push_back(orgVertices[i]);
-				tDstVertices.push_back(pMeshSaver->get_point(i));
 			}
 		}
-		pMeshSaver->release();
+		if (!MeshUtil::readMeshVertices(*shape, tIndices, tDstVertices)) return false;
 		const int tVersCou = (int)tSrcVertices.size();
 		if (tVersCou < 3) return false;
 
@@ -26,18 +26,37 @@
 // Morph Targets 情報.
 #define MORPH_TARGETS_STREAM_ID sx::uuid_class("53DEDAFF-6CE4-4D66-8A3F-D046C5246F9C")
 
+// MotionGroup 情報 (ボーンルートに保存).
+#define MOTION_DATA_STREAM_ID sx::uuid_class("E547C163-6531-4C88-B4DF-170DE3440C62")
+
+// リターゲットのジョイントの対応と補正 (移し先のボーンルートに保存).
+#define MOTION_RETARGET_STREAM_ID sx::uuid_class("7C2F4A91-3B6E-4D85-9E1A-5F08C3D27B64")
+
 /**
  * streamに保存するバージョン.
  */
-#define MORPH_TARGETS_STREAM_VERSION 0x100		// Morph Targets情報保存用.
+#define MORPH_TARGETS_STREAM_VERSION_100 0x100		// Morph Targets情報保存用.
+#define MORPH_TARGETS_STREAM_VERSION_101 0x101		// Morph Targets情報保存用 (対称マップを追加).
+#define MORPH_TARGETS_STREAM_VERSION_102 0x102		// Morph Targets情報保存用 (ヘッダとTargetの配置表を先頭に置き、頂点を遅延読み込み).
+#define MORPH_TARGETS_STREAM_VERSION_103 0x103		// Morph Targets情報保存用 (頂点の圧縮に対応).
+#define MORPH_TARGETS_STREAM_VERSION_104 0x104		// Morph Targets情報保存用 (セクションごとのCRC32Cを追加).
+#define MORPH_TARGETS_STREAM_VERSION_105 0x105		// Morph Targets情報保存用 (Targetごとの移動量の統計を配置表に追加).
+#define MORPH_TARGETS_STREAM_VERSION MORPH_TARGETS_STREAM_VERSION_105
+
+#define MOTION_DATA_STREAM_VERSION_100 0x100		// MotionGroup情報保存用 (量子化したキーフレーム).
+#define MOTION_DATA_STREAM_VERSION_101 0x101		// MotionGroup情報保存用 (ボーン階層のシグネチャとジョイント名を追加).
+#define MOTION_DATA_STREAM_VERSION MOTION_DATA_STREAM_VERSION_101
+
+#define MOTION_RETARGET_STREAM_VERSION_100 0x100	// リターゲット情報保存用.
+#define MOTION_RETARGET_STREAM_VERSION MOTION_RETARGET_STREAM_VERSION_100
 
 /**
  * 外部公開クラスのバージョン.
  */
 // BoneAttributeAcessクラスのバージョン.
-#define BONE_ATTRIBUTE_ACCESS_VERSION	0x001
+#define BONE_ATTRIBUTE_ACCESS_VERSION	0x002
 
 // MorphTargetsAttributeAcessクラスのバージョン.
-#define MORPHTARGETS_ATTRIBUTE_ACCESS_VERSION	0x001
+#define MORPHTARGETS_ATTRIBUTE_ACCESS_VERSION	0x002
 
 #endif
@@ -3,6 +3,10 @@
  */
 #include "HiddenBoneUtilInterface.h"
 #include "BoneUtil.h"
+#include "SkinDeform.h"
+#include "SkinWeights.h"
+
+#include <algorithm>
 
 CHiddenBoneUtilInterface::CHiddenBoneUtilInterface (sxsdk::shade_interface& shade) : shade(shade)
 {
@@ -53,3 +57,49 @@ void CHiddenBoneUtilInterface::resizeBones (sxsdk::shape_class* boneRoot)
 {
 	return BoneUtil::resizeBones(boneRoot);
 }
+
+/**
+ * ボーンルート以下のすべてのボーンの情報を、親から子の順(深さ優先)で取得.
+ * @return ボーン数 (maxCountより多い場合も、ボーン数を返す).
+ */
+int CHiddenBoneUtilInterface::getBonesHierarchy (sxsdk::shape_class* boneRoot, const int maxCount, void** shapeHandles, int* parentIndices, sxsdk::vec3* centers, float* sizes, sxsdk::vec3* axisDirs)
+{
+	return BoneUtil::getBonesHierarchy(boneRoot, maxCount, shapeHandles, parentIndices, centers, sizes, axisDirs);
+}
+
+/**
+ * ポリゴンメッシュのスキンのウエイト値を、頂点ごとにmaxInfluences個の固定形式で取得.
+ * jointIndices/weightsには、maxVertices個までの頂点を格納する.
+ * @return 頂点数 (maxVerticesより多い場合も、頂点数を返す。スキンを持たない場合は0).
+ */
+int CHiddenBoneUtilInterface::getSkinWeights (sxsdk::shape_class& shape, const int maxInfluences, const bool normalizeToOne, const int maxVertices, const int maxJoints, void** jointHandles, int* jointsCount, int* jointIndices, float* weights, float* maxWeightError)
+{
+	if (jointsCount) *jointsCount = 0;
+	if (maxWeightError) *maxWeightError = 0.0f;
+
+	CSkinWeightOptions options;
+	options.maxInfluences  = std::max(1, maxInfluences);
+	options.normalizeToOne = normalizeToOne;
+	options.mergeTolerance = -1.0f;
+
+	CSkinWeightTable table;
+	CSkinWeightStats stats;
+	if (!SkinWeights::readSkinWeights(shape, options, table, &stats)) return 0;
+
+	if (jointsCount) *jointsCount = stats.jointsCount;
+	if (maxWeightError) *maxWeightError = stats.maxWeightError;
+	if (jointHandles) {
+		const int cou = std::min(std::max(0, maxJoints), (int)table.jointHandles.size());
+		for (int i = 0; i < cou; ++i) jointHandles[i] = table.jointHandles[i];
+	}
+	const int versCou = std::min(std::max(0, maxVertices), table.verticesCount);
+	if ((jointIndices || weights) && versCou > 0) {
+		CSkinInfluences influences, fixedInfluences;
+		table.toInfluences(influences);
+		influences.toFixed(options.maxInfluences, fixedInfluences);
+		const size_t cou = (size_t)versCou * (size_t)options.maxInfluences;
+		if (jointIndices) std::copy(fixedInfluences.jointIndices.begin(), fixedInfluences.jointIndices.begin() + cou, jointIndices);
+		if (weights) std::copy(fixedInfluences.weights.begin(), fixedInfluences.weights.begin() + cou, weights);
+	}
+	return table.verticesCount;
+}
@@ -65,6 +65,24 @@ public:
 	 * @param[in] boneRoot  対象のボーンルート.
 	 */
 	void resizeBones (sxsdk::shape_class* boneRoot);
+
+	//------------------------------------------------------------------------------.
+	// ボーン階層の一括取得 (クラスバージョン0x002 - ).
+	//------------------------------------------------------------------------------.
+	/**
+	 * ボーンルート以下のすべてのボーンの情報を、親から子の順(深さ優先)で取得.
+	 * @return ボーン数 (maxCountより多い場合も、ボーン数を返す).
+	 */
+	int getBonesHierarchy (sxsdk::shape_class* boneRoot, const int maxCount, void** shapeHandles, int* parentIndices, sxsdk::vec3* centers, float* sizes, sxsdk::vec3* axisDirs);
+
+	//------------------------------------------------------------------------------.
+	// スキンのウエイト値の一括取得 (クラスバージョン0x002 - ).
+	//------------------------------------------------------------------------------.
+	/**
+	 * ポリゴンメッシュのスキンのウエイト値を、頂点ごとにmaxInfluences個の固定形式で取得.
+	 * @return 頂点数 (maxVerticesより多い場合も、頂点数を返す。スキンを持たない場合は0).
+	 */
+	int getSkinWeights (sxsdk::shape_class& shape, const int maxInfluences, const bool normalizeToOne, const int maxVertices, const int maxJoints, void** jointHandles, int* jointsCount, int* jointIndices, float* weights, float* maxWeightError);
 };
 
 #endif
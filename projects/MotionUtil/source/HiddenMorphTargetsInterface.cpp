@@ -3,6 +3,11 @@
  */
 
 #include "HiddenMorphTargetsInterface.h"
+#include "MorphTargetsRegistry.h"
+#include "MorphTargetsSceneEval.h"
+#include "MorphTargetsUndo.h"
+#include "ProfileUtil.h"
+#include "TraceUtil.h"
 
 CHiddenMorphTargetsInterface::CHiddenMorphTargetsInterface (sxsdk::shade_interface& shade) : shade(shade)
 {
@@ -63,8 +68,7 @@ sxsdk::shape_class* CHiddenMorphTargetsInterface::getTargetShape ()
  */
 int CHiddenMorphTargetsInterface::getOrgVerticesCount () const
 {
-	const std::vector<sxsdk::vec3>& vers = m_morphTargetsData.getOrgVertices();
-	return (int)vers.size();
+	return m_morphTargetsData.getOrgVerticesCount();
 }
 
 /**
@@ -269,7 +273,15 @@ bool CHiddenMorphTargetsInterface::getShapeCurrentWeights (const sxsdk::shape_cl
  */
 bool CHiddenMorphTargetsInterface::cleanupRedundantVertices (sxsdk::shape_class& shape)
 {
-	return m_morphTargetsData.cleanupRedundantVertices(shape);
+	if (!m_morphTargetsData.loadAllVertices()) return false;
+	const CMorphTargetsCtrl oldData = m_morphTargetsData;
+	if (!m_morphTargetsData.cleanupRedundantVertices(shape)) return false;
+
+	// UNDO用に記録.
+	if (m_morphTargetsData.getTargetShape()) {
+		MorphTargetsUndo::getJournal().recordCleanup(m_morphTargetsData.getTargetShape()->get_handle(), oldData, m_morphTargetsData);
+	}
+	return true;
 }
 
 /**
@@ -284,3 +296,247 @@ void CHiddenMorphTargetsInterface::updateMesh ()
 		}
 	} catch (...) { }
 }
+
+//---------------------------------------------------------------.
+// 処理時間の計測用.
+//---------------------------------------------------------------.
+/**
+ * 処理時間の計測の有効/無効を指定.
+ */
+void CHiddenMorphTargetsInterface::setProfileEnabled (const bool enabled)
+{
+	ProfileUtil::setEnabled(enabled);
+}
+
+/**
+ * 処理時間の計測が有効か.
+ */
+bool CHiddenMorphTargetsInterface::isProfileEnabled ()
+{
+	return ProfileUtil::isEnabled();
+}
+
+/**
+ * 計測結果をクリア.
+ */
+void CHiddenMorphTargetsInterface::resetProfileCounters ()
+{
+	ProfileUtil::reset();
+}
+
+/**
+ * 計測対象の処理の数を取得.
+ */
+int CHiddenMorphTargetsInterface::getProfileCountersCount ()
+{
+	return (int)profile_counters_count;
+}
+
+/**
+ * 計測結果を取得.
+ * @param[in]  index   計測対象の番号 (0 - getProfileCountersCount() - 1).
+ * @param[out] data    計測結果が返る.
+ */
+bool CHiddenMorphTargetsInterface::getProfileCounter (const int index, CProfileCounterData* data)
+{
+	if (!data || index < 0 || index >= (int)profile_counters_count) return false;
+	return ProfileUtil::getCounter((PROFILE_COUNTER_TYPE)index, *data);
+}
+
+/**
+ * 計測結果をJSON形式でファイルに出力.
+ * @param[in] fileName  出力ファイル名 (UTF-8).
+ */
+bool CHiddenMorphTargetsInterface::writeProfileJSON (const char* fileName)
+{
+	return ProfileUtil::writeJSON(fileName);
+}
+
+//---------------------------------------------------------------.
+// 処理のタイムラインの記録用.
+//---------------------------------------------------------------.
+/**
+ * タイムラインの記録の有効/無効を指定.
+ */
+void CHiddenMorphTargetsInterface::setTraceEnabled (const bool enabled)
+{
+	TraceUtil::setEnabled(enabled);
+}
+
+/**
+ * タイムラインの記録が有効か.
+ */
+bool CHiddenMorphTargetsInterface::isTraceEnabled ()
+{
+	return TraceUtil::isEnabled();
+}
+
+/**
+ * 記録済みのイベントをクリア.
+ */
+void CHiddenMorphTargetsInterface::clearTrace ()
+{
+	TraceUtil::clear();
+}
+
+/**
+ * 記録したイベントをChrome trace形式(JSON)でファイルに出力.
+ * @param[in] fileName  出力ファイル名 (UTF-8).
+ */
+bool CHiddenMorphTargetsInterface::writeTraceJSON (const char* fileName)
+{
+	return TraceUtil::writeJSON(fileName);
+}
+
+/**
+ * writeMorphTargetsDataでstreamに保存する際に、頂点を圧縮するか指定.
+ */
+void CHiddenMorphTargetsInterface::setStreamCompressed (const bool compressed)
+{
+	m_morphTargetsData.setStreamEncoding(compressed ? morph_stream_encoding_delta : morph_stream_encoding_raw);
+}
+
+/**
+ * streamに保存する際に、頂点を圧縮するか.
+ */
+bool CHiddenMorphTargetsInterface::isStreamCompressed ()
+{
+	return (m_morphTargetsData.getStreamEncoding() != morph_stream_encoding_raw);
+}
+
+//---------------------------------------------------------------.
+// シーン内のMorph Targets情報を持つ形状.
+//---------------------------------------------------------------.
+/**
+ * シーン内のMorph Targets情報を持つ形状の数を取得.
+ * 削除された形状はここで一覧から除外し、以降の番号での取得では含まれない.
+ */
+int CHiddenMorphTargetsInterface::getMorphTargetsShapesCount (sxsdk::scene_interface* scene)
+{
+	std::vector<sxsdk::shape_class *> shapeList;
+	return MorphTargetsRegistry::getRegistry().resolveShapes(scene, shapeList);
+}
+
+/**
+ * シーン内のMorph Targets情報を持つ形状を取得.
+ * @param[in]  index   番号 (0 - getMorphTargetsShapesCount() - 1).
+ */
+sxsdk::shape_class* CHiddenMorphTargetsInterface::getMorphTargetsShape (sxsdk::scene_interface* scene, const int index)
+{
+	const std::vector<CMorphTargetsShapeSummary>& shapes = MorphTargetsRegistry::getRegistry().getShapes(scene);
+	if (index < 0 || index >= (int)shapes.size()) return NULL;
+
+	try {
+		return scene->get_shape_by_handle(shapes[index].shapeHandle);
+	} catch (...) { }
+
+	return NULL;
+}
+
+/**
+ * シーン内のMorph Targets情報を持つ形状のTarget数と頂点数を取得 (頂点は読み込まない).
+ * @param[in]  index              番号 (0 - getMorphTargetsShapesCount() - 1).
+ * @param[out] targetsCount       Target数が返る.
+ * @param[out] orgVerticesCount   ベースの頂点数が返る.
+ */
+bool CHiddenMorphTargetsInterface::getMorphTargetsShapeSummary (sxsdk::scene_interface* scene, const int index, int* targetsCount, int* orgVerticesCount)
+{
+	const std::vector<CMorphTargetsShapeSummary>& shapes = MorphTargetsRegistry::getRegistry().getShapes(scene);
+	if (index < 0 || index >= (int)shapes.size()) return false;
+
+	if (targetsCount) *targetsCount = shapes[index].targetsCount;
+	if (orgVerticesCount) *orgVerticesCount = shapes[index].orgVerticesCount;
+	return true;
+}
+
+//---------------------------------------------------------------.
+// Targetの移動量の統計.
+//---------------------------------------------------------------.
+/**
+ * Morph Targetの、ベースの頂点座標からの移動量の統計を取得.
+ * @param[in]  tIndex          Morph Targets番号.
+ * @param[out] deltaMin        移動量のバウンディングボックスの最小値が返る.
+ * @param[out] deltaMax        移動量のバウンディングボックスの最大値が返る.
+ * @param[out] maxDeltaLength  移動量の長さの最大値が返る.
+ * @param[out] nonZeroCount    移動量が0でない頂点数が返る.
+ */
+bool CHiddenMorphTargetsInterface::getTargetDeltaStats (const int tIndex, sxsdk::vec3* deltaMin, sxsdk::vec3* deltaMax, float* maxDeltaLength, int* nonZeroCount)
+{
+	if (tIndex < 0 || tIndex >= m_morphTargetsData.getTargetsCount()) return false;
+
+	const CMorphTargetsDeltaStats& stats = m_morphTargetsData.getTargetDeltaStats(tIndex);
+	if (deltaMin) *deltaMin = stats.deltaMin;
+	if (deltaMax) *deltaMax = stats.deltaMax;
+	if (maxDeltaLength) *maxDeltaLength = stats.maxDeltaLength;
+	if (nonZeroCount) *nonZeroCount = stats.nonZeroCount;
+	return true;
+}
+
+//---------------------------------------------------------------.
+// 許容誤差を指定したメッシュの更新.
+//---------------------------------------------------------------.
+/**
+ * updateMeshで許容する頂点位置の誤差を指定.
+ */
+void CHiddenMorphTargetsInterface::setBlendTolerance (const float tolerance)
+{
+	m_morphTargetsData.setBlendTolerance(tolerance);
+}
+
+/**
+ * updateMeshで許容する頂点位置の誤差を取得.
+ */
+float CHiddenMorphTargetsInterface::getBlendTolerance ()
+{
+	return m_morphTargetsData.getBlendTolerance();
+}
+
+/**
+ * 直前のupdateMeshで、省略したTargetによる頂点位置の誤差の上限を取得.
+ * @param[out] culledCount   許容誤差により省略したTarget数が返る.
+ */
+float CHiddenMorphTargetsInterface::getBlendErrorBound (int* culledCount)
+{
+	if (culledCount) *culledCount = m_morphTargetsData.getBlendCulledCount();
+	return m_morphTargetsData.getBlendErrorBound();
+}
+
+//---------------------------------------------------------------.
+// シーン内のメッシュの一括更新.
+//---------------------------------------------------------------.
+/**
+ * シーン内のMorph Targets情報を持つすべての形状のメッシュを、保存されているウエイト値で更新.
+ * @param[in] checkVerticesModify  頂点の移動や回転を補正.
+ * @return 頂点座標が変更された形状数.
+ */
+int CHiddenMorphTargetsInterface::updateSceneMeshes (sxsdk::scene_interface* scene, const bool checkVerticesModify)
+{
+	return MorphTargetsSceneEval::updateSceneMeshes(scene, checkVerticesModify);
+}
+
+//---------------------------------------------------------------.
+// UNDO/REDOの履歴.
+//---------------------------------------------------------------.
+/**
+ * UNDO/REDOの履歴が保持するメモリの上限(バイト数)を指定.
+ */
+void CHiddenMorphTargetsInterface::setUndoMemoryLimit (const long long bytes)
+{
+	MorphTargetsUndo::getJournal().setMaxMemorySize((bytes > 0) ? (size_t)bytes : 0);
+}
+
+/**
+ * UNDO/REDOの履歴が保持するメモリの上限(バイト数)を取得.
+ */
+long long CHiddenMorphTargetsInterface::getUndoMemoryLimit ()
+{
+	return (long long)MorphTargetsUndo::getJournal().getMaxMemorySize();
+}
+
+/**
+ * UNDO/REDOの履歴が現在保持しているメモリ量(バイト数)を取得.
+ */
+long long CHiddenMorphTargetsInterface::getUndoMemorySize ()
+{
+	return (long long)MorphTargetsUndo::getJournal().getMemorySize();
+}
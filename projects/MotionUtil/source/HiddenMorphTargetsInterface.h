@@ -198,6 +198,161 @@ public:
 	 * Morph Targetsの情報より、m_pTargetShapeのポリゴンメッシュを更新.
 	 */
 	void updateMesh ();
+
+	//---------------------------------------------------------------.
+	// 処理時間の計測用.
+	//---------------------------------------------------------------.
+	/**
+	 * 処理時間の計測の有効/無効を指定.
+	 */
+	void setProfileEnabled (const bool enabled);
+
+	/**
+	 * 処理時間の計測が有効か.
+	 */
+	bool isProfileEnabled ();
+
+	/**
+	 * 計測結果をクリア.
+	 */
+	void resetProfileCounters ();
+
+	/**
+	 * 計測対象の処理の数を取得.
+	 */
+	int getProfileCountersCount ();
+
+	/**
+	 * 計測結果を取得.
+	 * @param[in]  index   計測対象の番号 (0 - getProfileCountersCount() - 1).
+	 * @param[out] data    計測結果が返る.
+	 */
+	bool getProfileCounter (const int index, CProfileCounterData* data);
+
+	/**
+	 * 計測結果をJSON形式でファイルに出力.
+	 * @param[in] fileName  出力ファイル名 (UTF-8).
+	 */
+	bool writeProfileJSON (const char* fileName);
+
+	//---------------------------------------------------------------.
+	// 処理のタイムラインの記録用.
+	//---------------------------------------------------------------.
+	/**
+	 * タイムラインの記録の有効/無効を指定.
+	 */
+	void setTraceEnabled (const bool enabled);
+
+	/**
+	 * タイムラインの記録が有効か.
+	 */
+	bool isTraceEnabled ();
+
+	/**
+	 * 記録済みのイベントをクリア.
+	 */
+	void clearTrace ();
+
+	/**
+	 * 記録したイベントをChrome trace形式(JSON)でファイルに出力.
+	 * @param[in] fileName  出力ファイル名 (UTF-8).
+	 */
+	bool writeTraceJSON (const char* fileName);
+
+	//---------------------------------------------------------------.
+	// streamへの保存形式.
+	//---------------------------------------------------------------.
+	/**
+	 * writeMorphTargetsDataでstreamに保存する際に、頂点を圧縮するか指定.
+	 */
+	void setStreamCompressed (const bool compressed);
+
+	/**
+	 * streamに保存する際に、頂点を圧縮するか.
+	 */
+	bool isStreamCompressed ();
+
+	//---------------------------------------------------------------.
+	// シーン内のMorph Targets情報を持つ形状.
+	//---------------------------------------------------------------.
+	/**
+	 * シーン内のMorph Targets情報を持つ形状の数を取得.
+	 */
+	int getMorphTargetsShapesCount (sxsdk::scene_interface* scene);
+
+	/**
+	 * シーン内のMorph Targets情報を持つ形状を取得.
+	 * @param[in]  index   番号 (0 - getMorphTargetsShapesCount() - 1).
+	 */
+	sxsdk::shape_class* getMorphTargetsShape (sxsdk::scene_interface* scene, const int index);
+
+	/**
+	 * シーン内のMorph Targets情報を持つ形状のTarget数と頂点数を取得 (頂点は読み込まない).
+	 * @param[in]  index              番号 (0 - getMorphTargetsShapesCount() - 1).
+	 * @param[out] targetsCount       Target数が返る.
+	 * @param[out] orgVerticesCount   ベースの頂点数が返る.
+	 */
+	bool getMorphTargetsShapeSummary (sxsdk::scene_interface* scene, const int index, int* targetsCount, int* orgVerticesCount);
+
+	//---------------------------------------------------------------.
+	// Targetの移動量の統計.
+	//---------------------------------------------------------------.
+	/**
+	 * Morph Targetの、ベースの頂点座標からの移動量の統計を取得.
+	 * @param[in]  tIndex          Morph Targets番号.
+	 * @param[out] deltaMin        移動量のバウンディングボックスの最小値が返る.
+	 * @param[out] deltaMax        移動量のバウンディングボックスの最大値が返る.
+	 * @param[out] maxDeltaLength  移動量の長さの最大値が返る.
+	 * @param[out] nonZeroCount    移動量が0でない頂点数が返る.
+	 */
+	bool getTargetDeltaStats (const int tIndex, sxsdk::vec3* deltaMin, sxsdk::vec3* deltaMax, float* maxDeltaLength, int* nonZeroCount);
+
+	//---------------------------------------------------------------.
+	// 許容誤差を指定したメッシュの更新.
+	//---------------------------------------------------------------.
+	/**
+	 * updateMeshで許容する頂点位置の誤差を指定.
+	 */
+	void setBlendTolerance (const float tolerance);
+
+	/**
+	 * updateMeshで許容する頂点位置の誤差を取得.
+	 */
+	float getBlendTolerance ();
+
+	/**
+	 * 直前のupdateMeshで、省略したTargetによる頂点位置の誤差の上限を取得.
+	 * @param[out] culledCount   許容誤差により省略したTarget数が返る.
+	 */
+	float getBlendErrorBound (int* culledCount);
+
+	//---------------------------------------------------------------.
+	// シーン内のメッシュの一括更新.
+	//---------------------------------------------------------------.
+	/**
+	 * シーン内のMorph Targets情報を持つすべての形状のメッシュを、保存されているウエイト値で更新.
+	 * @param[in] checkVerticesModify  頂点の移動や回転を補正.
+	 * @return 頂点座標が変更された形状数.
+	 */
+	int updateSceneMeshes (sxsdk::scene_interface* scene, const bool checkVerticesModify = true);
+
+	//---------------------------------------------------------------.
+	// UNDO/REDOの履歴.
+	//---------------------------------------------------------------.
+	/**
+	 * UNDO/REDOの履歴が保持するメモリの上限(バイト数)を指定.
+	 */
+	void setUndoMemoryLimit (const long long bytes);
+
+	/**
+	 * UNDO/REDOの履歴が保持するメモリの上限(バイト数)を取得.
+	 */
+	long long getUndoMemoryLimit ();
+
+	/**
+	 * UNDO/REDOの履歴が現在保持しているメモリ量(バイト数)を取得.
+	 */
+	long long getUndoMemorySize ();
 };
 
 #endif
@@ -4,6 +4,7 @@
 #include "MathUtil.h"
 
 #include <algorithm>
+#include <cmath>
 
 /**
  * ゼロチェック.
@@ -117,3 +118,146 @@ void MathUtil::calcBoundingBox (const std::vector<sxsdk::vec3>& vers, sxsdk::vec
 		bbMax.z = std::max(bbMax.z, v.z);
 	}
 }
+
+/**
+ * クォータニオンから回転行列を計算 (v * mでクォータニオンの回転となる).
+ */
+sxsdk::mat4 MathUtil::quaternionToMatrix (const sxsdk::quaternion_class& q)
+{
+	const float x = q.x, y = q.y, z = q.z, w = q.w;
+	sxsdk::mat4 m = sxsdk::mat4::identity;
+	m[0][0] = 1.0f - 2.0f * (y * y + z * z);
+	m[0][1] = 2.0f * (x * y + w * z);
+	m[0][2] = 2.0f * (x * z - w * y);
+	m[1][0] = 2.0f * (x * y - w * z);
+	m[1][1] = 1.0f - 2.0f * (x * x + z * z);
+	m[1][2] = 2.0f * (y * z + w * x);
+	m[2][0] = 2.0f * (x * z + w * y);
+	m[2][1] = 2.0f * (y * z - w * x);
+	m[2][2] = 1.0f - 2.0f * (x * x + y * y);
+	return m;
+}
+
+/**
+ * 回転行列からクォータニオンを計算 (正規化済み).
+ * 回転/スケールの3x3の各行を正規化して、スケールを除く.
+ */
+sxsdk::quaternion_class MathUtil::matrixToQuaternion (const sxsdk::mat4& m)
+{
+	float r[3][3];
+	for (int i = 0; i < 3; ++i) {
+		const float len = std::sqrt(m[i][0] * m[i][0] + m[i][1] * m[i][1] + m[i][2] * m[i][2]);
+		const float d = (len > 0.0f) ? (1.0f / len) : 0.0f;
+		for (int j = 0; j < 3; ++j) r[i][j] = m[i][j] * d;
+	}
+
+	// v * r の回転行列を、列ベクトル形式の c[i][j] = r[j][i] として扱う.
+	float w, x, y, z;
+	const float tr = r[0][0] + r[1][1] + r[2][2];
+	if (tr > 0.0f) {
+		const float s = std::sqrt(tr + 1.0f) * 2.0f;
+		w = 0.25f * s;
+		x = (r[1][2] - r[2][1]) / s;
+		y = (r[2][0] - r[0][2]) / s;
+		z = (r[0][1] - r[1][0]) / s;
+	} else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+		const float s = std::sqrt(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+		w = (r[1][2] - r[2][1]) / s;
+		x = 0.25f * s;
+		y = (r[1][0] + r[0][1]) / s;
+		z = (r[2][0] + r[0][2]) / s;
+	} else if (r[1][1] > r[2][2]) {
+		const float s = std::sqrt(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+		w = (r[2][0] - r[0][2]) / s;
+		x = (r[1][0] + r[0][1]) / s;
+		y = 0.25f * s;
+		z = (r[2][1] + r[1][2]) / s;
+	} else {
+		const float s = std::sqrt(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+		w = (r[0][1] - r[1][0]) / s;
+		x = (r[2][0] + r[0][2]) / s;
+		y = (r[2][1] + r[1][2]) / s;
+		z = 0.25f * s;
+	}
+
+	sxsdk::quaternion_class q = sxsdk::quaternion_class::identity;
+	const float len = std::sqrt(w * w + x * x + y * y + z * z);
+	if (len > 0.0f) {
+		q.x = x / len;
+		q.y = y / len;
+		q.z = z / len;
+		q.w = w / len;
+	}
+	return q;
+}
+
+/**
+ * 2つの正規化済みのクォータニオンの回転の差の角度 (ラジアン、0.0 - π).
+ * 差の回転(q0の共役 * q1)のベクトル部の長さと実部からatan2で求め、角度が小さい場合もacosより精度を保つ.
+ */
+float MathUtil::getRotationAngle (const sxsdk::quaternion_class& q0, const sxsdk::quaternion_class& q1)
+{
+	const float w = q0.w * q1.w + q0.x * q1.x + q0.y * q1.y + q0.z * q1.z;
+	const float x = q0.w * q1.x - q0.x * q1.w - q0.y * q1.z + q0.z * q1.y;
+	const float y = q0.w * q1.y + q0.x * q1.z - q0.y * q1.w - q0.z * q1.x;
+	const float z = q0.w * q1.z - q0.x * q1.y + q0.y * q1.x - q0.z * q1.w;
+	return 2.0f * std::atan2(std::sqrt(x * x + y * y + z * z), std::abs(w));
+}
+
+/**
+ * クォータニオンの積 (a * b).
+ */
+sxsdk::quaternion_class MathUtil::multiplyQuaternion (const sxsdk::quaternion_class& a, const sxsdk::quaternion_class& b)
+{
+	sxsdk::quaternion_class q;
+	q.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+	q.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+	q.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+	q.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+	return q;
+}
+
+/**
+ * 正規化済みのクォータニオンの逆 (共役).
+ */
+sxsdk::quaternion_class MathUtil::conjugateQuaternion (const sxsdk::quaternion_class& q)
+{
+	sxsdk::quaternion_class r;
+	r.x = -q.x;
+	r.y = -q.y;
+	r.z = -q.z;
+	r.w = q.w;
+	return r;
+}
+
+/**
+ * 変換行列の移動成分.
+ */
+sxsdk::vec3 MathUtil::getMatrixPosition (const sxsdk::mat4& m)
+{
+	return sxsdk::vec3(m[3][0], m[3][1], m[3][2]);
+}
+
+/**
+ * 方向ベクトルに、変換行列の回転/スケール部分の逆行列を掛ける.
+ * 移動成分は方向ベクトルには影響しないため、4x4の逆行列ではなく3x3の余因子から計算する.
+ */
+sxsdk::vec3 MathUtil::transformDirByInverse (const sxsdk::vec3& v, const sxsdk::mat4& m)
+{
+	const float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	const float c01 = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+	const float c02 = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+	const float c10 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	const float c11 = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+	const float c12 = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+	const float c20 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+	const float c21 = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+	const float c22 = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+	const float det = m[0][0] * c00 + m[0][1] * c10 + m[0][2] * c20;
+	if (std::abs(det) < 1e-12f) return v;
+
+	const float d = 1.0f / det;
+	return sxsdk::vec3((v.x * c00 + v.y * c10 + v.z * c20) * d,
+					   (v.x * c01 + v.y * c11 + v.z * c21) * d,
+					   (v.x * c02 + v.y * c12 + v.z * c22) * d);
+}
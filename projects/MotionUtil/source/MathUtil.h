@@ -36,6 +36,45 @@ namespace MathUtil {
 	 * バウンディングボックスの最小最大を計算.
 	 */
 	void calcBoundingBox (const std::vector<sxsdk::vec3>& vers, sxsdk::vec3& bbMin, sxsdk::vec3& bbMax);
+
+	/**
+	 * クォータニオンから回転行列を計算 (v * mでクォータニオンの回転となる).
+	 */
+	sxsdk::mat4 quaternionToMatrix (const sxsdk::quaternion_class& q);
+
+	/**
+	 * 回転行列からクォータニオンを計算 (正規化済み).
+	 * 回転/スケールの3x3の各行を正規化して、スケールを除く.
+	 */
+	sxsdk::quaternion_class matrixToQuaternion (const sxsdk::mat4& m);
+
+	/**
+	 * 2つの正規化済みのクォータニオンの回転の差の角度 (ラジアン、0.0 - π).
+	 * qとq * -1は同じ回転として扱う.
+	 */
+	float getRotationAngle (const sxsdk::quaternion_class& q0, const sxsdk::quaternion_class& q1);
+
+	/**
+	 * クォータニオンの積 (a * b).
+	 * 変換行列では、bの回転の後にaの回転を行うことになる.
+	 */
+	sxsdk::quaternion_class multiplyQuaternion (const sxsdk::quaternion_class& a, const sxsdk::quaternion_class& b);
+
+	/**
+	 * 正規化済みのクォータニオンの逆 (共役).
+	 */
+	sxsdk::quaternion_class conjugateQuaternion (const sxsdk::quaternion_class& q);
+
+	/**
+	 * 変換行列の移動成分.
+	 */
+	sxsdk::vec3 getMatrixPosition (const sxsdk::mat4& m);
+
+	/**
+	 * 方向ベクトルに、変換行列の回転/スケール部分の逆行列を掛ける.
+	 * 逆行列を計算できない場合はvをそのまま返す.
+	 */
+	sxsdk::vec3 transformDirByInverse (const sxsdk::vec3& v, const sxsdk::mat4& m);
 }
 
 #endif
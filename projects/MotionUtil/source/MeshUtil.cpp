@@ -3,6 +3,7 @@
  */
 
 #include "MeshUtil.h"
+#include "ProfileUtil.h"
 
 /**
  * アクティブなシーンで選択されているポリゴンメッシュを取得.
@@ -42,20 +43,172 @@ std::vector<int> MeshUtil::getActiveVerticesInMesh (sxsdk::shape_class& shape)
 std::vector<sxsdk::vec3> MeshUtil::getMeshVertex (sxsdk::shape_class& shape, const std::vector<int>& indices)
 {
 	std::vector<sxsdk::vec3> vers;
-	if (indices.empty()) return vers;
+	if (!readMeshVertices(shape, indices, vers)) vers.clear();
+	return vers;
+}
+
+/**
+ * ポリゴンメッシュのすべての頂点座標を、1つのsaverでまとめて取得.
+ */
+bool MeshUtil::readMeshVertices (sxsdk::shape_class& shape, std::vector<sxsdk::vec3>& vertices)
+{
+	CProfileScope profileScope(profile_mesh_read);
+
+	vertices.clear();
+	if (shape.get_type() != sxsdk::enums::polygon_mesh) return false;
 
 	try {
-		if (shape.get_type() != sxsdk::enums::polygon_mesh) return vers;
+		sxsdk::polygon_mesh_class& pMesh = shape.get_polygon_mesh();
+		const int versCou = pMesh.get_total_number_of_control_points();
+		vertices.resize(versCou);
+		if (versCou > 0) {
+			// 頂点座標を効率よく取得するためのsaverクラス.
+			sxsdk::polygon_mesh_saver_class* pMeshSaver = pMesh.get_polygon_mesh_saver();
+			sxsdk::vec3* pV = &vertices[0];
+			for (int i = 0; i < versCou; ++i) pV[i] = pMeshSaver->get_point(i);
+			pMeshSaver->release();
+		}
+		ProfileUtil::addBytes(profile_mesh_read, (long long)sizeof(sxsdk::vec3) * versCou);
+		return true;
+	} catch (...) { }
+
+	vertices.clear();
+	return false;
+}
+
+/**
+ * 指定の頂点インデックスでの頂点座標を、1つのsaverでまとめて取得.
+ */
+bool MeshUtil::readMeshVertices (sxsdk::shape_class& shape, const std::vector<int>& indices, std::vector<sxsdk::vec3>& vertices)
+{
+	CProfileScope profileScope(profile_mesh_read);
 
+	vertices.clear();
+	if (shape.get_type() != sxsdk::enums::polygon_mesh) return false;
+	if (indices.empty()) return true;
+
+	try {
+		sxsdk::polygon_mesh_class& pMesh = shape.get_polygon_mesh();
 		const int cou = (int)indices.size();
-		vers.resize(cou);
+		vertices.resize(cou);
+
+		sxsdk::polygon_mesh_saver_class* pMeshSaver = pMesh.get_polygon_mesh_saver();
+		sxsdk::vec3* pV = &vertices[0];
+		for (int i = 0; i < cou; ++i) pV[i] = pMeshSaver->get_point(indices[i]);
+		pMeshSaver->release();
+
+		ProfileUtil::addBytes(profile_mesh_read, (long long)sizeof(sxsdk::vec3) * cou);
+		return true;
+	} catch (...) { }
+
+	vertices.clear();
+	return false;
+}
 
+/**
+ * ポリゴンメッシュの面を三角形分割し、三角形ごとの頂点インデックスを取得.
+ * 多角形は扇状に分割する.
+ */
+void MeshUtil::getMeshTriangles (sxsdk::shape_class& shape, std::vector<int>& triangles)
+{
+	triangles.clear();
+	if (shape.get_type() != sxsdk::enums::polygon_mesh) return;
+
+	try {
 		sxsdk::polygon_mesh_class& pMesh = shape.get_polygon_mesh();
-		sxsdk::polygon_mesh_saver_class* saver = pMesh.get_polygon_mesh_saver();
-		for (int i = 0; i < cou; ++i) {
-			vers[i] = saver->get_point(indices[i]);
+		const int facesCou = pMesh.get_number_of_faces();
+		triangles.reserve(facesCou * 6);
+
+		std::vector<int> indices;
+		for (int i = 0; i < facesCou; ++i) {
+			sxsdk::face_class& f = pMesh.face(i);
+			const int vCou = f.get_number_of_vertices();
+			if (vCou < 3) continue;
+			indices.resize(vCou);
+			f.get_vertex_indices(&(indices[0]));
+			for (int j = 1; j + 1 < vCou; ++j) {
+				triangles.push_back(indices[0]);
+				triangles.push_back(indices[j]);
+				triangles.push_back(indices[j + 1]);
+			}
 		}
-		saver->release();
 	} catch (...) { }
-	return vers;
+}
+
+//---------------------------------------------------------------.
+CMeshVerticesBuffer::CMeshVerticesBuffer ()
+{
+	clear();
+}
+
+void CMeshVerticesBuffer::clear ()
+{
+	m_vertices.clear();
+	m_dirty.clear();
+	m_dirtyStart = 0;
+	m_dirtyEnd   = 0;
+}
+
+/**
+ * ポリゴンメッシュのすべての頂点座標を読み込み.
+ * 配列の領域は再利用し、書き戻していない変更は破棄される.
+ */
+bool CMeshVerticesBuffer::read (sxsdk::shape_class& shape)
+{
+	const bool ret = MeshUtil::readMeshVertices(shape, m_vertices);
+	m_dirty.assign(m_vertices.size(), 0);
+	m_dirtyStart = (int)m_vertices.size();
+	m_dirtyEnd   = 0;
+	return ret;
+}
+
+/**
+ * 変更された頂点数を取得.
+ */
+int CMeshVerticesBuffer::getDirtyCount () const
+{
+	int cou = 0;
+	for (int i = m_dirtyStart; i < m_dirtyEnd; ++i) {
+		if (m_dirty[i]) cou++;
+	}
+	return cou;
+}
+
+/**
+ * 変更された頂点の連続した範囲ごとに、ポリゴンメッシュに書き戻す.
+ */
+int CMeshVerticesBuffer::write (sxsdk::shape_class& shape)
+{
+	if (m_dirtyStart >= m_dirtyEnd) return 0;
+
+	CProfileScope profileScope(profile_mesh_write);
+
+	int writeCou = 0;
+	try {
+		if (shape.get_type() != sxsdk::enums::polygon_mesh) return 0;
+		sxsdk::polygon_mesh_class& pMesh = shape.get_polygon_mesh();
+		if (pMesh.get_total_number_of_control_points() != (int)m_vertices.size()) return 0;
+
+		int i = m_dirtyStart;
+		while (i < m_dirtyEnd) {
+			if (!m_dirty[i]) {
+				++i;
+				continue;
+			}
+
+			// 連続して変更された範囲を書き戻す.
+			const int startI = i;
+			while (i < m_dirtyEnd && m_dirty[i]) ++i;
+			for (int j = startI; j < i; ++j) {
+				pMesh.vertex(j).set_position(m_vertices[j]);
+				m_dirty[j] = 0;
+			}
+			writeCou += i - startI;
+		}
+	} catch (...) { }
+
+	m_dirtyStart = (int)m_vertices.size();
+	m_dirtyEnd   = 0;
+	ProfileUtil::addBytes(profile_mesh_write, (long long)sizeof(sxsdk::vec3) * writeCou);
+	return writeCou;
 }
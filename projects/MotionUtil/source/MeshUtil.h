@@ -7,6 +7,67 @@
 
 #include "GlobalHeader.h"
 
+/**
+ * ポリゴンメッシュの頂点座標の一括読み込み/書き込み用バッファ.
+ * 1回の処理ですべての頂点座標を連続した配列に読み込み、変更された頂点の範囲のみを書き戻す.
+ * 配列は呼び出しをまたいで再利用する.
+ */
+class CMeshVerticesBuffer
+{
+private:
+	std::vector<sxsdk::vec3> m_vertices;		// 頂点座標.
+	std::vector<unsigned char> m_dirty;			// 頂点ごとに、書き戻しが必要か.
+	int m_dirtyStart, m_dirtyEnd;				// 書き戻しが必要な頂点の範囲 (m_dirtyStart - m_dirtyEnd - 1).
+
+public:
+	CMeshVerticesBuffer ();
+
+	void clear ();
+
+	/**
+	 * ポリゴンメッシュのすべての頂点座標を読み込み.
+	 * 書き戻していない変更は破棄される.
+	 */
+	bool read (sxsdk::shape_class& shape);
+
+	/**
+	 * 頂点数.
+	 */
+	int size () const { return (int)m_vertices.size(); }
+
+	/**
+	 * 頂点座標を取得.
+	 */
+	const sxsdk::vec3& get (const int index) const { return m_vertices[index]; }
+	const std::vector<sxsdk::vec3>& getVertices () const { return m_vertices; }
+
+	/**
+	 * 頂点座標を変更 (読み込んだ値と異なる場合のみ、書き戻しの対象となる).
+	 */
+	void set (const int index, const sxsdk::vec3& v) {
+		sxsdk::vec3& dst = m_vertices[index];
+		if (dst.x == v.x && dst.y == v.y && dst.z == v.z) return;
+		dst = v;
+		if (!m_dirty[index]) {
+			m_dirty[index] = 1;
+			if (index < m_dirtyStart) m_dirtyStart = index;
+			if (index >= m_dirtyEnd) m_dirtyEnd = index + 1;
+		}
+	}
+
+	/**
+	 * 変更された頂点数を取得.
+	 */
+	int getDirtyCount () const;
+
+	/**
+	 * 変更された頂点の連続した範囲ごとに、ポリゴンメッシュに書き戻す.
+	 * polygon_mesh_class::updateは呼ばないため、書き戻した頂点がある場合は呼び出し側で更新すること.
+	 * @return 書き戻した頂点数.
+	 */
+	int write (sxsdk::shape_class& shape);
+};
+
 namespace MeshUtil
 {
 	/**
@@ -23,6 +84,23 @@ namespace MeshUtil
 	 * 指定の頂点インデックスでの頂点座標を取得.
 	 */
 	std::vector<sxsdk::vec3> getMeshVertex (sxsdk::shape_class& shape, const std::vector<int>& indices);
+
+	/**
+	 * ポリゴンメッシュのすべての頂点座標を、1つのsaverでまとめて取得.
+	 * verticesの領域は再利用される.
+	 */
+	bool readMeshVertices (sxsdk::shape_class& shape, std::vector<sxsdk::vec3>& vertices);
+
+	/**
+	 * 指定の頂点インデックスでの頂点座標を、1つのsaverでまとめて取得.
+	 * verticesの領域は再利用される.
+	 */
+	bool readMeshVertices (sxsdk::shape_class& shape, const std::vector<int>& indices, std::vector<sxsdk::vec3>& vertices);
+
+	/**
+	 * ポリゴンメッシュの面を三角形分割し、三角形ごとの頂点インデックスを取得.
+	 */
+	void getMeshTriangles (sxsdk::shape_class& shape, std::vector<int>& triangles);
 }
 
 #endif
@@ -7,6 +7,15 @@
 #include "BSPPoint.h"
 #include "MathUtil.h"
 #include "CalcMeshTransform.h"
+#include "MeshUtil.h"
+#include "MorphTargetsRegistry.h"
+#include "MorphTargetsRemap.h"
+#include "MorphTargetsSceneEval.h"
+#include "ProfileUtil.h"
+#include "TraceUtil.h"
+
+#include <algorithm>
+#include <cmath>
 
 /*
 	ポリゴンメッシュのすべての変形前の頂点をあらかじめ保持.
@@ -66,13 +75,145 @@ void CMorphTargetsData::clear ()
 	weight = 0.0f;
 }
 
+//-------------------------------------------------.
+CMorphTargetsDeltaStats::CMorphTargetsDeltaStats ()
+{
+	clear();
+}
+
+void CMorphTargetsDeltaStats::clear ()
+{
+	deltaMin       = sxsdk::vec3(0, 0, 0);
+	deltaMax       = sxsdk::vec3(0, 0, 0);
+	maxDeltaLength = 0.0f;
+	nonZeroCount   = 0;
+}
+
+//-------------------------------------------------.
+CMorphTargetsBlendCulling::CMorphTargetsBlendCulling ()
+{
+	clear();
+}
+
+void CMorphTargetsBlendCulling::clear ()
+{
+	valid       = false;
+	tolerance   = 0.0f;
+	weights.clear();
+	skipTargets.clear();
+	errorBound  = 0.0f;
+	culledCount = 0;
+}
+
+//-------------------------------------------------.
+CMorphTargetsStreamLayout::CMorphTargetsStreamLayout ()
+{
+	clear();
+}
+
+void CMorphTargetsStreamLayout::clear ()
+{
+	version          = 0;
+	serial           = 0;
+	streamSize       = 0;
+	orgVerticesCount = 0;
+	baseOffset       = 0;
+	baseSize         = 0;
+	symmetryOffset   = -1;
+	symmetrySize     = 0;
+	encoding         = morph_stream_encoding_raw;
+	hasEmptyTargets  = false;
+	hasChecksum      = false;
+	hasDeltaStats    = false;
+	baseCrc          = 0;
+	symmetryCrc      = 0;
+
+	names.clear();
+	weights.clear();
+	verticesCounts.clear();
+	indicesOffsets.clear();
+	verticesOffsets.clear();
+	indicesSizes.clear();
+	verticesSizes.clear();
+	weightOffsets.clear();
+	geometryCrcs.clear();
+	deltaStats.clear();
+}
+
+/**
+ * 頂点数とTargetの構成が同じか (頂点座標やウエイト値は比較しない).
+ */
+bool CMorphTargetsStreamLayout::isCompatible (const CMorphTargetsStreamLayout& v) const
+{
+	if (!isValid() || !v.isValid()) return false;
+	if (orgVerticesCount != v.orgVerticesCount) return false;
+	return (verticesCounts == v.verticesCounts);
+}
+
 //-------------------------------------------------.
 namespace {
 	std::vector< std::vector<CMorphTargetsWeightCache> > g_shapeWeightCache;	// 形状ごとのMorph Targetsのウエイト値の一時保持用.
+
+	const int DELTA_STATS_BLOCK_SIZE = 256;		// 移動量の統計で、まとめて集計する頂点数.
+
+	/**
+	 * Targetの、ベースの頂点座標からの移動量の統計を計算.
+	 * 頂点インデックスで参照する差分の計算と、集計を分けて行う.
+	 * 集計は、成分ごとの配列に対して分岐なしのmin/maxと加算のみで行う (コンパイラのベクトル化の対象とする).
+	 * ベースの頂点数の範囲外の頂点インデックスは、移動量0として扱う.
+	 */
+	void m_calcDeltaStats (const std::vector<sxsdk::vec3>& orgVertices, const CMorphTargetsData& targetD, CMorphTargetsDeltaStats& stats)
+	{
+		stats.clear();
+		const int vCou   = (int)std::min(targetD.vIndices.size(), targetD.vertices.size());
+		const int orgCou = (int)orgVertices.size();
+		if (vCou <= 0) return;
+
+		float dx[DELTA_STATS_BLOCK_SIZE], dy[DELTA_STATS_BLOCK_SIZE], dz[DELTA_STATS_BLOCK_SIZE];
+		float minX = 0.0f, minY = 0.0f, minZ = 0.0f;
+		float maxX = 0.0f, maxY = 0.0f, maxZ = 0.0f;
+		float maxLen2 = 0.0f;
+		int nonZeroCou = 0;
+		bool first = true;
+
+		for (int start = 0; start < vCou; start += DELTA_STATS_BLOCK_SIZE) {
+			const int cou = std::min(DELTA_STATS_BLOCK_SIZE, vCou - start);
+			for (int i = 0; i < cou; ++i) {
+				const int vIndex = targetD.vIndices[start + i];
+				const sxsdk::vec3& v = targetD.vertices[start + i];
+				const sxsdk::vec3& orgV = (vIndex >= 0 && vIndex < orgCou) ? orgVertices[vIndex] : v;
+				dx[i] = v.x - orgV.x;
+				dy[i] = v.y - orgV.y;
+				dz[i] = v.z - orgV.z;
+			}
+			if (first) {
+				minX = maxX = dx[0];
+				minY = maxY = dy[0];
+				minZ = maxZ = dz[0];
+				first = false;
+			}
+			for (int i = 0; i < cou; ++i) {
+				minX = std::min(minX, dx[i]);
+				minY = std::min(minY, dy[i]);
+				minZ = std::min(minZ, dz[i]);
+				maxX = std::max(maxX, dx[i]);
+				maxY = std::max(maxY, dy[i]);
+				maxZ = std::max(maxZ, dz[i]);
+				maxLen2 = std::max(maxLen2, dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i]);
+				nonZeroCou += (int)((dx[i] != 0.0f) | (dy[i] != 0.0f) | (dz[i] != 0.0f));
+			}
+		}
+
+		stats.deltaMin       = sxsdk::vec3(minX, minY, minZ);
+		stats.deltaMax       = sxsdk::vec3(maxX, maxY, maxZ);
+		stats.maxDeltaLength = std::sqrt(maxLen2);
+		stats.nonZeroCount   = nonZeroCou;
+	}
 }
 
 CMorphTargetsCtrl::CMorphTargetsCtrl ()
 {
+	m_blendTolerance = 0.0f;
 	clear();
 }
 
@@ -82,28 +223,342 @@ void CMorphTargetsCtrl::clear ()
 	m_orgVertices.clear();
 	m_morphTargetsData.clear();
 	m_selectTargetIndex = -1;
+	m_symmetryMap.clear();
+
+	m_streamLayout.clear();
+	m_baseLoaded = true;
+	m_targetsLoaded.clear();
+	m_lazyLoadFailed = false;
+
+	m_streamEncoding = morph_stream_encoding_raw;
+
+	m_targetsDeltaStats.clear();
+	m_targetsDeltaStatsValid.clear();
+	m_blendCulling.clear();
 }
 
+//---------------------------------------------------------------.
+// streamからの遅延読み込み用.
+//---------------------------------------------------------------.
 /**
- * Morph Targets情報を持つ形状をシーンから再帰的に探して格納.
- * @param[in]   shape  検索形状.
- * @param[out]  shapeList  ポリゴンメッシュでMorph Targetsを持つ形状が返る.
+ * streamから読み込んだ配置より、名前とウエイト値のみを格納する.
+ * 頂点は、getOrgVertices/getMorphTargetDataなどで必要になった時点で読み込まれる.
  */
-void CMorphTargetsCtrl::m_findMorphTargetsShape (sxsdk::shape_class* shape, std::vector<sxsdk::shape_class *>& shapeList)
+void CMorphTargetsCtrl::setupStreamLayout (sxsdk::shape_class* pShape, const CMorphTargetsStreamLayout& layout)
 {
-	if (shape->get_type() == sxsdk::enums::polygon_mesh) {
-		if (StreamCtrl::hasMorphTargetsData(*shape)) {
-			shapeList.push_back(shape);
+	clear();
+	if (!pShape || !layout.isValid()) return;
+
+	m_pTargetShape = pShape;
+
+	const int targetsCou = layout.getTargetsCount();
+	m_morphTargetsData.resize(targetsCou);
+	for (int i = 0; i < targetsCou; ++i) {
+		CMorphTargetsData& targetD = m_morphTargetsData[i];
+		targetD.name   = layout.names[i];
+		targetD.weight = std::min(1.0f, std::max(0.0f, layout.weights[i]));
+	}
+
+	m_streamLayout   = layout;
+	m_baseLoaded     = false;
+	m_targetsLoaded.resize(targetsCou, 0);
+	m_streamEncoding = (MORPH_TARGETS_STREAM_ENCODING)layout.encoding;
+
+	m_invalidateDeltaStats();
+	m_setDeltaStatsFromLayout();
+}
+
+/**
+ * 遅延読み込み中のstreamが変更されている場合は、配置を読み直す.
+ * 頂点数やTargetの構成が変わっている場合は読み込みを打ち切る.
+ */
+bool CMorphTargetsCtrl::m_checkStreamLayout ()
+{
+	if (!m_pTargetShape) return false;
+	if (StreamCtrl::checkMorphTargetsLayout(*m_pTargetShape, m_streamLayout)) return true;
+
+	// 他の処理で保存し直されている場合も、構成が同じであれば新しい位置から読み込む.
+	CMorphTargetsStreamLayout layout;
+	if (!StreamCtrl::readMorphTargetsLayout(*m_pTargetShape, layout)) return false;
+	if (!layout.isCompatible(m_streamLayout)) return false;
+	m_streamLayout = layout;
+	m_setDeltaStatsFromLayout();
+	return true;
+}
+
+/**
+ * ベースの頂点座標と対称マップを読み込む (遅延読み込み中の場合).
+ */
+void CMorphTargetsCtrl::m_loadBase ()
+{
+	if (!m_streamLayout.isValid() || m_baseLoaded) return;
+
+	std::vector<sxsdk::vec3> orgVertices;
+	CMorphTargetsSymmetryMap symmetryMap;
+	if (m_checkStreamLayout() && StreamCtrl::readMorphTargetsBase(*m_pTargetShape, m_streamLayout, orgVertices, symmetryMap)) {
+		m_orgVertices.swap(orgVertices);
+		m_baseLoaded = true;
+
+		// ベースの頂点座標と一致しない場合は破棄.
+		if (symmetryMap.isValid(m_orgVertices)) m_symmetryMap = symmetryMap;
+		else m_symmetryMap.clear();
+	} else {
+		m_lazyLoadFailed = true;
+	}
+	m_finishLazyLoad();
+}
+
+/**
+ * 指定のTargetの頂点を読み込む (遅延読み込み中の場合).
+ */
+void CMorphTargetsCtrl::m_loadTarget (const int tIndex)
+{
+	if (!m_streamLayout.isValid()) return;
+	if (tIndex < 0 || tIndex >= (int)m_targetsLoaded.size() || m_targetsLoaded[tIndex]) return;
+
+	// 圧縮されている場合は、ベースの頂点座標との差分として格納されている.
+	if (m_streamLayout.encoding != morph_stream_encoding_raw) {
+		m_loadBase();
+		if (!m_streamLayout.isValid()) return;
+	}
+
+	CMorphTargetsData& targetD = m_morphTargetsData[tIndex];
+	if (m_checkStreamLayout() && StreamCtrl::readMorphTargetVertices(*m_pTargetShape, m_streamLayout, tIndex, m_orgVertices, targetD.vIndices, targetD.vertices)) {
+		m_targetsLoaded[tIndex] = 1;
+
+		// 統計はCRC32Cの対象外のため、読み込んだ頂点から計算し直す.
+		m_invalidateDeltaStats(tIndex);
+	} else {
+		m_lazyLoadFailed = true;
+	}
+	m_finishLazyLoad();
+}
+
+/**
+ * すべての読み込みが終わった、または読み込みに失敗した場合は、遅延読み込みの情報をクリア.
+ */
+void CMorphTargetsCtrl::m_finishLazyLoad ()
+{
+	if (!m_lazyLoadFailed) {
+		if (!m_baseLoaded) return;
+		for (size_t i = 0; i < m_targetsLoaded.size(); ++i) {
+			if (!m_targetsLoaded[i]) return;
 		}
 	}
+	m_streamLayout.clear();
+	m_baseLoaded = true;
+	m_targetsLoaded.clear();
+}
 
-	if (shape->has_son()) {
-		sxsdk::shape_class* pShape = shape->get_son();
-		while (pShape->has_bro()) {
-			pShape = pShape->get_bro();
-			m_findMorphTargetsShape(pShape, shapeList);
+/**
+ * 遅延読み込み中の、頂点を読み込んでいないTargetの移動量の統計をstream上の配置から格納.
+ */
+void CMorphTargetsCtrl::m_setDeltaStatsFromLayout ()
+{
+	if (!m_streamLayout.isValid() || !m_streamLayout.hasDeltaStats) return;
+
+	const int targetsCou = (int)m_morphTargetsData.size();
+	if ((int)m_streamLayout.deltaStats.size() != targetsCou || (int)m_targetsLoaded.size() != targetsCou) return;
+	for (int i = 0; i < targetsCou; ++i) {
+		if (m_targetsLoaded[i]) continue;
+		m_targetsDeltaStats[i]      = m_streamLayout.deltaStats[i];
+		m_targetsDeltaStatsValid[i] = 1;
+	}
+	m_blendCulling.valid = false;
+}
+
+/**
+ * すべてのTargetの移動量の統計を無効にする (ベースの頂点座標が変わった場合など).
+ */
+void CMorphTargetsCtrl::m_invalidateDeltaStats ()
+{
+	const size_t targetsCou = m_morphTargetsData.size();
+	m_targetsDeltaStats.resize(targetsCou);
+	m_targetsDeltaStatsValid.assign(targetsCou, 0);
+	m_blendCulling.valid = false;
+}
+
+/**
+ * 指定のTargetの移動量の統計を無効にする.
+ */
+void CMorphTargetsCtrl::m_invalidateDeltaStats (const int tIndex)
+{
+	if (m_targetsDeltaStatsValid.size() != m_morphTargetsData.size()) {
+		m_invalidateDeltaStats();
+		return;
+	}
+	if (tIndex >= 0 && tIndex < (int)m_targetsDeltaStatsValid.size()) m_targetsDeltaStatsValid[tIndex] = 0;
+	m_blendCulling.valid = false;
+}
+
+/**
+ * 指定のTargetの移動量の統計を計算.
+ */
+void CMorphTargetsCtrl::m_updateDeltaStats (const int tIndex)
+{
+	if (m_targetsDeltaStatsValid.size() != m_morphTargetsData.size()) m_invalidateDeltaStats();
+	if (tIndex < 0 || tIndex >= (int)m_morphTargetsData.size()) return;
+
+	m_loadBase();
+	m_loadTarget(tIndex);
+	m_calcDeltaStats(m_orgVertices, m_morphTargetsData[tIndex], m_targetsDeltaStats[tIndex]);
+	m_targetsDeltaStatsValid[tIndex] = 1;
+	m_blendCulling.valid = false;
+}
+
+/**
+ * Morph Targetの、ベースの頂点座標からの移動量の統計を取得.
+ * 無効になっている場合のみ、ここで計算し直す.
+ */
+const CMorphTargetsDeltaStats& CMorphTargetsCtrl::getTargetDeltaStats (const int tIndex) const
+{
+	CMorphTargetsCtrl* pThis = const_cast<CMorphTargetsCtrl *>(this);
+	if (m_targetsDeltaStatsValid.size() != m_morphTargetsData.size()) pThis->m_invalidateDeltaStats();
+	if (!m_targetsDeltaStatsValid[tIndex]) pThis->m_updateDeltaStats(tIndex);
+	return m_targetsDeltaStats[tIndex];
+}
+
+/**
+ * メッシュの更新時に許容する頂点位置の誤差を指定.
+ */
+void CMorphTargetsCtrl::setBlendTolerance (const float tolerance)
+{
+	m_blendTolerance = std::max(0.0f, tolerance);
+}
+
+/**
+ * メッシュの更新時に省略するTargetを判定.
+ * ウエイト値と許容誤差が前回の判定から変わっていない場合は何もしない.
+ */
+void CMorphTargetsCtrl::m_updateBlendCulling ()
+{
+	CMorphTargetsBlendCulling& culling = m_blendCulling;
+	const int targetsCou = (int)m_morphTargetsData.size();
+	if (culling.valid && culling.tolerance == m_blendTolerance && (int)culling.weights.size() == targetsCou) {
+		bool sameWeights = true;
+		for (int i = 0; i < targetsCou && sameWeights; ++i) sameWeights = (culling.weights[i] == m_morphTargetsData[i].weight);
+		if (sameWeights) return;
+	}
+
+	culling.clear();
+	culling.tolerance = m_blendTolerance;
+	culling.weights.resize(targetsCou);
+	culling.skipTargets.resize(targetsCou, 0);
+
+	// Targetを省略した場合の頂点位置の誤差は、(ウエイト値 x 移動量の長さの最大値)以下.
+	// ウエイト値が0、移動量がすべて0のTargetは常に省略し、それ以外は誤差の小さいTargetから合計が許容誤差以下となる範囲で省略する.
+	double errorBound = 0.0;
+	std::vector< std::pair<float, int> > bounds;
+	for (int i = 0; i < targetsCou; ++i) {
+		const float weight = m_morphTargetsData[i].weight;
+		culling.weights[i] = weight;
+
+		const CMorphTargetsDeltaStats& stats = getTargetDeltaStats(i);
+		const float bound = std::min(1.0f, std::max(0.0f, weight)) * stats.maxDeltaLength;
+		if (sx::zero(weight) || stats.isZero()) {
+			culling.skipTargets[i] = 1;
+			errorBound += (double)bound;
+		} else if (m_blendTolerance > 0.0f) {
+			bounds.push_back(std::make_pair(bound, i));
+		}
+	}
+	if (!bounds.empty()) {
+		std::sort(bounds.begin(), bounds.end());
+		for (size_t i = 0; i < bounds.size(); ++i) {
+			if (errorBound + (double)bounds[i].first > (double)m_blendTolerance) break;
+			errorBound += (double)bounds[i].first;
+			culling.skipTargets[ bounds[i].second ] = 1;
+			culling.culledCount++;
 		}
 	}
+	culling.errorBound = (float)errorBound;
+	culling.valid      = true;
+}
+
+/**
+ * 遅延読み込み中の頂点をすべて読み込む.
+ * @return すべて読み込めた場合はtrue.
+ */
+bool CMorphTargetsCtrl::loadAllVertices () const
+{
+	if (m_streamLayout.isValid()) {
+		CMorphTargetsCtrl* pThis = const_cast<CMorphTargetsCtrl *>(this);
+		pThis->m_loadBase();
+		for (size_t i = 0; i < m_targetsLoaded.size(); ++i) {
+			pThis->m_loadTarget((int)i);
+		}
+	}
+	return !m_lazyLoadFailed;
+}
+
+/**
+ * オリジナルの頂点座標を取得.
+ * 遅延読み込み中の場合は、ここでstreamから読み込まれる.
+ */
+const std::vector<sxsdk::vec3>& CMorphTargetsCtrl::getOrgVertices () const
+{
+	const_cast<CMorphTargetsCtrl *>(this)->m_loadBase();
+	return m_orgVertices;
+}
+std::vector<sxsdk::vec3>& CMorphTargetsCtrl::getOrgVertices ()
+{
+	// ベースが変更される可能性があるため、ベースとの差分で格納されたTargetも先に読み込む.
+	loadAllVertices();
+	m_invalidateDeltaStats();
+	return m_orgVertices;
+}
+
+/**
+ * オリジナルの頂点数を取得 (遅延読み込み中でも頂点は読み込まない).
+ */
+int CMorphTargetsCtrl::getOrgVerticesCount () const
+{
+	if (m_streamLayout.isValid() && !m_baseLoaded) return m_streamLayout.orgVerticesCount;
+	return (int)m_orgVertices.size();
+}
+
+/**
+ * Morph Targetの情報を取得.
+ * 遅延読み込み中の場合は、ここでstreamから指定のTargetの頂点が読み込まれる.
+ */
+const CMorphTargetsData& CMorphTargetsCtrl::getMorphTargetData (const int tIndex) const
+{
+	const_cast<CMorphTargetsCtrl *>(this)->m_loadTarget(tIndex);
+	return m_morphTargetsData[tIndex];
+}
+CMorphTargetsData& CMorphTargetsCtrl::getMorphTargetData (const int tIndex)
+{
+	m_loadTarget(tIndex);
+	m_invalidateDeltaStats(tIndex);
+	return m_morphTargetsData[tIndex];
+}
+
+/**
+ * すべてのMorph Targetの情報を取得.
+ */
+const std::vector<CMorphTargetsData>& CMorphTargetsCtrl::getMorphTargetsData () const
+{
+	loadAllVertices();
+	return m_morphTargetsData;
+}
+
+/**
+ * すべてのMorph Targetの情報を置き換え.
+ */
+void CMorphTargetsCtrl::setMorphTargetsData (const std::vector<CMorphTargetsData>& targetsData)
+{
+	loadAllVertices();
+	m_morphTargetsData = targetsData;
+	m_invalidateDeltaStats();
+}
+
+/**
+ * 対称マップを取得.
+ */
+const CMorphTargetsSymmetryMap& CMorphTargetsCtrl::getSymmetryMap () const
+{
+	const_cast<CMorphTargetsCtrl *>(this)->m_loadBase();
+	return m_symmetryMap;
 }
 
 //---------------------------------------------------------------.
@@ -120,16 +575,7 @@ bool CMorphTargetsCtrl::setupShape (sxsdk::shape_class* pShape)
 	if (pShape->get_type() != sxsdk::enums::polygon_mesh) return false;
 
 	try {
-		sxsdk::polygon_mesh_class& pMesh = pShape->get_polygon_mesh();
-		const int versCou = pMesh.get_total_number_of_control_points();
-
-		// 頂点座標を効率よく取得するためのsaverクラス.
-		sxsdk::polygon_mesh_saver_class* pMeshSaver = pMesh.get_polygon_mesh_saver();
-
-		m_orgVertices.resize(versCou);
-		for (int i = 0; i < versCou; ++i) m_orgVertices[i] = pMeshSaver->get_point(i);
-
-		pMeshSaver->release();
+		if (!MeshUtil::readMeshVertices(*pShape, m_orgVertices)) return false;
 
 		m_pTargetShape = pShape;
 
@@ -145,19 +591,13 @@ bool CMorphTargetsCtrl::setupShape (sxsdk::shape_class* pShape)
 bool CMorphTargetsCtrl::updateMorphTargetsBase (sxsdk::shape_class* pShape)
 {
 	if (pShape->get_type() != sxsdk::enums::polygon_mesh) return false;
+	if (!loadAllVertices()) return false;
 	try {
-		sxsdk::polygon_mesh_class& pMesh = pShape->get_polygon_mesh();
-		const int versCou = pMesh.get_total_number_of_control_points();
-
-		// 頂点座標を効率よく取得するためのsaverクラス.
-		sxsdk::polygon_mesh_saver_class* pMeshSaver = pMesh.get_polygon_mesh_saver();
-
-		m_orgVertices.resize(versCou);
-		for (int i = 0; i < versCou; ++i) m_orgVertices[i] = pMeshSaver->get_point(i);
-
-		pMeshSaver->release();
+		if (!MeshUtil::readMeshVertices(*pShape, m_orgVertices)) return false;
 
 		m_pTargetShape = pShape;
+		m_symmetryMap.clear();
+		m_invalidateDeltaStats();
 
 		return true;
 	} catch (...) { }
@@ -169,7 +609,57 @@ bool CMorphTargetsCtrl::updateMorphTargetsBase (sxsdk::shape_class* pShape)
  */
 void CMorphTargetsCtrl::setOrgVertices (const std::vector<sxsdk::vec3>& vertices)
 {
+	loadAllVertices();
 	m_orgVertices = vertices;
+	m_symmetryMap.clear();
+	m_invalidateDeltaStats();
+}
+
+/**
+ * 対称マップを指定。streamからの読み込み時に呼ばれる.
+ * ベースの頂点座標と一致しない場合は破棄される.
+ */
+void CMorphTargetsCtrl::setSymmetryMap (const CMorphTargetsSymmetryMap& symmetryMap)
+{
+	m_loadBase();
+	if (symmetryMap.isValid(m_orgVertices)) m_symmetryMap = symmetryMap;
+	else m_symmetryMap.clear();
+}
+
+/**
+ * 対称マップを更新.
+ * 同じ対称面で計算済みで、ベースが変わっていない場合はキャッシュを使用する.
+ */
+bool CMorphTargetsCtrl::updateSymmetryMap (const int axis, const float center, const float tolerance)
+{
+	m_loadBase();
+	if (m_symmetryMap.isSameSetting(axis, center, tolerance) && m_symmetryMap.isValid(m_orgVertices)) return true;
+	return MorphTargetsSymmetry::calcSymmetryMap(m_orgVertices, axis, center, tolerance, m_symmetryMap);
+}
+
+/**
+ * 指定のTargetを反転/左右分割したTargetを末尾に追加.
+ * @return 追加されたTarget数.
+ */
+int CMorphTargetsCtrl::appendMirrorTargets (const std::vector<int>& tIndices, const MORPH_TARGETS_MIRROR_TYPE type)
+{
+	if (!loadAllVertices()) return 0;
+	if (!m_symmetryMap.isValid(m_orgVertices)) return 0;
+
+	std::vector<CMorphTargetsData> srcTargets;
+	for (size_t i = 0; i < tIndices.size(); ++i) {
+		const int tIndex = tIndices[i];
+		if (tIndex < 0 || tIndex >= (int)m_morphTargetsData.size()) continue;
+		srcTargets.push_back(m_morphTargetsData[tIndex]);
+	}
+
+	std::vector<CMorphTargetsData> dstTargets;
+	if (!MorphTargetsSymmetry::createMirrorTargets(m_orgVertices, m_symmetryMap, srcTargets, type, dstTargets)) return 0;
+	const int startIndex = (int)m_morphTargetsData.size();
+	m_morphTargetsData.insert(m_morphTargetsData.end(), dstTargets.begin(), dstTargets.end());
+	for (int i = 0; i < (int)dstTargets.size(); ++i) m_updateDeltaStats(startIndex + i);
+
+	return (int)dstTargets.size();
 }
 
 /**
@@ -183,6 +673,7 @@ int CMorphTargetsCtrl::appendTargetVertices (const std::string& name, const std:
 {
 	if (vertices.empty() || indices.empty()) return -1;
 	if (vertices.size() != indices.size()) return -1;
+	if (!loadAllVertices()) return -1;
 
 	const int index = (int)m_morphTargetsData.size();
 	m_morphTargetsData.push_back(CMorphTargetsData());
@@ -192,9 +683,32 @@ int CMorphTargetsCtrl::appendTargetVertices (const std::string& name, const std:
 	targetData.vertices = vertices;
 	targetData.weight   = 1.0f;
 
+	m_targetsDeltaStats.push_back(CMorphTargetsDeltaStats());
+	m_targetsDeltaStatsValid.push_back(0);
+	m_updateDeltaStats(index);
+
 	return index;
 }
 
+/**
+ * Morph Targetの情報を指定の位置に挿入 (UNDO/REDO用).
+ * @param[in] tIndex      挿入するMorph Targets番号.
+ * @param[in] targetData  Targetの情報.
+ */
+bool CMorphTargetsCtrl::insertTargetData (const int tIndex, const CMorphTargetsData& targetData)
+{
+	if (tIndex < 0 || tIndex > (int)m_morphTargetsData.size()) return false;
+	if (!loadAllVertices()) return false;
+	m_morphTargetsData.insert(m_morphTargetsData.begin() + tIndex, targetData);
+	if (m_targetsDeltaStatsValid.size() + 1 == m_morphTargetsData.size()) {
+		m_targetsDeltaStats.insert(m_targetsDeltaStats.begin() + tIndex, CMorphTargetsDeltaStats());
+		m_targetsDeltaStatsValid.insert(m_targetsDeltaStatsValid.begin() + tIndex, 0);
+	}
+	m_updateDeltaStats(tIndex);
+	m_selectTargetIndex = -1;
+	return true;
+}
+
 /**
  * 選択頂点座標をMorphTargetsの頂点として更新.
  * 更新時の頂点はウエイト値1.0とする.
@@ -205,6 +719,7 @@ int CMorphTargetsCtrl::appendTargetVertices (const std::string& name, const std:
 int CMorphTargetsCtrl::updateTargetVertices (sxsdk::scene_interface* scene, const int tIndex, const std::vector<int>& indices, const std::vector<sxsdk::vec3>& vertices)
 {
 	if (tIndex < 0 || tIndex >= (int)m_morphTargetsData.size()) return -1;
+	if (!loadAllVertices()) return -1;
 
 	// tIndexのTargetを一度ウエイト0.0に戻す.
 	{
@@ -216,6 +731,7 @@ int CMorphTargetsCtrl::updateTargetVertices (sxsdk::scene_interface* scene, cons
 	targetData.vIndices = indices;
 	targetData.vertices = vertices;
 	targetData.weight   = 1.0f;
+	m_updateDeltaStats(tIndex);
 
 	return tIndex;
 }
@@ -235,6 +751,7 @@ int CMorphTargetsCtrl::getTargetsCount () const
 int CMorphTargetsCtrl::getTargetVerticesCount (const int tIndex) const
 {
 	if (tIndex < 0 || tIndex >= (int)m_morphTargetsData.size()) return 0;
+	if (m_streamLayout.isValid() && !m_targetsLoaded[tIndex]) return m_streamLayout.verticesCounts[tIndex];
 	const CMorphTargetsData& targetData = m_morphTargetsData[tIndex];
 	return targetData.vIndices.size();
 }
@@ -251,7 +768,7 @@ bool CMorphTargetsCtrl::getTargetVertices (const int tIndex, std::vector<int>& i
 	vertices.clear();
 
 	if (tIndex < 0 || tIndex >= (int)m_morphTargetsData.size()) return false;
-	CMorphTargetsData& targetData = m_morphTargetsData[tIndex];
+	const CMorphTargetsData& targetData = getMorphTargetData(tIndex);
 	indices  = targetData.vIndices;
 	vertices = targetData.vertices;
 	return true;
@@ -323,7 +840,12 @@ bool CMorphTargetsCtrl::removeTarget (const int tIndex)
 	m_selectTargetIndex = -1;
 	const int tCou = (int)m_morphTargetsData.size();
 	if (tIndex < 0 || tIndex >= tCou) return false;
+	if (!loadAllVertices()) return false;
 	m_morphTargetsData.erase(m_morphTargetsData.begin() + tIndex);
+	if (m_targetsDeltaStatsValid.size() == m_morphTargetsData.size() + 1) {
+		m_targetsDeltaStats.erase(m_targetsDeltaStats.begin() + tIndex);
+		m_targetsDeltaStatsValid.erase(m_targetsDeltaStatsValid.begin() + tIndex);
+	}
 
 	return true;
 }
@@ -357,6 +879,7 @@ bool CMorphTargetsCtrl::cleanupRedundantVertices (sxsdk::shape_class& shape)
 		pMesh.cleanup_redundant_vertices();
 		return false;
 	}
+	if (!loadAllVertices()) return false;
 
 	try {
 		compointer<sxsdk::scene_interface> scene(m_pTargetShape->get_scene_interface());
@@ -414,6 +937,10 @@ bool CMorphTargetsCtrl::cleanupRedundantVertices (sxsdk::shape_class& shape)
 			pMesh.end_removing_control_points();
 		}
 
+		// 頂点数が変わるため、対称マップと移動量の統計は無効.
+		m_symmetryMap.clear();
+		m_invalidateDeltaStats();
+
 		// Morph Targetsでの頂点インデックスを置き換え、重複しているものを削除.
 		const size_t targetsCou = m_morphTargetsData.size();
 		for (size_t i = 0; i < targetsCou; ++i) {
@@ -448,53 +975,98 @@ bool CMorphTargetsCtrl::cleanupRedundantVertices (sxsdk::shape_class& shape)
  */
 void CMorphTargetsCtrl::m_updateMesh ()
 {
-	if (m_pTargetShape) {
-		if (m_orgVertices.size() != (m_pTargetShape->get_total_number_of_control_points())) return;
-	}
-	if (!m_pTargetShape || m_morphTargetsData.empty()) return;
+	std::vector<sxsdk::vec3> meshVers;
+	std::vector<char> useMeshVers;
+	if (calcMeshVertices(meshVers, useMeshVers)) writeMeshVertices(meshVers, useMeshVers);
+}
 
-	try {
-		std::vector<sxsdk::vec3> meshVers = m_orgVertices;
-		const int versCou = (int)meshVers.size();
-		std::vector<int> useMeshVers;
-		useMeshVers.resize(versCou, false);
+/**
+ * updateMeshの前処理として、streamから頂点を読み込み、移動/回転を補正.
+ * @return メッシュの更新が必要な場合はtrue.
+ */
+bool CMorphTargetsCtrl::prepareUpdateMesh (const bool checkVerticesModify)
+{
+	// 変形にはすべての頂点が必要.
+	if (!loadAllVertices()) return false;
 
-		const int targetsCou = (int)m_morphTargetsData.size();
+	// 頂点の追加/削除が行われた場合は、remapMeshVerticesで対応付け直すまで変形しない.
+	if (!m_pTargetShape || m_morphTargetsData.empty()) return false;
+	if ((int)m_orgVertices.size() != m_pTargetShape->get_total_number_of_control_points()) return false;
 
-		// 更新が必要な頂点をフラグ立て.
-		for (int loop = 0; loop < targetsCou; ++loop) {
-			const CMorphTargetsData& targetD = m_morphTargetsData[loop];
-			const int vCou = (int)targetD.vIndices.size();
-			for (int i = 0; i < vCou; ++i) {
-				const int vIndex = targetD.vIndices[i];
-				useMeshVers[vIndex] = true; 
-			}
+	// オリジナルの頂点より、移動/回転があるかチェック.
+	if (checkVerticesModify) m_updateMeshVertices();
+
+	return ((int)m_orgVertices.size() == m_pTargetShape->get_total_number_of_control_points());
+}
+
+/**
+ * ウエイト値により変形した頂点座標を計算.
+ * SDKの関数は呼ばないため、Morph Targets情報ごとに別のスレッドで呼び出せる.
+ */
+bool CMorphTargetsCtrl::calcMeshVertices (std::vector<sxsdk::vec3>& vertices, std::vector<char>& useVertices)
+{
+	vertices.clear();
+	useVertices.clear();
+	if (isLazyLoading() || m_lazyLoadFailed) return false;
+	if (!m_pTargetShape || m_morphTargetsData.empty()) return false;
+
+	vertices = m_orgVertices;
+	const int versCou = (int)vertices.size();
+	useVertices.resize(versCou, 0);
+
+	const int targetsCou = (int)m_morphTargetsData.size();
+
+	// 更新が必要な頂点をフラグ立て.
+	for (int loop = 0; loop < targetsCou; ++loop) {
+		const CMorphTargetsData& targetD = m_morphTargetsData[loop];
+		const int vCou = (int)targetD.vIndices.size();
+		for (int i = 0; i < vCou; ++i) {
+			const int vIndex = targetD.vIndices[i];
+			useVertices[vIndex] = 1;
 		}
+	}
 
-		// Morph Targetsの情報をウエイト値により、tVerticesの頂点座標を変換.
-		for (int loop = 0; loop < targetsCou; ++loop) {
-			const CMorphTargetsData& targetD = m_morphTargetsData[loop];
-			if (sx::zero(targetD.weight)) continue;
+	// Morph Targetsの情報をウエイト値により、tVerticesの頂点座標を変換.
+	// ウエイト値/移動量が0のTarget、許容誤差内で影響の小さいTargetはスキップ.
+	m_updateBlendCulling();
+	for (int loop = 0; loop < targetsCou; ++loop) {
+		const CMorphTargetsData& targetD = m_morphTargetsData[loop];
+		if (m_blendCulling.skipTargets[loop]) continue;
 
-			const int vCou = (int)targetD.vIndices.size();
-			const float weight = std::min(1.0f, std::max(0.0f, targetD.weight));
+		const int vCou = (int)targetD.vIndices.size();
+		const float weight = std::min(1.0f, std::max(0.0f, targetD.weight));
 
-			for (int i = 0; i < vCou; ++i) {
-				const int vIndex = targetD.vIndices[i];
-				meshVers[vIndex] += (targetD.vertices[i] - m_orgVertices[vIndex]) * weight;
-			}
+		for (int i = 0; i < vCou; ++i) {
+			const int vIndex = targetD.vIndices[i];
+			vertices[vIndex] += (targetD.vertices[i] - m_orgVertices[vIndex]) * weight;
 		}
+	}
+	return true;
+}
 
-		// ポリゴンメッシュの頂点座標を更新.
-		sxsdk::polygon_mesh_class& pMesh = m_pTargetShape->get_polygon_mesh();
+/**
+ * calcMeshVerticesで計算した頂点座標を、m_pTargetShapeのポリゴンメッシュに書き込む.
+ * @return 頂点座標が変更された場合はtrue.
+ */
+bool CMorphTargetsCtrl::writeMeshVertices (const std::vector<sxsdk::vec3>& vertices, const std::vector<char>& useVertices)
+{
+	if (!m_pTargetShape) return false;
+	const int versCou = (int)vertices.size();
+	if ((int)useVertices.size() != versCou) return false;
+
+	try {
+		// 現在の頂点座標をまとめて読み込み、位置が変わる頂点の範囲のみを書き戻す.
+		if (!m_meshBuffer.read(*m_pTargetShape) || m_meshBuffer.size() != versCou) return false;
 		for (int i = 0; i < versCou; ++i) {
-			if (!useMeshVers[i]) continue;
-			sxsdk::vertex_class& v = pMesh.vertex(i);
-			v.set_position(meshVers[i]);
+			if (useVertices[i]) m_meshBuffer.set(i, vertices[i]);
+		}
+		if (m_meshBuffer.write(*m_pTargetShape) > 0) {
+			m_pTargetShape->get_polygon_mesh().update();
+			return true;
 		}
-		pMesh.update();
-
 	} catch (...) { }
+
+	return false;
 }
 
 /**
@@ -503,22 +1075,13 @@ void CMorphTargetsCtrl::m_updateMesh ()
  */
 void CMorphTargetsCtrl::updateMesh (sxsdk::scene_interface* scene, const bool checkVerticesModify)
 {
-	if (m_pTargetShape) {
-		if (m_orgVertices.size() != (m_pTargetShape->get_total_number_of_control_points())) return;
-	}
-	if (!m_pTargetShape || m_morphTargetsData.empty()) return;
+	CProfileScope profileScope(profile_update_mesh);
+	CTraceScope traceScope("CMorphTargetsCtrl::updateMesh", "handle", (long long)(size_t)(m_pTargetShape ? m_pTargetShape->get_handle() : NULL), "vertices", (long long)getOrgVerticesCount());
 
-	if (!checkVerticesModify) {
-		// メッシュ情報を更新.
-		m_updateMesh();
+	if (!prepareUpdateMesh(checkVerticesModify)) return;
 
-	} else {
-		// オリジナルの頂点より、移動/回転があるかチェック.
-		const bool ret = m_updateMeshVertices();
-
-		// メッシュ情報を更新.
-		m_updateMesh();
-	}
+	// メッシュ情報を更新.
+	m_updateMesh();
 }
 
 /**
@@ -527,43 +1090,56 @@ void CMorphTargetsCtrl::updateMesh (sxsdk::scene_interface* scene, const bool ch
  */
 void CMorphTargetsCtrl::pushAllWeight (sxsdk::scene_interface* scene, const bool setZeroWeight)
 {
+	CProfileScope profileScope(profile_push_all_weight);
+	CTraceScope traceScope("CMorphTargetsCtrl::pushAllWeight", "setZeroWeight", setZeroWeight ? 1 : 0);
+
 	g_shapeWeightCache.push_back(std::vector<CMorphTargetsWeightCache>());
 	std::vector<CMorphTargetsWeightCache>& wCache = g_shapeWeightCache.back();
 
 	try {
 		// Morph Targets情報を持つ形状を取得.
+		// シーン全体は走査せず、一覧から取得する (削除された形状は一覧から除外する).
 		std::vector<sxsdk::shape_class *> shapeList;
-		sxsdk::shape_class& rootShape = scene->get_shape();
-		m_findMorphTargetsShape(&rootShape, shapeList);
+		MorphTargetsRegistry::getRegistry().resolveShapes(scene, shapeList);
+		traceScope.setEndArg("shapes", (long long)shapeList.size());
 		if (shapeList.empty()) return;
 
-		const size_t shapeCou = shapeList.size();
-		wCache.resize(shapeCou);
-		for (size_t i = 0; i < shapeCou; ++i) {
-			CMorphTargetsWeightCache& weightC = wCache[i];
-			weightC.clear();
-			weightC.shapeHandle = shapeList[i]->get_handle();
+		// streamは形状ごとに1度だけ読み込み (名前とウエイト値のみ)、ウエイト値を0にする場合もそのまま使用する.
+		// 読み込めない形状(UNDOでstreamが削除された、壊れているなど)は、書き込みで上書きしないよう対象から除き、一覧からも削除する.
+		std::vector<CMorphTargetsCtrl> targetCtrls(shapeList.size());
+		size_t shapeCou = 0;
+		for (size_t i = 0; i < shapeList.size(); ++i) {
+			CMorphTargetsCtrl& targetC = targetCtrls[shapeCou];
+			if (!StreamCtrl::readMorphTargetsData(*shapeList[i], targetC)) {
+				MorphTargetsRegistry::getRegistry().removeShape(shapeList[i]->get_handle());
+				targetC.clear();
+				continue;
+			}
+			shapeList[shapeCou] = shapeList[i];
 
-			CMorphTargetsCtrl targetC;
-			StreamCtrl::readMorphTargetsData(*shapeList[i], targetC);
+			wCache.push_back(CMorphTargetsWeightCache());
+			CMorphTargetsWeightCache& weightC = wCache.back();
+			weightC.shapeHandle = shapeList[i]->get_handle();
 			const int tCou = targetC.getTargetsCount();
 			weightC.weights.resize(tCou, 0.0f);
 			for (int j = 0; j < tCou; ++j) {
 				weightC.weights[j] = targetC.getTargetWeight(j);
 			}
+			shapeCou++;
 		}
+		targetCtrls.resize(shapeCou);
 
 		// ウエイト値を0にする.
+		// メッシュの更新は、すべての形状のウエイト値を保存した後にまとめて行う.
 		if (setZeroWeight) {
 			for (size_t i = 0; i < shapeCou; ++i) {
-				const CMorphTargetsWeightCache& weightC = wCache[i];
-
-				CMorphTargetsCtrl targetC;
-				StreamCtrl::readMorphTargetsData(*shapeList[i], targetC);
+				CMorphTargetsCtrl& targetC = targetCtrls[i];
 				targetC.setZeroAllWeight();
-				StreamCtrl::writeMorphTargetsData(*shapeList[i], targetC);
-				targetC.updateMesh(scene);
+				if (!StreamCtrl::writeMorphTargetsWeights(*shapeList[i], targetC)) {
+					StreamCtrl::writeMorphTargetsData(*shapeList[i], targetC);
+				}
 			}
+			MorphTargetsSceneEval::updateMeshes(targetCtrls);
 		}
 	} catch (...) { }
 }
@@ -573,25 +1149,39 @@ void CMorphTargetsCtrl::pushAllWeight (sxsdk::scene_interface* scene, const bool
  */
 void CMorphTargetsCtrl::popAllWeight (sxsdk::scene_interface* scene)
 {
+	CProfileScope profileScope(profile_pop_all_weight);
+	CTraceScope traceScope("CMorphTargetsCtrl::popAllWeight");
+
 	if (g_shapeWeightCache.empty()) return;
 
 	const std::vector<CMorphTargetsWeightCache>& wCache = g_shapeWeightCache.back();
 	try {
 		const size_t shapeCou = wCache.size();
+		traceScope.setEndArg("shapes", (long long)shapeCou);
+
+		// メッシュの更新は、すべての形状のウエイト値を保存した後にまとめて行う.
+		// 読み込めない形状は、書き込みで上書きしないよう対象から除き、一覧からも削除する.
+		std::vector<CMorphTargetsCtrl> targetCtrls(shapeCou);
 		for (size_t i = 0; i < shapeCou; ++i) {
 			const CMorphTargetsWeightCache& weightC = wCache[i];
 			sxsdk::shape_class* shape = scene->get_shape_by_handle(weightC.shapeHandle);
 			if (!shape) continue;
 
-			CMorphTargetsCtrl targetC;
-			StreamCtrl::readMorphTargetsData(*shape, targetC);
-			const int tCou = targetC.getTargetsCount();
+			CMorphTargetsCtrl& targetC = targetCtrls[i];
+			if (!StreamCtrl::readMorphTargetsData(*shape, targetC)) {
+				MorphTargetsRegistry::getRegistry().removeShape(weightC.shapeHandle);
+				targetC.clear();
+				continue;
+			}
+			const int tCou = std::min(targetC.getTargetsCount(), (int)weightC.weights.size());
 			for (int j = 0; j < tCou; ++j) {
 				targetC.setTargetWeight(j, weightC.weights[j]);
 			}
-			StreamCtrl::writeMorphTargetsData(*shape, targetC);
-			targetC.updateMesh(scene);
+			if (!StreamCtrl::writeMorphTargetsWeights(*shape, targetC)) {
+				StreamCtrl::writeMorphTargetsData(*shape, targetC);
+			}
 		}
+		MorphTargetsSceneEval::updateMeshes(targetCtrls);
 	} catch (...) { }
 
 	g_shapeWeightCache.pop_back();
@@ -635,8 +1225,11 @@ bool CMorphTargetsCtrl::getShapeCurrentWeights (const sxsdk::shape_class* shape,
  */
 bool CMorphTargetsCtrl::m_updateMeshVertices ()
 {
+	CProfileScope profileScope(profile_update_mesh_vertices);
+
 	if (!m_pTargetShape) return false;
 	if (m_pTargetShape->get_type() != sxsdk::enums::polygon_mesh) return false;
+	if (!loadAllVertices()) return false;
 	if (m_orgVertices.size() != (m_pTargetShape->get_total_number_of_control_points())) return false;
 
 	try {
@@ -667,6 +1260,7 @@ bool CMorphTargetsCtrl::m_updateMeshVertices ()
 				targetsD.vertices[i] = meshTransC.calcMeshPos(targetsD.vertices[i]);
 			}
 		}
+		m_invalidateDeltaStats();
 
 		// streamを更新.
 		StreamCtrl::writeMorphTargetsData(*m_pTargetShape, *this);
@@ -675,6 +1269,56 @@ bool CMorphTargetsCtrl::m_updateMeshVertices ()
 	return true;
 }
 
+/**
+ * ポリゴンメッシュの頂点数がベースと異なるか.
+ */
+bool CMorphTargetsCtrl::isVerticesCountChanged () const
+{
+	if (!m_pTargetShape) return false;
+	return (getOrgVerticesCount() != m_pTargetShape->get_total_number_of_control_points());
+}
+
+/**
+ * ポリゴンメッシュの頂点数がベースと異なる場合に、現在の頂点に対応付け直す.
+ * 位置が一致する頂点は元のベース頂点を引き継ぎ、追加された頂点は隣接頂点から移動量を補間する.
+ * @param[out] stats  対応付けの結果の統計情報 (NULLの場合は返さない).
+ * @return 対応付けできた場合はtrue.
+ */
+bool CMorphTargetsCtrl::remapMeshVertices (CMorphTargetsRemapStats* stats)
+{
+	if (!m_pTargetShape) return false;
+	if (m_pTargetShape->get_type() != sxsdk::enums::polygon_mesh) return false;
+	if (!loadAllVertices()) return false;
+
+	try {
+		sxsdk::polygon_mesh_class& pMesh = m_pTargetShape->get_polygon_mesh();
+		const int versCou = pMesh.get_total_number_of_control_points();
+		if (versCou == (int)m_orgVertices.size() || versCou == 0) return false;
+
+		// 現在のメッシュの頂点座標と三角形.
+		std::vector<sxsdk::vec3> meshVertices;
+		if (!MeshUtil::readMeshVertices(*m_pTargetShape, meshVertices)) return false;
+		std::vector<int> meshTriangles;
+		MeshUtil::getMeshTriangles(*m_pTargetShape, meshTriangles);
+
+		std::vector<sxsdk::vec3> newOrgVertices;
+		std::vector<CMorphTargetsData> newTargets;
+		CMorphTargetsRemapStats remapStats;
+		if (!MorphTargetsRemap::remapTargets(m_orgVertices, m_morphTargetsData, meshVertices, meshTriangles, newOrgVertices, newTargets, remapStats)) return false;
+		if (stats) *stats = remapStats;
+
+		// Targetは、頂点を持たなくなったものも含めて同じ順に置き換える.
+		m_orgVertices = newOrgVertices;
+		m_symmetryMap.clear();
+		m_morphTargetsData = newTargets;
+		m_invalidateDeltaStats();
+		return true;
+
+	} catch (...) { }
+
+	return false;
+}
+
 //---------------------------------------------------------------.
 // Stream保存/読み込み用.
 //---------------------------------------------------------------.
@@ -6,8 +6,12 @@
 #define _MORPHTARGETS_CTRL_H
 
 #include "GlobalHeader.h"
+#include "MeshUtil.h"
+#include "MorphTargetsSymmetry.h"
 #include <vector>
 
+class CMorphTargetsRemapStats;
+
 //-------------------------------------------------.
 /**
  * Morph Targetsのウエイト情報の一時保持用.
@@ -63,6 +67,111 @@ public:
 	void clear ();
 };
 
+//-------------------------------------------------.
+/**
+ * Morph Targetの1つの、ベースの頂点座標からの移動量の統計.
+ * Targetに含まれる頂点のみで計算する (含まれない頂点の移動量0は含まない).
+ */
+class CMorphTargetsDeltaStats
+{
+public:
+	sxsdk::vec3 deltaMin;					// 移動量のバウンディングボックスの最小値.
+	sxsdk::vec3 deltaMax;					// 移動量のバウンディングボックスの最大値.
+	float maxDeltaLength;					// 移動量の長さの最大値.
+	int nonZeroCount;						// 移動量が0でない頂点数.
+
+public:
+	CMorphTargetsDeltaStats ();
+
+	void clear ();
+
+	/**
+	 * すべての頂点の移動量が0か (メッシュの変形に影響しない).
+	 */
+	bool isZero () const { return nonZeroCount == 0; }
+};
+
+//-------------------------------------------------.
+/**
+ * メッシュの更新時に、影響の小さいTargetの計算を省略するための判定結果.
+ * ウエイト値と許容誤差が変わらない間は、判定を再利用する.
+ */
+class CMorphTargetsBlendCulling
+{
+public:
+	bool valid;								// 判定済みか.
+	float tolerance;						// 判定した時点の許容誤差.
+	std::vector<float> weights;				// 判定した時点のウエイト値.
+	std::vector<char> skipTargets;			// Targetごとに計算を省略するか.
+	float errorBound;						// 省略したTargetによる頂点位置の誤差の上限.
+	int culledCount;						// 許容誤差により省略したTarget数 (ウエイト値/移動量が0のTargetは含まない).
+
+public:
+	CMorphTargetsBlendCulling ();
+
+	void clear ();
+};
+
+/**
+ * streamに保存する頂点の形式.
+ */
+enum MORPH_TARGETS_STREAM_ENCODING {
+	morph_stream_encoding_raw = 0,			// 頂点インデックスと頂点座標をそのまま格納.
+	morph_stream_encoding_delta,			// 差分を可変長整数で圧縮して格納 (ver.0x103 - ).
+};
+
+//-------------------------------------------------.
+/**
+ * stream上のMorph Targets情報の配置.
+ * 名前/ウエイト値/頂点数と、ベース/Targetごとの頂点の位置を保持し、頂点は必要になったときに読み込む.
+ */
+class CMorphTargetsStreamLayout
+{
+public:
+	int version;							// streamのバージョン (0の場合は無効).
+	int serial;								// 保存ごとに変わる値 (ver.0x102 - ).
+	int streamSize;							// streamのサイズ.
+	int orgVerticesCount;					// ベースの頂点数.
+	int baseOffset;							// ベースの頂点座標の位置.
+	int baseSize;							// ベースの頂点座標のバイト数.
+	int symmetryOffset;						// 対称マップの位置 (ない場合は-1).
+	int symmetrySize;						// 対称マップのバイト数 (ver.0x104 - ).
+	int encoding;							// 頂点の形式 (MORPH_TARGETS_STREAM_ENCODING).
+	bool hasEmptyTargets;					// 頂点を持たないTarget(ver.0x100/0x101で、読み込み時に除外される)がある場合はtrue.
+	bool hasChecksum;						// セクションごとのCRC32Cを持つか (ver.0x104 - ).
+	bool hasDeltaStats;						// Targetごとの移動量の統計を持つか (ver.0x105 - ).
+	unsigned int baseCrc;					// ベースの頂点座標のCRC32C.
+	unsigned int symmetryCrc;				// 対称マップのCRC32C.
+
+	std::vector<std::string> names;			// Targetごとの名前.
+	std::vector<float> weights;				// Targetごとのウエイト値.
+	std::vector<int> verticesCounts;		// Targetごとの頂点数.
+	std::vector<int> indicesOffsets;		// Targetごとの頂点インデックスの位置.
+	std::vector<int> verticesOffsets;		// Targetごとの頂点座標の位置.
+	std::vector<int> indicesSizes;			// Targetごとの頂点インデックスのバイト数.
+	std::vector<int> verticesSizes;			// Targetごとの頂点座標のバイト数.
+	std::vector<int> weightOffsets;			// Targetごとのウエイト値の位置.
+	std::vector<unsigned int> geometryCrcs;	// Targetごとの頂点インデックスと頂点座標のCRC32C.
+	std::vector<CMorphTargetsDeltaStats> deltaStats;	// Targetごとの移動量の統計.
+
+public:
+	CMorphTargetsStreamLayout ();
+
+	void clear ();
+
+	bool isValid () const { return version > 0; }
+
+	/**
+	 * Targetの数.
+	 */
+	int getTargetsCount () const { return (int)names.size(); }
+
+	/**
+	 * 頂点数とTargetの構成が同じか (頂点座標やウエイト値は比較しない).
+	 */
+	bool isCompatible (const CMorphTargetsStreamLayout& v) const;
+};
+
 //-------------------------------------------------.
 class CMorphTargetsCtrl
 {
@@ -74,13 +183,72 @@ private:
 
 	int m_selectTargetIndex;								// 選択されているTarget番号.
 
+	CMorphTargetsSymmetryMap m_symmetryMap;					// ベース頂点の対称マップ (ベースが変わると無効).
+
+	CMorphTargetsStreamLayout m_streamLayout;				// 遅延読み込み中のstream上の配置 (すべて読み込み済みの場合は無効).
+	bool m_baseLoaded;										// ベースの頂点座標を読み込み済みか.
+	std::vector<char> m_targetsLoaded;						// Targetごとに頂点を読み込み済みか.
+	bool m_lazyLoadFailed;									// streamが変更されたため、読み込めなかった頂点がある場合はtrue.
+
+	MORPH_TARGETS_STREAM_ENCODING m_streamEncoding;			// streamに保存する頂点の形式.
+
+	CMeshVerticesBuffer m_meshBuffer;						// メッシュの更新時の頂点座標の読み書き用 (呼び出しをまたいで再利用).
+
+	std::vector<CMorphTargetsDeltaStats> m_targetsDeltaStats;	// Targetごとの移動量の統計.
+	std::vector<char> m_targetsDeltaStatsValid;				// Targetごとに移動量の統計が計算済みか.
+
+	float m_blendTolerance;									// メッシュの更新時に許容する頂点位置の誤差 (0の場合は省略しない).
+	CMorphTargetsBlendCulling m_blendCulling;				// メッシュの更新時に省略するTargetの判定結果.
+
 private:
 	/**
-	 * Morph Targets情報を持つ形状をシーンから再帰的に探して格納.
-	 * @param[in]   shape  検索形状.
-	 * @param[out]  shapeList  ポリゴンメッシュでMorph Targetsを持つ形状が返る.
+	 * 遅延読み込み中のstreamが変更されている場合は、配置を読み直す.
+	 * 頂点数やTargetの構成が変わっている場合は読み込みを打ち切る.
+	 * @return 読み込みを継続できる場合はtrue.
+	 */
+	bool m_checkStreamLayout ();
+
+	/**
+	 * ベースの頂点座標と対称マップを読み込む (遅延読み込み中の場合).
+	 */
+	void m_loadBase ();
+
+	/**
+	 * 指定のTargetの頂点を読み込む (遅延読み込み中の場合).
+	 */
+	void m_loadTarget (const int tIndex);
+
+	/**
+	 * すべての読み込みが終わった場合は、遅延読み込みの情報をクリア.
+	 */
+	void m_finishLazyLoad ();
+
+	/**
+	 * すべてのTargetの移動量の統計を無効にする (ベースの頂点座標が変わった場合など).
+	 * 統計は、次にgetTargetDeltaStatsで参照された時点で計算し直す.
+	 */
+	void m_invalidateDeltaStats ();
+
+	/**
+	 * 指定のTargetの移動量の統計を無効にする.
+	 */
+	void m_invalidateDeltaStats (const int tIndex);
+
+	/**
+	 * 指定のTargetの移動量の統計を計算.
+	 */
+	void m_updateDeltaStats (const int tIndex);
+
+	/**
+	 * 遅延読み込み中の、頂点を読み込んでいないTargetの移動量の統計をstream上の配置から格納.
 	 */
-	void m_findMorphTargetsShape (sxsdk::shape_class* shape, std::vector<sxsdk::shape_class *>& shapeList);
+	void m_setDeltaStatsFromLayout ();
+
+	/**
+	 * メッシュの更新時に省略するTargetを判定.
+	 * ウエイト値と許容誤差が前回の判定から変わっていない場合は何もしない.
+	 */
+	void m_updateBlendCulling ();
 
 	/**
 	 * Morph Targetsの情報より、m_pTargetShapeのポリゴンメッシュを更新.
@@ -109,13 +277,69 @@ public:
 
 	/**
 	 * オリジナルの頂点座標を取得.
+	 * 遅延読み込み中の場合は、ここでstreamから読み込まれる.
+	 * 非const版はベースが変更されるものとして、すべてのTargetの移動量の統計を無効にする.
+	 */
+	const std::vector<sxsdk::vec3>& getOrgVertices () const;
+	std::vector<sxsdk::vec3>& getOrgVertices ();
+
+	/**
+	 * オリジナルの頂点数を取得 (遅延読み込み中でも頂点は読み込まない).
 	 */
-	const std::vector<sxsdk::vec3>& getOrgVertices () const { return m_orgVertices;  }
+	int getOrgVerticesCount () const;
 
 	/**
 	 * Morph Targetの情報を取得.
+	 * 遅延読み込み中の場合は、ここでstreamから指定のTargetの頂点が読み込まれる.
+	 * 非const版はTargetが変更されるものとして、そのTargetの移動量の統計を無効にする.
+	 */
+	const CMorphTargetsData& getMorphTargetData (const int tIndex) const;
+	CMorphTargetsData& getMorphTargetData (const int tIndex);
+
+	/**
+	 * すべてのMorph Targetの情報を取得.
 	 */
-	const CMorphTargetsData& getMorphTargetData (const int tIndex) const { return m_morphTargetsData[tIndex]; }
+	const std::vector<CMorphTargetsData>& getMorphTargetsData () const;
+
+	/**
+	 * すべてのMorph Targetの情報を置き換え.
+	 */
+	void setMorphTargetsData (const std::vector<CMorphTargetsData>& targetsData);
+
+	//---------------------------------------------------------------.
+	// streamからの遅延読み込み用.
+	//---------------------------------------------------------------.
+	/**
+	 * streamから読み込んだ配置より、名前とウエイト値のみを格納する.
+	 * 頂点は、getOrgVertices/getMorphTargetDataなどで必要になった時点で読み込まれる.
+	 * @param[in] pShape   対象形状.
+	 * @param[in] layout   stream上の配置.
+	 */
+	void setupStreamLayout (sxsdk::shape_class* pShape, const CMorphTargetsStreamLayout& layout);
+
+	/**
+	 * 遅延読み込み中の頂点をすべて読み込む.
+	 * @return すべて読み込めた場合はtrue.
+	 */
+	bool loadAllVertices () const;
+
+	/**
+	 * streamから頂点を読み込んでいないものがあるか.
+	 */
+	bool isLazyLoading () const { return m_streamLayout.isValid(); }
+
+	/**
+	 * streamが変更されたため、読み込めなかった頂点があるか.
+	 * この場合はstreamへの保存は行わない.
+	 */
+	bool isLazyLoadFailed () const { return m_lazyLoadFailed; }
+
+	/**
+	 * streamに保存する頂点の形式を指定.
+	 * streamから読み込んだ場合は、そのstreamの形式となる.
+	 */
+	void setStreamEncoding (const MORPH_TARGETS_STREAM_ENCODING encoding) { m_streamEncoding = encoding; }
+	MORPH_TARGETS_STREAM_ENCODING getStreamEncoding () const { return m_streamEncoding; }
 
 	/**
 	 * 対象のポリゴンメッシュ形状クラスを渡す.
@@ -129,6 +353,20 @@ public:
 	 */
 	bool updateMorphTargetsBase (sxsdk::shape_class* pShape);
 
+	/**
+	 * ポリゴンメッシュの頂点数がベースと異なるか (remapMeshVerticesで対応付け直すまで変形されない).
+	 */
+	bool isVerticesCountChanged () const;
+
+	/**
+	 * ポリゴンメッシュの頂点数がベースと異なる場合に、現在の頂点に対応付け直す.
+	 * 移動する頂点がなくなったTargetも、Targetの番号を変えないため残す.
+	 * streamへの保存とUNDO用の記録は呼び出し側で行うこと.
+	 * @param[out] stats  対応付けの結果の統計情報 (NULLの場合は返さない).
+	 * @return 対応付けできた場合はtrue.
+	 */
+	bool remapMeshVertices (CMorphTargetsRemapStats* stats = NULL);
+
 	/**
 	 * baseの頂点座標を格納。streamからの読み込み時に呼ばれる.
 	 */
@@ -143,6 +381,13 @@ public:
 	 */
 	int appendTargetVertices (const std::string& name, const std::vector<int>& indices, const std::vector<sxsdk::vec3>& vertices);
 
+	/**
+	 * Morph Targetの情報を指定の位置に挿入 (UNDO/REDO用).
+	 * @param[in] tIndex      挿入するMorph Targets番号.
+	 * @param[in] targetData  Targetの情報.
+	 */
+	bool insertTargetData (const int tIndex, const CMorphTargetsData& targetData);
+
 	/**
 	 * 選択頂点座標をMorphTargetsの頂点として更新.
 	 * 更新時の頂点はウエイト値1.0とする.
@@ -171,7 +416,7 @@ public:
 	void setTargetName (const int tIndex, const std::string& name);
 
 	/**
-	 * Morph Targetsの頂点数を取得.
+	 * Morph Targetsの頂点数を取得 (遅延読み込み中でも頂点は読み込まない).
 	 * @param[in]  tIndex    Morph Targets番号.
 	 */
 	int getTargetVerticesCount (const int tIndex) const;
@@ -205,6 +450,32 @@ public:
 	 */
 	float getTargetWeight (const int tIndex) const;
 
+	/**
+	 * Morph Targetの、ベースの頂点座標からの移動量の統計を取得.
+	 * 追加/更新時に計算して保持しており、遅延読み込み中で頂点を読み込んでいないTargetはstreamに保存された値を返す.
+	 * ベースの頂点座標の変更などで無効になっている場合のみ、ここで計算し直す.
+	 * @param[in]  tIndex    Morph Targets番号.
+	 */
+	const CMorphTargetsDeltaStats& getTargetDeltaStats (const int tIndex) const;
+
+	/**
+	 * メッシュの更新時に許容する頂点位置の誤差を指定.
+	 * 省略するTargetの(ウエイト値 x 移動量の長さの最大値)の合計がこの値以下となる範囲で、影響の小さいTargetから計算を省略する.
+	 * 0の場合は、ウエイト値が0のTarget以外は省略しない (clearでは変更されない).
+	 */
+	void setBlendTolerance (const float tolerance);
+	float getBlendTolerance () const { return m_blendTolerance; }
+
+	/**
+	 * 直前のメッシュの更新で、省略したTargetによる頂点位置の誤差の上限を取得.
+	 */
+	float getBlendErrorBound () const { return m_blendCulling.errorBound; }
+
+	/**
+	 * 直前のメッシュの更新で、許容誤差により省略したTarget数を取得.
+	 */
+	int getBlendCulledCount () const { return m_blendCulling.culledCount; }
+
 	/**
 	 * 指定のMorph Target情報を削除.
 	 * @param[in]  tIndex    Morph Targets番号.
@@ -234,6 +505,35 @@ public:
 	 */
 	void popAllWeight (sxsdk::scene_interface* scene);
 
+	/**
+	 * 対称マップを取得.
+	 */
+	const CMorphTargetsSymmetryMap& getSymmetryMap () const;
+
+	/**
+	 * 対称マップを指定。streamからの読み込み時に呼ばれる.
+	 * ベースの頂点座標と一致しない場合は破棄される.
+	 */
+	void setSymmetryMap (const CMorphTargetsSymmetryMap& symmetryMap);
+
+	/**
+	 * 対称マップを更新.
+	 * 同じ対称面で計算済みで、ベースが変わっていない場合はキャッシュを使用する.
+	 * @param[in] axis       対称面の法線の軸 (0:X, 1:Y, 2:Z).
+	 * @param[in] center     対称面の位置.
+	 * @param[in] tolerance  許容誤差.
+	 */
+	bool updateSymmetryMap (const int axis, const float center, const float tolerance);
+
+	/**
+	 * 指定のTargetを反転/左右分割したTargetを末尾に追加.
+	 * 事前にupdateSymmetryMapで対称マップを計算しておくこと.
+	 * @param[in] tIndices   元のMorph Targets番号のリスト.
+	 * @param[in] type       作成方法.
+	 * @return 追加されたTarget数.
+	 */
+	int appendMirrorTargets (const std::vector<int>& tIndices, const MORPH_TARGETS_MIRROR_TYPE type);
+
 	/**
 	 * 重複頂点をマージする.
 	 * ポリゴンメッシュの「sxsdk::polygon_mesh_class::cleanup_redundant_vertices」と同等で、Morph Targetsも考慮したもの.
@@ -246,6 +546,30 @@ public:
 	 */
 	void updateMesh (sxsdk::scene_interface* scene, const bool checkVerticesModify = true);
 
+	/**
+	 * updateMeshの前処理として、streamから頂点を読み込み、移動/回転を補正.
+	 * 頂点数がベースと異なる場合は更新しない.
+	 * SDKの関数を呼ぶため、メインスレッドで呼ぶこと.
+	 * @param[in] checkVerticesModify  頂点の移動や回転を補正.
+	 * @return メッシュの更新が必要な場合はtrue.
+	 */
+	bool prepareUpdateMesh (const bool checkVerticesModify = true);
+
+	/**
+	 * ウエイト値により変形した頂点座標を計算 (prepareUpdateMeshの後に呼ぶこと).
+	 * SDKの関数は呼ばないため、Morph Targets情報ごとに別のスレッドで呼び出せる.
+	 * @param[out] vertices     すべての頂点座標が返る.
+	 * @param[out] useVertices  Targetに含まれる(更新が必要な)頂点の場合は1が返る.
+	 */
+	bool calcMeshVertices (std::vector<sxsdk::vec3>& vertices, std::vector<char>& useVertices);
+
+	/**
+	 * calcMeshVerticesで計算した頂点座標を、m_pTargetShapeのポリゴンメッシュに書き込む.
+	 * SDKの関数を呼ぶため、メインスレッドで呼ぶこと.
+	 * @return 頂点座標が変更された場合はtrue.
+	 */
+	bool writeMeshVertices (const std::vector<sxsdk::vec3>& vertices, const std::vector<char>& useVertices);
+
 	//---------------------------------------------------------------.
 	// Stream保存/読み込み用.
 	//---------------------------------------------------------------.
@@ -0,0 +1,234 @@
+﻿/**
+ * シーン内のMorph Targets情報を持つ形状の一覧.
+ */
+#include "MorphTargetsRegistry.h"
+#include "MorphTargetsCtrl.h"
+#include "StreamCtrl.h"
+#include "TraceUtil.h"
+
+namespace {
+	CMorphTargetsRegistry g_morphTargetsRegistry;		// プラグイン全体で共有する一覧.
+}
+
+/**
+ * プラグイン全体で共有する一覧を取得.
+ */
+CMorphTargetsRegistry& MorphTargetsRegistry::getRegistry ()
+{
+	return g_morphTargetsRegistry;
+}
+
+//-------------------------------------------------.
+CMorphTargetsRegistry::CMorphTargetsRegistry ()
+{
+	clear();
+	m_rescanCount = 0;
+}
+
+void CMorphTargetsRegistry::clear ()
+{
+	m_rootHandle = NULL;
+	m_shapes.clear();
+	m_indices.clear();
+}
+
+/**
+ * 一覧を無効にし、次に参照された時点でシーン全体を走査させる.
+ */
+void CMorphTargetsRegistry::invalidate ()
+{
+	clear();
+}
+
+/**
+ * シーン全体を走査して、一覧を作り直す.
+ */
+void CMorphTargetsRegistry::m_rescan (sxsdk::scene_interface* scene)
+{
+	CTraceScope traceScope("CMorphTargetsRegistry::rescan");
+
+	clear();
+	if (!scene) return;
+
+	try {
+		sxsdk::shape_class& rootShape = scene->get_shape();
+		m_rootHandle = rootShape.get_handle();
+		m_findMorphTargetsShape(&rootShape);
+		m_rescanCount++;
+		traceScope.setEndArg("shapes", (long long)m_shapes.size());
+	} catch (...) {
+		clear();
+	}
+}
+
+/**
+ * 形状以下を再帰的にたどり、Morph Targets情報を持つポリゴンメッシュを一覧に格納.
+ */
+void CMorphTargetsRegistry::m_findMorphTargetsShape (sxsdk::shape_class* shape)
+{
+	if (shape->get_type() == sxsdk::enums::polygon_mesh) {
+		m_updateShapeFromStream(*shape);
+	}
+
+	if (shape->has_son()) {
+		sxsdk::shape_class* pShape = shape->get_son();
+		while (pShape->has_bro()) {
+			pShape = pShape->get_bro();
+			m_findMorphTargetsShape(pShape);
+		}
+	}
+}
+
+/**
+ * 形状のstreamからTarget数と頂点数を読み込み、一覧に格納 (持たない場合は一覧から除外).
+ * 頂点は読み込まず、ヘッダとTargetの配置表のみを参照する.
+ */
+void CMorphTargetsRegistry::m_updateShapeFromStream (sxsdk::shape_class& shape)
+{
+	if (shape.get_type() != sxsdk::enums::polygon_mesh || !StreamCtrl::hasMorphTargetsData(shape)) {
+		removeShape(shape.get_handle());
+		return;
+	}
+
+	CMorphTargetsShapeSummary summary;
+	summary.shapeHandle = shape.get_handle();
+
+	// 配置表が読み込めない場合も、Morph Targets情報を持つ形状として扱う (pushAllWeightなどでの扱いを従来と同じにする).
+	CMorphTargetsStreamLayout layout;
+	if (StreamCtrl::readMorphTargetsLayout(shape, layout)) {
+		summary.targetsCount     = layout.getTargetsCount();
+		summary.orgVerticesCount = layout.orgVerticesCount;
+	}
+	m_set(summary);
+}
+
+/**
+ * 一覧に追加、または更新.
+ */
+void CMorphTargetsRegistry::m_set (const CMorphTargetsShapeSummary& summary)
+{
+	std::map<void*, int>::const_iterator iter = m_indices.find(summary.shapeHandle);
+	if (iter != m_indices.end()) {
+		m_shapes[iter->second] = summary;
+	} else {
+		m_indices[summary.shapeHandle] = (int)m_shapes.size();
+		m_shapes.push_back(summary);
+	}
+}
+
+/**
+ * 形状がこの一覧のシーンに属するか.
+ */
+bool CMorphTargetsRegistry::m_isSameScene (sxsdk::shape_class& shape) const
+{
+	if (!isValid()) return false;
+
+	try {
+		compointer<sxsdk::scene_interface> scene(shape.get_scene_interface());
+		if (!scene) return false;
+		return (scene->get_shape().get_handle() == m_rootHandle);
+	} catch (...) { }
+
+	return false;
+}
+
+/**
+ * シーン内のMorph Targets情報を持つ形状の一覧を取得.
+ * 一覧が無効の場合、別のシーンの場合はシーン全体を走査して作り直す.
+ */
+const std::vector<CMorphTargetsShapeSummary>& CMorphTargetsRegistry::getShapes (sxsdk::scene_interface* scene)
+{
+	if (!scene) {
+		clear();
+		return m_shapes;
+	}
+
+	try {
+		if (!isValid() || scene->get_shape().get_handle() != m_rootHandle) m_rescan(scene);
+	} catch (...) {
+		clear();
+	}
+	return m_shapes;
+}
+
+/**
+ * シーン内のMorph Targets情報を持つ形状を取得.
+ * get_shape_by_handleで取得できない(削除された)形状は、一覧から除外する.
+ */
+int CMorphTargetsRegistry::resolveShapes (sxsdk::scene_interface* scene, std::vector<sxsdk::shape_class *>& shapeList)
+{
+	shapeList.clear();
+	if (!scene) return 0;
+
+	// removeShapeで一覧が変わるため、複製したものをたどる.
+	const std::vector<CMorphTargetsShapeSummary> shapes = getShapes(scene);
+	shapeList.reserve(shapes.size());
+	try {
+		for (size_t i = 0; i < shapes.size(); ++i) {
+			sxsdk::shape_class* shape = scene->get_shape_by_handle(shapes[i].shapeHandle);
+			if (shape) shapeList.push_back(shape);
+			else removeShape(shapes[i].shapeHandle);
+		}
+	} catch (...) { }
+
+	return (int)shapeList.size();
+}
+
+/**
+ * 指定の形状の概要を取得.
+ */
+const CMorphTargetsShapeSummary* CMorphTargetsRegistry::getShapeSummary (sxsdk::scene_interface* scene, void* shapeHandle)
+{
+	getShapes(scene);
+	std::map<void*, int>::const_iterator iter = m_indices.find(shapeHandle);
+	return (iter != m_indices.end()) ? &m_shapes[iter->second] : NULL;
+}
+
+/**
+ * streamに保存した形状の概要を更新.
+ * 一覧が無効の場合、別のシーンの形状の場合は、次にgetShapesで走査した時点で反映されるため何もしない.
+ */
+void CMorphTargetsRegistry::updateShape (sxsdk::shape_class& shape, const int targetsCount, const int orgVerticesCount)
+{
+	if (!m_isSameScene(shape)) return;
+
+	CMorphTargetsShapeSummary summary;
+	summary.shapeHandle      = shape.get_handle();
+	summary.targetsCount     = targetsCount;
+	summary.orgVerticesCount = orgVerticesCount;
+	m_set(summary);
+}
+
+/**
+ * 選択された形状とその子形状について、streamから読み込んで一覧を更新.
+ */
+void CMorphTargetsRegistry::updateShapes (sxsdk::shape_class* const * shapes, const int count)
+{
+	if (!isValid() || !shapes) return;
+
+	try {
+		for (int i = 0; i < count; ++i) {
+			if (!shapes[i] || !m_isSameScene(*shapes[i])) continue;
+			m_findMorphTargetsShape(shapes[i]);
+		}
+	} catch (...) { }
+}
+
+/**
+ * 一覧から除外.
+ * 末尾の要素と入れ替えて削除するため、一覧の順番は変わる.
+ */
+void CMorphTargetsRegistry::removeShape (void* shapeHandle)
+{
+	std::map<void*, int>::iterator iter = m_indices.find(shapeHandle);
+	if (iter == m_indices.end()) return;
+
+	const int index     = iter->second;
+	const int lastIndex = (int)m_shapes.size() - 1;
+	m_indices.erase(iter);
+	if (index != lastIndex) {
+		m_shapes[index] = m_shapes[lastIndex];
+		m_indices[m_shapes[index].shapeHandle] = index;
+	}
+	m_shapes.pop_back();
+}
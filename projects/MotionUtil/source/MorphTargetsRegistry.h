@@ -0,0 +1,135 @@
+﻿/**
+ * シーン内のMorph Targets情報を持つ形状の一覧.
+ * streamへの保存/削除と、ウィンドウのシーン/形状選択の変更で更新し、.
+ * シーン全体を走査するのは一覧が無効になった場合のみとする.
+ * Shade3D側のUNDOやstreamへの直接の書き込みなどで、選択されていない形状がMorph Targets情報を持った場合は、.
+ * 次にシーン全体を走査するまで(別のシーンへの切り替え、invalidate)一覧に含まれない.
+ */
+#ifndef _MORPHTARGETSREGISTRY_H
+#define _MORPHTARGETSREGISTRY_H
+
+#include "GlobalHeader.h"
+
+#include <map>
+#include <vector>
+
+/**
+ * Morph Targets情報を持つ形状の概要.
+ */
+class CMorphTargetsShapeSummary
+{
+public:
+	void* shapeHandle;						// 形状のハンドル.
+	int targetsCount;						// Target数.
+	int orgVerticesCount;					// ベースの頂点数.
+
+public:
+	CMorphTargetsShapeSummary () : shapeHandle(NULL), targetsCount(0), orgVerticesCount(0) { }
+};
+
+//-------------------------------------------------.
+/**
+ * Morph Targets情報を持つ形状の一覧.
+ * 1つのシーンに対してのみ保持し、別のシーンが指定された場合は作り直す.
+ */
+class CMorphTargetsRegistry
+{
+private:
+	void* m_rootHandle;									// 一覧を作成したシーンのルート形状のハンドル (NULLの場合は一覧が無効).
+	std::vector<CMorphTargetsShapeSummary> m_shapes;	// Morph Targets情報を持つ形状.
+	std::map<void*, int> m_indices;						// 形状のハンドルから、m_shapesでのインデックス.
+	int m_rescanCount;									// シーン全体を走査した回数.
+
+private:
+	/**
+	 * シーン全体を走査して、一覧を作り直す.
+	 */
+	void m_rescan (sxsdk::scene_interface* scene);
+
+	/**
+	 * 形状以下を再帰的にたどり、Morph Targets情報を持つポリゴンメッシュを一覧に格納.
+	 */
+	void m_findMorphTargetsShape (sxsdk::shape_class* shape);
+
+	/**
+	 * 形状のstreamからTarget数と頂点数を読み込み、一覧に格納 (持たない場合は一覧から除外).
+	 */
+	void m_updateShapeFromStream (sxsdk::shape_class& shape);
+
+	/**
+	 * 一覧に追加、または更新.
+	 */
+	void m_set (const CMorphTargetsShapeSummary& summary);
+
+	/**
+	 * 形状がこの一覧のシーンに属するか.
+	 */
+	bool m_isSameScene (sxsdk::shape_class& shape) const;
+
+public:
+	CMorphTargetsRegistry ();
+
+	void clear ();
+
+	/**
+	 * 一覧を無効にし、次に参照された時点でシーン全体を走査させる.
+	 */
+	void invalidate ();
+
+	/**
+	 * 一覧が有効か.
+	 */
+	bool isValid () const { return m_rootHandle != NULL; }
+
+	/**
+	 * シーン全体を走査した回数を取得.
+	 */
+	int getRescanCount () const { return m_rescanCount; }
+
+	/**
+	 * シーン内のMorph Targets情報を持つ形状の一覧を取得.
+	 * 一覧が無効の場合、別のシーンの場合はシーン全体を走査して作り直す.
+	 * 削除された形状のハンドルが含まれる場合があるため、get_shape_by_handleで形状を取得できない場合はremoveShapeで除外すること.
+	 */
+	const std::vector<CMorphTargetsShapeSummary>& getShapes (sxsdk::scene_interface* scene);
+
+	/**
+	 * シーン内のMorph Targets情報を持つ形状を取得.
+	 * get_shape_by_handleで取得できない(削除された)形状は、一覧から除外する.
+	 * @param[out] shapeList  形状が返る.
+	 * @return 形状数.
+	 */
+	int resolveShapes (sxsdk::scene_interface* scene, std::vector<sxsdk::shape_class *>& shapeList);
+
+	/**
+	 * 指定の形状の概要を取得.
+	 * @return Morph Targets情報を持たない場合はNULL.
+	 */
+	const CMorphTargetsShapeSummary* getShapeSummary (sxsdk::scene_interface* scene, void* shapeHandle);
+
+	/**
+	 * streamに保存した形状の概要を更新 (StreamCtrl::writeMorphTargetsDataから呼ばれる).
+	 */
+	void updateShape (sxsdk::shape_class& shape, const int targetsCount, const int orgVerticesCount);
+
+	/**
+	 * 選択された形状とその子形状について、streamから読み込んで一覧を更新.
+	 * コピー/ペーストなど、streamへの保存を経由せずにMorph Targets情報を持つ形状が追加された場合に対応する.
+	 */
+	void updateShapes (sxsdk::shape_class* const * shapes, const int count);
+
+	/**
+	 * 一覧から除外.
+	 */
+	void removeShape (void* shapeHandle);
+};
+
+namespace MorphTargetsRegistry
+{
+	/**
+	 * プラグイン全体で共有する一覧を取得.
+	 */
+	CMorphTargetsRegistry& getRegistry ();
+}
+
+#endif
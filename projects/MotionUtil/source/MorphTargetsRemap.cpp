@@ -0,0 +1,291 @@
+﻿/**
+ * ポリゴンメッシュの頂点の追加/削除時の、Morph Targetsの頂点の対応付け直し.
+ * 現在のメッシュの頂点を保存されているベース頂点に対応付け、Targetの頂点インデックスを再構築する.
+ */
+#include "MorphTargetsRemap.h"
+#include "BSPPoint.h"
+#include "MathUtil.h"
+#include "ParallelUtil.h"
+
+#include <algorithm>
+
+namespace {
+	/**
+	 * 補間する頂点の、対応付けられた隣接頂点と重み.
+	 */
+	class CRemapStencil {
+	public:
+		std::vector<int> vIndices;			// 対応付けられた隣接頂点 (変更後の頂点インデックス).
+		std::vector<float> weights;			// 重み (合計1.0).
+	};
+
+	/**
+	 * 隣接頂点をたどる最大の深さ.
+	 */
+	const int MAX_NEIGHBOR_RINGS = 4;
+}
+
+//-------------------------------------------------.
+CMorphTargetsRemapStats::CMorphTargetsRemapStats ()
+{
+	clear();
+}
+
+void CMorphTargetsRemapStats::clear ()
+{
+	oldVerticesCount  = 0;
+	newVerticesCount  = 0;
+	matchedCount      = 0;
+	interpolatedCount = 0;
+	removedCount      = 0;
+}
+
+//-------------------------------------------------.
+/**
+ * 現在のメッシュの頂点に合わせて、ベース頂点とTargetを対応付け直す.
+ */
+bool MorphTargetsRemap::remapTargets (const std::vector<sxsdk::vec3>& orgVertices, const std::vector<CMorphTargetsData>& targets,
+	const std::vector<sxsdk::vec3>& meshVertices, const std::vector<int>& meshTriangles,
+	std::vector<sxsdk::vec3>& newOrgVertices, std::vector<CMorphTargetsData>& newTargets, CMorphTargetsRemapStats& stats)
+{
+	newOrgVertices.clear();
+	newTargets.clear();
+	stats.clear();
+
+	const int oldCou = (int)orgVertices.size();
+	const int newCou = (int)meshVertices.size();
+	const int targetsCou = (int)targets.size();
+	stats.oldVerticesCount = oldCou;
+	stats.newVerticesCount = newCou;
+	if (oldCou == 0 || newCou == 0) return false;
+
+	try {
+		// 変更前のメッシュの頂点座標 (ウエイト値を反映したもの).
+		std::vector<sxsdk::vec3> morphedVertices = orgVertices;
+		for (int loop = 0; loop < targetsCou; ++loop) {
+			const CMorphTargetsData& targetD = targets[loop];
+			const float weight = std::min(1.0f, std::max(0.0f, targetD.weight));
+			if (weight <= 0.0f) continue;
+			const int vCou = (int)std::min(targetD.vIndices.size(), targetD.vertices.size());
+			for (int i = 0; i < vCou; ++i) {
+				const int vIndex = targetD.vIndices[i];
+				if (vIndex < 0 || vIndex >= oldCou) continue;
+				morphedVertices[vIndex] += (targetD.vertices[i] - orgVertices[vIndex]) * weight;
+			}
+		}
+
+		// 許容誤差.
+		float tolerance = 1e-4f;
+		{
+			sxsdk::vec3 bbMin, bbMax;
+			MathUtil::calcBoundingBox(morphedVertices, bbMin, bbMax);
+			tolerance = std::max(tolerance, sxsdk::absolute(bbMax - bbMin) * 1e-5f);
+		}
+
+		// 現在の頂点ごとに、対応する変更前の頂点インデックスを求める (対応しない場合は-1).
+		std::vector<int> oldIndices(newCou, -1);
+		std::vector<char> used(oldCou, 0);
+		{
+			// 頂点は末尾に追加/削除されることが多いため、先頭から同じ位置のものはそのまま対応付ける.
+			const int cou = std::min(oldCou, newCou);
+			int prefixCou = 0;
+			for (int i = 0; i < cou; ++i) {
+				const sxsdk::vec3 dd = meshVertices[i] - morphedVertices[i];
+				if (std::abs(dd.x) > tolerance || std::abs(dd.y) > tolerance || std::abs(dd.z) > tolerance) break;
+				oldIndices[i] = i;
+				used[i] = 1;
+				prefixCou++;
+			}
+
+			// 残りは空間分割を使用して近接頂点を探す.
+			if (prefixCou < newCou) {
+				CBSPPoint bspPoint(morphedVertices);
+				bspPoint.build();
+
+				std::vector<int> indices;
+				for (int i = prefixCou; i < newCou; ++i) {
+					const int sCou = bspPoint.searchVertices(meshVertices[i], tolerance, indices);
+					int minIndex = -1;
+					float minDist2 = 0.0f;
+					bool minUsed = true;
+					for (int j = 0; j < sCou; ++j) {
+						const int oIndex = indices[j];
+						const sxsdk::vec3 dd = morphedVertices[oIndex] - meshVertices[i];
+						const float dist2 = dd.x * dd.x + dd.y * dd.y + dd.z * dd.z;
+						const bool isUsed = (used[oIndex] != 0);
+
+						// 未使用の頂点を優先する (同一位置に複数の頂点がある場合).
+						if (minIndex < 0 || (minUsed && !isUsed) || (minUsed == isUsed && dist2 < minDist2)) {
+							minIndex = oIndex;
+							minDist2 = dist2;
+							minUsed  = isUsed;
+						}
+					}
+					if (minIndex >= 0) {
+						oldIndices[i] = minIndex;
+						used[minIndex] = 1;
+					}
+				}
+			}
+		}
+		for (int i = 0; i < newCou; ++i) {
+			if (oldIndices[i] >= 0) stats.matchedCount++;
+		}
+		for (int i = 0; i < oldCou; ++i) {
+			if (!used[i]) stats.removedCount++;
+		}
+		stats.interpolatedCount = newCou - stats.matchedCount;
+
+		// 対応しない頂点について、対応付けられた隣接頂点から補間するための重みを計算.
+		std::vector<int> interpolateIndices;
+		std::vector<CRemapStencil> stencils;
+		if (stats.interpolatedCount > 0) {
+			// 隣接頂点のリスト (CSR形式).
+			std::vector<int> adjStart(newCou + 1, 0);
+			std::vector<int> adjList;
+			{
+				const int triCou = (int)(meshTriangles.size() / 3);
+				for (int i = 0; i < triCou; ++i) {
+					for (int j = 0; j < 3; ++j) {
+						const int vIndex = meshTriangles[i * 3 + j];
+						if (vIndex >= 0 && vIndex < newCou) adjStart[vIndex + 1] += 2;
+					}
+				}
+				for (int i = 0; i < newCou; ++i) adjStart[i + 1] += adjStart[i];
+				adjList.resize(adjStart[newCou], -1);
+				std::vector<int> adjPos(adjStart.begin(), adjStart.end() - 1);
+				for (int i = 0; i < triCou; ++i) {
+					const int* tri = &meshTriangles[i * 3];
+					for (int j = 0; j < 3; ++j) {
+						const int vIndex = tri[j];
+						if (vIndex < 0 || vIndex >= newCou) continue;
+						adjList[adjPos[vIndex]++] = tri[(j + 1) % 3];
+						adjList[adjPos[vIndex]++] = tri[(j + 2) % 3];
+					}
+				}
+			}
+
+			for (int i = 0; i < newCou; ++i) {
+				if (oldIndices[i] < 0) interpolateIndices.push_back(i);
+			}
+			const int iCou = (int)interpolateIndices.size();
+			stencils.resize(iCou);
+
+			// 隣接頂点を幅優先でたどり、対応付けられた頂点が見つかった深さの頂点を距離の逆数で重み付け.
+			const bool ret = ParallelUtil::parallelFor(iCou, [&](int index) {
+				const int vIndex = interpolateIndices[index];
+				CRemapStencil& stencil = stencils[index];
+				std::vector<int> ring(1, vIndex), nextRing, visited(1, vIndex);
+				for (int depth = 0; depth < MAX_NEIGHBOR_RINGS && stencil.vIndices.empty() && !ring.empty(); ++depth) {
+					nextRing.clear();
+					for (size_t k = 0; k < ring.size(); ++k) {
+						const int v = ring[k];
+						for (int j = adjStart[v]; j < adjStart[v + 1]; ++j) {
+							const int n = adjList[j];
+							if (n < 0 || std::find(visited.begin(), visited.end(), n) != visited.end()) continue;
+							visited.push_back(n);
+							nextRing.push_back(n);
+							if (oldIndices[n] >= 0) stencil.vIndices.push_back(n);
+						}
+					}
+					ring.swap(nextRing);
+				}
+
+				float sumW = 0.0f;
+				stencil.weights.resize(stencil.vIndices.size());
+				for (size_t k = 0; k < stencil.vIndices.size(); ++k) {
+					const float dist = sxsdk::absolute(meshVertices[ stencil.vIndices[k] ] - meshVertices[vIndex]);
+					stencil.weights[k] = 1.0f / std::max(dist, tolerance);
+					sumW += stencil.weights[k];
+				}
+				for (size_t k = 0; k < stencil.weights.size(); ++k) stencil.weights[k] /= sumW;
+			}, 64);
+			if (!ret) throw "stencil failed";
+		}
+
+		// Targetごとに、変更後の頂点での移動量を求める.
+		// 作業用の配列はTargetごとに確保し、結果は移動する頂点のみを保持する.
+		newTargets.resize(targetsCou);
+		std::vector< std::vector<sxsdk::vec3> > newDeltas(targetsCou);
+		const bool ret = ParallelUtil::parallelFor(targetsCou, [&](int loop) {
+			const CMorphTargetsData& srcTarget = targets[loop];
+			std::vector<sxsdk::vec3> oldDeltas(oldCou, sxsdk::vec3(0, 0, 0));
+			std::vector<char> oldMoved(oldCou, 0);
+			const int vCou = (int)std::min(srcTarget.vIndices.size(), srcTarget.vertices.size());
+			for (int i = 0; i < vCou; ++i) {
+				const int vIndex = srcTarget.vIndices[i];
+				if (vIndex < 0 || vIndex >= oldCou) continue;
+				oldDeltas[vIndex] = srcTarget.vertices[i] - orgVertices[vIndex];
+				oldMoved[vIndex]  = 1;
+			}
+
+			std::vector<sxsdk::vec3> deltas(newCou, sxsdk::vec3(0, 0, 0));
+			std::vector<char> moved(newCou, 0);
+			for (int i = 0; i < newCou; ++i) {
+				const int oIndex = oldIndices[i];
+				if (oIndex < 0 || !oldMoved[oIndex]) continue;
+				deltas[i] = oldDeltas[oIndex];
+				moved[i]  = 1;
+			}
+			for (size_t k = 0; k < stencils.size(); ++k) {
+				const CRemapStencil& stencil = stencils[k];
+				sxsdk::vec3 dv(0, 0, 0);
+				bool hasMoved = false;
+				for (size_t j = 0; j < stencil.vIndices.size(); ++j) {
+					const int n = stencil.vIndices[j];
+					if (!moved[n]) continue;
+					dv += deltas[n] * stencil.weights[j];
+					hasMoved = true;
+				}
+				if (!hasMoved) continue;
+				deltas[ interpolateIndices[k] ] = dv;
+				moved[ interpolateIndices[k] ]  = 1;
+			}
+
+			CMorphTargetsData& targetD = newTargets[loop];
+			targetD.clear();
+			targetD.name   = srcTarget.name;
+			targetD.weight = srcTarget.weight;
+			for (int i = 0; i < newCou; ++i) {
+				if (!moved[i]) continue;
+				targetD.vIndices.push_back(i);
+				newDeltas[loop].push_back(deltas[i]);
+			}
+		});
+		if (!ret) throw "remap failed";
+
+		// 変更後のベース頂点.
+		// 追加された頂点は、現在の位置からウエイト値による移動を差し引いたものとする.
+		newOrgVertices.resize(newCou);
+		for (int i = 0; i < newCou; ++i) {
+			if (oldIndices[i] >= 0) newOrgVertices[i] = orgVertices[ oldIndices[i] ];
+			else newOrgVertices[i] = meshVertices[i];
+		}
+		for (int loop = 0; loop < targetsCou; ++loop) {
+			const float weight = std::min(1.0f, std::max(0.0f, targets[loop].weight));
+			if (weight <= 0.0f) continue;
+			const CMorphTargetsData& targetD = newTargets[loop];
+			for (size_t i = 0; i < targetD.vIndices.size(); ++i) {
+				const int vIndex = targetD.vIndices[i];
+				if (oldIndices[vIndex] < 0) newOrgVertices[vIndex] -= newDeltas[loop][i] * weight;
+			}
+		}
+
+		// Targetの頂点座標.
+		for (int loop = 0; loop < targetsCou; ++loop) {
+			CMorphTargetsData& targetD = newTargets[loop];
+			const int vCou = (int)targetD.vIndices.size();
+			targetD.vertices.resize(vCou);
+			for (int i = 0; i < vCou; ++i) {
+				targetD.vertices[i] = newOrgVertices[ targetD.vIndices[i] ] + newDeltas[loop][i];
+			}
+		}
+
+		return true;
+
+	} catch (...) { }
+
+	newOrgVertices.clear();
+	newTargets.clear();
+	return false;
+}
@@ -0,0 +1,49 @@
+﻿/**
+ * ポリゴンメッシュの頂点の追加/削除時の、Morph Targetsの頂点の対応付け直し.
+ * 現在のメッシュの頂点を保存されているベース頂点に対応付け、Targetの頂点インデックスを再構築する.
+ */
+#ifndef _MORPHTARGETSREMAP_H
+#define _MORPHTARGETSREMAP_H
+
+#include "GlobalHeader.h"
+#include "MorphTargetsCtrl.h"
+
+#include <vector>
+
+/**
+ * 対応付けの結果の統計情報.
+ */
+class CMorphTargetsRemapStats
+{
+public:
+	int oldVerticesCount;				// 変更前の頂点数.
+	int newVerticesCount;				// 変更後の頂点数.
+	int matchedCount;					// 変更前の頂点に対応付けられた頂点数.
+	int interpolatedCount;				// 隣接頂点から補間した(新たに追加された)頂点数.
+	int removedCount;					// 削除された頂点数.
+
+public:
+	CMorphTargetsRemapStats ();
+
+	void clear ();
+};
+
+namespace MorphTargetsRemap
+{
+	/**
+	 * 現在のメッシュの頂点に合わせて、ベース頂点とTargetを対応付け直す.
+	 * 現在のメッシュは、ウエイト値が反映された状態であるとする.
+	 * @param[in]  orgVertices     変更前のベースの頂点座標.
+	 * @param[in]  targets         変更前のTarget.
+	 * @param[in]  meshVertices    現在のメッシュの頂点座標.
+	 * @param[in]  meshTriangles   現在のメッシュの三角形ごとの頂点インデックス (追加された頂点の隣接頂点の検索用).
+	 * @param[out] newOrgVertices  対応付け後のベースの頂点座標.
+	 * @param[out] newTargets      対応付け後のTarget (元のTargetと同じ順).
+	 * @param[out] stats           統計情報.
+	 */
+	bool remapTargets (const std::vector<sxsdk::vec3>& orgVertices, const std::vector<CMorphTargetsData>& targets,
+		const std::vector<sxsdk::vec3>& meshVertices, const std::vector<int>& meshTriangles,
+		std::vector<sxsdk::vec3>& newOrgVertices, std::vector<CMorphTargetsData>& newTargets, CMorphTargetsRemapStats& stats);
+}
+
+#endif
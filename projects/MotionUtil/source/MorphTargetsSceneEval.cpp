@@ -0,0 +1,121 @@
+﻿/**
+ * シーン内のMorph Targets情報を持つ形状のメッシュを、まとめて更新.
+ */
+#include "MorphTargetsSceneEval.h"
+#include "MorphTargetsRegistry.h"
+#include "ParallelUtil.h"
+#include "ProfileUtil.h"
+#include "StreamCtrl.h"
+#include "TraceUtil.h"
+
+#include <algorithm>
+
+//-------------------------------------------------.
+CMorphTargetsSceneEvalStats::CMorphTargetsSceneEvalStats ()
+{
+	clear();
+}
+
+void CMorphTargetsSceneEvalStats::clear ()
+{
+	shapesCount    = 0;
+	evaluatedCount = 0;
+	updatedCount   = 0;
+	verticesCount  = 0;
+	threadsCount   = 0;
+}
+
+//-------------------------------------------------.
+namespace {
+	/**
+	 * 変形の計算量の目安 (ベースの頂点数とTargetの頂点数の合計).
+	 */
+	long long m_calcEvalCost (const CMorphTargetsCtrl& ctrl)
+	{
+		long long cost = (long long)ctrl.getOrgVerticesCount();
+		const int targetsCou = ctrl.getTargetsCount();
+		for (int i = 0; i < targetsCou; ++i) cost += (long long)ctrl.getTargetVerticesCount(i);
+		return cost;
+	}
+}
+
+/**
+ * 指定のMorph Targets情報のメッシュをまとめて更新.
+ * @return 頂点座標が変更された形状数.
+ */
+int MorphTargetsSceneEval::updateMeshes (std::vector<CMorphTargetsCtrl>& ctrls, const bool checkVerticesModify, CMorphTargetsSceneEvalStats* stats)
+{
+	CProfileScope profileScope(profile_scene_eval);
+	CTraceScope traceScope("MorphTargetsSceneEval::updateMeshes", "shapes", (long long)ctrls.size());
+
+	CMorphTargetsSceneEvalStats evalStats;
+	const int shapesCou = (int)ctrls.size();
+	evalStats.shapesCount = shapesCou;
+
+	// streamからの読み込みと、頂点数の変化や移動/回転の補正 (SDKを呼ぶため、メインスレッドで順に行う).
+	// 計算量の多い形状から処理することで、スレッドごとの処理量の偏りを小さくする.
+	std::vector< std::pair<long long, int> > evalOrder;
+	evalOrder.reserve(shapesCou);
+	for (int i = 0; i < shapesCou; ++i) {
+		try {
+			if (!ctrls[i].prepareUpdateMesh(checkVerticesModify)) continue;
+		} catch (...) {
+			continue;
+		}
+		const long long cost = m_calcEvalCost(ctrls[i]);
+		evalOrder.push_back(std::make_pair(-cost, i));
+		evalStats.verticesCount += (long long)ctrls[i].getOrgVerticesCount();
+	}
+	std::sort(evalOrder.begin(), evalOrder.end());
+	const int evalCou = (int)evalOrder.size();
+	evalStats.evaluatedCount = evalCou;
+	evalStats.threadsCount   = std::max(1, std::min(ParallelUtil::getThreadsCount(), evalCou));
+
+	// 形状ごとの変形の計算 (形状ごとに独立しているため、並列に行う).
+	std::vector< std::vector<sxsdk::vec3> > verticesList(shapesCou);
+	std::vector< std::vector<char> > useVerticesList(shapesCou);
+	std::vector<char> calculated(shapesCou, 0);
+	ParallelUtil::parallelFor(evalCou, [&](int index) {
+		const int i = evalOrder[index].second;
+		if (ctrls[i].calcMeshVertices(verticesList[i], useVerticesList[i])) calculated[i] = 1;
+	});
+
+	// メッシュへの書き込み (SDKを呼ぶため、メインスレッドで元の順に行う).
+	for (int i = 0; i < shapesCou; ++i) {
+		if (!calculated[i]) continue;
+		if (ctrls[i].writeMeshVertices(verticesList[i], useVerticesList[i])) evalStats.updatedCount++;
+
+		// 書き込んだ形状の頂点座標は不要となるため、先に解放する.
+		std::vector<sxsdk::vec3>().swap(verticesList[i]);
+		std::vector<char>().swap(useVerticesList[i]);
+	}
+
+	traceScope.setEndArg("updated", (long long)evalStats.updatedCount);
+	if (stats) *stats = evalStats;
+	return evalStats.updatedCount;
+}
+
+/**
+ * シーン内のMorph Targets情報を持つすべての形状のメッシュを、現在のウエイト値で更新.
+ * @return 頂点座標が変更された形状数.
+ */
+int MorphTargetsSceneEval::updateSceneMeshes (sxsdk::scene_interface* scene, const bool checkVerticesModify, CMorphTargetsSceneEvalStats* stats)
+{
+	if (stats) stats->clear();
+	if (!scene) return 0;
+
+	std::vector<CMorphTargetsCtrl> ctrls;
+	try {
+		// Morph Targets情報を持つ形状を一覧から取得 (削除された形状は一覧から除外する).
+		std::vector<sxsdk::shape_class *> shapeList;
+		MorphTargetsRegistry::getRegistry().resolveShapes(scene, shapeList);
+
+		// 名前とウエイト値のみを読み込み、頂点はupdateMeshesの前処理で読み込む.
+		ctrls.resize(shapeList.size());
+		for (size_t i = 0; i < shapeList.size(); ++i) {
+			StreamCtrl::readMorphTargetsData(*shapeList[i], ctrls[i]);
+		}
+	} catch (...) { }
+
+	return updateMeshes(ctrls, checkVerticesModify, stats);
+}
@@ -0,0 +1,57 @@
+﻿/**
+ * シーン内のMorph Targets情報を持つ形状のメッシュを、まとめて更新.
+ * streamからの読み込みとメッシュへの書き込みはメインスレッドで順に行い、.
+ * 形状ごとの変形の計算を複数スレッドで並列に行う.
+ */
+#ifndef _MORPHTARGETSSCENEEVAL_H
+#define _MORPHTARGETSSCENEEVAL_H
+
+#include "GlobalHeader.h"
+#include "MorphTargetsCtrl.h"
+
+#include <vector>
+
+/**
+ * まとめて更新した結果の統計情報.
+ */
+class CMorphTargetsSceneEvalStats
+{
+public:
+	int shapesCount;					// 対象の形状数.
+	int evaluatedCount;					// 変形を計算した形状数.
+	int updatedCount;					// 頂点座標が変更された形状数.
+	long long verticesCount;			// 変形を計算した頂点数の合計.
+	int threadsCount;					// 変形の計算に使用したスレッド数.
+
+public:
+	CMorphTargetsSceneEvalStats ();
+
+	void clear ();
+};
+
+namespace MorphTargetsSceneEval
+{
+	/**
+	 * 指定のMorph Targets情報のメッシュをまとめて更新.
+	 * 1. 形状ごとにprepareUpdateMeshを呼ぶ (メインスレッドで順に).
+	 * 2. 形状ごとにcalcMeshVerticesを呼ぶ (計算量の多い形状から順に、複数スレッドで).
+	 * 3. 形状ごとにwriteMeshVerticesを呼ぶ (メインスレッドで、ctrlsの順に).
+	 * 形状ごとの計算は独立しているため、結果はスレッド数によらず同じとなる.
+	 * @param[in] ctrls                Morph Targets情報 (形状ごと).
+	 * @param[in] checkVerticesModify  頂点の移動や回転を補正.
+	 * @param[out] stats               統計情報 (NULLの場合は返さない).
+	 * @return 頂点座標が変更された形状数.
+	 */
+	int updateMeshes (std::vector<CMorphTargetsCtrl>& ctrls, const bool checkVerticesModify = true, CMorphTargetsSceneEvalStats* stats = NULL);
+
+	/**
+	 * シーン内のMorph Targets情報を持つすべての形状のメッシュを、現在のウエイト値で更新.
+	 * 形状はシーン全体を走査せず、MorphTargetsRegistryの一覧から取得する.
+	 * @param[in] checkVerticesModify  頂点の移動や回転を補正.
+	 * @param[out] stats               統計情報 (NULLの場合は返さない).
+	 * @return 頂点座標が変更された形状数.
+	 */
+	int updateSceneMeshes (sxsdk::scene_interface* scene, const bool checkVerticesModify = true, CMorphTargetsSceneEvalStats* stats = NULL);
+}
+
+#endif
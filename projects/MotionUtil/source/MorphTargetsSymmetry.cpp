@@ -0,0 +1,308 @@
+﻿/**
+ * Morph Targetsの左右対称の処理.
+ * ベース頂点の左右の対応(対称マップ)を計算し、Targetの反転/左右分割を行う.
+ */
+#include "MorphTargetsSymmetry.h"
+#include "MorphTargetsCtrl.h"
+#include "BSPPoint.h"
+#include "MathUtil.h"
+#include "ParallelUtil.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace {
+	/**
+	 * 座標値を対称面で反転.
+	 */
+	inline sxsdk::vec3 mirrorPosition (const sxsdk::vec3& v, const int axis, const float center) {
+		sxsdk::vec3 v2 = v;
+		if (axis == 0) v2.x = center * 2.0f - v.x;
+		else if (axis == 1) v2.y = center * 2.0f - v.y;
+		else v2.z = center * 2.0f - v.z;
+		return v2;
+	}
+
+	/**
+	 * 移動量/法線を対称面で反転.
+	 */
+	inline sxsdk::vec3 mirrorDirection (const sxsdk::vec3& v, const int axis) {
+		sxsdk::vec3 v2 = v;
+		if (axis == 0) v2.x = -v.x;
+		else if (axis == 1) v2.y = -v.y;
+		else v2.z = -v.z;
+		return v2;
+	}
+
+	/**
+	 * 軸方向の座標値を取得.
+	 */
+	inline float getAxisValue (const sxsdk::vec3& v, const int axis) {
+		return (axis == 0) ? v.x : ((axis == 1) ? v.y : v.z);
+	}
+}
+
+//-------------------------------------------------.
+CMorphTargetsSymmetryMap::CMorphTargetsSymmetryMap ()
+{
+	clear();
+}
+
+void CMorphTargetsSymmetryMap::clear ()
+{
+	axis      = 0;
+	center    = 0.0f;
+	tolerance = 0.0f;
+	baseHash  = 0;
+	mirrorIndices.clear();
+}
+
+/**
+ * 対称マップが指定のベース頂点に対して有効か.
+ */
+bool CMorphTargetsSymmetryMap::isValid (const std::vector<sxsdk::vec3>& orgVertices) const
+{
+	if (mirrorIndices.empty() || mirrorIndices.size() != orgVertices.size()) return false;
+	return (baseHash == MorphTargetsSymmetry::calcVerticesHash(orgVertices));
+}
+
+/**
+ * 指定の対称面の情報で計算されたものか.
+ */
+bool CMorphTargetsSymmetryMap::isSameSetting (const int axis, const float center, const float tolerance) const
+{
+	return (this->axis == axis && this->center == center && this->tolerance == tolerance);
+}
+
+/**
+ * 対称位置の頂点が見つかった頂点数を取得.
+ */
+int CMorphTargetsSymmetryMap::getMatchedCount () const
+{
+	int cou = 0;
+	for (size_t i = 0; i < mirrorIndices.size(); ++i) {
+		if (mirrorIndices[i] >= 0) cou++;
+	}
+	return cou;
+}
+
+/**
+ * 頂点座標が対称面のどちら側にあるかを取得.
+ * @return +側の場合は1、-側の場合は-1、対称面上の場合は0.
+ */
+int CMorphTargetsSymmetryMap::getSide (const sxsdk::vec3& v) const
+{
+	const float d = getAxisValue(v, axis) - center;
+	if (d > tolerance) return 1;
+	if (d < -tolerance) return -1;
+	return 0;
+}
+
+//-------------------------------------------------.
+/**
+ * 頂点座標のハッシュ値を計算 (ベースの変更の検出用).
+ * FNV-1aで、座標値のビット列から計算する.
+ */
+unsigned int MorphTargetsSymmetry::calcVerticesHash (const std::vector<sxsdk::vec3>& vertices)
+{
+	unsigned int hash = 2166136261U;
+	const size_t vCou = vertices.size();
+	for (size_t i = 0; i < vCou; ++i) {
+		const float fv[3] = { vertices[i].x, vertices[i].y, vertices[i].z };
+		unsigned int iv[3];
+		memcpy(iv, fv, sizeof(float) * 3);
+		for (int j = 0; j < 3; ++j) {
+			hash = (hash ^ iv[j]) * 16777619U;
+		}
+	}
+	return hash;
+}
+
+/**
+ * ベース頂点のバウンディングボックスの大きさから、許容誤差の既定値を計算.
+ */
+float MorphTargetsSymmetry::calcDefaultTolerance (const std::vector<sxsdk::vec3>& orgVertices)
+{
+	if (orgVertices.empty()) return 1e-3f;
+
+	sxsdk::vec3 bbMin, bbMax;
+	MathUtil::calcBoundingBox(orgVertices, bbMin, bbMax);
+	const float len = sxsdk::absolute(bbMax - bbMin);
+	return std::max(1e-3f, len * 1e-4f);
+}
+
+/**
+ * 対称マップを計算.
+ * 空間分割(CBSPPoint)を使用し、各頂点の対称位置に近接する頂点を探す.
+ */
+bool MorphTargetsSymmetry::calcSymmetryMap (const std::vector<sxsdk::vec3>& orgVertices, const int axis, const float center, const float tolerance, CMorphTargetsSymmetryMap& symmetryMap)
+{
+	symmetryMap.clear();
+	if (orgVertices.empty() || axis < 0 || axis > 2) return false;
+
+	try {
+		const int vCou = (int)orgVertices.size();
+		symmetryMap.axis      = axis;
+		symmetryMap.center    = center;
+		symmetryMap.tolerance = std::max(0.0f, tolerance);
+		symmetryMap.baseHash  = calcVerticesHash(orgVertices);
+		symmetryMap.mirrorIndices.resize(vCou, -1);
+
+		// 空間分割クラスに頂点を渡して空間分割を実行.
+		CBSPPoint bspPoint(orgVertices);
+		bspPoint.build();
+
+		// 頂点を一定数ずつのブロックに分けて、並列に対称位置の頂点を検索.
+		// 構築後のCBSPPointの検索は読み込みのみのため、複数スレッドから呼び出せる.
+		const int blockSize = 1024;
+		const int blocksCou = (vCou + blockSize - 1) / blockSize;
+		const float distance = symmetryMap.tolerance;
+		std::vector<int>& mirrorIndices = symmetryMap.mirrorIndices;
+
+		const bool ret = ParallelUtil::parallelFor(blocksCou, [&](int blockIndex) {
+			std::vector<int> indices;
+			const int iStart = blockIndex * blockSize;
+			const int iEnd   = std::min(vCou, iStart + blockSize);
+			for (int i = iStart; i < iEnd; ++i) {
+				const sxsdk::vec3 mirrorV = mirrorPosition(orgVertices[i], axis, center);
+				const int cou = bspPoint.searchVertices(mirrorV, distance, indices);
+
+				// 最も近い頂点を採用.
+				int minIndex = -1;
+				float minDist2 = 0.0f;
+				for (int j = 0; j < cou; ++j) {
+					const sxsdk::vec3 dd = orgVertices[ indices[j] ] - mirrorV;
+					const float dist2 = dd.x * dd.x + dd.y * dd.y + dd.z * dd.z;
+					if (minIndex < 0 || dist2 < minDist2) {
+						minIndex = indices[j];
+						minDist2 = dist2;
+					}
+				}
+				mirrorIndices[i] = minIndex;
+			}
+		});
+		if (!ret) throw "search failed";
+
+		return true;
+
+	} catch (...) { }
+
+	symmetryMap.clear();
+	return false;
+}
+
+/**
+ * 対称面で反転したTargetを作成.
+ * 元のTargetの各頂点の移動量を反転し、対称位置の頂点に割り当てる.
+ */
+bool MorphTargetsSymmetry::createMirrorTarget (const std::vector<sxsdk::vec3>& orgVertices, const CMorphTargetsSymmetryMap& symmetryMap, const CMorphTargetsData& srcTarget, CMorphTargetsData& dstTarget)
+{
+	dstTarget.clear();
+	dstTarget.name = srcTarget.name + "_mirror";
+
+	const int vCou = (int)srcTarget.vIndices.size();
+	const int orgVersCou = (int)orgVertices.size();
+	const bool hasNormals = (srcTarget.normals.size() == srcTarget.vertices.size());
+	if (vCou == 0 || (int)symmetryMap.mirrorIndices.size() != orgVersCou) return false;
+
+	// (対称位置の頂点インデックス, 元の要素番号)を頂点インデックス順に並べ、重複を除く.
+	std::vector< std::pair<int, int> > mirrorList;
+	mirrorList.reserve(vCou);
+	for (int i = 0; i < vCou; ++i) {
+		const int vIndex = srcTarget.vIndices[i];
+		if (vIndex < 0 || vIndex >= orgVersCou) continue;
+		const int mIndex = symmetryMap.mirrorIndices[vIndex];
+		if (mIndex < 0) continue;
+		mirrorList.push_back(std::pair<int, int>(mIndex, i));
+	}
+	std::stable_sort(mirrorList.begin(), mirrorList.end());
+
+	const int mCou = (int)mirrorList.size();
+	dstTarget.vIndices.reserve(mCou);
+	dstTarget.vertices.reserve(mCou);
+	if (hasNormals) dstTarget.normals.reserve(mCou);
+	for (int i = 0; i < mCou; ++i) {
+		if (i > 0 && mirrorList[i].first == mirrorList[i - 1].first) continue;
+		const int mIndex = mirrorList[i].first;
+		const int sIndex = mirrorList[i].second;
+		const sxsdk::vec3 dv = srcTarget.vertices[sIndex] - orgVertices[ srcTarget.vIndices[sIndex] ];
+
+		dstTarget.vIndices.push_back(mIndex);
+		dstTarget.vertices.push_back(orgVertices[mIndex] + mirrorDirection(dv, symmetryMap.axis));
+		if (hasNormals) dstTarget.normals.push_back(mirrorDirection(srcTarget.normals[sIndex], symmetryMap.axis));
+	}
+
+	return !dstTarget.vIndices.empty();
+}
+
+/**
+ * Targetを対称面の+側(_L)/-側(_R)に分割.
+ * 対称面上の頂点は、それぞれに移動量の半分を割り当てる (2つのTargetの合計が元のTargetと一致する).
+ */
+void MorphTargetsSymmetry::createSplitTargets (const std::vector<sxsdk::vec3>& orgVertices, const CMorphTargetsSymmetryMap& symmetryMap, const CMorphTargetsData& srcTarget, std::vector<CMorphTargetsData>& dstTargets)
+{
+	dstTargets.clear();
+
+	const int vCou = (int)srcTarget.vIndices.size();
+	const int orgVersCou = (int)orgVertices.size();
+	const bool hasNormals = (srcTarget.normals.size() == srcTarget.vertices.size());
+	if (vCou == 0) return;
+
+	CMorphTargetsData targets[2];
+	targets[0].name = srcTarget.name + "_L";
+	targets[1].name = srcTarget.name + "_R";
+	for (int i = 0; i < vCou; ++i) {
+		const int vIndex = srcTarget.vIndices[i];
+		if (vIndex < 0 || vIndex >= orgVersCou) continue;
+		const sxsdk::vec3& orgV = orgVertices[vIndex];
+		const int side = symmetryMap.getSide(orgV);
+
+		for (int j = 0; j < 2; ++j) {
+			if ((j == 0 && side < 0) || (j == 1 && side > 0)) continue;
+			CMorphTargetsData& dstTarget = targets[j];
+			dstTarget.vIndices.push_back(vIndex);
+			if (side == 0) {
+				dstTarget.vertices.push_back(orgV + (srcTarget.vertices[i] - orgV) * 0.5f);
+			} else {
+				dstTarget.vertices.push_back(srcTarget.vertices[i]);
+			}
+			if (hasNormals) dstTarget.normals.push_back(srcTarget.normals[i]);
+		}
+	}
+
+	for (int j = 0; j < 2; ++j) {
+		if (!targets[j].vIndices.empty()) dstTargets.push_back(targets[j]);
+	}
+}
+
+/**
+ * 複数のTargetについて、反転/左右分割したTargetを作成.
+ * Targetごとに並列に処理する.
+ */
+bool MorphTargetsSymmetry::createMirrorTargets (const std::vector<sxsdk::vec3>& orgVertices, const CMorphTargetsSymmetryMap& symmetryMap, const std::vector<CMorphTargetsData>& srcTargets, const MORPH_TARGETS_MIRROR_TYPE type, std::vector<CMorphTargetsData>& dstTargets)
+{
+	dstTargets.clear();
+
+	const int tCou = (int)srcTargets.size();
+	if (tCou == 0) return true;
+
+	std::vector< std::vector<CMorphTargetsData> > targetsList(tCou);
+	const bool ret = ParallelUtil::parallelFor(tCou, [&](int tIndex) {
+		std::vector<CMorphTargetsData>& targets = targetsList[tIndex];
+		if (type == morph_mirror_flip) {
+			targets.resize(1);
+			if (!createMirrorTarget(orgVertices, symmetryMap, srcTargets[tIndex], targets[0])) targets.clear();
+		} else {
+			createSplitTargets(orgVertices, symmetryMap, srcTargets[tIndex], targets);
+		}
+
+		// 作成したTargetは、ウエイト値0で追加する.
+		for (size_t i = 0; i < targets.size(); ++i) targets[i].weight = 0.0f;
+	});
+	if (!ret) return false;
+
+	for (int i = 0; i < tCou; ++i) {
+		dstTargets.insert(dstTargets.end(), targetsList[i].begin(), targetsList[i].end());
+	}
+	return true;
+}
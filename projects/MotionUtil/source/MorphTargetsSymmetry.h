@@ -0,0 +1,119 @@
+﻿/**
+ * Morph Targetsの左右対称の処理.
+ * ベース頂点の左右の対応(対称マップ)を計算し、Targetの反転/左右分割を行う.
+ */
+#ifndef _MORPHTARGETSSYMMETRY_H
+#define _MORPHTARGETSSYMMETRY_H
+
+#include "GlobalHeader.h"
+
+#include <vector>
+
+class CMorphTargetsData;
+
+/**
+ * 反転Targetの作成方法.
+ */
+enum MORPH_TARGETS_MIRROR_TYPE {
+	morph_mirror_flip = 0,					// 対称面で反転したTargetを作成.
+	morph_mirror_split,						// 対称面の+側/-側に分割したTargetを作成.
+};
+
+//-------------------------------------------------.
+/**
+ * ベース頂点の左右の対応情報 (対称マップ).
+ * ベースの頂点座標から計算され、streamに保存される。ベースが変わった場合は無効となる.
+ */
+class CMorphTargetsSymmetryMap
+{
+public:
+	int axis;								// 対称面の法線の軸 (0:X, 1:Y, 2:Z).
+	float center;							// 対称面の位置.
+	float tolerance;						// 対称位置の頂点を探す際の許容誤差.
+	unsigned int baseHash;					// 計算時のベース頂点座標のハッシュ値.
+	std::vector<int> mirrorIndices;			// 頂点ごとの対称位置の頂点インデックス (見つからない場合は-1).
+
+public:
+	CMorphTargetsSymmetryMap ();
+
+	void clear ();
+
+	/**
+	 * 対称マップが指定のベース頂点に対して有効か.
+	 */
+	bool isValid (const std::vector<sxsdk::vec3>& orgVertices) const;
+
+	/**
+	 * 指定の対称面の情報で計算されたものか.
+	 */
+	bool isSameSetting (const int axis, const float center, const float tolerance) const;
+
+	/**
+	 * 対称位置の頂点が見つかった頂点数を取得.
+	 */
+	int getMatchedCount () const;
+
+	/**
+	 * 頂点座標が対称面のどちら側にあるかを取得.
+	 * @return +側の場合は1、-側の場合は-1、対称面上の場合は0.
+	 */
+	int getSide (const sxsdk::vec3& v) const;
+};
+
+namespace MorphTargetsSymmetry
+{
+	/**
+	 * 頂点座標のハッシュ値を計算 (ベースの変更の検出用).
+	 */
+	unsigned int calcVerticesHash (const std::vector<sxsdk::vec3>& vertices);
+
+	/**
+	 * ベース頂点のバウンディングボックスの大きさから、許容誤差の既定値を計算.
+	 */
+	float calcDefaultTolerance (const std::vector<sxsdk::vec3>& orgVertices);
+
+	/**
+	 * 対称マップを計算.
+	 * 空間分割(CBSPPoint)を使用し、各頂点の対称位置に近接する頂点を探す.
+	 * @param[in]  orgVertices  ベースの頂点座標.
+	 * @param[in]  axis         対称面の法線の軸 (0:X, 1:Y, 2:Z).
+	 * @param[in]  center       対称面の位置.
+	 * @param[in]  tolerance    許容誤差.
+	 * @param[out] symmetryMap  対称マップが返る.
+	 */
+	bool calcSymmetryMap (const std::vector<sxsdk::vec3>& orgVertices, const int axis, const float center, const float tolerance, CMorphTargetsSymmetryMap& symmetryMap);
+
+	/**
+	 * 対称面で反転したTargetを作成.
+	 * @param[in]  orgVertices  ベースの頂点座標.
+	 * @param[in]  symmetryMap  対称マップ.
+	 * @param[in]  srcTarget    反転元のTarget.
+	 * @param[out] dstTarget    反転したTargetが返る.
+	 * @return 頂点を持つTargetが作成された場合はtrue.
+	 */
+	bool createMirrorTarget (const std::vector<sxsdk::vec3>& orgVertices, const CMorphTargetsSymmetryMap& symmetryMap, const CMorphTargetsData& srcTarget, CMorphTargetsData& dstTarget);
+
+	/**
+	 * Targetを対称面の+側(_L)/-側(_R)に分割.
+	 * 対称面上の頂点は、それぞれに移動量の半分を割り当てる (2つのTargetの合計が元のTargetと一致する).
+	 * @param[in]  orgVertices  ベースの頂点座標.
+	 * @param[in]  symmetryMap  対称マップ.
+	 * @param[in]  srcTarget    分割元のTarget.
+	 * @param[out] dstTargets   分割したTargetが返る (頂点を持つもののみ).
+	 */
+	void createSplitTargets (const std::vector<sxsdk::vec3>& orgVertices, const CMorphTargetsSymmetryMap& symmetryMap, const CMorphTargetsData& srcTarget, std::vector<CMorphTargetsData>& dstTargets);
+
+	/**
+	 * 複数のTargetについて、反転/左右分割したTargetを作成.
+	 * Targetごとに並列に処理する.
+	 * @param[in]  orgVertices  ベースの頂点座標.
+	 * @param[in]  symmetryMap  対称マップ.
+	 * @param[in]  srcTargets   元のTargetのリスト.
+	 * @param[in]  type         作成方法.
+	 * @param[out] dstTargets   作成されたTargetが、srcTargetsの順に返る.
+	 * @return 作成できなかった場合はfalse (dstTargetsは空となる).
+	 */
+	bool createMirrorTargets (const std::vector<sxsdk::vec3>& orgVertices, const CMorphTargetsSymmetryMap& symmetryMap, const std::vector<CMorphTargetsData>& srcTargets, const MORPH_TARGETS_MIRROR_TYPE type, std::vector<CMorphTargetsData>& dstTargets);
+}
+
+#endif
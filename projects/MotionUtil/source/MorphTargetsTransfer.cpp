@@ -0,0 +1,154 @@
+﻿/**
+ * 頂点数/トポロジの異なるポリゴンメッシュ間でのMorph Targetsの転送.
+ * 転送先のベース頂点を転送元の最も近い三角形に投影し、三角形の頂点の移動量を重心座標で補間する.
+ */
+#include "MorphTargetsTransfer.h"
+#include "BVHTriangle.h"
+#include "ParallelUtil.h"
+
+namespace {
+	/**
+	 * 転送先の頂点が投影される、転送元の三角形と重心座標.
+	 */
+	class CTransferBinding {
+	public:
+		int vIndices[3];				// 転送元の頂点インデックス (見つからない場合は-1).
+		float bary[3];					// 重心座標.
+	};
+}
+
+//-------------------------------------------------.
+CMorphTargetsTransferStats::CMorphTargetsTransferStats ()
+{
+	clear();
+}
+
+void CMorphTargetsTransferStats::clear ()
+{
+	verticesCount     = 0;
+	unmatchedCount    = 0;
+	maxDistance       = 0.0f;
+	averageDistance   = 0.0f;
+	targetsCount      = 0;
+	emptyTargetsCount = 0;
+}
+
+//-------------------------------------------------.
+/**
+ * Morph Targetsを転送.
+ * 転送先頂点ごと、Targetごとにそれぞれ並列に処理する.
+ */
+bool MorphTargetsTransfer::transferMorphTargets (const std::vector<sxsdk::vec3>& srcOrgVertices, const std::vector<int>& srcTriangles, const std::vector<CMorphTargetsData>& srcTargets,
+	const std::vector<sxsdk::vec3>& dstOrgVertices, const sxsdk::mat4& dstToSrcMatrix, const float maxDistance,
+	std::vector<CMorphTargetsData>& dstTargets, CMorphTargetsTransferStats& stats)
+{
+	dstTargets.clear();
+	stats.clear();
+
+	const int srcVersCou = (int)srcOrgVertices.size();
+	const int dstVersCou = (int)dstOrgVertices.size();
+	if (srcVersCou == 0 || dstVersCou == 0 || srcTriangles.size() < 3) return false;
+
+	try {
+		// 転送元の三角形のBVHを構築.
+		CBVHTriangle bvh(srcOrgVertices, srcTriangles);
+		bvh.build();
+		if (bvh.getTrianglesCount() == 0) return false;
+
+		// 転送先の各頂点を、転送元の最も近い三角形に投影.
+		std::vector<CTransferBinding> bindings(dstVersCou);
+		std::vector<float> distances(dstVersCou, -1.0f);
+		{
+			const int blockSize = 1024;
+			const int blocksCou = (dstVersCou + blockSize - 1) / blockSize;
+			const bool ret = ParallelUtil::parallelFor(blocksCou, [&](int blockIndex) {
+				BVH_TRIANGLE_HIT hit;
+				const int iStart = blockIndex * blockSize;
+				const int iEnd   = std::min(dstVersCou, iStart + blockSize);
+				for (int i = iStart; i < iEnd; ++i) {
+					CTransferBinding& binding = bindings[i];
+					binding.vIndices[0] = binding.vIndices[1] = binding.vIndices[2] = -1;
+					if (!bvh.searchClosestPoint(dstOrgVertices[i] * dstToSrcMatrix, maxDistance, hit)) continue;
+
+					const int* tri = bvh.getTriangle(hit.triIndex);
+					for (int j = 0; j < 3; ++j) {
+						binding.vIndices[j] = tri[j];
+						binding.bary[j]     = hit.bary[j];
+					}
+					distances[i] = hit.distance;
+				}
+			});
+			if (!ret) throw "bind failed";
+		}
+
+		// 統計情報.
+		{
+			stats.verticesCount = dstVersCou;
+			double sumDist = 0.0;
+			int matchedCou = 0;
+			for (int i = 0; i < dstVersCou; ++i) {
+				if (distances[i] < 0.0f) {
+					stats.unmatchedCount++;
+					continue;
+				}
+				stats.maxDistance = std::max(stats.maxDistance, distances[i]);
+				sumDist += (double)distances[i];
+				matchedCou++;
+			}
+			if (matchedCou > 0) stats.averageDistance = (float)(sumDist / (double)matchedCou);
+		}
+
+		// 転送元の移動量を転送先の座標系に戻すための行列.
+		const sxsdk::mat4 srcToDstMatrix = inv(dstToSrcMatrix);
+		const sxsdk::vec3 zeroV = sxsdk::vec3(0, 0, 0) * srcToDstMatrix;
+
+		// Targetごとに、転送元の移動量を補間して転送先のTargetを作成.
+		const int tCou = (int)srcTargets.size();
+		std::vector<CMorphTargetsData> targetsList(tCou);
+		const bool ret = ParallelUtil::parallelFor(tCou, [&](int tIndex) {
+			const CMorphTargetsData& srcTarget = srcTargets[tIndex];
+			CMorphTargetsData& dstTarget = targetsList[tIndex];
+			dstTarget.clear();
+			dstTarget.name = srcTarget.name;
+
+			// 転送元の頂点ごとの移動量.
+			std::vector<sxsdk::vec3> deltas(srcVersCou, sxsdk::vec3(0, 0, 0));
+			std::vector<char> moved(srcVersCou, 0);
+			const int vCou = (int)std::min(srcTarget.vIndices.size(), srcTarget.vertices.size());
+			for (int i = 0; i < vCou; ++i) {
+				const int vIndex = srcTarget.vIndices[i];
+				if (vIndex < 0 || vIndex >= srcVersCou) continue;
+				deltas[vIndex] = srcTarget.vertices[i] - srcOrgVertices[vIndex];
+				moved[vIndex]  = 1;
+			}
+
+			for (int i = 0; i < dstVersCou; ++i) {
+				const CTransferBinding& binding = bindings[i];
+				if (binding.vIndices[0] < 0) continue;
+				if (!moved[binding.vIndices[0]] && !moved[binding.vIndices[1]] && !moved[binding.vIndices[2]]) continue;
+
+				const sxsdk::vec3 dv = deltas[binding.vIndices[0]] * binding.bary[0] + deltas[binding.vIndices[1]] * binding.bary[1] + deltas[binding.vIndices[2]] * binding.bary[2];
+				dstTarget.vIndices.push_back(i);
+				dstTarget.vertices.push_back(dstOrgVertices[i] + (dv * srcToDstMatrix - zeroV));
+			}
+		});
+		if (!ret) throw "transfer failed";
+
+		// 転送されたTargetは、ウエイト値0で追加する.
+		for (int i = 0; i < tCou; ++i) {
+			if (targetsList[i].vIndices.empty()) {
+				stats.emptyTargetsCount++;
+				continue;
+			}
+			targetsList[i].weight = 0.0f;
+			dstTargets.push_back(targetsList[i]);
+		}
+		stats.targetsCount = (int)dstTargets.size();
+
+		return true;
+
+	} catch (...) { }
+
+	dstTargets.clear();
+	return false;
+}
@@ -0,0 +1,51 @@
+﻿/**
+ * 頂点数/トポロジの異なるポリゴンメッシュ間でのMorph Targetsの転送.
+ * 転送先のベース頂点を転送元の最も近い三角形に投影し、三角形の頂点の移動量を重心座標で補間する.
+ */
+#ifndef _MORPHTARGETSTRANSFER_H
+#define _MORPHTARGETSTRANSFER_H
+
+#include "GlobalHeader.h"
+#include "MorphTargetsCtrl.h"
+
+#include <vector>
+
+/**
+ * 転送結果の統計情報.
+ */
+class CMorphTargetsTransferStats
+{
+public:
+	int verticesCount;					// 転送先の頂点数.
+	int unmatchedCount;					// 最大距離内に転送元の三角形が見つからなかった頂点数.
+	float maxDistance;					// 転送先の頂点と、転送元の投影位置の最大距離.
+	float averageDistance;				// 転送先の頂点と、転送元の投影位置の平均距離.
+	int targetsCount;					// 転送されたTarget数.
+	int emptyTargetsCount;				// 移動する頂点がなく、転送されなかったTarget数.
+
+public:
+	CMorphTargetsTransferStats ();
+
+	void clear ();
+};
+
+namespace MorphTargetsTransfer
+{
+	/**
+	 * Morph Targetsを転送.
+	 * 転送先頂点ごと、Targetごとにそれぞれ並列に処理する.
+	 * @param[in]  srcOrgVertices  転送元のベースの頂点座標.
+	 * @param[in]  srcTriangles    転送元の三角形ごとの頂点インデックス.
+	 * @param[in]  srcTargets      転送元のTarget.
+	 * @param[in]  dstOrgVertices  転送先のベースの頂点座標.
+	 * @param[in]  dstToSrcMatrix  転送先の座標を転送元の座標に変換する行列.
+	 * @param[in]  maxDistance     転送先の頂点から転送元の三角形を探す最大距離 (0以下の場合は制限なし).
+	 * @param[out] dstTargets      転送されたTarget (頂点を持つもののみ).
+	 * @param[out] stats           統計情報.
+	 */
+	bool transferMorphTargets (const std::vector<sxsdk::vec3>& srcOrgVertices, const std::vector<int>& srcTriangles, const std::vector<CMorphTargetsData>& srcTargets,
+		const std::vector<sxsdk::vec3>& dstOrgVertices, const sxsdk::mat4& dstToSrcMatrix, const float maxDistance,
+		std::vector<CMorphTargetsData>& dstTargets, CMorphTargetsTransferStats& stats);
+}
+
+#endif
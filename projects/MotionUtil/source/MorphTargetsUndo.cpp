@@ -0,0 +1,483 @@
+﻿/**
+ * Morph Targetsの編集操作のUNDO/REDO.
+ * 形状全体のスナップショットではなく、変更された要素のみを差分として保持する.
+ */
+#include "MorphTargetsUndo.h"
+
+namespace {
+	CMorphTargetsUndoJournal g_undoJournal;			// プラグイン全体で共有する履歴.
+
+	/**
+	 * Targetが保持するメモリ量.
+	 */
+	size_t calcTargetMemorySize (const CMorphTargetsData& targetD) {
+		return targetD.name.capacity() + targetD.vIndices.capacity() * sizeof(int) + (targetD.vertices.capacity() + targetD.normals.capacity()) * sizeof(sxsdk::vec3);
+	}
+}
+
+/**
+ * プラグイン全体で共有するUNDO/REDOの履歴を取得.
+ */
+CMorphTargetsUndoJournal& MorphTargetsUndo::getJournal ()
+{
+	return g_undoJournal;
+}
+
+//-------------------------------------------------.
+CMorphTargetsUndoEntry::CMorphTargetsUndoEntry ()
+{
+	clear();
+}
+
+void CMorphTargetsUndoEntry::clear ()
+{
+	type        = morph_undo_none;
+	shapeHandle = NULL;
+	tIndex      = -1;
+	sealed      = false;
+	oldName = newName = "";
+	weights.clear();
+	ranges.clear();
+	oldTarget.clear();
+	newTarget.clear();
+	oldOrgVertices.clear();
+	newOrgVertices.clear();
+	oldTargets.clear();
+	newTargets.clear();
+}
+
+/**
+ * 保持しているメモリ量(バイト数)を計算.
+ */
+size_t CMorphTargetsUndoEntry::calcMemorySize () const
+{
+	size_t size = sizeof(CMorphTargetsUndoEntry);
+	size += oldName.capacity() + newName.capacity();
+	size += weights.capacity() * sizeof(CMorphTargetsUndoWeight);
+	for (size_t i = 0; i < ranges.size(); ++i) {
+		size += sizeof(CMorphTargetsUndoRange) + (ranges[i].oldValues.capacity() + ranges[i].newValues.capacity()) * sizeof(sxsdk::vec3);
+	}
+	size += calcTargetMemorySize(oldTarget) + calcTargetMemorySize(newTarget);
+	size += (oldOrgVertices.capacity() + newOrgVertices.capacity()) * sizeof(sxsdk::vec3);
+	for (size_t i = 0; i < oldTargets.size(); ++i) size += sizeof(CMorphTargetsData) + calcTargetMemorySize(oldTargets[i]);
+	for (size_t i = 0; i < newTargets.size(); ++i) size += sizeof(CMorphTargetsData) + calcTargetMemorySize(newTargets[i]);
+	return size;
+}
+
+//-------------------------------------------------.
+CMorphTargetsUndoJournal::CMorphTargetsUndoJournal ()
+{
+	m_maxMemorySize = 64 * 1024 * 1024;
+	m_memorySize    = 0;
+}
+
+void CMorphTargetsUndoJournal::clear ()
+{
+	m_undoList.clear();
+	m_redoList.clear();
+	m_memorySize = 0;
+}
+
+/**
+ * 保持するメモリの上限を指定.
+ */
+void CMorphTargetsUndoJournal::setMaxMemorySize (const size_t size)
+{
+	m_maxMemorySize = size;
+	m_evict();
+}
+
+/**
+ * 指定の形状の履歴を削除 (Morph Targets情報自体を削除した場合など).
+ */
+void CMorphTargetsUndoJournal::removeShape (void* shapeHandle)
+{
+	for (int loop = 0; loop < 2; ++loop) {
+		std::deque<CMorphTargetsUndoEntry>& list = (loop == 0) ? m_undoList : m_redoList;
+		for (int i = (int)list.size() - 1; i >= 0; --i) {
+			if (list[i].shapeHandle == shapeHandle) {
+				m_memorySize -= list[i].calcMemorySize();
+				list.erase(list.begin() + i);
+			}
+		}
+	}
+}
+
+/**
+ * 差分を履歴に追加し、REDOの履歴をクリア.
+ */
+void CMorphTargetsUndoJournal::m_push (const CMorphTargetsUndoEntry& entry)
+{
+	for (size_t i = 0; i < m_redoList.size(); ++i) m_memorySize -= m_redoList[i].calcMemorySize();
+	m_redoList.clear();
+
+	// 直前のウエイト値の変更は、以降結合しない.
+	if (!m_undoList.empty()) m_undoList.back().sealed = true;
+
+	m_undoList.push_back(entry);
+	m_memorySize += m_undoList.back().calcMemorySize();
+
+	m_evict();
+}
+
+/**
+ * メモリ上限を超えた分を古いものから破棄.
+ */
+void CMorphTargetsUndoJournal::m_evict ()
+{
+	while (m_memorySize > m_maxMemorySize && !m_undoList.empty()) {
+		m_memorySize -= m_undoList.front().calcMemorySize();
+		m_undoList.pop_front();
+	}
+	if (m_memorySize > m_maxMemorySize) {
+		m_redoList.clear();
+		m_memorySize = 0;
+	}
+}
+
+/**
+ * 頂点配列の差分を連続範囲として格納.
+ */
+void CMorphTargetsUndoJournal::m_calcRanges (const std::vector<sxsdk::vec3>& oldValues, const std::vector<sxsdk::vec3>& newValues, std::vector<CMorphTargetsUndoRange>& ranges)
+{
+	ranges.clear();
+	const int vCou = (int)std::min(oldValues.size(), newValues.size());
+	int i = 0;
+	while (i < vCou) {
+		if (oldValues[i] == newValues[i]) {
+			i++;
+			continue;
+		}
+		int j = i + 1;
+		while (j < vCou && !(oldValues[j] == newValues[j])) j++;
+
+		ranges.push_back(CMorphTargetsUndoRange());
+		CMorphTargetsUndoRange& range = ranges.back();
+		range.startIndex = i;
+		range.oldValues.assign(oldValues.begin() + i, oldValues.begin() + j);
+		range.newValues.assign(newValues.begin() + i, newValues.begin() + j);
+		i = j;
+	}
+}
+
+//---------------------------------------------------------------.
+// 操作の記録.
+//---------------------------------------------------------------.
+/**
+ * Targetの追加を記録 (追加後に呼ぶ).
+ */
+void CMorphTargetsUndoJournal::recordAppendTarget (void* shapeHandle, const int tIndex, const CMorphTargetsData& newTarget)
+{
+	CMorphTargetsUndoEntry entry;
+	entry.type        = morph_undo_append_target;
+	entry.shapeHandle = shapeHandle;
+	entry.tIndex      = tIndex;
+	entry.newTarget   = newTarget;
+	m_push(entry);
+}
+
+/**
+ * Targetの更新を記録.
+ * 頂点インデックスが同じ場合は、位置が変化した範囲のみを保持する.
+ */
+void CMorphTargetsUndoJournal::recordUpdateTarget (void* shapeHandle, const int tIndex, const CMorphTargetsData& oldTarget, const CMorphTargetsData& newTarget)
+{
+	CMorphTargetsUndoEntry entry;
+	entry.type        = morph_undo_update_target;
+	entry.shapeHandle = shapeHandle;
+	entry.tIndex      = tIndex;
+	entry.oldTarget.weight = oldTarget.weight;
+	entry.newTarget.weight = newTarget.weight;
+
+	if (oldTarget.vIndices == newTarget.vIndices && oldTarget.normals.empty() && newTarget.normals.empty()) {
+		m_calcRanges(oldTarget.vertices, newTarget.vertices, entry.ranges);
+	} else {
+		entry.oldTarget = oldTarget;
+		entry.newTarget = newTarget;
+	}
+	m_push(entry);
+}
+
+/**
+ * Targetの削除を記録.
+ */
+void CMorphTargetsUndoJournal::recordRemoveTarget (void* shapeHandle, const int tIndex, const CMorphTargetsData& oldTarget)
+{
+	CMorphTargetsUndoEntry entry;
+	entry.type        = morph_undo_remove_target;
+	entry.shapeHandle = shapeHandle;
+	entry.tIndex      = tIndex;
+	entry.oldTarget   = oldTarget;
+	m_push(entry);
+}
+
+/**
+ * Target名の変更を記録.
+ */
+void CMorphTargetsUndoJournal::recordRenameTarget (void* shapeHandle, const int tIndex, const std::string& oldName, const std::string& newName)
+{
+	if (oldName == newName) return;
+
+	CMorphTargetsUndoEntry entry;
+	entry.type        = morph_undo_rename_target;
+	entry.shapeHandle = shapeHandle;
+	entry.tIndex      = tIndex;
+	entry.oldName     = oldName;
+	entry.newName     = newName;
+	m_push(entry);
+}
+
+/**
+ * 1つのTargetのウエイト値の変更を記録.
+ * @param[in] dragged   スライダのドラッグ中の場合はtrue。直前の同じTargetの変更と結合する.
+ */
+void CMorphTargetsUndoJournal::recordWeight (void* shapeHandle, const int tIndex, const float oldWeight, const float newWeight, const bool dragged)
+{
+	if (oldWeight == newWeight) return;
+
+	// ドラッグ中は、直前の同じTargetのウエイト値の変更に結合する.
+	if (dragged && !m_undoList.empty()) {
+		CMorphTargetsUndoEntry& lastEntry = m_undoList.back();
+		if (lastEntry.type == morph_undo_weights && !lastEntry.sealed && lastEntry.shapeHandle == shapeHandle) {
+			if (lastEntry.weights.size() == 1 && lastEntry.weights[0].tIndex == tIndex) {
+				m_memorySize -= lastEntry.calcMemorySize();
+				lastEntry.weights[0].newWeight = newWeight;
+				m_memorySize += lastEntry.calcMemorySize();
+				for (size_t i = 0; i < m_redoList.size(); ++i) m_memorySize -= m_redoList[i].calcMemorySize();
+				m_redoList.clear();
+				return;
+			}
+		}
+	}
+
+	CMorphTargetsUndoEntry entry;
+	entry.type        = morph_undo_weights;
+	entry.shapeHandle = shapeHandle;
+	entry.tIndex      = tIndex;
+	entry.weights.resize(1);
+	entry.weights[0].tIndex    = tIndex;
+	entry.weights[0].oldWeight = oldWeight;
+	entry.weights[0].newWeight = newWeight;
+	m_push(entry);
+}
+
+/**
+ * 複数のTargetのウエイト値の変更を記録 (変化したものだけ格納).
+ */
+void CMorphTargetsUndoJournal::recordWeights (void* shapeHandle, const std::vector<float>& oldWeights, const std::vector<float>& newWeights)
+{
+	CMorphTargetsUndoEntry entry;
+	entry.type        = morph_undo_weights;
+	entry.shapeHandle = shapeHandle;
+
+	const size_t tCou = std::min(oldWeights.size(), newWeights.size());
+	for (size_t i = 0; i < tCou; ++i) {
+		if (oldWeights[i] == newWeights[i]) continue;
+		CMorphTargetsUndoWeight w;
+		w.tIndex    = (int)i;
+		w.oldWeight = oldWeights[i];
+		w.newWeight = newWeights[i];
+		entry.weights.push_back(w);
+	}
+	if (entry.weights.empty()) return;
+
+	entry.sealed = true;
+	m_push(entry);
+}
+
+/**
+ * ウエイト値の変更の結合を打ち切る.
+ */
+void CMorphTargetsUndoJournal::sealWeightChange ()
+{
+	if (!m_undoList.empty()) m_undoList.back().sealed = true;
+}
+
+/**
+ * ベースの頂点座標の更新を記録.
+ */
+void CMorphTargetsUndoJournal::recordUpdateBase (void* shapeHandle, const std::vector<sxsdk::vec3>& oldOrgVertices, const std::vector<sxsdk::vec3>& newOrgVertices)
+{
+	CMorphTargetsUndoEntry entry;
+	entry.type        = morph_undo_update_base;
+	entry.shapeHandle = shapeHandle;
+
+	if (oldOrgVertices.size() == newOrgVertices.size()) {
+		m_calcRanges(oldOrgVertices, newOrgVertices, entry.ranges);
+		if (entry.ranges.empty()) return;
+	} else {
+		entry.oldOrgVertices = oldOrgVertices;
+		entry.newOrgVertices = newOrgVertices;
+	}
+	m_push(entry);
+}
+
+/**
+ * 重複頂点のマージを記録.
+ * 頂点数とすべてのTargetの頂点インデックスが変わるため、この操作のみ全体を保持する.
+ */
+void CMorphTargetsUndoJournal::recordCleanup (void* shapeHandle, const CMorphTargetsCtrl& oldData, const CMorphTargetsCtrl& newData)
+{
+	CMorphTargetsUndoEntry entry;
+	entry.type           = morph_undo_cleanup;
+	entry.shapeHandle    = shapeHandle;
+	entry.oldOrgVertices = oldData.getOrgVertices();
+	entry.newOrgVertices = newData.getOrgVertices();
+	entry.oldTargets     = oldData.getMorphTargetsData();
+	entry.newTargets     = newData.getMorphTargetsData();
+	m_push(entry);
+}
+
+/**
+ * 頂点の追加/削除後の対応付け直しを記録.
+ * 重複頂点のマージと同様に、頂点数とすべてのTargetの頂点インデックスが変わるため全体を保持する.
+ */
+void CMorphTargetsUndoJournal::recordRemap (void* shapeHandle, const CMorphTargetsCtrl& oldData, const CMorphTargetsCtrl& newData)
+{
+	CMorphTargetsUndoEntry entry;
+	entry.type           = morph_undo_remap;
+	entry.shapeHandle    = shapeHandle;
+	entry.oldOrgVertices = oldData.getOrgVertices();
+	entry.newOrgVertices = newData.getOrgVertices();
+	entry.oldTargets     = oldData.getMorphTargetsData();
+	entry.newTargets     = newData.getMorphTargetsData();
+	m_push(entry);
+}
+
+//---------------------------------------------------------------.
+// UNDO/REDO.
+//---------------------------------------------------------------.
+/**
+ * 次にUNDO/REDOされる形状のハンドルを取得.
+ */
+void* CMorphTargetsUndoJournal::getUndoShapeHandle () const
+{
+	if (m_undoList.empty()) return NULL;
+	return m_undoList.back().shapeHandle;
+}
+void* CMorphTargetsUndoJournal::getRedoShapeHandle () const
+{
+	if (m_redoList.empty()) return NULL;
+	return m_redoList.back().shapeHandle;
+}
+
+/**
+ * 差分を適用.
+ * @param[in] entry    差分.
+ * @param[in] undo     UNDOの場合はtrue、REDOの場合はfalse.
+ */
+void CMorphTargetsUndoJournal::m_apply (sxsdk::scene_interface* scene, const CMorphTargetsUndoEntry& entry, const bool undo, CMorphTargetsCtrl& data)
+{
+	const int tIndex = entry.tIndex;
+
+	switch (entry.type) {
+	case morph_undo_append_target:
+	case morph_undo_remove_target:
+		{
+			// 追加のUNDOと削除のREDOは、Targetの削除になる.
+			const bool removeF = (entry.type == morph_undo_append_target) ? undo : !undo;
+			if (removeF) {
+				data.setTargetWeight(tIndex, 0.0f);
+				data.updateMesh(scene, false);
+				data.removeTarget(tIndex);
+			} else {
+				data.insertTargetData(tIndex, (entry.type == morph_undo_append_target) ? entry.newTarget : entry.oldTarget);
+			}
+		}
+		break;
+
+	case morph_undo_update_target:
+		{
+			// 一度ウエイト値0で頂点を戻してから入れ替える.
+			data.setTargetWeight(tIndex, 0.0f);
+			data.updateMesh(scene, false);
+
+			CMorphTargetsData& targetD = data.getMorphTargetData(tIndex);
+			if (entry.ranges.empty() && entry.oldTarget.vIndices.size() + entry.newTarget.vIndices.size() > 0) {
+				const CMorphTargetsData& srcD = undo ? entry.oldTarget : entry.newTarget;
+				targetD.vIndices = srcD.vIndices;
+				targetD.vertices = srcD.vertices;
+				targetD.normals  = srcD.normals;
+			} else {
+				for (size_t i = 0; i < entry.ranges.size(); ++i) {
+					const CMorphTargetsUndoRange& range = entry.ranges[i];
+					const std::vector<sxsdk::vec3>& values = undo ? range.oldValues : range.newValues;
+					std::copy(values.begin(), values.end(), targetD.vertices.begin() + range.startIndex);
+				}
+			}
+			data.setTargetWeight(tIndex, undo ? entry.oldTarget.weight : entry.newTarget.weight);
+		}
+		break;
+
+	case morph_undo_rename_target:
+		data.setTargetName(tIndex, undo ? entry.oldName : entry.newName);
+		break;
+
+	case morph_undo_weights:
+		for (size_t i = 0; i < entry.weights.size(); ++i) {
+			const CMorphTargetsUndoWeight& w = entry.weights[i];
+			data.setTargetWeight(w.tIndex, undo ? w.oldWeight : w.newWeight);
+		}
+		break;
+
+	case morph_undo_update_base:
+		if (entry.ranges.empty()) {
+			data.setOrgVertices(undo ? entry.oldOrgVertices : entry.newOrgVertices);
+		} else {
+			std::vector<sxsdk::vec3>& orgVertices = data.getOrgVertices();
+			for (size_t i = 0; i < entry.ranges.size(); ++i) {
+				const CMorphTargetsUndoRange& range = entry.ranges[i];
+				const std::vector<sxsdk::vec3>& values = undo ? range.oldValues : range.newValues;
+				std::copy(values.begin(), values.end(), orgVertices.begin() + range.startIndex);
+			}
+		}
+		break;
+
+	case morph_undo_cleanup:
+	case morph_undo_remap:
+		// ポリゴンメッシュ自体は戻さない。頂点数が異なる間はupdateMeshで変形されない.
+		data.setOrgVertices(undo ? entry.oldOrgVertices : entry.newOrgVertices);
+		data.setMorphTargetsData(undo ? entry.oldTargets : entry.newTargets);
+		break;
+
+	default:
+		break;
+	}
+}
+
+/**
+ * UNDOを実行.
+ * dataは、getUndoShapeHandle()の形状のMorph Targets情報を読み込んだものを渡すこと.
+ * @return 適用した操作の種類.
+ */
+MORPH_TARGETS_UNDO_TYPE CMorphTargetsUndoJournal::undo (sxsdk::scene_interface* scene, CMorphTargetsCtrl& data)
+{
+	if (m_undoList.empty()) return morph_undo_none;
+	if (!data.getTargetShape() || data.getTargetShape()->get_handle() != m_undoList.back().shapeHandle) return morph_undo_none;
+
+	m_redoList.push_back(m_undoList.back());
+	m_undoList.pop_back();
+
+	CMorphTargetsUndoEntry& entry = m_redoList.back();
+	entry.sealed = true;
+	m_apply(scene, entry, true, data);
+	return entry.type;
+}
+
+/**
+ * REDOを実行.
+ * @return 適用した操作の種類.
+ */
+MORPH_TARGETS_UNDO_TYPE CMorphTargetsUndoJournal::redo (sxsdk::scene_interface* scene, CMorphTargetsCtrl& data)
+{
+	if (m_redoList.empty()) return morph_undo_none;
+	if (!data.getTargetShape() || data.getTargetShape()->get_handle() != m_redoList.back().shapeHandle) return morph_undo_none;
+
+	m_undoList.push_back(m_redoList.back());
+	m_redoList.pop_back();
+
+	CMorphTargetsUndoEntry& entry = m_undoList.back();
+	entry.sealed = true;
+	m_apply(scene, entry, false, data);
+	return entry.type;
+}
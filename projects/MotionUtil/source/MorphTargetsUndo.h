@@ -0,0 +1,233 @@
+﻿/**
+ * Morph Targetsの編集操作のUNDO/REDO.
+ * 形状全体のスナップショットではなく、変更された要素のみを差分として保持する.
+ */
+#ifndef _MORPHTARGETSUNDO_H
+#define _MORPHTARGETSUNDO_H
+
+#include "GlobalHeader.h"
+#include "MorphTargetsCtrl.h"
+
+#include <deque>
+
+/**
+ * 記録する編集操作の種類.
+ */
+enum MORPH_TARGETS_UNDO_TYPE {
+	morph_undo_none = 0,					// なし.
+	morph_undo_append_target,				// Targetの追加.
+	morph_undo_update_target,				// Targetの頂点を更新.
+	morph_undo_remove_target,				// Targetの削除.
+	morph_undo_rename_target,				// Target名の変更.
+	morph_undo_weights,						// ウエイト値の変更.
+	morph_undo_update_base,					// ベースの頂点座標を更新.
+	morph_undo_cleanup,						// 重複頂点のマージ.
+	morph_undo_remap,						// 頂点の追加/削除後の対応付け直し.
+};
+
+//-------------------------------------------------.
+/**
+ * 連続した頂点インデックスの範囲での変更前/変更後の座標.
+ */
+class CMorphTargetsUndoRange
+{
+public:
+	int startIndex;							// 開始インデックス.
+	std::vector<sxsdk::vec3> oldValues;		// 変更前の値.
+	std::vector<sxsdk::vec3> newValues;		// 変更後の値.
+
+public:
+	CMorphTargetsUndoRange () : startIndex(0) { }
+};
+
+/**
+ * 1つのTargetのウエイト値の変更.
+ */
+class CMorphTargetsUndoWeight
+{
+public:
+	int tIndex;								// Morph Targets番号.
+	float oldWeight;						// 変更前のウエイト値.
+	float newWeight;						// 変更後のウエイト値.
+
+public:
+	CMorphTargetsUndoWeight () : tIndex(-1), oldWeight(0.0f), newWeight(0.0f) { }
+};
+
+/**
+ * 1回の編集操作の差分.
+ */
+class CMorphTargetsUndoEntry
+{
+public:
+	MORPH_TARGETS_UNDO_TYPE type;			// 操作の種類.
+	void* shapeHandle;						// 対象形状のハンドル.
+	int tIndex;								// 対象のMorph Targets番号.
+	bool sealed;							// ウエイト値のドラッグ中の結合を打ち切った場合はtrue.
+
+	std::string oldName, newName;							// 名前変更.
+	std::vector<CMorphTargetsUndoWeight> weights;			// ウエイト値の変更.
+	std::vector<CMorphTargetsUndoRange> ranges;				// 変更された頂点の範囲 (ベース更新、Targetの頂点位置のみの更新).
+	CMorphTargetsData oldTarget, newTarget;					// Targetの追加/削除、頂点インデックスが変わる更新.
+
+	std::vector<sxsdk::vec3> oldOrgVertices, newOrgVertices;	// 頂点数が変わる場合のベース頂点.
+	std::vector<CMorphTargetsData> oldTargets, newTargets;		// 重複頂点のマージ、対応付け直し時のTarget.
+
+public:
+	CMorphTargetsUndoEntry ();
+
+	void clear ();
+
+	/**
+	 * 保持しているメモリ量(バイト数)を計算.
+	 */
+	size_t calcMemorySize () const;
+};
+
+//-------------------------------------------------.
+/**
+ * UNDO/REDOの履歴.
+ * 保持する差分の合計がメモリ上限を超えた場合は、古いものから破棄する.
+ */
+class CMorphTargetsUndoJournal
+{
+private:
+	std::deque<CMorphTargetsUndoEntry> m_undoList;		// UNDOの履歴 (末尾が最新).
+	std::deque<CMorphTargetsUndoEntry> m_redoList;		// REDOの履歴 (末尾が最新).
+
+	size_t m_maxMemorySize;								// 保持するメモリの上限(バイト数).
+	size_t m_memorySize;								// 現在保持しているメモリ量.
+
+private:
+	/**
+	 * 差分を履歴に追加し、REDOの履歴をクリア.
+	 */
+	void m_push (const CMorphTargetsUndoEntry& entry);
+
+	/**
+	 * メモリ上限を超えた分を古いものから破棄.
+	 */
+	void m_evict ();
+
+	/**
+	 * 頂点配列の差分を連続範囲として格納.
+	 */
+	static void m_calcRanges (const std::vector<sxsdk::vec3>& oldValues, const std::vector<sxsdk::vec3>& newValues, std::vector<CMorphTargetsUndoRange>& ranges);
+
+	/**
+	 * 差分を適用.
+	 * @param[in] entry    差分.
+	 * @param[in] undo     UNDOの場合はtrue、REDOの場合はfalse.
+	 */
+	void m_apply (sxsdk::scene_interface* scene, const CMorphTargetsUndoEntry& entry, const bool undo, CMorphTargetsCtrl& data);
+
+public:
+	CMorphTargetsUndoJournal ();
+
+	void clear ();
+
+	/**
+	 * 保持するメモリの上限を指定 (上限を超えている場合は、古いものから破棄する).
+	 */
+	void setMaxMemorySize (const size_t size);
+	size_t getMaxMemorySize () const { return m_maxMemorySize; }
+
+	/**
+	 * 現在保持しているメモリ量を取得.
+	 */
+	size_t getMemorySize () const { return m_memorySize; }
+
+	/**
+	 * 指定の形状の履歴を削除 (Morph Targets情報自体を削除した場合など).
+	 */
+	void removeShape (void* shapeHandle);
+
+	//---------------------------------------------------------------.
+	// 操作の記録.
+	//---------------------------------------------------------------.
+	/**
+	 * Targetの追加を記録 (追加後に呼ぶ).
+	 */
+	void recordAppendTarget (void* shapeHandle, const int tIndex, const CMorphTargetsData& newTarget);
+
+	/**
+	 * Targetの更新を記録.
+	 */
+	void recordUpdateTarget (void* shapeHandle, const int tIndex, const CMorphTargetsData& oldTarget, const CMorphTargetsData& newTarget);
+
+	/**
+	 * Targetの削除を記録.
+	 */
+	void recordRemoveTarget (void* shapeHandle, const int tIndex, const CMorphTargetsData& oldTarget);
+
+	/**
+	 * Target名の変更を記録.
+	 */
+	void recordRenameTarget (void* shapeHandle, const int tIndex, const std::string& oldName, const std::string& newName);
+
+	/**
+	 * 1つのTargetのウエイト値の変更を記録.
+	 * @param[in] dragged   スライダのドラッグ中の場合はtrue。直前の同じTargetの変更と結合する.
+	 */
+	void recordWeight (void* shapeHandle, const int tIndex, const float oldWeight, const float newWeight, const bool dragged = false);
+
+	/**
+	 * 複数のTargetのウエイト値の変更を記録 (変化したものだけ格納).
+	 */
+	void recordWeights (void* shapeHandle, const std::vector<float>& oldWeights, const std::vector<float>& newWeights);
+
+	/**
+	 * ウエイト値の変更の結合を打ち切る.
+	 */
+	void sealWeightChange ();
+
+	/**
+	 * ベースの頂点座標の更新を記録.
+	 */
+	void recordUpdateBase (void* shapeHandle, const std::vector<sxsdk::vec3>& oldOrgVertices, const std::vector<sxsdk::vec3>& newOrgVertices);
+
+	/**
+	 * 重複頂点のマージを記録.
+	 */
+	void recordCleanup (void* shapeHandle, const CMorphTargetsCtrl& oldData, const CMorphTargetsCtrl& newData);
+
+	/**
+	 * 頂点の追加/削除後の対応付け直しを記録.
+	 */
+	void recordRemap (void* shapeHandle, const CMorphTargetsCtrl& oldData, const CMorphTargetsCtrl& newData);
+
+	//---------------------------------------------------------------.
+	// UNDO/REDO.
+	//---------------------------------------------------------------.
+	bool canUndo () const { return !m_undoList.empty(); }
+	bool canRedo () const { return !m_redoList.empty(); }
+
+	/**
+	 * 次にUNDO/REDOされる形状のハンドルを取得.
+	 */
+	void* getUndoShapeHandle () const;
+	void* getRedoShapeHandle () const;
+
+	/**
+	 * UNDOを実行.
+	 * dataは、getUndoShapeHandle()の形状のMorph Targets情報を読み込んだものを渡すこと.
+	 * @return 適用した操作の種類.
+	 */
+	MORPH_TARGETS_UNDO_TYPE undo (sxsdk::scene_interface* scene, CMorphTargetsCtrl& data);
+
+	/**
+	 * REDOを実行.
+	 * @return 適用した操作の種類.
+	 */
+	MORPH_TARGETS_UNDO_TYPE redo (sxsdk::scene_interface* scene, CMorphTargetsCtrl& data);
+};
+
+namespace MorphTargetsUndo
+{
+	/**
+	 * プラグイン全体で共有するUNDO/REDOの履歴を取得.
+	 */
+	CMorphTargetsUndoJournal& getJournal ();
+}
+
+#endif
@@ -5,9 +5,17 @@
 #include "StreamCtrl.h"
 #include "MeshUtil.h"
 #include "RenameDialog.h"
+#include "MorphTargetsRegistry.h"
+#include "MorphTargetsUndo.h"
+#include "MorphTargetsRemap.h"
+#include "MorphTargetsTransfer.h"
+#include "MathUtil.h"
+#include "TraceUtil.h"
+
+#include <stdio.h>
 
 // ボタンのウィジットの高さ.
-#define BUTTONS_WIDGHT_HEIGHT  120
+#define BUTTONS_WIDGHT_HEIGHT  192
 
 //--------------------------------------------------------------.
 CButtonsWidget::CButtonsWidget (CMorphWindowInterface* pParent) : sxsdk::window_interface(*pParent, 0), m_pParent(pParent)
@@ -15,10 +23,16 @@ CButtonsWidget::CButtonsWidget (CMorphWindowInterface* pParent) : sxsdk::window_
 	m_pRemoveRestoreCheckBox = NULL;
 	m_pSetupMorphTargetsBut = NULL;
 	m_pUpdateMorphTargetsBaseBut = NULL;
+	m_pRemapVerticesBut = NULL;
 	m_pAppendTargetBut = NULL;
 	m_pRemoveMorphTargetsBut = NULL;
 	m_pSelectVerticesBut = NULL;
 	m_pClearAllWeightsBut = NULL;
+	m_pUndoBut = NULL;
+	m_pRedoBut = NULL;
+	m_pMirrorTargetBut = NULL;
+	m_pSplitTargetBut = NULL;
+	m_pTransferTargetsBut = NULL;
 }
 
 /**
@@ -49,6 +63,10 @@ bool CButtonsWidget::setup_push_button (sxsdk::window_interface::push_button_cla
 		if (!m_pUpdateMorphTargetsBaseBut) m_pUpdateMorphTargetsBaseBut = &push_button;
 		return true;
 	}
+	if (name == "remap_vertices_but") {
+		if (!m_pRemapVerticesBut) m_pRemapVerticesBut = &push_button;
+		return true;
+	}
 	if (name == "append_target_but") {
 		if (!m_pAppendTargetBut) m_pAppendTargetBut = &push_button;
 		return true;
@@ -65,6 +83,26 @@ bool CButtonsWidget::setup_push_button (sxsdk::window_interface::push_button_cla
 		if (!m_pClearAllWeightsBut) m_pClearAllWeightsBut = &push_button;
 		return true;
 	}
+	if (name == "undo_but") {
+		if (!m_pUndoBut) m_pUndoBut = &push_button;
+		return true;
+	}
+	if (name == "redo_but") {
+		if (!m_pRedoBut) m_pRedoBut = &push_button;
+		return true;
+	}
+	if (name == "mirror_target_but") {
+		if (!m_pMirrorTargetBut) m_pMirrorTargetBut = &push_button;
+		return true;
+	}
+	if (name == "split_target_but") {
+		if (!m_pSplitTargetBut) m_pSplitTargetBut = &push_button;
+		return true;
+	}
+	if (name == "transfer_targets_but") {
+		if (!m_pTransferTargetsBut) m_pTransferTargetsBut = &push_button;
+		return true;
+	}
 
 	return false;
 }
@@ -90,6 +128,9 @@ void CButtonsWidget::push_button_clicked (sxsdk::window_interface::push_button_c
 	if (name == "update_target_but") {		// Morph Targetのベース情報を更新.
 		m_pParent->updateMorphTargetData();
 	}
+	if (name == "remap_vertices_but") {		// 頂点の追加/削除後に対応付け直す.
+		m_pParent->remapMorphTargetsVertices();
+	}
 
 	if (name == "append_target_but") {		// Morph Target情報を追加登録.
 		m_pParent->appendMorphTargetData();
@@ -106,6 +147,24 @@ void CButtonsWidget::push_button_clicked (sxsdk::window_interface::push_button_c
 	if (name == "select_target_vertices_but") {		// Morph Target対象の頂点を選択.
 		m_pParent->selectTargetVertices();
 	}
+
+	if (name == "undo_but") {		// 元に戻す.
+		m_pParent->undoMorphTargets();
+	}
+	if (name == "redo_but") {		// やり直し.
+		m_pParent->redoMorphTargets();
+	}
+
+	if (name == "mirror_target_but") {		// 左右反転したTargetを追加.
+		m_pParent->appendMirrorMorphTarget(morph_mirror_flip);
+	}
+	if (name == "split_target_but") {		// 左右に分割したTargetを追加.
+		m_pParent->appendMirrorMorphTarget(morph_mirror_split);
+	}
+
+	if (name == "transfer_targets_but") {		// Morph Targetsを他の形状に転送.
+		m_pParent->transferMorphTargets();
+	}
 }
 
 void CButtonsWidget::checkbox_value_changed (sxsdk::window_interface::checkbox_class &checkbox, void *)
@@ -131,6 +190,10 @@ void CButtonsWidget::updateUI ()
 		m_pUpdateMorphTargetsBaseBut->set_active(hasMorphTargets);
 		m_pUpdateMorphTargetsBaseBut->invalidate();
 	}
+	if (m_pRemapVerticesBut) {
+		m_pRemapVerticesBut->set_active(hasMorphTargets);
+		m_pRemapVerticesBut->invalidate();
+	}
 	if (m_pAppendTargetBut) {
 		m_pAppendTargetBut->set_active(hasMorphTargets);
 		m_pAppendTargetBut->invalidate();
@@ -148,10 +211,38 @@ void CButtonsWidget::updateUI ()
 		m_pClearAllWeightsBut->invalidate();
 	}
 
+	// Targetが選択されているか.
+	const bool selectedTarget = hasMorphTargets && (morphTargetsD.getSelectTargetIndex() >= 0);
+	if (m_pMirrorTargetBut) {
+		m_pMirrorTargetBut->set_active(selectedTarget);
+		m_pMirrorTargetBut->invalidate();
+	}
+	if (m_pSplitTargetBut) {
+		m_pSplitTargetBut->set_active(selectedTarget);
+		m_pSplitTargetBut->invalidate();
+	}
+
+	// 転送元と転送先の形状が選択されているか.
+	if (m_pTransferTargetsBut) {
+		m_pTransferTargetsBut->set_active(m_pParent->getActiveShapesCount() >= 2);
+		m_pTransferTargetsBut->invalidate();
+	}
+
 	if (m_pRemoveRestoreCheckBox) {
 		m_pRemoveRestoreCheckBox->set_active(hasMorphTargets);
 		m_pRemoveRestoreCheckBox->invalidate();
 	}
+
+	// UNDO/REDOの履歴があるか.
+	const CMorphTargetsUndoJournal& journal = MorphTargetsUndo::getJournal();
+	if (m_pUndoBut) {
+		m_pUndoBut->set_active(journal.canUndo());
+		m_pUndoBut->invalidate();
+	}
+	if (m_pRedoBut) {
+		m_pRedoBut->set_active(journal.canRedo());
+		m_pRedoBut->invalidate();
+	}
 }
 
 //--------------------------------------------------------------.
@@ -175,6 +266,9 @@ void CMorphWindowInterface::initialize (void *)
 	m_msg_noModifyVertexMode    = shade.gettext("msg_no_modify_vertex_mode");
 	m_msg_noSelectedVertices    = shade.gettext("msg_no_selected_vertices");
 	m_msg_noSelectedPolygonmesh = shade.gettext("msg_no_selected_polygonmesh");
+	m_msg_transferSelectShapes  = shade.gettext("msg_transfer_select_shapes");
+	m_msg_transferResult        = shade.gettext("msg_transfer_result");
+	m_msg_remapResult           = shade.gettext("msg_remap_result");
 
 	int control_id = 1000;
 	m_pMorphTargetsWidget = new CUIMorphTargetsWidget(this, control_id++);
@@ -265,6 +359,10 @@ bool CMorphWindowInterface::chkInnerMorphTargetsList (const sx::vec<int,2>& p)
  */
 void CMorphWindowInterface::active_scene_changed (bool &b, sxsdk::scene_interface *scene, void *)
 {
+	m_activeShapeHandles.clear();
+
+	// シーンの読み込みや切り替えでは、Morph Targets情報を持つ形状の一覧を作り直す.
+	MorphTargetsRegistry::getRegistry().invalidate();
 	if (!scene) {
 		m_morphTargetsData.clear();
 		m_updateUI();
@@ -281,6 +379,17 @@ void CMorphWindowInterface::active_scene_changed (bool &b, sxsdk::scene_interfac
  */
 void CMorphWindowInterface::active_shapes_changed (bool &b, sxsdk::scene_interface *scene, int old_n, sxsdk::shape_class *const *old_shapes, int n, sxsdk::shape_class *const *shapes, void *)
 {
+	// 選択形状を保持.
+	m_activeShapeHandles.clear();
+	try {
+		for (int i = 0; i < n; ++i) {
+			if (shapes[i]) m_activeShapeHandles.push_back(shapes[i]->get_handle());
+		}
+	} catch (...) { }
+
+	// ペーストなどで追加された形状は選択状態になるため、選択形状以下をMorph Targets情報を持つ形状の一覧に反映.
+	MorphTargetsRegistry::getRegistry().updateShapes(shapes, n);
+
 	if (!scene) {
 		m_morphTargetsData.clear();
 		m_updateUI();
@@ -352,7 +461,9 @@ void CMorphWindowInterface::updateMorphTargetData ()
 
 	try {
 		// 選択形状をMorph Targetsの対象として指定.
-		m_morphTargetsData.updateMorphTargetsBase(shape);
+		const std::vector<sxsdk::vec3> oldOrgVertices = m_morphTargetsData.getOrgVertices();
+		if (!m_morphTargetsData.updateMorphTargetsBase(shape)) return;
+		MorphTargetsUndo::getJournal().recordUpdateBase(shape->get_handle(), oldOrgVertices, m_morphTargetsData.getOrgVertices());
 
 		// streamにMorph Targets情報を保存.
 		StreamCtrl::writeMorphTargetsData(*shape, m_morphTargetsData);
@@ -363,6 +474,40 @@ void CMorphWindowInterface::updateMorphTargetData ()
 	} catch (...) { }
 }
 
+/**
+ * ポリゴンメッシュの頂点の追加/削除後に、Morph Targetsの頂点を対応付け直す.
+ * 残った頂点は元の頂点に対応付け、追加された頂点のTargetの移動量は周囲の頂点から補間する.
+ * Targetの番号は変わらない (移動する頂点がなくなったTargetも残る).
+ */
+void CMorphWindowInterface::remapMorphTargetsVertices ()
+{
+	// 選択されたポリゴンメッシュ形状を取得.
+	sxsdk::shape_class* shape = MeshUtil::getActivePolygonMesh(shade);
+	if (!shape || m_morphTargetsData.getTargetShape() != shape) return;
+	if (!m_morphTargetsData.isVerticesCountChanged()) return;
+
+	try {
+		if (!m_morphTargetsData.loadAllVertices()) return;
+		const CMorphTargetsCtrl oldData = m_morphTargetsData;
+		CMorphTargetsRemapStats stats;
+		if (!m_morphTargetsData.remapMeshVertices(&stats)) return;
+		MorphTargetsUndo::getJournal().recordRemap(shape->get_handle(), oldData, m_morphTargetsData);
+
+		// streamにMorph Targets情報を保存.
+		StreamCtrl::writeMorphTargetsData(*shape, m_morphTargetsData);
+
+		// 対応付けの結果を表示.
+		{
+			char szStr[512];
+			snprintf(szStr, sizeof(szStr), m_msg_remapResult.c_str(), stats.matchedCount, stats.interpolatedCount, stats.removedCount);
+			shade.show_message_box(szStr, false);
+		}
+
+		// UIの更新.
+		m_updateUI();
+
+	} catch (...) { }
+}
 
 /**
  * Morph Target情報を新たに追加.
@@ -401,6 +546,9 @@ void CMorphWindowInterface::appendMorphTargetData ()
 		// 選択頂点をMorph Target情報として登録.
 		const std::vector<sxsdk::vec3> vers = MeshUtil::getMeshVertex(*shape, vIndices);
 		const int tIndex = m_morphTargetsData.appendTargetVertices("target", vIndices, vers);
+		if (tIndex >= 0) {
+			MorphTargetsUndo::getJournal().recordAppendTarget(shape->get_handle(), tIndex, m_morphTargetsData.getMorphTargetData(tIndex));
+		}
 
 		// 追加された要素を選択状態にする.
 		m_morphTargetsData.setSelectTargetIndex(tIndex);
@@ -419,7 +567,15 @@ void CMorphWindowInterface::appendMorphTargetData ()
  */
 void CMorphWindowInterface::clearAllWeights ()
 {
+	const int targetsCou = m_morphTargetsData.getTargetsCount();
+	std::vector<float> oldWeights(targetsCou);
+	for (int i = 0; i < targetsCou; ++i) oldWeights[i] = m_morphTargetsData.getTargetWeight(i);
+
 	m_morphTargetsData.setZeroAllWeight();
+	if (m_morphTargetsData.getTargetShape()) {
+		MorphTargetsUndo::getJournal().recordWeights(m_morphTargetsData.getTargetShape()->get_handle(), oldWeights, std::vector<float>(targetsCou, 0.0f));
+	}
+
 	m_updateUI();
 	m_morphTargetsData.writeMorphTargetsData();
 }
@@ -433,6 +589,10 @@ void CMorphWindowInterface::removeMorphTargetsData ()
 	if (!scene) return;
 
 	// カレント形状でのMorph Targets情報を削除.
+	// 削除した形状の履歴は、以降適用できないため破棄する.
+	if (m_morphTargetsData.getTargetShape()) {
+		MorphTargetsUndo::getJournal().removeShape(m_morphTargetsData.getTargetShape()->get_handle());
+	}
 	m_morphTargetsData.removeMorphTargets(scene, m_removeRestoreCheck);
 	m_updateUI();
 }
@@ -503,6 +663,7 @@ void CMorphWindowInterface::idle_task (bool &b, sxsdk::scene_interface *scene, v
 		m_needLoadMorph = false;
 		if (scene) {
 			sxsdk::shape_class& shape = scene->active_shape();
+			CTraceScope traceScope("CMorphWindowInterface::idle_task loadMorph", "handle", (long long)(size_t)shape.get_handle());
 			if (StreamCtrl::readMorphTargetsData(shape, m_morphTargetsData)) {
 				m_updateUI();
 			} else {
@@ -519,17 +680,30 @@ void CMorphWindowInterface::idle_task (bool &b, sxsdk::scene_interface *scene, v
 	}
 }
 
+/**
+ * ボタン部のUIを更新 (Targetの選択が変更された場合など).
+ */
+void CMorphWindowInterface::updateButtonsUI ()
+{
+	if (m_pButtonsWidget) m_pButtonsWidget->updateUI();
+}
+
 /**
  * Morph情報を更新.
  */
 void CMorphWindowInterface::updateMorph ()
 {
 	m_needUpdateMorph = false;
+	CTraceScope traceScope("CMorphWindowInterface::updateMorph", "vertices", (long long)m_morphTargetsData.getOrgVerticesCount(), "targets", (long long)m_morphTargetsData.getTargetsCount());
 
 	// streamにMorph Targets情報を保存.
+	// ウエイト値のみの変更のため、構成が同じ場合はstream上のウエイト値のみを書き換える.
 	sxsdk::shape_class* shape = MeshUtil::getActivePolygonMesh(shade);
 	if (shape) {
-		StreamCtrl::writeMorphTargetsData(*shape, m_morphTargetsData);
+		traceScope.setEndArg("handle", (long long)(size_t)shape->get_handle());
+		if (!StreamCtrl::writeMorphTargetsWeights(*shape, m_morphTargetsData)) {
+			StreamCtrl::writeMorphTargetsData(*shape, m_morphTargetsData);
+		}
 
 		compointer<sxsdk::scene_interface> scene(shade.get_scene_interface());
 		if (!scene) return;
@@ -537,6 +711,9 @@ void CMorphWindowInterface::updateMorph ()
 		// ウエイト値によりメッシュを更新.
 		m_morphTargetsData.updateMesh(scene);
 	}
+
+	// UNDO/REDOボタンの状態を更新.
+	if (m_pButtonsWidget) m_pButtonsWidget->updateUI();
 }
 
 /**
@@ -571,7 +748,12 @@ void CMorphWindowInterface::updateMorphTarget (const int index)
 
 		// 選択頂点をMorph Target情報として登録.
 		const std::vector<sxsdk::vec3> vers = MeshUtil::getMeshVertex(*shape, vIndices);
+		if (index < 0 || index >= m_morphTargetsData.getTargetsCount()) return;
+		const CMorphTargetsData oldTargetData = m_morphTargetsData.getMorphTargetData(index);
 		const int tIndex = m_morphTargetsData.updateTargetVertices(scene, index, vIndices, vers);
+		if (tIndex >= 0) {
+			MorphTargetsUndo::getJournal().recordUpdateTarget(shape->get_handle(), tIndex, oldTargetData, m_morphTargetsData.getMorphTargetData(tIndex));
+		}
 
 		// 追加された要素を選択状態にする.
 		m_morphTargetsData.setSelectTargetIndex(tIndex);
@@ -596,11 +778,15 @@ void CMorphWindowInterface::removeMorphTarget (const int index)
 		compointer<sxsdk::scene_interface> scene(shade.get_scene_interface());
 		if (!scene) return;
 
+		if (index < 0 || index >= m_morphTargetsData.getTargetsCount()) return;
+		const CMorphTargetsData oldTargetData = m_morphTargetsData.getMorphTargetData(index);
+
 		// 一度ウエイト値を0に戻す.
 		m_morphTargetsData.setTargetWeight(index, 0.0f);
 		m_morphTargetsData.updateMesh(scene);
 
 		if (m_morphTargetsData.removeTarget(index)) {
+			MorphTargetsUndo::getJournal().recordRemoveTarget(shape->get_handle(), index, oldTargetData);
 			StreamCtrl::writeMorphTargetsData(*shape, m_morphTargetsData);
 			m_updateUI();
 		}
@@ -616,7 +802,9 @@ void CMorphWindowInterface::renameMorphTarget (const int index, const std::strin
 {
 	sxsdk::shape_class* shape = MeshUtil::getActivePolygonMesh(shade);
 	if (shape) {
+		const std::string oldName = m_morphTargetsData.getTargetName(index);
 		m_morphTargetsData.setTargetName(index, name);
+		MorphTargetsUndo::getJournal().recordRenameTarget(shape->get_handle(), index, oldName, name);
 		StreamCtrl::writeMorphTargetsData(*shape, m_morphTargetsData);
 		m_updateUI();
 	}
@@ -645,3 +833,202 @@ bool CMorphWindowInterface::showRenameDialog (const int index)
 	} catch (...) { }
 	return false;
 }
+
+/**
+ * 選択されたMorph Targetを、X軸方向で反転/左右分割したTargetを追加.
+ * 対称マップはstreamにキャッシュされ、ベースが変わるまで再利用される.
+ * @param[in] type   作成方法.
+ */
+void CMorphWindowInterface::appendMirrorMorphTarget (const MORPH_TARGETS_MIRROR_TYPE type)
+{
+	sxsdk::shape_class* shape = MeshUtil::getActivePolygonMesh(shade);
+	if (!shape || m_morphTargetsData.getTargetShape() == NULL) return;
+
+	const int tIndex = m_morphTargetsData.getSelectTargetIndex();
+	if (tIndex < 0 || tIndex >= m_morphTargetsData.getTargetsCount()) return;
+
+	try {
+		// X軸方向(YZ平面)で対称マップを計算.
+		const float tolerance = MorphTargetsSymmetry::calcDefaultTolerance(m_morphTargetsData.getOrgVertices());
+		if (!m_morphTargetsData.updateSymmetryMap(0, 0.0f, tolerance)) return;
+
+		const int startIndex = m_morphTargetsData.getTargetsCount();
+		const int cou = m_morphTargetsData.appendMirrorTargets(std::vector<int>(1, tIndex), type);
+		if (cou <= 0) return;
+
+		CMorphTargetsUndoJournal& journal = MorphTargetsUndo::getJournal();
+		for (int i = 0; i < cou; ++i) {
+			journal.recordAppendTarget(shape->get_handle(), startIndex + i, m_morphTargetsData.getMorphTargetData(startIndex + i));
+		}
+
+		// 追加された要素を選択状態にする.
+		m_morphTargetsData.setSelectTargetIndex(startIndex);
+
+		// streamにMorph Targets情報を保存.
+		StreamCtrl::writeMorphTargetsData(*shape, m_morphTargetsData);
+
+		// UIの更新.
+		m_updateUI();
+
+	} catch (...) { }
+}
+
+/**
+ * 選択されたポリゴンメッシュのうち、Morph Targetsを持つ形状から他の形状へMorph Targetsを転送.
+ * 頂点数/トポロジが異なる形状にも転送できる.
+ */
+void CMorphWindowInterface::transferMorphTargets ()
+{
+	try {
+		compointer<sxsdk::scene_interface> scene(shade.get_scene_interface());
+		if (!scene) return;
+
+		// 選択形状のうち、最初にMorph Targets情報を持つポリゴンメッシュを転送元、それ以外を転送先とする.
+		sxsdk::shape_class* srcShape = NULL;
+		std::vector<sxsdk::shape_class *> dstShapes;
+		for (size_t i = 0; i < m_activeShapeHandles.size(); ++i) {
+			sxsdk::shape_class* shape = scene->get_shape_by_handle(m_activeShapeHandles[i]);
+			if (!shape || shape->get_type() != sxsdk::enums::polygon_mesh) continue;
+			if (!srcShape && StreamCtrl::hasMorphTargetsData(*shape)) srcShape = shape;
+			else dstShapes.push_back(shape);
+		}
+		if (!srcShape || dstShapes.empty()) {
+			shade.show_message_box(m_msg_transferSelectShapes.c_str(), false);
+			return;
+		}
+
+		// 転送元のMorph Targets情報と三角形.
+		// ベースと現在のメッシュの頂点数が異なる場合は、面の頂点インデックスが対応しないため転送できない.
+		CMorphTargetsCtrl srcData;
+		if (!StreamCtrl::readMorphTargetsData(*srcShape, srcData)) return;
+		if ((int)srcData.getOrgVertices().size() != srcShape->get_total_number_of_control_points()) return;
+		std::vector<int> srcTriangles;
+		MeshUtil::getMeshTriangles(*srcShape, srcTriangles);
+
+		const sxsdk::mat4 srcLWMat = srcShape->get_transformation() * srcShape->get_local_to_world_matrix();
+		const sxsdk::mat4 srcWLMat = inv(srcLWMat);
+
+		// 転送元のバウンディングボックスの5%を、転送先の頂点から三角形を探す最大距離とする.
+		float maxDistance = 0.0f;
+		{
+			sxsdk::vec3 bbMin, bbMax;
+			MathUtil::calcBoundingBox(srcData.getOrgVertices(), bbMin, bbMax);
+			maxDistance = sxsdk::absolute(bbMax - bbMin) * 0.05f;
+		}
+
+		CMorphTargetsUndoJournal& journal = MorphTargetsUndo::getJournal();
+		CMorphTargetsTransferStats totalStats;
+		double sumDistance = 0.0;
+		for (size_t i = 0; i < dstShapes.size(); ++i) {
+			sxsdk::shape_class* dstShape = dstShapes[i];
+
+			// 転送先がMorph Targets情報を持つ場合は、そのベースに追加する.
+			CMorphTargetsCtrl dstData;
+			if (!StreamCtrl::readMorphTargetsData(*dstShape, dstData)) {
+				if (!dstData.setupShape(dstShape)) continue;
+			}
+
+			const sxsdk::mat4 dstLWMat = dstShape->get_transformation() * dstShape->get_local_to_world_matrix();
+			std::vector<CMorphTargetsData> dstTargets;
+			CMorphTargetsTransferStats stats;
+			if (!MorphTargetsTransfer::transferMorphTargets(srcData.getOrgVertices(), srcTriangles, srcData.getMorphTargetsData(), dstData.getOrgVertices(), dstLWMat * srcWLMat, maxDistance, dstTargets, stats)) continue;
+
+			for (size_t j = 0; j < dstTargets.size(); ++j) {
+				const CMorphTargetsData& targetD = dstTargets[j];
+				const int tIndex = dstData.appendTargetVertices(targetD.name, targetD.vIndices, targetD.vertices);
+				if (tIndex < 0) continue;
+				dstData.setTargetWeight(tIndex, 0.0f);
+				journal.recordAppendTarget(dstShape->get_handle(), tIndex, dstData.getMorphTargetData(tIndex));
+			}
+			StreamCtrl::writeMorphTargetsData(*dstShape, dstData);
+
+			totalStats.verticesCount  += stats.verticesCount;
+			totalStats.unmatchedCount += stats.unmatchedCount;
+			totalStats.targetsCount   += stats.targetsCount;
+			totalStats.maxDistance     = std::max(totalStats.maxDistance, stats.maxDistance);
+			sumDistance += (double)stats.averageDistance * (double)(stats.verticesCount - stats.unmatchedCount);
+		}
+		if (totalStats.verticesCount > totalStats.unmatchedCount) {
+			totalStats.averageDistance = (float)(sumDistance / (double)(totalStats.verticesCount - totalStats.unmatchedCount));
+		}
+
+		// 転送結果を表示.
+		{
+			char szStr[512];
+			snprintf(szStr, sizeof(szStr), m_msg_transferResult.c_str(), totalStats.targetsCount, totalStats.unmatchedCount, totalStats.verticesCount, totalStats.maxDistance, totalStats.averageDistance);
+			shade.show_message_box(szStr, false);
+		}
+
+		// カレント形状のMorph Targets情報を読み込み直す.
+		setNeedLoadMorph();
+		if (m_pButtonsWidget) m_pButtonsWidget->updateUI();
+
+	} catch (...) { }
+}
+
+/**
+ * Morph Targetsの編集操作を元に戻す.
+ */
+void CMorphWindowInterface::undoMorphTargets ()
+{
+	CMorphTargetsUndoJournal& journal = MorphTargetsUndo::getJournal();
+	if (!journal.canUndo()) return;
+
+	try {
+		compointer<sxsdk::scene_interface> scene(shade.get_scene_interface());
+		if (!scene) return;
+
+		// 履歴の対象形状がカレントでない場合は、streamから読み込む.
+		sxsdk::shape_class* shape = scene->get_shape_by_handle(journal.getUndoShapeHandle());
+		if (!shape) {
+			journal.removeShape(journal.getUndoShapeHandle());
+			m_updateUI();
+			return;
+		}
+		if (m_morphTargetsData.getTargetShape() != shape) {
+			if (!StreamCtrl::readMorphTargetsData(*shape, m_morphTargetsData)) return;
+		}
+
+		// ウエイト値のみの変更は、streamの該当箇所のみを書き換える.
+		const MORPH_TARGETS_UNDO_TYPE type = journal.undo(scene, m_morphTargetsData);
+		if (type == morph_undo_none) return;
+		if (type != morph_undo_weights || !StreamCtrl::writeMorphTargetsWeights(*shape, m_morphTargetsData)) {
+			StreamCtrl::writeMorphTargetsData(*shape, m_morphTargetsData);
+		}
+		m_updateUI();
+
+	} catch (...) { }
+}
+
+/**
+ * 元に戻したMorph Targetsの編集操作をやり直す.
+ */
+void CMorphWindowInterface::redoMorphTargets ()
+{
+	CMorphTargetsUndoJournal& journal = MorphTargetsUndo::getJournal();
+	if (!journal.canRedo()) return;
+
+	try {
+		compointer<sxsdk::scene_interface> scene(shade.get_scene_interface());
+		if (!scene) return;
+
+		// 履歴の対象形状がカレントでない場合は、streamから読み込む.
+		sxsdk::shape_class* shape = scene->get_shape_by_handle(journal.getRedoShapeHandle());
+		if (!shape) {
+			journal.removeShape(journal.getRedoShapeHandle());
+			m_updateUI();
+			return;
+		}
+		if (m_morphTargetsData.getTargetShape() != shape) {
+			if (!StreamCtrl::readMorphTargetsData(*shape, m_morphTargetsData)) return;
+		}
+
+		const MORPH_TARGETS_UNDO_TYPE type = journal.redo(scene, m_morphTargetsData);
+		if (type == morph_undo_none) return;
+		if (type != morph_undo_weights || !StreamCtrl::writeMorphTargetsWeights(*shape, m_morphTargetsData)) {
+			StreamCtrl::writeMorphTargetsData(*shape, m_morphTargetsData);
+		}
+		m_updateUI();
+
+	} catch (...) { }
+}
@@ -23,10 +23,16 @@ private:
 	checkbox_class* m_pRemoveRestoreCheckBox;
 	push_button_class* m_pSetupMorphTargetsBut;
 	push_button_class* m_pUpdateMorphTargetsBaseBut;
+	push_button_class* m_pRemapVerticesBut;
 	push_button_class* m_pAppendTargetBut;
 	push_button_class* m_pRemoveMorphTargetsBut;
 	push_button_class* m_pSelectVerticesBut;
 	push_button_class* m_pClearAllWeightsBut;
+	push_button_class* m_pUndoBut;
+	push_button_class* m_pRedoBut;
+	push_button_class* m_pMirrorTargetBut;
+	push_button_class* m_pSplitTargetBut;
+	push_button_class* m_pTransferTargetsBut;
 
 
 protected:
@@ -84,12 +90,17 @@ private:
 	bool m_needLoadMorph;								// 遅延でMorph Targetsのデータを読み込み、UIに反映.
 	bool m_showRenameDialog;							// 名前変更のダイアログをidleから呼ぶ。mouse_downからの呼び出しではうまくダイアログが出ないため.
 
+	std::vector<void *> m_activeShapeHandles;			// 選択されている形状のハンドル (Morph Targetsの転送で使用).
+
 private:
 	// 各種メッセージテキスト.
 	// イベントの呼び出しタイミングによってはshade.gettext("")から取得できないのであらかじめ読み込んでおく.
 	std::string m_msg_noModifyVertexMode;
 	std::string m_msg_noSelectedVertices;
 	std::string m_msg_noSelectedPolygonmesh;
+	std::string m_msg_transferSelectShapes;
+	std::string m_msg_transferResult;
+	std::string m_msg_remapResult;
 
 
 private:
@@ -172,6 +183,11 @@ public:
 	 */
 	void appendMorphTargetData ();
 
+	/**
+	 * ポリゴンメッシュの頂点の追加/削除後に、Morph Targetsの頂点を対応付け直す.
+	 */
+	void remapMorphTargetsVertices ();
+
 	/**
 	 * ウエイト値をすべてクリア.
 	 */
@@ -187,6 +203,28 @@ public:
 	 */
 	void selectTargetVertices ();
 
+	/**
+	 * 選択されたMorph Targetを、X軸方向で反転/左右分割したTargetを追加.
+	 * @param[in] type   作成方法.
+	 */
+	void appendMirrorMorphTarget (const MORPH_TARGETS_MIRROR_TYPE type);
+
+	/**
+	 * 選択されたポリゴンメッシュのうち、Morph Targetsを持つ形状から他の形状へMorph Targetsを転送.
+	 * 頂点数/トポロジが異なる形状にも転送できる.
+	 */
+	void transferMorphTargets ();
+
+	/**
+	 * Morph Targetsの編集操作を元に戻す.
+	 */
+	void undoMorphTargets ();
+
+	/**
+	 * 元に戻したMorph Targetsの編集操作をやり直す.
+	 */
+	void redoMorphTargets ();
+
 public:
 	explicit CMorphWindowInterface (sxsdk::shade_interface &shade);
 
@@ -198,6 +236,11 @@ public:
 	const CMorphTargetsCtrl& getMorphTargetsCtrl () const { return m_morphTargetsData; }
 	CMorphTargetsCtrl& getMorphTargetsCtrl () { return m_morphTargetsData; }
 
+	/**
+	 * 選択されている形状数を取得.
+	 */
+	int getActiveShapesCount () const { return (int)m_activeShapeHandles.size(); }
+
 	static const char *name (sxsdk::shade_interface *shade) { return shade->gettext("morph_window_title"); }
 
 	/**
@@ -220,6 +263,11 @@ public:
 	 */
 	void updateMorph ();
 
+	/**
+	 * ボタン部のUIを更新 (Targetの選択が変更された場合など).
+	 */
+	void updateButtonsUI ();
+
 	/**
 	 * 指定のMorph Target情報を更新する.
 	 * @param[in] index   Weightリストでの番号.
@@ -0,0 +1,350 @@
+﻿/**
+ * 複数のMotionGroupを重ねたポーズの計算 (レイヤーによるブレンド).
+ */
+#include "MotionBlend.h"
+#include "BoneSkeleton.h"
+#include "ParallelUtil.h"
+#include "ProfileUtil.h"
+#include "TraceUtil.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	/**
+	 * 成分ごとの配列の並び (ジョイント数ずつ).
+	 */
+	enum BLEND_VALUE_INDEX {
+		blend_value_offset = 0,					// ブレンド結果のOffset値 (x, y, z).
+		blend_value_rot = 3,					// ブレンド結果のRotation値 (x, y, z, w).
+		blend_value_layer_offset = 7,			// レイヤーのOffset値 (x, y, z).
+		blend_value_layer_rot = 10,				// レイヤーのRotation値 (x, y, z, w).
+		blend_values_count = 14,
+	};
+
+	bool m_compareKeyFrameTime (const MotionUtil::CMotionGroupKeyFrameMorphTargets& a, const MotionUtil::CMotionGroupKeyFrameMorphTargets& b)
+	{
+		return a.timeSec < b.timeSec;
+	}
+
+	inline float m_clamp01 (const float v)
+	{
+		return std::min(1.0f, std::max(0.0f, v));
+	}
+
+	/**
+	 * ブレンド結果のRotation値を正規化.
+	 */
+	void m_normalizeRotations (const int n, float* v)
+	{
+		float* ax = v + (blend_value_rot + 0) * n;
+		float* ay = v + (blend_value_rot + 1) * n;
+		float* az = v + (blend_value_rot + 2) * n;
+		float* aw = v + (blend_value_rot + 3) * n;
+		for (int j = 0; j < n; ++j) {
+			const float len2 = ax[j] * ax[j] + ay[j] * ay[j] + az[j] * az[j] + aw[j] * aw[j];
+			const float d = (len2 > 0.0f) ? (1.0f / std::sqrt(len2)) : 0.0f;
+			ax[j] *= d;
+			ay[j] *= d;
+			az[j] *= d;
+			aw[j] = (len2 > 0.0f) ? (aw[j] * d) : 1.0f;
+		}
+	}
+
+	/**
+	 * 上書きのレイヤーをブレンド.
+	 * 分岐を持たないループとし、コンパイラによるベクトル化を期待する.
+	 */
+	void m_blendOverride (const int n, const float* rates, float* v)
+	{
+		float* ax = v + (blend_value_rot + 0) * n;
+		float* ay = v + (blend_value_rot + 1) * n;
+		float* az = v + (blend_value_rot + 2) * n;
+		float* aw = v + (blend_value_rot + 3) * n;
+		const float* bx = v + (blend_value_layer_rot + 0) * n;
+		const float* by = v + (blend_value_layer_rot + 1) * n;
+		const float* bz = v + (blend_value_layer_rot + 2) * n;
+		const float* bw = v + (blend_value_layer_rot + 3) * n;
+
+		// 短い経路で補間するよう、内積が負の場合はレイヤーの符号を反転する.
+		for (int j = 0; j < n; ++j) {
+			const float d = ax[j] * bx[j] + ay[j] * by[j] + az[j] * bz[j] + aw[j] * bw[j];
+			const float r = (d < 0.0f) ? -rates[j] : rates[j];
+			const float w0 = 1.0f - rates[j];
+			ax[j] = ax[j] * w0 + bx[j] * r;
+			ay[j] = ay[j] * w0 + by[j] * r;
+			az[j] = az[j] * w0 + bz[j] * r;
+			aw[j] = aw[j] * w0 + bw[j] * r;
+		}
+		m_normalizeRotations(n, v);
+
+		for (int k = 0; k < 3; ++k) {
+			float* o0 = v + (blend_value_offset + k) * n;
+			const float* o1 = v + (blend_value_layer_offset + k) * n;
+			for (int j = 0; j < n; ++j) o0[j] += (o1[j] - o0[j]) * rates[j];
+		}
+	}
+
+	/**
+	 * 加算のレイヤーをブレンド.
+	 * レイヤーの回転を単位クォータニオンから割合分だけ補間し、ブレンド結果に右から掛ける (ジョイントのローカルで先に回転).
+	 */
+	void m_blendAdditive (const int n, const float* rates, float* v)
+	{
+		float* ax = v + (blend_value_rot + 0) * n;
+		float* ay = v + (blend_value_rot + 1) * n;
+		float* az = v + (blend_value_rot + 2) * n;
+		float* aw = v + (blend_value_rot + 3) * n;
+		const float* bx = v + (blend_value_layer_rot + 0) * n;
+		const float* by = v + (blend_value_layer_rot + 1) * n;
+		const float* bz = v + (blend_value_layer_rot + 2) * n;
+		const float* bw = v + (blend_value_layer_rot + 3) * n;
+
+		for (int j = 0; j < n; ++j) {
+			const float r = (bw[j] < 0.0f) ? -rates[j] : rates[j];
+			float qx = bx[j] * r;
+			float qy = by[j] * r;
+			float qz = bz[j] * r;
+			float qw = (1.0f - rates[j]) + bw[j] * r;
+			const float d = 1.0f / std::sqrt(std::max(qx * qx + qy * qy + qz * qz + qw * qw, 1e-20f));
+			qx *= d;
+			qy *= d;
+			qz *= d;
+			qw *= d;
+
+			const float x = aw[j] * qx + ax[j] * qw + ay[j] * qz - az[j] * qy;
+			const float y = aw[j] * qy - ax[j] * qz + ay[j] * qw + az[j] * qx;
+			const float z = aw[j] * qz + ax[j] * qy - ay[j] * qx + az[j] * qw;
+			const float w = aw[j] * qw - ax[j] * qx - ay[j] * qy - az[j] * qz;
+			ax[j] = x;
+			ay[j] = y;
+			az[j] = z;
+			aw[j] = w;
+		}
+		m_normalizeRotations(n, v);
+
+		for (int k = 0; k < 3; ++k) {
+			float* o0 = v + (blend_value_offset + k) * n;
+			const float* o1 = v + (blend_value_layer_offset + k) * n;
+			for (int j = 0; j < n; ++j) o0[j] += o1[j] * rates[j];
+		}
+	}
+
+	/**
+	 * レイヤーのMorph Targetsのウエイト値をブレンド.
+	 */
+	void m_blendMorphWeights (const CMotionBlendLayer& layer, const int morphChannelsCount, std::vector<float>& morphWeights)
+	{
+		const CMotionBlendClip& clip = *layer.clip;
+		const int tracksCou = (int)std::min(clip.morphChannels.size(), clip.morphKeyFrames.size());
+		for (int i = 0; i < tracksCou; ++i) {
+			const int ch = clip.morphChannels[i];
+			if (ch < 0 || ch >= morphChannelsCount || clip.morphKeyFrames[i].empty()) continue;
+			const float mask = (ch < (int)layer.morphMask.size()) ? layer.morphMask[ch] : 1.0f;
+			const float rate = m_clamp01(layer.weight * mask);
+			const float weight = MotionUtil::evaluateMorphWeight(clip.morphKeyFrames[i], layer.timeSec);
+			if (layer.mode == motion_blend_additive) {
+				morphWeights[ch] += weight * rate;
+			} else {
+				morphWeights[ch] += (weight - morphWeights[ch]) * rate;
+			}
+		}
+	}
+}
+
+//-------------------------------------------------.
+CMotionBlendMorphChannels::CMotionBlendMorphChannels ()
+{
+	clear();
+}
+
+void CMotionBlendMorphChannels::clear ()
+{
+	shapes.clear();
+	shapeHandles.clear();
+	targetIndices.clear();
+}
+
+/**
+ * 対象形状とTarget番号のチャンネル番号を取得 (ない場合は追加する).
+ */
+int CMotionBlendMorphChannels::appendChannel (sxsdk::shape_class* shape, const int targetIndex)
+{
+	if (!shape) return -1;
+	const int index = findChannel(shape, targetIndex);
+	if (index >= 0) return index;
+
+	void* handle = NULL;
+	try {
+		handle = shape->get_handle();
+	} catch (...) { }
+	shapes.push_back(shape);
+	shapeHandles.push_back(handle);
+	targetIndices.push_back(targetIndex);
+	return (int)targetIndices.size() - 1;
+}
+
+/**
+ * 対象形状とTarget番号のチャンネル番号.
+ */
+int CMotionBlendMorphChannels::findChannel (sxsdk::shape_class* shape, const int targetIndex) const
+{
+	if (!shape) return -1;
+	void* handle = NULL;
+	try {
+		handle = shape->get_handle();
+	} catch (...) { }
+
+	for (int i = 0; i < (int)targetIndices.size(); ++i) {
+		if (targetIndices[i] != targetIndex) continue;
+		if (handle ? (shapeHandles[i] == handle) : (shapes[i] == shape)) return i;
+	}
+	return -1;
+}
+
+//-------------------------------------------------.
+CMotionBlendClip::CMotionBlendClip ()
+{
+	clear();
+}
+
+void CMotionBlendClip::clear ()
+{
+	tracks.clear();
+	morphChannels.clear();
+	morphKeyFrames.clear();
+}
+
+//-------------------------------------------------.
+CMotionBlendLayer::CMotionBlendLayer () : clip(NULL), mode(motion_blend_override), timeSec(0.0f), weight(1.0f)
+{
+}
+
+//-------------------------------------------------.
+CMotionBlendPose::CMotionBlendPose ()
+{
+	clear();
+}
+
+void CMotionBlendPose::clear ()
+{
+	pose.clear();
+	morphWeights.clear();
+	values.clear();
+	rates.clear();
+}
+
+//-------------------------------------------------.
+/**
+ * MotionGroupから、ブレンド用のトラックを作成.
+ * @return キーフレームを持つジョイント数.
+ */
+int MotionBlend::setupClip (const MotionUtil::CMotionGroup& motionGroup, const CBoneSkeleton& skeleton, CMotionBlendMorphChannels& morphChannels, CMotionBlendClip& clip)
+{
+	clip.clear();
+	const int keyJointsCou = MotionFK::setupTracks(motionGroup, skeleton, clip.tracks);
+
+	const int morphTracksCou = (int)std::min(motionGroup.morphShapes.size(), std::min(motionGroup.morphTargetIndices.size(), motionGroup.morphKeyFrames.size()));
+	for (int i = 0; i < morphTracksCou; ++i) {
+		const int ch = morphChannels.appendChannel(motionGroup.morphShapes[i], motionGroup.morphTargetIndices[i]);
+		if (ch < 0) continue;
+		clip.morphChannels.push_back(ch);
+		clip.morphKeyFrames.push_back(motionGroup.morphKeyFrames[i]);
+		std::stable_sort(clip.morphKeyFrames.back().begin(), clip.morphKeyFrames.back().end(), m_compareKeyFrameTime);
+	}
+	return keyJointsCou;
+}
+
+/**
+ * レイヤーを下から順に重ねたポーズを計算.
+ * レイヤーごとに、キーフレームの補間、成分ごとの配列への取り出し、ブレンドの順に計算し、最後に変換行列を計算する.
+ */
+bool MotionBlend::evaluate (std::vector<CMotionBlendLayer>& layers, const int morphChannelsCount, CMotionBlendPose& pose, const MOTION_ROTATION_INTERPOLATION interpolation)
+{
+	const CMotionFKTracks* pTracks = NULL;
+	for (size_t i = 0; i < layers.size() && !pTracks; ++i) {
+		if (layers[i].clip) pTracks = &(layers[i].clip->tracks);
+	}
+	if (!pTracks) return false;
+
+	const int n = pTracks->jointsCount;
+	const int channelsCou = std::max(0, morphChannelsCount);
+	if ((int)pose.rates.size() != n) {
+		pose.values.assign(n * blend_values_count, 0.0f);
+		pose.rates.assign(n, 0.0f);
+		pose.pose.offsets.assign(n, sxsdk::vec3(0, 0, 0));
+		pose.pose.rotations.assign(n, sxsdk::quaternion_class::identity);
+	}
+	pose.morphWeights.assign(channelsCou, 0.0f);
+	if (n <= 0) return true;
+
+	// シーケンスOff時の姿勢から始める.
+	float* v = &pose.values[0];
+	std::fill(v, v + blend_value_layer_offset * n, 0.0f);
+	std::fill(v + (blend_value_rot + 3) * n, v + (blend_value_rot + 4) * n, 1.0f);
+
+	float* rates = &pose.rates[0];
+	for (size_t li = 0; li < layers.size(); ++li) {
+		CMotionBlendLayer& layer = layers[li];
+		if (!layer.clip || layer.clip->tracks.jointsCount != n || !(layer.weight > 0.0f)) continue;
+		const CMotionFKTracks& tracks = layer.clip->tracks;
+
+		MotionFK::sampleKeyFrames(tracks, layer.timeSec, layer.samplePose, interpolation);
+
+		// キーフレームを持たないジョイントは、下のレイヤーの結果のままとする.
+		const bool maskF = ((int)layer.jointMask.size() == n);
+		for (int j = 0; j < n; ++j) {
+			const float keyRate = (tracks.keyOffsets[j + 1] > tracks.keyOffsets[j]) ? 1.0f : 0.0f;
+			rates[j] = m_clamp01(layer.weight * (maskF ? layer.jointMask[j] : 1.0f)) * keyRate;
+		}
+		for (int j = 0; j < n; ++j) {
+			const sxsdk::vec3& o = layer.samplePose.offsets[j];
+			const sxsdk::quaternion_class& q = layer.samplePose.rotations[j];
+			v[(blend_value_layer_offset + 0) * n + j] = o.x;
+			v[(blend_value_layer_offset + 1) * n + j] = o.y;
+			v[(blend_value_layer_offset + 2) * n + j] = o.z;
+			v[(blend_value_layer_rot + 0) * n + j] = q.x;
+			v[(blend_value_layer_rot + 1) * n + j] = q.y;
+			v[(blend_value_layer_rot + 2) * n + j] = q.z;
+			v[(blend_value_layer_rot + 3) * n + j] = q.w;
+		}
+
+		if (layer.mode == motion_blend_additive) m_blendAdditive(n, rates, v);
+		else m_blendOverride(n, rates, v);
+
+		m_blendMorphWeights(layer, channelsCou, pose.morphWeights);
+	}
+
+	for (int j = 0; j < n; ++j) {
+		pose.pose.offsets[j] = sxsdk::vec3(v[(blend_value_offset + 0) * n + j], v[(blend_value_offset + 1) * n + j], v[(blend_value_offset + 2) * n + j]);
+		sxsdk::quaternion_class& q = pose.pose.rotations[j];
+		q.x = v[(blend_value_rot + 0) * n + j];
+		q.y = v[(blend_value_rot + 1) * n + j];
+		q.z = v[(blend_value_rot + 2) * n + j];
+		q.w = v[(blend_value_rot + 3) * n + j];
+	}
+	MotionFK::calcMatrices(*pTracks, pose.pose);
+	return true;
+}
+
+/**
+ * 複数のキャラクタのポーズを計算.
+ * キャラクタは互いに独立しているため、キャラクタ単位で並列に計算する.
+ */
+int MotionBlend::evaluateCharacters (std::vector<CMotionBlendCharacter>& characters, const int morphChannelsCount, const MOTION_ROTATION_INTERPOLATION interpolation)
+{
+	CProfileScope profileScope(profile_motion_blend);
+	CTraceScope traceScope("MotionBlend::evaluateCharacters", "characters", (long long)characters.size());
+
+	const int charactersCou = (int)characters.size();
+	std::vector<char> retList(charactersCou, 0);
+	ParallelUtil::parallelFor(charactersCou, [&](const int i) {
+		retList[i] = evaluate(characters[i].layers, morphChannelsCount, characters[i].pose, interpolation) ? 1 : 0;
+	});
+
+	int cou = 0;
+	for (int i = 0; i < charactersCou; ++i) {
+		if (retList[i]) cou++;
+	}
+	return cou;
+}
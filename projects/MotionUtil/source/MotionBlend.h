@@ -0,0 +1,159 @@
+﻿/**
+ * 複数のMotionGroupを重ねたポーズの計算 (レイヤーによるブレンド).
+ * MotionGroupごとにキーフレームのトラック(CMotionBlendClip)を作成し、上書き/加算のレイヤーとして下から順に重ねる.
+ * ブレンドはジョイントの成分ごとの配列で行い、作業用の配列はポーズ(CMotionBlendPose)に保持して使い回す.
+ */
+#ifndef _MOTIONBLEND_H
+#define _MOTIONBLEND_H
+
+#include "GlobalHeader.h"
+#include "MotionData.h"
+#include "MotionFK.h"
+
+#include <vector>
+
+class CBoneSkeleton;
+
+/**
+ * レイヤーの重ね方.
+ */
+enum MOTION_BLEND_MODE {
+	motion_blend_override = 0,				// 下のレイヤーの結果を、レイヤーのウエイト値の割合で置き換える.
+	motion_blend_additive,					// 下のレイヤーの結果に、レイヤーの値(差分)をウエイト値の割合で加える.
+};
+
+/**
+ * Morph Targetsのウエイト値のチャンネル (対象形状とTarget番号の組み合わせ).
+ * 複数のMotionGroupで同じ組み合わせのトラックは、同じチャンネルにブレンドされる.
+ */
+class CMotionBlendMorphChannels
+{
+public:
+	std::vector<sxsdk::shape_class *> shapes;		// チャンネルごとの対象形状.
+	std::vector<void *> shapeHandles;				// チャンネルごとの対象形状のハンドル.
+	std::vector<int> targetIndices;					// チャンネルごとのTarget番号.
+
+public:
+	CMotionBlendMorphChannels ();
+
+	void clear ();
+
+	/**
+	 * チャンネル数.
+	 */
+	int getChannelsCount () const { return (int)targetIndices.size(); }
+
+	/**
+	 * 対象形状とTarget番号のチャンネル番号を取得 (ない場合は追加する).
+	 * @return チャンネル番号 (形状がNULLの場合は-1).
+	 */
+	int appendChannel (sxsdk::shape_class* shape, const int targetIndex);
+
+	/**
+	 * 対象形状とTarget番号のチャンネル番号.
+	 * @return チャンネル番号 (ない場合は-1).
+	 */
+	int findChannel (sxsdk::shape_class* shape, const int targetIndex) const;
+};
+
+/**
+ * 1つのMotionGroupのキーフレームのトラック.
+ */
+class CMotionBlendClip
+{
+public:
+	CMotionFKTracks tracks;											// ジョイントごとのトラック.
+	std::vector<int> morphChannels;									// Morph Targetsのトラックごとのチャンネル番号.
+	std::vector< std::vector<MotionUtil::CMotionGroupKeyFrameMorphTargets> > morphKeyFrames;	// Morph Targetsのトラックごとのキーフレーム (時間順).
+
+public:
+	CMotionBlendClip ();
+
+	void clear ();
+};
+
+/**
+ * ブレンドするレイヤー.
+ */
+class CMotionBlendLayer
+{
+public:
+	const CMotionBlendClip* clip;			// レイヤーのトラック (NULLの場合はレイヤーを使用しない).
+	MOTION_BLEND_MODE mode;					// 重ね方.
+	float timeSec;							// トラックでの秒単位の時間.
+	float weight;							// レイヤーのウエイト値 (0.0 - 1.0).
+	std::vector<float> jointMask;			// ジョイントごとのウエイト値の倍率 (空の場合はすべて1.0).
+	std::vector<float> morphMask;			// Morph Targetsのチャンネルごとのウエイト値の倍率 (空の場合はすべて1.0).
+
+	CMotionFKPose samplePose;				// キーフレームの補間結果 (作業用、キーフレームの検索位置を保持する).
+
+public:
+	CMotionBlendLayer ();
+};
+
+/**
+ * ブレンドしたポーズ.
+ */
+class CMotionBlendPose
+{
+public:
+	CMotionFKPose pose;						// ジョイントごとのOffset値、Rotation値、変換行列.
+	std::vector<float> morphWeights;		// Morph Targetsのチャンネルごとのウエイト値.
+
+	std::vector<float> values;				// 成分ごとのブレンド結果とレイヤーの値 (作業用).
+	std::vector<float> rates;				// ジョイントごとのレイヤーの割合 (作業用).
+
+public:
+	CMotionBlendPose ();
+
+	void clear ();
+};
+
+/**
+ * 1つのキャラクタのレイヤーとポーズ (複数キャラクタをまとめて計算する場合に使用).
+ */
+class CMotionBlendCharacter
+{
+public:
+	std::vector<CMotionBlendLayer> layers;	// 下から順のレイヤー.
+	CMotionBlendPose pose;					// ブレンドしたポーズ.
+};
+
+namespace MotionBlend
+{
+	/**
+	 * MotionGroupから、ブレンド用のトラックを作成.
+	 * @param[in]     motionGroup    キーフレームを持つMotionGroup.
+	 * @param[in]     skeleton       ボーン階層 (ブレンドするすべてのトラックで同じボーン階層を使用すること).
+	 * @param[in,out] morphChannels  Morph Targetsのチャンネル (MotionGroupのトラックの対象がない場合は追加される).
+	 * @param[out]    clip           ブレンド用のトラック.
+	 * @return キーフレームを持つジョイント数.
+	 */
+	int setupClip (const MotionUtil::CMotionGroup& motionGroup, const CBoneSkeleton& skeleton, CMotionBlendMorphChannels& morphChannels, CMotionBlendClip& clip);
+
+	/**
+	 * レイヤーを下から順に重ねたポーズを計算.
+	 * シーケンスOff時の姿勢(移動なし、回転なし)とウエイト値0.0から始め、レイヤーごとにキーフレームを持つジョイントとチャンネルのみをブレンドする.
+	 * 上書きはOffset値とウエイト値を線形補間、Rotation値を正規化した線形補間とし、
+	 * 加算はOffset値とウエイト値を加え、Rotation値は単位クォータニオンから割合分だけ補間した回転を下のレイヤーの回転の前(ジョイントのローカル)に掛ける.
+	 * 呼び出しの間でメモリの確保を行わないよう、レイヤーとポーズは使い回すこと.
+	 * @param[in,out] layers              下から順のレイヤー (先頭のトラックとジョイント数が異なるレイヤーは使用しない).
+	 * @param[in]     morphChannelsCount  Morph Targetsのチャンネル数.
+	 * @param[out]    pose                ブレンドしたポーズ.
+	 * @param[in]     interpolation       回転の補間方法.
+	 * @return ポーズを計算できた場合はtrue (トラックを持つレイヤーがない場合はfalse).
+	 */
+	bool evaluate (std::vector<CMotionBlendLayer>& layers, const int morphChannelsCount, CMotionBlendPose& pose, const MOTION_ROTATION_INTERPOLATION interpolation = motion_rotation_nlerp);
+
+	/**
+	 * 複数のキャラクタのポーズを計算.
+	 * キャラクタごとに複数スレッドで並列に計算する.
+	 * @param[in,out] characters          キャラクタごとのレイヤーとポーズ.
+	 * @param[in]     morphChannelsCount  Morph Targetsのチャンネル数.
+	 * @param[in]     interpolation       回転の補間方法.
+	 * @return ポーズを計算したキャラクタ数.
+	 */
+	int evaluateCharacters (std::vector<CMotionBlendCharacter>& characters, const int morphChannelsCount, const MOTION_ROTATION_INTERPOLATION interpolation = motion_rotation_nlerp);
+}
+
+#endif
@@ -0,0 +1,405 @@
+﻿/**
+ * streamに保存するMotionGroupのキーフレームの量子化/展開.
+ */
+#include "MotionCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+/*
+	トラックごとのバイト列の構成 (整数はリトルエンディアン).
+	[ボーン/ボールジョイント]
+		[キーフレームの時間]
+		float    offsetMin[3]            Offset値の範囲の最小値.
+		float    offsetMax[3]            Offset値の範囲の最大値.
+		uint16   offsetX[keysCount]      範囲内を0 - 65535に量子化したOffset値 (成分ごとに並べ、最小値と最大値が同じ成分は省く).
+		uint16   offsetY[keysCount]
+		uint16   offsetZ[keysCount]
+		uint8    rotations[keysCount][6] 最大の成分の番号(2bit)と、残りの3成分(15bitずつ)を詰めた48bit.
+	[Morph Targetsのウエイト値]
+		[キーフレームの時間]
+		float    weightMin               ウエイト値の範囲の最小値.
+		float    weightMax               ウエイト値の範囲の最大値.
+		uint16   weights[keysCount]      範囲内を0 - 65535に量子化したウエイト値 (最小値と最大値が同じ場合は省く).
+	[キーフレームの時間]
+		varint   keysCount
+		varint   mode                    0 : キーフレームごと、1 : 一定間隔.
+		(mode 0)
+		varint   times[keysCount]        1つ前のキーフレームとの時間(1/6000秒単位)の差分をZigZag符号化したもの.
+		(mode 1)
+		varint   startTime               先頭のキーフレームの時間をZigZag符号化したもの.
+		varint   interval                キーフレームの間隔をZigZag符号化したもの.
+*/
+
+namespace {
+	const float ROTATION_COMPONENT_MAX = 0.70710678f;		// 最大の成分以外の成分の絶対値の最大 (1/√2).
+
+	const unsigned int MAX_TRACK_KEYS_COUNT = 1 << 24;		// 1つのトラックのキーフレーム数の上限 (不正なバイト列での過大な確保を防ぐ).
+
+	/**
+	 * キーフレームの時間の格納方法.
+	 */
+	enum MOTION_CODEC_TIME_MODE {
+		motion_codec_time_delta = 0,						// キーフレームごとに差分を格納.
+		motion_codec_time_uniform,							// 先頭の時間と間隔のみを格納.
+	};
+
+	inline unsigned int m_zigzag (const int d)
+	{
+		return ((unsigned int)d << 1) ^ (0u - ((unsigned int)d >> 31));
+	}
+
+	inline int m_unzigzag (const unsigned int v)
+	{
+		return (int)((v >> 1) ^ (0u - (v & 1)));
+	}
+
+	inline void m_writeUInt16 (unsigned char* p, const unsigned int v)
+	{
+		p[0] = (unsigned char)(v & 0xff);
+		p[1] = (unsigned char)((v >> 8) & 0xff);
+	}
+
+	inline unsigned int m_readUInt16 (const unsigned char* p)
+	{
+		return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+	}
+
+	inline void m_writeFloat (unsigned char* p, const float v)
+	{
+		unsigned int bits;
+		memcpy(&bits, &v, sizeof(float));
+		for (int i = 0; i < 4; ++i) p[i] = (unsigned char)((bits >> (i * 8)) & 0xff);
+	}
+
+	inline float m_readFloat (const unsigned char* p)
+	{
+		const unsigned int bits = (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+		float v;
+		memcpy(&v, &bits, sizeof(float));
+		return v;
+	}
+
+	/**
+	 * 範囲内の値を16bitに量子化.
+	 */
+	inline unsigned int m_quantize16 (const float v, const float minV, const float scale)
+	{
+		return (unsigned int)std::min(65535, std::max(0, (int)std::floor((v - minV) * scale + 0.5f)));
+	}
+
+	/**
+	 * キーフレームの時間を書き込み.
+	 * モーションキャプチャのように一定間隔の場合は、先頭の時間と間隔のみを格納する.
+	 */
+	template<typename T> void m_encodeTimes (const std::vector<T>& keyFrames, std::vector<unsigned char>& dst)
+	{
+		const int keysCou = (int)keyFrames.size();
+		std::vector<int> ticks(keysCou);
+		for (int i = 0; i < keysCou; ++i) {
+			const double tick = std::floor((double)keyFrames[i].timeSec * (double)MotionCodec::TIME_TICKS_PER_SEC + 0.5);
+			ticks[i] = (int)std::min(1073741823.0, std::max(-1073741823.0, tick));
+		}
+		bool uniformF = (keysCou >= 2);
+		for (int i = 2; i < keysCou && uniformF; ++i) {
+			if (ticks[i] - ticks[i - 1] != ticks[1] - ticks[0]) uniformF = false;
+		}
+
+		MotionCodec::writeVarint(dst, (unsigned int)keysCou);
+		MotionCodec::writeVarint(dst, uniformF ? (unsigned int)motion_codec_time_uniform : (unsigned int)motion_codec_time_delta);
+		if (uniformF) {
+			MotionCodec::writeVarint(dst, m_zigzag(ticks[0]));
+			MotionCodec::writeVarint(dst, m_zigzag(ticks[1] - ticks[0]));
+		} else {
+			int prevTick = 0;
+			for (int i = 0; i < keysCou; ++i) {
+				MotionCodec::writeVarint(dst, m_zigzag(ticks[i] - prevTick));
+				prevTick = ticks[i];
+			}
+		}
+	}
+
+	/**
+	 * キーフレームの時間を読み込み.
+	 * @param[in] keyBytes  キーフレームごとの、時間以外の最小のバイト数 (キーフレーム数の範囲チェック用).
+	 */
+	template<typename T> bool m_decodeTimes (const unsigned char* src, const int size, int& pos, const int keyBytes, std::vector<T>& keyFrames)
+	{
+		unsigned int keysCou, mode;
+		if (!MotionCodec::readVarint(src, size, pos, keysCou)) return false;
+		if (!MotionCodec::readVarint(src, size, pos, mode)) return false;
+		if (mode != (unsigned int)motion_codec_time_delta && mode != (unsigned int)motion_codec_time_uniform) return false;
+		if (keysCou > MAX_TRACK_KEYS_COUNT) return false;
+		if (keyBytes > 0 && keysCou > (unsigned int)(size - pos) / (unsigned int)keyBytes) return false;
+		if (mode == (unsigned int)motion_codec_time_delta && keysCou > (unsigned int)(size - pos)) return false;
+
+		keyFrames.resize(keysCou);
+		if (mode == (unsigned int)motion_codec_time_uniform) {
+			unsigned int startTick, interval;
+			if (!MotionCodec::readVarint(src, size, pos, startTick)) return false;
+			if (!MotionCodec::readVarint(src, size, pos, interval)) return false;
+			const double start = (double)m_unzigzag(startTick);
+			const double step  = (double)m_unzigzag(interval);
+			for (unsigned int i = 0; i < keysCou; ++i) {
+				keyFrames[i].timeSec = (float)((start + step * (double)i) / (double)MotionCodec::TIME_TICKS_PER_SEC);
+			}
+		} else {
+			int tick = 0;
+			for (unsigned int i = 0; i < keysCou; ++i) {
+				unsigned int d;
+				if (!MotionCodec::readVarint(src, size, pos, d)) return false;
+				tick += m_unzigzag(d);
+				keyFrames[i].timeSec = (float)((double)tick / (double)MotionCodec::TIME_TICKS_PER_SEC);
+			}
+		}
+		return true;
+	}
+}
+
+/**
+ * 符号なし整数を可変長整数(7ビットごと)としてdstの末尾に追加.
+ */
+void MotionCodec::writeVarint (std::vector<unsigned char>& dst, unsigned int v)
+{
+	while (v >= 0x80) {
+		dst.push_back((unsigned char)(v | 0x80));
+		v >>= 7;
+	}
+	dst.push_back((unsigned char)v);
+}
+
+/**
+ * 可変長整数を読み込み.
+ */
+bool MotionCodec::readVarint (const unsigned char* src, const int size, int& pos, unsigned int& v)
+{
+	v = 0;
+	for (int shift = 0; shift < 35 && pos < size; shift += 7) {
+		const unsigned char c = src[pos++];
+		v |= (unsigned int)(c & 0x7f) << shift;
+		if (!(c & 0x80)) return true;
+	}
+	return false;
+}
+
+/**
+ * Rotation値を48bitに量子化.
+ */
+void MotionCodec::packRotation (const sxsdk::quaternion_class& q, unsigned char* dst)
+{
+	float v[4] = {q.x, q.y, q.z, q.w};
+	const float len = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
+	if (len > 0.0f) {
+		for (int i = 0; i < 4; ++i) v[i] /= len;
+	} else {
+		v[0] = v[1] = v[2] = 0.0f;
+		v[3] = 1.0f;
+	}
+
+	int maxIndex = 0;
+	for (int i = 1; i < 4; ++i) {
+		if (std::abs(v[i]) > std::abs(v[maxIndex])) maxIndex = i;
+	}
+	const float sign = (v[maxIndex] < 0.0f) ? -1.0f : 1.0f;
+
+	unsigned long long bits = (unsigned long long)maxIndex;
+	int shift = 2;
+	for (int i = 0; i < 4; ++i) {
+		if (i == maxIndex) continue;
+		const float c = v[i] * sign;
+		const int qc = std::min(32767, std::max(0, (int)std::floor((c / ROTATION_COMPONENT_MAX + 1.0f) * 0.5f * 32767.0f + 0.5f)));
+		bits |= (unsigned long long)qc << shift;
+		shift += 15;
+	}
+	for (int i = 0; i < PACKED_ROTATION_SIZE; ++i) dst[i] = (unsigned char)((bits >> (i * 8)) & 0xff);
+}
+
+/**
+ * 量子化したRotation値を展開 (正規化済み).
+ */
+sxsdk::quaternion_class MotionCodec::unpackRotation (const unsigned char* src)
+{
+	unsigned long long bits = 0;
+	for (int i = 0; i < PACKED_ROTATION_SIZE; ++i) bits |= (unsigned long long)src[i] << (i * 8);
+
+	const int maxIndex = (int)(bits & 3);
+	float v[4];
+	float sum2 = 0.0f;
+	int shift = 2;
+	for (int i = 0; i < 4; ++i) {
+		if (i == maxIndex) continue;
+		const int qc = (int)((bits >> shift) & 0x7fff);
+		v[i] = ((float)qc / 32767.0f * 2.0f - 1.0f) * ROTATION_COMPONENT_MAX;
+		sum2 += v[i] * v[i];
+		shift += 15;
+	}
+	v[maxIndex] = std::sqrt(std::max(0.0f, 1.0f - sum2));
+
+	// 量子化の誤差で長さが1.0を超える場合があるため正規化する.
+	const float len = std::sqrt(sum2 + v[maxIndex] * v[maxIndex]);
+	sxsdk::quaternion_class q = sxsdk::quaternion_class::identity;
+	q.x = v[0] / len;
+	q.y = v[1] / len;
+	q.z = v[2] / len;
+	q.w = v[3] / len;
+	return q;
+}
+
+/**
+ * ボーン/ボールジョイントのキーフレームを量子化してdstの末尾に追加.
+ */
+void MotionCodec::encodeJointKeyFrames (const std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>& keyFrames, std::vector<unsigned char>& dst)
+{
+	const int keysCou = (int)keyFrames.size();
+	m_encodeTimes(keyFrames, dst);
+
+	float minV[3] = {0.0f, 0.0f, 0.0f};
+	float maxV[3] = {0.0f, 0.0f, 0.0f};
+	for (int i = 0; i < keysCou; ++i) {
+		const float v[3] = {keyFrames[i].offset.x, keyFrames[i].offset.y, keyFrames[i].offset.z};
+		for (int j = 0; j < 3; ++j) {
+			minV[j] = (i == 0) ? v[j] : std::min(minV[j], v[j]);
+			maxV[j] = (i == 0) ? v[j] : std::max(maxV[j], v[j]);
+		}
+	}
+	int axesCou = 0;
+	for (int j = 0; j < 3; ++j) {
+		if (maxV[j] > minV[j]) axesCou++;
+	}
+
+	// 固定長の部分はまとめて確保して書き込む.
+	const size_t top = dst.size();
+	dst.resize(top + 24 + (size_t)keysCou * (axesCou * 2 + PACKED_ROTATION_SIZE));
+	unsigned char* p = &dst[top];
+	for (int j = 0; j < 3; ++j) m_writeFloat(p + j * 4, minV[j]);
+	for (int j = 0; j < 3; ++j) m_writeFloat(p + 12 + j * 4, maxV[j]);
+	p += 24;
+
+	for (int j = 0; j < 3; ++j) {
+		if (!(maxV[j] > minV[j])) continue;
+		const float scale = 65535.0f / (maxV[j] - minV[j]);
+		for (int i = 0; i < keysCou; ++i, p += 2) {
+			const sxsdk::vec3& o = keyFrames[i].offset;
+			m_writeUInt16(p, m_quantize16((j == 0) ? o.x : ((j == 1) ? o.y : o.z), minV[j], scale));
+		}
+	}
+	for (int i = 0; i < keysCou; ++i, p += PACKED_ROTATION_SIZE) {
+		packRotation(keyFrames[i].rotation, p);
+	}
+}
+
+/**
+ * ボーン/ボールジョイントのキーフレームを展開.
+ * @return バイト列が不正な場合はfalse.
+ */
+bool MotionCodec::decodeJointKeyFrames (const unsigned char* src, const int size, int& pos, std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>& keyFrames)
+{
+	keyFrames.clear();
+	if (!m_decodeTimes(src, size, pos, PACKED_ROTATION_SIZE, keyFrames)) return false;
+	const int keysCou = (int)keyFrames.size();
+	if (size - pos < 24) {
+		keyFrames.clear();
+		return false;
+	}
+
+	float minV[3], stepV[3];
+	int axesCou = 0;
+	for (int j = 0; j < 3; ++j) {
+		minV[j] = m_readFloat(src + pos + j * 4);
+		const float maxV = m_readFloat(src + pos + 12 + j * 4);
+		stepV[j] = (maxV > minV[j]) ? ((maxV - minV[j]) / 65535.0f) : 0.0f;
+		if (maxV > minV[j]) axesCou++;
+	}
+	pos += 24;
+	const int keyBytes = axesCou * 2 + PACKED_ROTATION_SIZE;
+	if ((size - pos) / keyBytes < keysCou) {
+		keyFrames.clear();
+		return false;
+	}
+
+	// 範囲が0の成分は格納されていないため、最小値で埋める.
+	const unsigned char* pAxes[3];
+	const unsigned char* p = src + pos;
+	for (int j = 0; j < 3; ++j) {
+		if (stepV[j] > 0.0f) {
+			pAxes[j] = p;
+			p += keysCou * 2;
+		} else {
+			pAxes[j] = NULL;
+		}
+	}
+	const unsigned char* pR = p;
+	for (int i = 0; i < keysCou; ++i) {
+		MotionUtil::CMotionGroupKeyFrameBallBoneJoint& key = keyFrames[i];
+		float v[3];
+		for (int j = 0; j < 3; ++j) {
+			v[j] = pAxes[j] ? (minV[j] + (float)m_readUInt16(pAxes[j] + i * 2) * stepV[j]) : minV[j];
+		}
+		key.type = MotionUtil::keyframe_type_ball_bone_joint;
+		key.offset = sxsdk::vec3(v[0], v[1], v[2]);
+		key.rotation = unpackRotation(pR + i * PACKED_ROTATION_SIZE);
+	}
+	pos += keysCou * keyBytes;
+	return true;
+}
+
+/**
+ * Morph Targetsのウエイト値のキーフレームを量子化してdstの末尾に追加.
+ */
+void MotionCodec::encodeMorphKeyFrames (const std::vector<MotionUtil::CMotionGroupKeyFrameMorphTargets>& keyFrames, std::vector<unsigned char>& dst)
+{
+	const int keysCou = (int)keyFrames.size();
+	m_encodeTimes(keyFrames, dst);
+
+	float minV = 0.0f, maxV = 0.0f;
+	for (int i = 0; i < keysCou; ++i) {
+		minV = (i == 0) ? keyFrames[i].weight : std::min(minV, keyFrames[i].weight);
+		maxV = (i == 0) ? keyFrames[i].weight : std::max(maxV, keyFrames[i].weight);
+	}
+	const bool rangeF = (maxV > minV);
+
+	const size_t top = dst.size();
+	dst.resize(top + 8 + (rangeF ? (size_t)keysCou * 2 : 0));
+	unsigned char* p = &dst[top];
+	m_writeFloat(p, minV);
+	m_writeFloat(p + 4, maxV);
+	p += 8;
+	if (!rangeF) return;
+
+	const float scale = 65535.0f / (maxV - minV);
+	for (int i = 0; i < keysCou; ++i, p += 2) m_writeUInt16(p, m_quantize16(keyFrames[i].weight, minV, scale));
+}
+
+/**
+ * Morph Targetsのウエイト値のキーフレームを展開.
+ * @return バイト列が不正な場合はfalse.
+ */
+bool MotionCodec::decodeMorphKeyFrames (const unsigned char* src, const int size, int& pos, std::vector<MotionUtil::CMotionGroupKeyFrameMorphTargets>& keyFrames)
+{
+	keyFrames.clear();
+	if (!m_decodeTimes(src, size, pos, 0, keyFrames)) return false;
+	const int keysCou = (int)keyFrames.size();
+	if (size - pos < 8) {
+		keyFrames.clear();
+		return false;
+	}
+
+	const float minV = m_readFloat(src + pos);
+	const float maxV = m_readFloat(src + pos + 4);
+	const bool rangeF = (maxV > minV);
+	pos += 8;
+	if (rangeF && (size - pos) / 2 < keysCou) {
+		keyFrames.clear();
+		return false;
+	}
+
+	const float stepV = rangeF ? ((maxV - minV) / 65535.0f) : 0.0f;
+	for (int i = 0; i < keysCou; ++i) {
+		MotionUtil::CMotionGroupKeyFrameMorphTargets& key = keyFrames[i];
+		key.type = MotionUtil::keyframe_type_morph_targets;
+		key.weight = rangeF ? (minV + (float)m_readUInt16(src + pos + i * 2) * stepV) : minV;
+	}
+	if (rangeF) pos += keysCou * 2;
+	return true;
+}
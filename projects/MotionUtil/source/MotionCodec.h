@@ -0,0 +1,73 @@
+﻿/**
+ * streamに保存するMotionGroupのキーフレームの量子化/展開.
+ * キーフレームの時間は1/6000秒単位の整数の差分をZigZag符号化した可変長整数 (一定間隔の場合は先頭と間隔のみ)、
+ * Offset値とMorph Targetsのウエイト値はトラックごとの範囲で16bitに量子化、
+ * Rotation値は最大の成分を除く3成分を15bitずつに量子化する (smallest three, 48bit).
+ */
+#ifndef _MOTIONCODEC_H
+#define _MOTIONCODEC_H
+
+#include "GlobalHeader.h"
+#include "MotionData.h"
+
+#include <vector>
+
+namespace MotionCodec
+{
+	const int TIME_TICKS_PER_SEC = 6000;		// キーフレームの時間の単位 (24/25/30/60/120fpsのフレーム位置を誤差なく表せる).
+	const int PACKED_ROTATION_SIZE = 6;			// 量子化したRotation値のバイト数.
+
+	/**
+	 * Rotation値を48bitに量子化.
+	 * 正規化し、最大の成分が正となるよう符号をそろえる (qと-qは同じ回転).
+	 * @param[in]  q    Rotation値.
+	 * @param[out] dst  PACKED_ROTATION_SIZEバイト.
+	 */
+	void packRotation (const sxsdk::quaternion_class& q, unsigned char* dst);
+
+	/**
+	 * 量子化したRotation値を展開 (正規化済み).
+	 */
+	sxsdk::quaternion_class unpackRotation (const unsigned char* src);
+
+	/**
+	 * ボーン/ボールジョイントのキーフレームを量子化してdstの末尾に追加.
+	 * @param[in]  keyFrames  時間順のキーフレーム.
+	 * @param[out] dst        量子化したバイト列が追加される.
+	 */
+	void encodeJointKeyFrames (const std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>& keyFrames, std::vector<unsigned char>& dst);
+
+	/**
+	 * ボーン/ボールジョイントのキーフレームを展開.
+	 * @param[in]     src        量子化したバイト列.
+	 * @param[in]     size       srcのバイト数.
+	 * @param[in,out] pos        読み込み位置 (読み込んだ分だけ進む).
+	 * @param[out]    keyFrames  キーフレーム.
+	 * @return バイト列が不正な場合はfalse.
+	 */
+	bool decodeJointKeyFrames (const unsigned char* src, const int size, int& pos, std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>& keyFrames);
+
+	/**
+	 * Morph Targetsのウエイト値のキーフレームを量子化してdstの末尾に追加.
+	 */
+	void encodeMorphKeyFrames (const std::vector<MotionUtil::CMotionGroupKeyFrameMorphTargets>& keyFrames, std::vector<unsigned char>& dst);
+
+	/**
+	 * Morph Targetsのウエイト値のキーフレームを展開.
+	 * @return バイト列が不正な場合はfalse.
+	 */
+	bool decodeMorphKeyFrames (const unsigned char* src, const int size, int& pos, std::vector<MotionUtil::CMotionGroupKeyFrameMorphTargets>& keyFrames);
+
+	/**
+	 * 符号なし整数を可変長整数(7ビットごと)としてdstの末尾に追加.
+	 */
+	void writeVarint (std::vector<unsigned char>& dst, unsigned int v);
+
+	/**
+	 * 可変長整数を読み込み.
+	 * @return バイト列が不正な場合はfalse.
+	 */
+	bool readVarint (const unsigned char* src, const int size, int& pos, unsigned int& v);
+}
+
+#endif
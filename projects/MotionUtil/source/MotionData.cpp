@@ -44,4 +44,35 @@ void MotionUtil::CMotionGroupKeyFrameMorphTargets::clear ()
 //------------------------------------------------------------------.
 MotionUtil::CMotionGroup::CMotionGroup ()
 {
+}
+
+void MotionUtil::CMotionGroup::clear ()
+{
+	shapes.clear();
+	jointKeyFrames.clear();
+	morphShapes.clear();
+	morphTargetIndices.clear();
+	morphKeyFrames.clear();
+}
+
+//------------------------------------------------------------------.
+/**
+ * Morph Targetsのウエイト値のキーフレームから、指定の時間でのウエイト値を線形補間で計算.
+ */
+float MotionUtil::evaluateMorphWeight (const std::vector<CMotionGroupKeyFrameMorphTargets>& keyFrames, const float timeSec)
+{
+	const int keysCou = (int)keyFrames.size();
+	if (keysCou == 0) return 0.0f;
+	if (timeSec <= keyFrames[0].timeSec) return keyFrames[0].weight;
+	if (timeSec >= keyFrames[keysCou - 1].timeSec) return keyFrames[keysCou - 1].weight;
+
+	// keyFrames[k].timeSec <= timeSec < keyFrames[k + 1].timeSec となるk.
+	int k0 = 0, k1 = keysCou - 1;
+	while (k1 - k0 > 1) {
+		const int k = (k0 + k1) / 2;
+		if (keyFrames[k].timeSec <= timeSec) k0 = k;
+		else k1 = k;
+	}
+	const float rate = (timeSec - keyFrames[k0].timeSec) / (keyFrames[k1].timeSec - keyFrames[k0].timeSec);
+	return keyFrames[k0].weight + (keyFrames[k1].weight - keyFrames[k0].weight) * rate;
 }
\ No newline at end of file
@@ -72,10 +72,26 @@ namespace MotionUtil
 	public:
 		std::vector<sxsdk::shape_class *> shapes;		// 対象のボーン/ボールジョイント形状.
 														// shapes[0]のジョイントの子が格納される.
+		std::vector< std::vector<CMotionGroupKeyFrameBallBoneJoint> > jointKeyFrames;	// shapesごとのキーフレーム (時間順).
+
+		std::vector<sxsdk::shape_class *> morphShapes;	// Morph Targetsのウエイト値のトラックの対象形状.
+		std::vector<int> morphTargetIndices;			// morphShapesごとのTarget番号.
+		std::vector< std::vector<CMotionGroupKeyFrameMorphTargets> > morphKeyFrames;	// morphShapesごとのキーフレーム (時間順).
 
 	public:
 		CMotionGroup ();
+
+		void clear ();
 	};
+
+	/**
+	 * Morph Targetsのウエイト値のキーフレームから、指定の時間でのウエイト値を線形補間で計算.
+	 * キーフレームの範囲外の時間は、先頭または末尾のキーフレームの値となる.
+	 * @param[in] keyFrames  時間順のキーフレーム.
+	 * @param[in] timeSec    秒単位の時間.
+	 * @return ウエイト値 (キーフレームがない場合は0.0).
+	 */
+	float evaluateMorphWeight (const std::vector<CMotionGroupKeyFrameMorphTargets>& keyFrames, const float timeSec);
 }
 
 
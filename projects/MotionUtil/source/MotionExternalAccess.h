@@ -39,6 +39,25 @@ public:
 	}
 };
 
+/**
+ * 処理時間の計測結果 (クラスバージョン0x002 - ).
+ */
+class CProfileCounterData {
+public:
+	char name[64];				// 計測対象の処理名.
+	long long calls;			// 呼び出し回数.
+	long long bytes;			// 入出力のバイト数.
+	double totalTime;			// 処理時間の合計 (ミリ秒).
+	double maxTime;				// 1回の呼び出しの最大処理時間 (ミリ秒).
+
+public:
+	CProfileCounterData () {
+		name[0] = '\0';
+		calls = bytes = 0;
+		totalTime = maxTime = 0.0;
+	}
+};
+
 //----------------------------------------------------------------------.
 /**
  * ボーン機能へのアクセス.
@@ -74,6 +93,46 @@ public:
 	 * クラスバージョンを取得 (ver.0.0.0.4 - ).
 	 */
 	virtual int getVersion () = 0;
+
+	//---------------------------------------------------------------.
+	// ボーン階層の一括取得 (クラスバージョン0x002 - ).
+	//---------------------------------------------------------------.
+	/**
+	 * ボーンルート以下のすべてのボーンの情報を、親から子の順(深さ優先)で取得.
+	 * ボーン階層は1度だけたどるため、ボーンごとにgetBoneCenterを呼ぶよりも高速.
+	 * ボーン以外の形状とその子は含まない。各配列はmaxCount以上の要素数を確保し、NULLの場合は返さない.
+	 * @param[in]  boneRoot       対象のボーンルート.
+	 * @param[in]  maxCount       配列に格納する最大数 (0の場合はボーン数のみを返す).
+	 * @param[out] shapeHandles   形状のハンドルが返る.
+	 * @param[out] parentIndices  親ボーンの番号が返る (ボーンルートの場合は-1).
+	 * @param[out] centers        シーケンスOff時のワールド座標での中心位置が返る.
+	 * @param[out] sizes          ボーンサイズが返る.
+	 * @param[out] axisDirs       ワールド座標でのボーンの向き(正規化済み)が返る.
+	 * @return ボーン数 (maxCountより多い場合も、ボーン数を返す).
+	 */
+	virtual int getBonesHierarchy (sxsdk::shape_class* boneRoot, const int maxCount, void** shapeHandles, int* parentIndices, sxsdk::vec3* centers, float* sizes, sxsdk::vec3* axisDirs) = 0;
+
+	//---------------------------------------------------------------.
+	// スキンのウエイト値の一括取得 (クラスバージョン0x002 - ).
+	//---------------------------------------------------------------.
+	/**
+	 * ポリゴンメッシュのスキンのウエイト値を、頂点ごとにmaxInfluences個の固定形式で取得.
+	 * バインド情報は1度だけ読み込み、ウエイト値の大きい順にmaxInfluences個を残す.
+	 * 影響がmaxInfluences個未満の頂点は、ボーン番号0/ウエイト値0で埋める.
+	 * 頂点数が分からない場合は、maxVerticesを0にして頂点数を取得してから配列を確保すること.
+	 * @param[in]  shape           対象のポリゴンメッシュ.
+	 * @param[in]  maxInfluences   頂点ごとの影響数.
+	 * @param[in]  normalizeToOne  ウエイト値の合計を1.0にする (falseの場合は、省く前の合計に合わせる).
+	 * @param[in]  maxVertices     jointIndices/weightsに格納する最大の頂点数 (配列はmaxVertices x maxInfluences個以上の要素数を確保する。0の場合は頂点数のみを返す).
+	 * @param[in]  maxJoints       jointHandlesに格納する最大数.
+	 * @param[out] jointHandles    ボーン番号ごとのボーン形状のハンドルが返る (NULLの場合は返さない).
+	 * @param[out] jointsCount     影響するボーン数が返る.
+	 * @param[out] jointIndices    頂点ごとのボーン番号が返る (min(頂点数, maxVertices) x maxInfluences個、NULLの場合は返さない).
+	 * @param[out] weights         頂点ごとのウエイト値が返る (min(頂点数, maxVertices) x maxInfluences個、NULLの場合は返さない).
+	 * @param[out] maxWeightError  読み込んだウエイト値に対する誤差の最大が返る.
+	 * @return 頂点数 (maxVerticesより多い場合も、頂点数を返す。スキンを持たない場合は0).
+	 */
+	virtual int getSkinWeights (sxsdk::shape_class& shape, const int maxInfluences, const bool normalizeToOne, const int maxVertices, const int maxJoints, void** jointHandles, int* jointsCount, int* jointIndices, float* weights, float* maxWeightError) = 0;
 };
 
 //----------------------------------------------------------------------.
@@ -243,6 +302,171 @@ public:
 	 * クラスバージョンを取得 (ver.0.0.0.4 - ).
 	 */
 	virtual int getVersion () = 0;
+
+	//---------------------------------------------------------------.
+	// 処理時間の計測用 (クラスバージョン0x002 - ).
+	//---------------------------------------------------------------.
+	/**
+	 * 処理時間の計測の有効/無効を指定.
+	 */
+	virtual void setProfileEnabled (const bool enabled) = 0;
+
+	/**
+	 * 処理時間の計測が有効か.
+	 */
+	virtual bool isProfileEnabled () = 0;
+
+	/**
+	 * 計測結果をクリア.
+	 */
+	virtual void resetProfileCounters () = 0;
+
+	/**
+	 * 計測対象の処理の数を取得.
+	 */
+	virtual int getProfileCountersCount () = 0;
+
+	/**
+	 * 計測結果を取得.
+	 * @param[in]  index   計測対象の番号 (0 - getProfileCountersCount() - 1).
+	 * @param[out] data    計測結果が返る.
+	 */
+	virtual bool getProfileCounter (const int index, CProfileCounterData* data) = 0;
+
+	/**
+	 * 計測結果をJSON形式でファイルに出力.
+	 * @param[in] fileName  出力ファイル名 (UTF-8).
+	 */
+	virtual bool writeProfileJSON (const char* fileName) = 0;
+
+	//---------------------------------------------------------------.
+	// 処理のタイムラインの記録用 (クラスバージョン0x002 - ).
+	//---------------------------------------------------------------.
+	/**
+	 * タイムラインの記録の有効/無効を指定.
+	 */
+	virtual void setTraceEnabled (const bool enabled) = 0;
+
+	/**
+	 * タイムラインの記録が有効か.
+	 */
+	virtual bool isTraceEnabled () = 0;
+
+	/**
+	 * 記録済みのイベントをクリア.
+	 */
+	virtual void clearTrace () = 0;
+
+	/**
+	 * 記録したイベントをChrome trace形式(JSON)でファイルに出力.
+	 * @param[in] fileName  出力ファイル名 (UTF-8).
+	 */
+	virtual bool writeTraceJSON (const char* fileName) = 0;
+
+	//---------------------------------------------------------------.
+	// streamへの保存形式 (クラスバージョン0x002 - ).
+	//---------------------------------------------------------------.
+	/**
+	 * writeMorphTargetsDataでstreamに保存する際に、頂点を圧縮するか指定.
+	 * readMorphTargetsDataで読み込んだ場合は、読み込んだstreamの指定となる.
+	 */
+	virtual void setStreamCompressed (const bool compressed) = 0;
+
+	/**
+	 * streamに保存する際に、頂点を圧縮するか.
+	 */
+	virtual bool isStreamCompressed () = 0;
+
+	//---------------------------------------------------------------.
+	// シーン内のMorph Targets情報を持つ形状 (クラスバージョン0x002 - ).
+	//---------------------------------------------------------------.
+	/**
+	 * シーン内のMorph Targets情報を持つ形状の数を取得.
+	 * シーン全体は走査せず、保存時やシーンの変更時に更新される一覧を参照する (削除された形状は除外される).
+	 * 選択されていない形状が、保存を経由せずに(Shade3D側のUNDOなど)Morph Targets情報を持った場合は、シーンを切り替えるまで含まれない.
+	 */
+	virtual int getMorphTargetsShapesCount (sxsdk::scene_interface* scene) = 0;
+
+	/**
+	 * シーン内のMorph Targets情報を持つ形状を取得.
+	 * @param[in]  index   番号 (0 - getMorphTargetsShapesCount() - 1).
+	 * @return 形状。削除された形状の場合はNULL.
+	 */
+	virtual sxsdk::shape_class* getMorphTargetsShape (sxsdk::scene_interface* scene, const int index) = 0;
+
+	/**
+	 * シーン内のMorph Targets情報を持つ形状のTarget数と頂点数を取得 (頂点は読み込まない).
+	 * @param[in]  index              番号 (0 - getMorphTargetsShapesCount() - 1).
+	 * @param[out] targetsCount       Target数が返る.
+	 * @param[out] orgVerticesCount   ベースの頂点数が返る.
+	 */
+	virtual bool getMorphTargetsShapeSummary (sxsdk::scene_interface* scene, const int index, int* targetsCount, int* orgVerticesCount) = 0;
+
+	//---------------------------------------------------------------.
+	// Targetの移動量の統計 (クラスバージョン0x002 - ).
+	//---------------------------------------------------------------.
+	/**
+	 * Morph Targetの、ベースの頂点座標からの移動量の統計を取得.
+	 * 保持している値を返すため、遅延読み込み中でも頂点は読み込まない.
+	 * Targetに含まれる頂点のみで計算した値で、含まれない頂点の移動量0は含まない.
+	 * @param[in]  tIndex          Morph Targets番号.
+	 * @param[out] deltaMin        移動量のバウンディングボックスの最小値が返る.
+	 * @param[out] deltaMax        移動量のバウンディングボックスの最大値が返る.
+	 * @param[out] maxDeltaLength  移動量の長さの最大値が返る.
+	 * @param[out] nonZeroCount    移動量が0でない頂点数が返る.
+	 */
+	virtual bool getTargetDeltaStats (const int tIndex, sxsdk::vec3* deltaMin, sxsdk::vec3* deltaMax, float* maxDeltaLength, int* nonZeroCount) = 0;
+
+	//---------------------------------------------------------------.
+	// 許容誤差を指定したメッシュの更新 (クラスバージョン0x002 - ).
+	//---------------------------------------------------------------.
+	/**
+	 * updateMeshで許容する頂点位置の誤差を指定.
+	 * 省略するTargetの(ウエイト値 x 移動量の長さの最大値)の合計がこの値以下となる範囲で、影響の小さいTargetの計算を省略する.
+	 * 0の場合は省略しない (初期値).
+	 */
+	virtual void setBlendTolerance (const float tolerance) = 0;
+
+	/**
+	 * updateMeshで許容する頂点位置の誤差を取得.
+	 */
+	virtual float getBlendTolerance () = 0;
+
+	/**
+	 * 直前のupdateMeshで、省略したTargetによる頂点位置の誤差の上限を取得.
+	 * @param[out] culledCount   許容誤差により省略したTarget数が返る.
+	 */
+	virtual float getBlendErrorBound (int* culledCount) = 0;
+
+	//---------------------------------------------------------------.
+	// シーン内のメッシュの一括更新 (クラスバージョン0x002 - ).
+	//---------------------------------------------------------------.
+	/**
+	 * シーン内のMorph Targets情報を持つすべての形状のメッシュを、保存されているウエイト値で更新.
+	 * 形状ごとの変形の計算は複数スレッドで並列に行い、結果はスレッド数によらず同じとなる.
+	 * @param[in] checkVerticesModify  頂点の移動や回転を補正.
+	 * @return 頂点座標が変更された形状数.
+	 */
+	virtual int updateSceneMeshes (sxsdk::scene_interface* scene, const bool checkVerticesModify = true) = 0;
+
+	//---------------------------------------------------------------.
+	// UNDO/REDOの履歴 (クラスバージョン0x002 - ).
+	//---------------------------------------------------------------.
+	/**
+	 * Morph Targetsの編集操作のUNDO/REDOの履歴が保持するメモリの上限(バイト数)を指定.
+	 * 上限を下げた場合は、超えた分を古い履歴からすぐに破棄する (初期値は64MB).
+	 */
+	virtual void setUndoMemoryLimit (const long long bytes) = 0;
+
+	/**
+	 * UNDO/REDOの履歴が保持するメモリの上限(バイト数)を取得.
+	 */
+	virtual long long getUndoMemoryLimit () = 0;
+
+	/**
+	 * UNDO/REDOの履歴が現在保持しているメモリ量(バイト数)を取得.
+	 */
+	virtual long long getUndoMemorySize () = 0;
 };
 
 //----------------------------------------------------------------------.
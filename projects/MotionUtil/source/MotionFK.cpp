@@ -0,0 +1,441 @@
+﻿/**
+ * ボーン/ボールジョイントのキーフレームからのポーズの計算 (Forward Kinematics).
+ */
+#include "MotionFK.h"
+#include "BoneSkeleton.h"
+#include "MathUtil.h"
+#include "ParallelUtil.h"
+#include "ProfileUtil.h"
+#include "TraceUtil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace {
+	const int FK_FRAMES_BLOCK_SIZE = 16;		// 1スレッドでまとめて計算する時間の数.
+	const int FK_MIN_PARALLEL_BLOCKS = 2;		// このブロック数未満の場合は、スレッドを使用しない.
+
+	/**
+	 * 成分ごとの補間結果の配列の並び (ジョイント数ずつ).
+	 */
+	enum FK_VALUE_INDEX {
+		fk_value_rot0 = 0,						// 補間元のRotation値 (x, y, z, w). 補間結果もここに格納する.
+		fk_value_rot1 = 4,						// 補間先のRotation値 (x, y, z, w).
+		fk_value_offset0 = 8,					// 補間元のOffset値 (x, y, z). 補間結果もここに格納する.
+		fk_value_offset1 = 11,					// 補間先のOffset値 (x, y, z).
+		fk_values_count = 14,
+	};
+
+	/**
+	 * 時間順に並べるための比較.
+	 */
+	bool m_compareKeyFrameTime (const MotionUtil::CMotionGroupKeyFrameBallBoneJoint& a, const MotionUtil::CMotionGroupKeyFrameBallBoneJoint& b)
+	{
+		return a.timeSec < b.timeSec;
+	}
+
+	/**
+	 * ジョイントごとに、補間するキーフレームの位置と割合を検索.
+	 * 前回の位置かその次の区間に含まれる場合は、二分探索を行わない.
+	 */
+	void m_findKeyFrames (const CMotionFKTracks& tracks, const float timeSec, CMotionFKPose& pose)
+	{
+		const float* keyTimes = tracks.keyTimes.empty() ? NULL : &tracks.keyTimes[0];
+		for (int j = 0; j < tracks.jointsCount; ++j) {
+			const int kBegin = tracks.keyOffsets[j];
+			const int kEnd   = tracks.keyOffsets[j + 1];
+			if (kBegin == kEnd) {
+				pose.keyIndices0[j] = pose.keyIndices1[j] = -1;
+				pose.blendRates[j] = 0.0f;
+				continue;
+			}
+			if (timeSec <= keyTimes[kBegin] || kEnd - kBegin == 1) {
+				pose.keyIndices0[j] = pose.keyIndices1[j] = kBegin;
+				pose.blendRates[j] = 0.0f;
+				continue;
+			}
+			if (timeSec >= keyTimes[kEnd - 1]) {
+				pose.keyIndices0[j] = pose.keyIndices1[j] = kEnd - 1;
+				pose.blendRates[j] = 0.0f;
+				continue;
+			}
+
+			// keyTimes[k] <= timeSec < keyTimes[k + 1] となるk.
+			int k = std::min(std::max(pose.keyCursors[j], kBegin), kEnd - 2);
+			if (!(keyTimes[k] <= timeSec && timeSec < keyTimes[k + 1])) {
+				if (k + 2 < kEnd && keyTimes[k + 1] <= timeSec && timeSec < keyTimes[k + 2]) {
+					k++;
+				} else {
+					k = (int)(std::upper_bound(keyTimes + kBegin, keyTimes + kEnd, timeSec) - keyTimes) - 1;
+				}
+			}
+			pose.keyCursors[j]  = k;
+			pose.keyIndices0[j] = k;
+			pose.keyIndices1[j] = k + 1;
+			pose.blendRates[j]  = (timeSec - keyTimes[k]) / (keyTimes[k + 1] - keyTimes[k]);
+		}
+	}
+
+	/**
+	 * 補間するキーフレームの値を、成分ごとの配列に取り出す.
+	 * キーフレームがないジョイントは、単位クォータニオンと移動なしとする.
+	 */
+	void m_gatherKeyFrames (const CMotionFKTracks& tracks, CMotionFKPose& pose)
+	{
+		const int n = tracks.jointsCount;
+		float* v = &pose.values[0];
+		for (int j = 0; j < n; ++j) {
+			const int k0 = pose.keyIndices0[j];
+			const int k1 = pose.keyIndices1[j];
+			if (k0 < 0) {
+				v[(fk_value_rot0 + 0) * n + j] = v[(fk_value_rot1 + 0) * n + j] = 0.0f;
+				v[(fk_value_rot0 + 1) * n + j] = v[(fk_value_rot1 + 1) * n + j] = 0.0f;
+				v[(fk_value_rot0 + 2) * n + j] = v[(fk_value_rot1 + 2) * n + j] = 0.0f;
+				v[(fk_value_rot0 + 3) * n + j] = v[(fk_value_rot1 + 3) * n + j] = 1.0f;
+				v[(fk_value_offset0 + 0) * n + j] = v[(fk_value_offset1 + 0) * n + j] = 0.0f;
+				v[(fk_value_offset0 + 1) * n + j] = v[(fk_value_offset1 + 1) * n + j] = 0.0f;
+				v[(fk_value_offset0 + 2) * n + j] = v[(fk_value_offset1 + 2) * n + j] = 0.0f;
+				continue;
+			}
+			v[(fk_value_rot0 + 0) * n + j] = tracks.rotX[k0];
+			v[(fk_value_rot0 + 1) * n + j] = tracks.rotY[k0];
+			v[(fk_value_rot0 + 2) * n + j] = tracks.rotZ[k0];
+			v[(fk_value_rot0 + 3) * n + j] = tracks.rotW[k0];
+			v[(fk_value_rot1 + 0) * n + j] = tracks.rotX[k1];
+			v[(fk_value_rot1 + 1) * n + j] = tracks.rotY[k1];
+			v[(fk_value_rot1 + 2) * n + j] = tracks.rotZ[k1];
+			v[(fk_value_rot1 + 3) * n + j] = tracks.rotW[k1];
+			v[(fk_value_offset0 + 0) * n + j] = tracks.offsetX[k0];
+			v[(fk_value_offset0 + 1) * n + j] = tracks.offsetY[k0];
+			v[(fk_value_offset0 + 2) * n + j] = tracks.offsetZ[k0];
+			v[(fk_value_offset1 + 0) * n + j] = tracks.offsetX[k1];
+			v[(fk_value_offset1 + 1) * n + j] = tracks.offsetY[k1];
+			v[(fk_value_offset1 + 2) * n + j] = tracks.offsetZ[k1];
+		}
+	}
+
+	/**
+	 * 全ジョイントのRotation値とOffset値を、成分ごとの配列で一括して補間.
+	 * 分岐を持たないループとし、コンパイラによるベクトル化を期待する.
+	 */
+	void m_interpolateValues (const int n, const float* rates, float* v, const MOTION_ROTATION_INTERPOLATION interpolation)
+	{
+		float* ax = v + (fk_value_rot0 + 0) * n;
+		float* ay = v + (fk_value_rot0 + 1) * n;
+		float* az = v + (fk_value_rot0 + 2) * n;
+		float* aw = v + (fk_value_rot0 + 3) * n;
+		const float* bx = v + (fk_value_rot1 + 0) * n;
+		const float* by = v + (fk_value_rot1 + 1) * n;
+		const float* bz = v + (fk_value_rot1 + 2) * n;
+		const float* bw = v + (fk_value_rot1 + 3) * n;
+
+		if (interpolation == motion_rotation_slerp) {
+			for (int j = 0; j < n; ++j) {
+				// 角度が小さい場合は、sinでの除算を避けて線形補間とする.
+				const float d = std::min(1.0f, ax[j] * bx[j] + ay[j] * by[j] + az[j] * bz[j] + aw[j] * bw[j]);
+				const float theta = std::acos(d);
+				const float s = std::sin(theta);
+				const bool linearF = (s < 1e-4f);
+				const float invS = linearF ? 0.0f : (1.0f / s);
+				const float w0 = linearF ? (1.0f - rates[j]) : (std::sin((1.0f - rates[j]) * theta) * invS);
+				const float w1 = linearF ? rates[j] : (std::sin(rates[j] * theta) * invS);
+				ax[j] = ax[j] * w0 + bx[j] * w1;
+				ay[j] = ay[j] * w0 + by[j] * w1;
+				az[j] = az[j] * w0 + bz[j] * w1;
+				aw[j] = aw[j] * w0 + bw[j] * w1;
+			}
+		} else {
+			for (int j = 0; j < n; ++j) {
+				const float w0 = 1.0f - rates[j];
+				const float w1 = rates[j];
+				ax[j] = ax[j] * w0 + bx[j] * w1;
+				ay[j] = ay[j] * w0 + by[j] * w1;
+				az[j] = az[j] * w0 + bz[j] * w1;
+				aw[j] = aw[j] * w0 + bw[j] * w1;
+			}
+		}
+
+		// 正規化.
+		for (int j = 0; j < n; ++j) {
+			const float len2 = ax[j] * ax[j] + ay[j] * ay[j] + az[j] * az[j] + aw[j] * aw[j];
+			const float d = (len2 > 0.0f) ? (1.0f / std::sqrt(len2)) : 0.0f;
+			ax[j] *= d;
+			ay[j] *= d;
+			az[j] *= d;
+			aw[j] = (len2 > 0.0f) ? (aw[j] * d) : 1.0f;
+		}
+
+		// Offset値の線形補間.
+		for (int k = 0; k < 3; ++k) {
+			float* o0 = v + (fk_value_offset0 + k) * n;
+			const float* o1 = v + (fk_value_offset1 + k) * n;
+			for (int j = 0; j < n; ++j) o0[j] += (o1[j] - o0[j]) * rates[j];
+		}
+	}
+}
+
+//-------------------------------------------------.
+CMotionFKTracks::CMotionFKTracks ()
+{
+	clear();
+}
+
+void CMotionFKTracks::clear ()
+{
+	jointsCount = 0;
+	shapeHandles.clear();
+	parents.clear();
+	bindMatrices.clear();
+	rootMatrix = sxsdk::mat4::identity;
+	keyOffsets.clear();
+	keyOffsets.push_back(0);
+	keyTimes.clear();
+	offsetX.clear();
+	offsetY.clear();
+	offsetZ.clear();
+	rotX.clear();
+	rotY.clear();
+	rotZ.clear();
+	rotW.clear();
+}
+
+/**
+ * キーフレームの時間の範囲.
+ * @return キーフレームがない場合はfalse.
+ */
+bool CMotionFKTracks::getTimeRange (float& startTime, float& endTime) const
+{
+	startTime = endTime = 0.0f;
+	if (keyTimes.empty()) return false;
+	startTime = *std::min_element(keyTimes.begin(), keyTimes.end());
+	endTime   = *std::max_element(keyTimes.begin(), keyTimes.end());
+	return true;
+}
+
+//-------------------------------------------------.
+CMotionFKPose::CMotionFKPose ()
+{
+	clear();
+}
+
+void CMotionFKPose::clear ()
+{
+	offsets.clear();
+	rotations.clear();
+	localMatrices.clear();
+	worldMatrices.clear();
+	keyCursors.clear();
+	keyIndices0.clear();
+	keyIndices1.clear();
+	blendRates.clear();
+	values.clear();
+}
+
+//-------------------------------------------------.
+/**
+ * MotionGroupのキーフレームから、ボーン階層のジョイントごとのトラックを作成.
+ * @return キーフレームを持つジョイント数.
+ */
+int MotionFK::setupTracks (const MotionUtil::CMotionGroup& motionGroup, const CBoneSkeleton& skeleton, CMotionFKTracks& tracks)
+{
+	tracks.clear();
+	const int jointsCou = skeleton.getBonesCount();
+	if (jointsCou <= 0) return 0;
+
+	tracks.jointsCount  = jointsCou;
+	tracks.parents      = skeleton.getParents();
+	tracks.bindMatrices = skeleton.getLocalMatrices();
+	tracks.rootMatrix   = skeleton.getRootLocalToWorldMatrix();
+	tracks.shapeHandles.resize(jointsCou, NULL);
+
+	// 形状のハンドルからジョイント番号.
+	std::map<void *, int> jointsMap;
+	for (int i = 0; i < jointsCou; ++i) {
+		try {
+			tracks.shapeHandles[i] = skeleton.getShape(i)->get_handle();
+			jointsMap[ tracks.shapeHandles[i] ] = i;
+		} catch (...) { }
+	}
+
+	// ジョイントごとのMotionGroup内の位置.
+	std::vector<int> groupIndices(jointsCou, -1);
+	const int groupCou = (int)std::min(motionGroup.shapes.size(), motionGroup.jointKeyFrames.size());
+	for (int i = 0; i < groupCou; ++i) {
+		if (!motionGroup.shapes[i]) continue;
+		try {
+			std::map<void *, int>::const_iterator it = jointsMap.find(motionGroup.shapes[i]->get_handle());
+			if (it != jointsMap.end()) groupIndices[it->second] = i;
+		} catch (...) { }
+	}
+
+	int keyJointsCou = 0;
+	std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint> keyFrames;
+	for (int i = 0; i < jointsCou; ++i) {
+		if (groupIndices[i] >= 0) {
+			keyFrames = motionGroup.jointKeyFrames[ groupIndices[i] ];
+			std::stable_sort(keyFrames.begin(), keyFrames.end(), m_compareKeyFrameTime);
+
+			float prevX = 0.0f, prevY = 0.0f, prevZ = 0.0f, prevW = 1.0f;
+			for (size_t k = 0; k < keyFrames.size(); ++k) {
+				const MotionUtil::CMotionGroupKeyFrameBallBoneJoint& key = keyFrames[k];
+				float x = key.rotation.x, y = key.rotation.y, z = key.rotation.z, w = key.rotation.w;
+				const float len = std::sqrt(x * x + y * y + z * z + w * w);
+				if (len > 0.0f) {
+					x /= len;
+					y /= len;
+					z /= len;
+					w /= len;
+				} else {
+					x = y = z = 0.0f;
+					w = 1.0f;
+				}
+
+				// 補間時に短い経路となるように、前のキーフレームと符号をそろえる.
+				if (k > 0 && (x * prevX + y * prevY + z * prevZ + w * prevW) < 0.0f) {
+					x = -x;
+					y = -y;
+					z = -z;
+					w = -w;
+				}
+				prevX = x;
+				prevY = y;
+				prevZ = z;
+				prevW = w;
+
+				tracks.keyTimes.push_back(key.timeSec);
+				tracks.offsetX.push_back(key.offset.x);
+				tracks.offsetY.push_back(key.offset.y);
+				tracks.offsetZ.push_back(key.offset.z);
+				tracks.rotX.push_back(x);
+				tracks.rotY.push_back(y);
+				tracks.rotZ.push_back(z);
+				tracks.rotW.push_back(w);
+			}
+			if (!keyFrames.empty()) keyJointsCou++;
+		}
+		tracks.keyOffsets.push_back((int)tracks.keyTimes.size());
+	}
+	return keyJointsCou;
+}
+
+/**
+ * 指定の時間でのOffset値とRotation値を計算.
+ * キーフレームの検索、成分ごとの配列での補間の順に計算する.
+ */
+void MotionFK::sampleKeyFrames (const CMotionFKTracks& tracks, const float timeSec, CMotionFKPose& pose, const MOTION_ROTATION_INTERPOLATION interpolation)
+{
+	const int n = tracks.jointsCount;
+	if ((int)pose.keyCursors.size() != n) {
+		pose.offsets.assign(n, sxsdk::vec3(0, 0, 0));
+		pose.rotations.assign(n, sxsdk::quaternion_class::identity);
+		pose.localMatrices.assign(n, sxsdk::mat4::identity);
+		pose.worldMatrices.assign(n, sxsdk::mat4::identity);
+		pose.keyCursors.assign(n, 0);
+		pose.keyIndices0.assign(n, -1);
+		pose.keyIndices1.assign(n, -1);
+		pose.blendRates.assign(n, 0.0f);
+		pose.values.assign(n * fk_values_count, 0.0f);
+	}
+	if (n <= 0) return;
+
+	m_findKeyFrames(tracks, timeSec, pose);
+	m_gatherKeyFrames(tracks, pose);
+	m_interpolateValues(n, &pose.blendRates[0], &pose.values[0], interpolation);
+
+	const float* v = &pose.values[0];
+	for (int j = 0; j < n; ++j) {
+		sxsdk::quaternion_class& q = pose.rotations[j];
+		q.x = v[(fk_value_rot0 + 0) * n + j];
+		q.y = v[(fk_value_rot0 + 1) * n + j];
+		q.z = v[(fk_value_rot0 + 2) * n + j];
+		q.w = v[(fk_value_rot0 + 3) * n + j];
+		pose.offsets[j] = sxsdk::vec3(v[(fk_value_offset0 + 0) * n + j], v[(fk_value_offset0 + 1) * n + j], v[(fk_value_offset0 + 2) * n + j]);
+	}
+}
+
+/**
+ * ポーズのOffset値とRotation値から、ジョイントの変換行列を計算し、親から順にワールド変換行列を計算.
+ */
+void MotionFK::calcMatrices (const CMotionFKTracks& tracks, CMotionFKPose& pose)
+{
+	const int n = tracks.jointsCount;
+	if ((int)pose.offsets.size() != n || (int)pose.rotations.size() != n) return;
+	pose.localMatrices.resize(n);
+	pose.worldMatrices.resize(n);
+
+	for (int j = 0; j < n; ++j) {
+		const sxsdk::vec3& offset = pose.offsets[j];
+		sxsdk::mat4 m = MathUtil::quaternionToMatrix(pose.rotations[j]);
+		m[3][0] = offset.x;
+		m[3][1] = offset.y;
+		m[3][2] = offset.z;
+		pose.localMatrices[j] = m * tracks.bindMatrices[j];
+
+		const int parentIndex = tracks.parents[j];
+		pose.worldMatrices[j] = pose.localMatrices[j] * ((parentIndex >= 0) ? pose.worldMatrices[parentIndex] : tracks.rootMatrix);
+	}
+}
+
+/**
+ * 指定の時間でのポーズを計算.
+ * キーフレームの補間(sampleKeyFrames)と、親から順に変換行列を掛ける計算(calcMatrices)を行う.
+ */
+void MotionFK::evaluate (const CMotionFKTracks& tracks, const float timeSec, CMotionFKPose& pose, const MOTION_ROTATION_INTERPOLATION interpolation)
+{
+	sampleKeyFrames(tracks, timeSec, pose, interpolation);
+	calcMatrices(tracks, pose);
+}
+
+/**
+ * 複数の時間でのワールド変換行列を計算 (ベイク).
+ * 連続する時間を同じスレッドで計算し、キーフレームの検索位置を使い回す.
+ */
+bool MotionFK::evaluateFrames (const CMotionFKTracks& tracks, const std::vector<float>& times, std::vector<sxsdk::mat4>& worldMatrices, const MOTION_ROTATION_INTERPOLATION interpolation)
+{
+	CProfileScope profileScope(profile_motion_fk_eval);
+	CTraceScope traceScope("MotionFK::evaluateFrames", "frames", (long long)times.size());
+
+	const int n = tracks.jointsCount;
+	const int framesCou = (int)times.size();
+	worldMatrices.resize((size_t)framesCou * (size_t)n);
+	if (n <= 0 || framesCou <= 0) return true;
+
+	const int blocksCou = (framesCou + FK_FRAMES_BLOCK_SIZE - 1) / FK_FRAMES_BLOCK_SIZE;
+	const bool ret = ParallelUtil::parallelFor(blocksCou, [&](const int blockIndex) {
+		CMotionFKPose pose;
+		const int fEnd = std::min(framesCou, (blockIndex + 1) * FK_FRAMES_BLOCK_SIZE);
+		for (int f = blockIndex * FK_FRAMES_BLOCK_SIZE; f < fEnd; ++f) {
+			evaluate(tracks, times[f], pose, interpolation);
+			std::copy(pose.worldMatrices.begin(), pose.worldMatrices.end(), worldMatrices.begin() + (size_t)f * (size_t)n);
+		}
+	}, FK_MIN_PARALLEL_BLOCKS);
+	if (!ret) worldMatrices.clear();
+	return ret;
+}
+
+/**
+ * 2つのRotation値を補間 (evaluateと同じ計算).
+ */
+sxsdk::quaternion_class MotionFK::interpolateRotation (const sxsdk::quaternion_class& q0, const sxsdk::quaternion_class& q1, const float rate, const MOTION_ROTATION_INTERPOLATION interpolation)
+{
+	const float sign = (q0.x * q1.x + q0.y * q1.y + q0.z * q1.z + q0.w * q1.w < 0.0f) ? -1.0f : 1.0f;
+	float v[fk_values_count];
+	v[fk_value_rot0 + 0] = q0.x;
+	v[fk_value_rot0 + 1] = q0.y;
+	v[fk_value_rot0 + 2] = q0.z;
+	v[fk_value_rot0 + 3] = q0.w;
+	v[fk_value_rot1 + 0] = q1.x * sign;
+	v[fk_value_rot1 + 1] = q1.y * sign;
+	v[fk_value_rot1 + 2] = q1.z * sign;
+	v[fk_value_rot1 + 3] = q1.w * sign;
+	for (int k = 0; k < 3; ++k) v[fk_value_offset0 + k] = v[fk_value_offset1 + k] = 0.0f;
+	m_interpolateValues(1, &rate, v, interpolation);
+
+	sxsdk::quaternion_class q = sxsdk::quaternion_class::identity;
+	q.x = v[fk_value_rot0 + 0];
+	q.y = v[fk_value_rot0 + 1];
+	q.z = v[fk_value_rot0 + 2];
+	q.w = v[fk_value_rot0 + 3];
+	return q;
+}
@@ -0,0 +1,139 @@
+﻿/**
+ * ボーン/ボールジョイントのキーフレームからのポーズの計算 (Forward Kinematics).
+ * ボーン階層のスナップショット(CBoneSkeleton)の順にジョイントを並べ、キーフレームを成分ごとの配列で保持して補間する.
+ * SDKの関数は呼ばないため、複数の時間のポーズを複数スレッドで並列に計算できる.
+ */
+#ifndef _MOTIONFK_H
+#define _MOTIONFK_H
+
+#include "GlobalHeader.h"
+#include "MotionData.h"
+
+#include <vector>
+
+class CBoneSkeleton;
+
+/**
+ * 回転の補間方法.
+ */
+enum MOTION_ROTATION_INTERPOLATION {
+	motion_rotation_nlerp = 0,				// 線形補間して正規化 (Normalized Lerp).
+	motion_rotation_slerp,					// 球面線形補間 (Spherical Linear Interpolation).
+};
+
+/**
+ * ジョイントごとのキーフレームのトラック.
+ * ジョイントの並びはCBoneSkeletonと同じで、親のジョイントは子より前にある.
+ */
+class CMotionFKTracks
+{
+public:
+	int jointsCount;								// ジョイント数.
+	std::vector<void *> shapeHandles;				// ジョイントごとの形状のハンドル.
+	std::vector<int> parents;						// 親のジョイント番号 (ボーンルートの場合は-1).
+	std::vector<sxsdk::mat4> bindMatrices;			// シーケンスOff時のボーンの変換行列.
+	sxsdk::mat4 rootMatrix;							// ボーンルートの親までのローカルからワールドへの変換行列.
+
+	std::vector<int> keyOffsets;					// ジョイントごとのキーフレームの先頭位置 (ジョイント数 + 1個).
+	std::vector<float> keyTimes;					// キーフレーム位置での時間 (秒).
+	std::vector<float> offsetX, offsetY, offsetZ;	// Offset値.
+	std::vector<float> rotX, rotY, rotZ, rotW;		// Rotation値 (正規化済み、隣り合うキーフレームで内積が負にならないよう符号をそろえる).
+
+public:
+	CMotionFKTracks ();
+
+	void clear ();
+
+	/**
+	 * キーフレームの時間の範囲.
+	 * @return キーフレームがない場合はfalse.
+	 */
+	bool getTimeRange (float& startTime, float& endTime) const;
+};
+
+/**
+ * 1つの時間でのポーズ.
+ * キーフレームの検索位置を保持するため、時間を少しずつ進めて計算する場合は同じポーズを使い回すこと.
+ */
+class CMotionFKPose
+{
+public:
+	std::vector<sxsdk::vec3> offsets;				// ジョイントごとのOffset値.
+	std::vector<sxsdk::quaternion_class> rotations;	// ジョイントごとのRotation値.
+	std::vector<sxsdk::mat4> localMatrices;			// ジョイントごとの、親に対する変換行列.
+	std::vector<sxsdk::mat4> worldMatrices;			// ジョイントごとの、ローカルからワールドへの変換行列.
+
+	std::vector<int> keyCursors;					// ジョイントごとの、前回の計算で使用したキーフレームの位置 (作業用).
+	std::vector<int> keyIndices0, keyIndices1;		// 補間するキーフレームの位置 (作業用).
+	std::vector<float> blendRates;					// 補間の割合 (作業用).
+	std::vector<float> values;						// 成分ごとの補間結果 (作業用).
+
+public:
+	CMotionFKPose ();
+
+	void clear ();
+};
+
+namespace MotionFK
+{
+	/**
+	 * MotionGroupのキーフレームから、ボーン階層のジョイントごとのトラックを作成.
+	 * MotionGroupに含まれないジョイントや、キーフレームがないジョイントはシーケンスOff時の姿勢のままとなる.
+	 * @param[in]  motionGroup  キーフレームを持つMotionGroup (shapesとjointKeyFramesが同じ数であること).
+	 * @param[in]  skeleton     ボーン階層.
+	 * @param[out] tracks       ジョイントごとのトラック.
+	 * @return キーフレームを持つジョイント数.
+	 */
+	int setupTracks (const MotionUtil::CMotionGroup& motionGroup, const CBoneSkeleton& skeleton, CMotionFKTracks& tracks);
+
+	/**
+	 * 指定の時間でのポーズを計算.
+	 * キーフレームの範囲外の時間は、先頭または末尾のキーフレームの値となる.
+	 * ジョイントの変換行列は (Rotation値の回転 * Offset値の移動 * シーケンスOff時のボーンの変換行列) とする.
+	 * @param[in]  tracks         ジョイントごとのトラック.
+	 * @param[in]  timeSec        秒単位の時間.
+	 * @param[out] pose           ポーズ.
+	 * @param[in]  interpolation  回転の補間方法.
+	 */
+	void evaluate (const CMotionFKTracks& tracks, const float timeSec, CMotionFKPose& pose, const MOTION_ROTATION_INTERPOLATION interpolation = motion_rotation_nlerp);
+
+	/**
+	 * 指定の時間でのOffset値とRotation値のみを計算 (pose.offsetsとpose.rotationsを更新し、変換行列は計算しない).
+	 * キーフレームがないジョイントは、移動なしと単位クォータニオンとなる.
+	 * @param[in]  tracks         ジョイントごとのトラック.
+	 * @param[in]  timeSec        秒単位の時間.
+	 * @param[out] pose           ポーズ.
+	 * @param[in]  interpolation  回転の補間方法.
+	 */
+	void sampleKeyFrames (const CMotionFKTracks& tracks, const float timeSec, CMotionFKPose& pose, const MOTION_ROTATION_INTERPOLATION interpolation = motion_rotation_nlerp);
+
+	/**
+	 * ポーズのOffset値とRotation値から、ジョイントごとの変換行列(pose.localMatricesとpose.worldMatrices)を計算.
+	 * @param[in]     tracks  ジョイントごとのトラック (ボーン階層と、シーケンスOff時の変換行列を使用).
+	 * @param[in,out] pose    ポーズ (offsetsとrotationsはジョイント数分であること).
+	 */
+	void calcMatrices (const CMotionFKTracks& tracks, CMotionFKPose& pose);
+
+	/**
+	 * 複数の時間でのワールド変換行列を計算 (ベイク).
+	 * 時間を一定数ずつに分けて、複数スレッドで並列に計算する.
+	 * @param[in]  tracks         ジョイントごとのトラック.
+	 * @param[in]  times          秒単位の時間.
+	 * @param[out] worldMatrices  時間ごとに、ジョイント数分のローカルからワールドへの変換行列 (時間の数 x ジョイント数).
+	 * @param[in]  interpolation  回転の補間方法.
+	 * @return 計算できなかった場合はfalse (worldMatricesは空となる).
+	 */
+	bool evaluateFrames (const CMotionFKTracks& tracks, const std::vector<float>& times, std::vector<sxsdk::mat4>& worldMatrices, const MOTION_ROTATION_INTERPOLATION interpolation = motion_rotation_nlerp);
+
+	/**
+	 * 2つのRotation値を補間 (evaluateと同じ計算).
+	 * @param[in] q0             補間元のRotation値 (正規化済み).
+	 * @param[in] q1             補間先のRotation値 (正規化済み、q0との内積が負の場合は符号を反転して補間する).
+	 * @param[in] rate           補間の割合 (0.0 - 1.0).
+	 * @param[in] interpolation  回転の補間方法.
+	 * @return 補間したRotation値 (正規化済み).
+	 */
+	sxsdk::quaternion_class interpolateRotation (const sxsdk::quaternion_class& q0, const sxsdk::quaternion_class& q1, const float rate, const MOTION_ROTATION_INTERPOLATION interpolation = motion_rotation_nlerp);
+}
+
+#endif
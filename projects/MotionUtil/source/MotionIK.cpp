@@ -0,0 +1,466 @@
+﻿/**
+ * ボーンの連なり(チェイン)を目標位置に向けるIK (Inverse Kinematics).
+ */
+#include "MotionIK.h"
+#include "BoneSkeleton.h"
+#include "MathUtil.h"
+#include "ParallelUtil.h"
+#include "ProfileUtil.h"
+#include "TraceUtil.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	const int IK_CHAINS_BLOCK_SIZE = 16;		// 1スレッドでまとめて計算するチェインの数.
+	const int IK_MIN_PARALLEL_BLOCKS = 2;		// このブロック数未満の場合は、スレッドを使用しない.
+
+	/**
+	 * 1つのチェインの計算用 (作業用).
+	 * 配列の番号はチェイン内の番号 (0が根元).
+	 */
+	class CIKChainWork
+	{
+	public:
+		std::vector<sxsdk::quaternion_class> rotations;		// Rotation値.
+		std::vector<sxsdk::quaternion_class> restRotations;	// 計算前のRotation値.
+		std::vector<sxsdk::mat4> worldMatrices;				// ローカルからワールドへの変換行列.
+		std::vector<sxsdk::vec3> positions;					// FABRIKでのジョイントの位置.
+		std::vector<float> lengths;							// 次のジョイントまでの距離.
+		sxsdk::mat4 parentMatrix;							// 根元のジョイントの親の、ローカルからワールドへの変換行列.
+	};
+
+	/**
+	 * チェインごとの計算結果.
+	 */
+	class CIKChainResult
+	{
+	public:
+		int iterationsCount;
+		float error;
+
+	public:
+		CIKChainResult () : iterationsCount(0), error(0.0f) { }
+	};
+
+	sxsdk::quaternion_class m_normalize (const sxsdk::quaternion_class& q)
+	{
+		const float len = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+		if (!(len > 0.0f)) return sxsdk::quaternion_class::identity;
+		sxsdk::quaternion_class r;
+		r.x = q.x / len;
+		r.y = q.y / len;
+		r.z = q.z / len;
+		r.w = q.w / len;
+		return r;
+	}
+
+	/**
+	 * チェインのジョイントの変換行列を、Rotation値と親の変換行列から計算 (MotionFK::calcMatricesと同じ計算).
+	 */
+	void m_updateJoint (const CMotionFKTracks& tracks, const CMotionFKPose& pose, const int* joints, const int i, CIKChainWork& work)
+	{
+		const int j = joints[i];
+		const sxsdk::vec3& offset = pose.offsets[j];
+		sxsdk::mat4 m = MathUtil::quaternionToMatrix(work.rotations[i]);
+		m[3][0] = offset.x;
+		m[3][1] = offset.y;
+		m[3][2] = offset.z;
+		work.worldMatrices[i] = (m * tracks.bindMatrices[j]) * ((i > 0) ? work.worldMatrices[i - 1] : work.parentMatrix);
+	}
+
+	/**
+	 * ワールド座標でfromDirの向きをtoDirの向きにする回転を、ジョイントのRotation値に加える.
+	 * 向きをジョイントのローカル座標に戻してから回転を求め、Rotation値の前(ローカル)に掛ける.
+	 * limitAngleが0以上の場合は、計算前のRotation値からの回転角度を制限する.
+	 */
+	void m_rotateJoint (const CMotionFKTracks& tracks, const int* joints, const int i, const sxsdk::vec3& fromDir, const sxsdk::vec3& toDir, const float limitAngle, CIKChainWork& work)
+	{
+		// ジョイントのOffset値より後の変換 (シーケンスOff時の変換行列 * 親の変換行列) の回転/スケール部分の逆行列で、ワールドの向きをローカルの向きに戻す.
+		// 非均等スケールを含む場合は転置では逆変換にならず、回転角度もワールドとローカルで異なるため、逆行列で戻した向きを正規化して回転を求める.
+		const sxsdk::mat4 m = tracks.bindMatrices[joints[i]] * ((i > 0) ? work.worldMatrices[i - 1] : work.parentMatrix);
+		const sxsdk::vec3 localFrom = MathUtil::transformDirByInverse(fromDir, m);
+		const sxsdk::vec3 localTo   = MathUtil::transformDirByInverse(toDir, m);
+		const float fromLen = sxsdk::absolute(localFrom);
+		const float toLen   = sxsdk::absolute(localTo);
+		if (fromLen < 1e-12f || toLen < 1e-12f) return;
+		const sxsdk::vec3 a = localFrom / fromLen;
+		const sxsdk::vec3 b = localTo / toLen;
+		sxsdk::vec3 localAxis = sx::product(a, b);
+		const float s = sxsdk::absolute(localAxis);
+		const float angle = std::atan2(s, sx::inner_product(a, b));
+		if (angle < 1e-7f) return;
+		if (s > 1e-12f) {
+			localAxis = localAxis / s;
+		} else {
+			// 逆向きの場合は、垂直な任意の軸で回転.
+			localAxis = sx::product(a, (std::abs(a.x) < 0.9f) ? sxsdk::vec3(1, 0, 0) : sxsdk::vec3(0, 1, 0));
+			localAxis = localAxis / sxsdk::absolute(localAxis);
+		}
+
+		sxsdk::quaternion_class e;
+		const float halfS = std::sin(angle * 0.5f);
+		e.x = localAxis.x * halfS;
+		e.y = localAxis.y * halfS;
+		e.z = localAxis.z * halfS;
+		e.w = std::cos(angle * 0.5f);
+		sxsdk::quaternion_class q = m_normalize(MathUtil::multiplyQuaternion(e, work.rotations[i]));
+
+		if (limitAngle >= 0.0f && MathUtil::getRotationAngle(work.restRotations[i], q) > limitAngle) {
+			// 計算前のRotation値からの回転 (q = d * rest) の角度を制限する.
+			const sxsdk::quaternion_class& r = work.restRotations[i];
+			const sxsdk::quaternion_class d = MathUtil::multiplyQuaternion(q, MathUtil::conjugateQuaternion(r));
+			const float vLen = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+			if (vLen > 1e-12f) {
+				const float sign = (d.w < 0.0f) ? -1.0f : 1.0f;
+				const float limitS = std::sin(limitAngle * 0.5f) * sign / vLen;
+				sxsdk::quaternion_class dLimit;
+				dLimit.x = d.x * limitS;
+				dLimit.y = d.y * limitS;
+				dLimit.z = d.z * limitS;
+				dLimit.w = std::cos(limitAngle * 0.5f);
+				q = m_normalize(MathUtil::multiplyQuaternion(dLimit, r));
+			}
+		}
+		work.rotations[i] = q;
+	}
+
+	/**
+	 * FABRIKの1回の反復.
+	 * 位置を先端から根元、根元から先端の順に合わせた後、位置に合うようにRotation値を根元から順に回転する.
+	 */
+	void m_iterateFABRIK (const CMotionFKTracks& tracks, const CMotionFKPose& pose, const int* joints, const int jointsCou, const float* limitAngles, const sxsdk::vec3& target, CIKChainWork& work)
+	{
+		const int k = jointsCou - 1;
+		std::vector<sxsdk::vec3>& p = work.positions;
+		for (int i = 0; i <= k; ++i) p[i] = MathUtil::getMatrixPosition(work.worldMatrices[i]);
+
+		const sxsdk::vec3 base = p[0];
+		float totalLen = 0.0f;
+		for (int i = 0; i < k; ++i) totalLen += work.lengths[i];
+
+		if (sxsdk::distance3(base, target) >= totalLen) {
+			// 届かない場合は、目標位置に向けて伸ばす.
+			for (int i = 0; i < k; ++i) {
+				const sxsdk::vec3 v = target - p[i];
+				const float len = sxsdk::absolute(v);
+				if (len > 0.0f) p[i + 1] = p[i] + v * (work.lengths[i] / len);
+			}
+		} else {
+			p[k] = target;
+			for (int i = k - 1; i >= 0; --i) {
+				const sxsdk::vec3 v = p[i] - p[i + 1];
+				const float len = sxsdk::absolute(v);
+				if (len > 0.0f) p[i] = p[i + 1] + v * (work.lengths[i] / len);
+			}
+			p[0] = base;
+			for (int i = 0; i < k; ++i) {
+				const sxsdk::vec3 v = p[i + 1] - p[i];
+				const float len = sxsdk::absolute(v);
+				if (len > 0.0f) p[i + 1] = p[i] + v * (work.lengths[i] / len);
+			}
+		}
+
+		// 子のジョイントの位置は、親の変換行列を更新してから計算する.
+		// ジョイントの変換行列は、親(i - 1)を回転する前に計算したものであるため、先に計算し直す.
+		for (int i = 0; i < k; ++i) {
+			if (i > 0) m_updateJoint(tracks, pose, joints, i, work);
+			m_updateJoint(tracks, pose, joints, i + 1, work);
+			const sxsdk::vec3 p0 = MathUtil::getMatrixPosition(work.worldMatrices[i]);
+			m_rotateJoint(tracks, joints, i, MathUtil::getMatrixPosition(work.worldMatrices[i + 1]) - p0, p[i + 1] - p[i], limitAngles[i], work);
+			m_updateJoint(tracks, pose, joints, i, work);
+		}
+		m_updateJoint(tracks, pose, joints, k, work);
+	}
+
+	/**
+	 * CCDの1回の反復.
+	 * 先端に近いジョイントから順に、ジョイントから先端への向きを目標位置への向きに回転する.
+	 */
+	void m_iterateCCD (const CMotionFKTracks& tracks, const CMotionFKPose& pose, const int* joints, const int jointsCou, const float* limitAngles, const sxsdk::vec3& target, CIKChainWork& work)
+	{
+		const int k = jointsCou - 1;
+		for (int i = k - 1; i >= 0; --i) {
+			const sxsdk::vec3 p0 = MathUtil::getMatrixPosition(work.worldMatrices[i]);
+			m_rotateJoint(tracks, joints, i, MathUtil::getMatrixPosition(work.worldMatrices[k]) - p0, target - p0, limitAngles[i], work);
+			for (int m = i; m <= k; ++m) m_updateJoint(tracks, pose, joints, m, work);
+		}
+	}
+
+	/**
+	 * 1つのチェインのIKを計算し、ポーズのRotation値を更新.
+	 */
+	void m_solveChain (const CMotionFKTracks& tracks, const CMotionIKChains& chains, const int chainIndex, const CMotionIKOptions& options, CMotionFKPose& pose, CIKChainWork& work, CIKChainResult& result)
+	{
+		const int jBegin = chains.chainOffsets[chainIndex];
+		const int jointsCou = chains.chainOffsets[chainIndex + 1] - jBegin;
+		const sxsdk::vec3& target = chains.targets[chainIndex];
+		result.iterationsCount = 0;
+		result.error = 0.0f;
+		if (jointsCou < 2) return;
+
+		const int* joints = &chains.jointIndices[jBegin];
+		const float* limitAngles = &chains.limitAngles[jBegin];
+		const int parentIndex = tracks.parents[joints[0]];
+		work.parentMatrix = (parentIndex >= 0) ? pose.worldMatrices[parentIndex] : tracks.rootMatrix;
+		work.rotations.resize(jointsCou);
+		work.restRotations.resize(jointsCou);
+		work.worldMatrices.resize(jointsCou);
+		work.positions.resize(jointsCou);
+		work.lengths.resize(jointsCou);
+		for (int i = 0; i < jointsCou; ++i) {
+			work.rotations[i] = work.restRotations[i] = pose.rotations[joints[i]];
+			work.worldMatrices[i] = pose.worldMatrices[joints[i]];
+		}
+		for (int i = 0; i + 1 < jointsCou; ++i) {
+			work.lengths[i] = sxsdk::distance3(MathUtil::getMatrixPosition(work.worldMatrices[i]), MathUtil::getMatrixPosition(work.worldMatrices[i + 1]));
+		}
+
+		const int k = jointsCou - 1;
+		float error = sxsdk::distance3(MathUtil::getMatrixPosition(work.worldMatrices[k]), target);
+		int iterCou = 0;
+		while (error > options.tolerance && iterCou < options.iterationsCount) {
+			if (options.solver == motion_ik_ccd) m_iterateCCD(tracks, pose, joints, jointsCou, limitAngles, target, work);
+			else m_iterateFABRIK(tracks, pose, joints, jointsCou, limitAngles, target, work);
+			error = sxsdk::distance3(MathUtil::getMatrixPosition(work.worldMatrices[k]), target);
+			iterCou++;
+		}
+
+		// 先端のジョイントのRotation値は変更しない.
+		for (int i = 0; i < k; ++i) pose.rotations[joints[i]] = work.rotations[i];
+		result.iterationsCount = iterCou;
+		result.error = error;
+	}
+}
+
+//-------------------------------------------------.
+CMotionIKChains::CMotionIKChains ()
+{
+	clear();
+}
+
+void CMotionIKChains::clear ()
+{
+	chainOffsets.clear();
+	chainOffsets.push_back(0);
+	jointIndices.clear();
+	limitAngles.clear();
+	targets.clear();
+}
+
+//-------------------------------------------------.
+CMotionIKReport::CMotionIKReport ()
+{
+	clear();
+}
+
+void CMotionIKReport::clear ()
+{
+	chainsCount     = 0;
+	reachedCount    = 0;
+	iterationsCount = 0;
+	maxError        = 0.0f;
+}
+
+//-------------------------------------------------.
+/**
+ * 2つのジョイントの間のチェインを追加.
+ * @return チェインを追加できた場合はtrue.
+ */
+bool MotionIK::appendChain (const CMotionFKTracks& tracks, const int startJoint, const int endJoint, CMotionIKChains& chains, const float limitAngle)
+{
+	const int jointsCou = tracks.jointsCount;
+	if (startJoint < 0 || startJoint >= jointsCou || endJoint < 0 || endJoint >= jointsCou || startJoint == endJoint) return false;
+
+	// 先端から根元まで親をたどる.
+	std::vector<int> joints;
+	int j = endJoint;
+	while (j >= 0 && j != startJoint) {
+		joints.push_back(j);
+		j = tracks.parents[j];
+	}
+	if (j != startJoint) return false;
+	joints.push_back(startJoint);
+
+	chains.jointIndices.insert(chains.jointIndices.end(), joints.rbegin(), joints.rend());
+	chains.limitAngles.insert(chains.limitAngles.end(), joints.size(), limitAngle);
+	chains.chainOffsets.push_back((int)chains.jointIndices.size());
+
+	// シーケンスOff時の先端の位置.
+	std::vector<int> parentJoints;
+	for (int p = tracks.parents[startJoint]; p >= 0; p = tracks.parents[p]) parentJoints.push_back(p);
+	sxsdk::mat4 m = tracks.rootMatrix;
+	for (int i = (int)parentJoints.size() - 1; i >= 0; --i) m = tracks.bindMatrices[ parentJoints[i] ] * m;
+	for (int i = (int)joints.size() - 1; i >= 0; --i) m = tracks.bindMatrices[ joints[i] ] * m;
+	chains.targets.push_back(MathUtil::getMatrixPosition(m));
+	return true;
+}
+
+/**
+ * 指定のジョイント以下の、枝分かれのない先端までの連なりをチェインとして追加.
+ * @return 追加したチェイン数.
+ */
+int MotionIK::appendLeafChains (const CMotionFKTracks& tracks, const int rootJoint, CMotionIKChains& chains, const float limitAngle)
+{
+	const int jointsCou = tracks.jointsCount;
+	if (rootJoint < 0 || rootJoint >= jointsCou) return 0;
+
+	// 親は子より前にあるため、前から順に子の数とrootJoint以下かを求める.
+	std::vector<int> childrenCounts(jointsCou, 0);
+	std::vector<char> subtreeList(jointsCou, 0);
+	subtreeList[rootJoint] = 1;
+	for (int j = 0; j < jointsCou; ++j) {
+		const int p = tracks.parents[j];
+		if (p < 0) continue;
+		childrenCounts[p]++;
+		if (j > rootJoint && subtreeList[p]) subtreeList[j] = 1;
+	}
+
+	int cou = 0;
+	for (int j = rootJoint + 1; j < jointsCou; ++j) {
+		if (!subtreeList[j] || childrenCounts[j] > 0) continue;
+		int start = j;
+		while (tracks.parents[start] != rootJoint && childrenCounts[ tracks.parents[start] ] == 1) start = tracks.parents[start];
+		if (start != j && appendChain(tracks, start, j, chains, limitAngle)) cou++;
+	}
+	return cou;
+}
+
+/**
+ * すべてのチェインのIKを計算.
+ * 他のチェインが回転するジョイントの子孫を根元とするチェインは、そのチェインより後の段階で計算する.
+ * 段階ごとにチェインを一定数ずつに分けて複数スレッドで計算し、作業用の配列はブロック内で使い回す.
+ */
+int MotionIK::solveChains (const CMotionFKTracks& tracks, const CMotionIKChains& chains, const CMotionIKOptions& options, CMotionFKPose& pose, CMotionIKReport* report)
+{
+	CProfileScope profileScope(profile_motion_ik_solve);
+	CTraceScope traceScope("MotionIK::solveChains", "chains", (long long)chains.getChainsCount());
+
+	if (report) report->clear();
+	const int chainsCou = std::min(chains.getChainsCount(), (int)chains.chainOffsets.size() - 1);
+	const int n = tracks.jointsCount;
+	if (chainsCou <= 0 || n <= 0 || (int)pose.rotations.size() != n || (int)pose.worldMatrices.size() != n) return 0;
+
+	// チェインの計算の段階を求める.
+	// 親は子より前にあるため、根元のジョイント番号順に見ると、親のジョイントを回転するチェインの段階は先に決まる.
+	// jointLevels[j]は、ジョイントjを回転するチェインより後となる段階.
+	std::vector<int> chainOrder(chainsCou);
+	for (int c = 0; c < chainsCou; ++c) chainOrder[c] = c;
+	std::stable_sort(chainOrder.begin(), chainOrder.end(), [&](const int a, const int b) {
+		const int ja = (chains.chainOffsets[a + 1] > chains.chainOffsets[a]) ? chains.jointIndices[ chains.chainOffsets[a] ] : -1;
+		const int jb = (chains.chainOffsets[b + 1] > chains.chainOffsets[b]) ? chains.jointIndices[ chains.chainOffsets[b] ] : -1;
+		return ja < jb;
+	});
+	std::vector<int> jointLevels(n, 0);
+	std::vector<int> chainLevels(chainsCou, 0);
+	int levelsCou = 1;
+	for (int i = 0; i < chainsCou; ++i) {
+		const int c = chainOrder[i];
+		const int jBegin = chains.chainOffsets[c];
+		const int jEnd = chains.chainOffsets[c + 1];
+		if (jEnd - jBegin < 2) continue;
+		int level = 0;
+		for (int p = tracks.parents[ chains.jointIndices[jBegin] ]; p >= 0; p = tracks.parents[p]) level = std::max(level, jointLevels[p]);
+		chainLevels[c] = level;
+		levelsCou = std::max(levelsCou, level + 1);
+		for (int j = jBegin; j + 1 < jEnd; ++j) {
+			int& jointLevel = jointLevels[ chains.jointIndices[j] ];
+			jointLevel = std::max(jointLevel, level + 1);
+		}
+	}
+
+	// 段階ごとのチェイン番号 (levelOffsets[level] - levelOffsets[level + 1]).
+	std::vector<int> levelOffsets(levelsCou + 1, 0);
+	for (int c = 0; c < chainsCou; ++c) levelOffsets[chainLevels[c] + 1]++;
+	for (int level = 0; level < levelsCou; ++level) levelOffsets[level + 1] += levelOffsets[level];
+	std::vector<int> levelChains(chainsCou);
+	{
+		std::vector<int> counts(levelOffsets.begin(), levelOffsets.end() - 1);
+		for (int c = 0; c < chainsCou; ++c) levelChains[ counts[chainLevels[c]]++ ] = c;
+	}
+
+	// 次の段階のチェインは、前の段階で回転した後の変換行列から計算する.
+	std::vector<CIKChainResult> results(chainsCou);
+	bool ret = true;
+	for (int level = 0; level < levelsCou && ret; ++level) {
+		if (level > 0) MotionFK::calcMatrices(tracks, pose);
+		const int lBegin = levelOffsets[level];
+		const int lChainsCou = levelOffsets[level + 1] - lBegin;
+		const int blocksCou = (lChainsCou + IK_CHAINS_BLOCK_SIZE - 1) / IK_CHAINS_BLOCK_SIZE;
+		ret = ParallelUtil::parallelFor(blocksCou, [&](const int blockIndex) {
+			CIKChainWork work;
+			const int iEnd = lBegin + std::min(lChainsCou, (blockIndex + 1) * IK_CHAINS_BLOCK_SIZE);
+			for (int i = lBegin + blockIndex * IK_CHAINS_BLOCK_SIZE; i < iEnd; ++i) {
+				const int c = levelChains[i];
+				m_solveChain(tracks, chains, c, options, pose, work, results[c]);
+			}
+		}, IK_MIN_PARALLEL_BLOCKS);
+	}
+
+	MotionFK::calcMatrices(tracks, pose);
+	if (!ret) return -1;
+
+	// 後で計算したチェインが先端の位置を動かす場合があるため、先端と目標位置の距離は最後のポーズから計算し直す.
+	for (int c = 0; c < chainsCou; ++c) {
+		const int jBegin = chains.chainOffsets[c];
+		const int jEnd = chains.chainOffsets[c + 1];
+		if (jEnd - jBegin < 2) continue;
+		results[c].error = sxsdk::distance3(MathUtil::getMatrixPosition(pose.worldMatrices[ chains.jointIndices[jEnd - 1] ]), chains.targets[c]);
+	}
+
+	CMotionIKReport retReport;
+	retReport.chainsCount = chainsCou;
+	for (int c = 0; c < chainsCou; ++c) {
+		if (results[c].error <= options.tolerance) retReport.reachedCount++;
+		retReport.iterationsCount += results[c].iterationsCount;
+		retReport.maxError = std::max(retReport.maxError, results[c].error);
+	}
+	traceScope.setEndArg("reached", (long long)retReport.reachedCount);
+	if (report) *report = retReport;
+	return retReport.reachedCount;
+}
+
+/**
+ * ボーン/ボールジョイントの現在のOffset値とRotation値からポーズを計算.
+ * @return ジョイント数.
+ */
+int MotionIK::readJointValues (const CBoneSkeleton& skeleton, const CMotionFKTracks& tracks, CMotionFKPose& pose)
+{
+	const int n = tracks.jointsCount;
+	if (skeleton.getBonesCount() != n) return 0;
+	pose.offsets.assign(n, sxsdk::vec3(0, 0, 0));
+	pose.rotations.assign(n, sxsdk::quaternion_class::identity);
+	for (int i = 0; i < n; ++i) {
+		try {
+			compointer<sxsdk::bone_joint_interface> bone(skeleton.getShape(i)->get_bone_joint_interface());
+			pose.offsets[i]   = bone->get_offset();
+			pose.rotations[i] = bone->get_rotation();
+		} catch (...) { }
+	}
+	MotionFK::calcMatrices(tracks, pose);
+	return n;
+}
+
+/**
+ * チェインのジョイントのRotation値を、まとめてボーン/ボールジョイントに反映.
+ * 先端のジョイントはRotation値を変更しないため反映しない.
+ * @return 反映したジョイント数.
+ */
+int MotionIK::commitRotations (const CBoneSkeleton& skeleton, const CMotionIKChains& chains, const CMotionFKPose& pose)
+{
+	const int bonesCou = skeleton.getBonesCount();
+	const int chainsCou = std::min(chains.getChainsCount(), (int)chains.chainOffsets.size() - 1);
+	int cou = 0;
+	for (int c = 0; c < chainsCou; ++c) {
+		for (int i = chains.chainOffsets[c]; i + 1 < chains.chainOffsets[c + 1]; ++i) {
+			const int j = chains.jointIndices[i];
+			if (j < 0 || j >= bonesCou || j >= (int)pose.rotations.size()) continue;
+			try {
+				compointer<sxsdk::bone_joint_interface> bone(skeleton.getShape(j)->get_bone_joint_interface());
+				bone->set_rotation(pose.rotations[j]);
+				cou++;
+			} catch (...) { }
+		}
+	}
+	return cou;
+}
@@ -0,0 +1,134 @@
+﻿/**
+ * ボーンの連なり(チェイン)を目標位置に向けるIK (Inverse Kinematics).
+ * ボーン階層のスナップショットから、チェインのジョイント番号を1つの配列にまとめ、
+ * FABRIKまたはCCDで、決められた反復回数以内でジョイントのRotation値を求める.
+ * SDKの関数は呼ばないため、複数のチェインを複数スレッドで並列に計算できる.
+ */
+#ifndef _MOTIONIK_H
+#define _MOTIONIK_H
+
+#include "GlobalHeader.h"
+#include "MotionFK.h"
+
+#include <vector>
+
+class CBoneSkeleton;
+
+/**
+ * IKの計算方法.
+ */
+enum MOTION_IK_SOLVER {
+	motion_ik_fabrik = 0,					// 位置を先端と根元から交互に合わせる (Forward And Backward Reaching Inverse Kinematics).
+	motion_ik_ccd,							// 先端に近いジョイントから順に、先端を目標位置に向けて回転 (Cyclic Coordinate Descent).
+};
+
+/**
+ * IKのチェインの一覧.
+ * チェインごとに、根元から先端の順のジョイント番号(CMotionFKTracksと同じ並び)を持つ.
+ * 先端のジョイントの位置を目標位置に合わせ、先端以外のジョイントのRotation値を変更する.
+ */
+class CMotionIKChains
+{
+public:
+	std::vector<int> chainOffsets;			// チェインごとのジョイントの先頭位置 (チェイン数 + 1個).
+	std::vector<int> jointIndices;			// 根元から先端の順のジョイント番号.
+	std::vector<float> limitAngles;			// jointIndicesごとの、計算前のRotation値からの回転角度の最大 (ラジアン、負の場合は制限なし).
+	std::vector<sxsdk::vec3> targets;		// チェインごとのワールド座標での目標位置.
+
+public:
+	CMotionIKChains ();
+
+	void clear ();
+
+	/**
+	 * チェイン数.
+	 */
+	int getChainsCount () const { return (int)targets.size(); }
+};
+
+/**
+ * IKの計算の指定.
+ */
+class CMotionIKOptions
+{
+public:
+	MOTION_IK_SOLVER solver;				// 計算方法.
+	int iterationsCount;					// チェインごとの最大の反復回数.
+	float tolerance;						// 先端と目標位置の距離がこれ以下となった場合は反復を終了する.
+
+public:
+	CMotionIKOptions () : solver(motion_ik_fabrik), iterationsCount(16), tolerance(0.001f) { }
+};
+
+/**
+ * IKの計算結果.
+ */
+class CMotionIKReport
+{
+public:
+	int chainsCount;						// 計算したチェイン数.
+	int reachedCount;						// 先端と目標位置の距離が許容誤差以下となったチェイン数.
+	long long iterationsCount;				// すべてのチェインの反復回数の合計.
+	float maxError;							// 先端と目標位置の距離の最大.
+
+public:
+	CMotionIKReport ();
+
+	void clear ();
+};
+
+namespace MotionIK
+{
+	/**
+	 * 2つのジョイントの間のチェインを追加.
+	 * @param[in]     tracks      ボーン階層 (MotionFK::setupTracksで作成したもの).
+	 * @param[in]     startJoint  根元のジョイント番号.
+	 * @param[in]     endJoint    先端のジョイント番号 (startJointの子孫であること).
+	 * @param[in,out] chains      チェインの一覧 (目標位置は先端のシーケンスOff時の位置で初期化する).
+	 * @param[in]     limitAngle  ジョイントごとの回転角度の最大 (ラジアン、負の場合は制限なし).
+	 * @return チェインを追加できた場合はtrue.
+	 */
+	bool appendChain (const CMotionFKTracks& tracks, const int startJoint, const int endJoint, CMotionIKChains& chains, const float limitAngle = -1.0f);
+
+	/**
+	 * 指定のジョイント以下の、枝分かれのない先端までの連なりをチェインとして追加 (手のジョイントを指定した場合の指など).
+	 * チェインは、先端から親をたどり、枝分かれのあるジョイントまたは指定のジョイントの子までとする.
+	 * @return 追加したチェイン数.
+	 */
+	int appendLeafChains (const CMotionFKTracks& tracks, const int rootJoint, CMotionIKChains& chains, const float limitAngle = -1.0f);
+
+	/**
+	 * すべてのチェインのIKを計算.
+	 * 他のチェインが回転するジョイントの子孫を根元とするチェイン (腕と指など) は、親側のチェインを計算して変換行列を更新した後に計算する.
+	 * それ以外のチェインは互いに独立しているとして、複数スレッドで並列に計算する (同じジョイントを含むチェインは別の呼び出しで計算すること).
+	 * チェインのジョイントのRotation値を変更し、最後にすべてのジョイントの変換行列を計算し直す.
+	 * 目標位置に届いたかどうかは、最後の変換行列での先端の位置で判定する.
+	 * @param[in]     tracks   ボーン階層 (MotionFK::setupTracksで作成したもの).
+	 * @param[in]     chains   チェインの一覧と目標位置.
+	 * @param[in]     options  計算の指定.
+	 * @param[in,out] pose     ポーズ (MotionFK::evaluateまたはreadJointValuesで計算したもの).
+	 * @param[out]    report   計算結果 (NULLの場合は返さない).
+	 * @return 先端が目標位置に届いたチェイン数 (計算中に失敗した場合は-1).
+	 */
+	int solveChains (const CMotionFKTracks& tracks, const CMotionIKChains& chains, const CMotionIKOptions& options, CMotionFKPose& pose, CMotionIKReport* report = NULL);
+
+	/**
+	 * ボーン/ボールジョイントの現在のOffset値とRotation値からポーズを計算.
+	 * @param[in]  skeleton  ボーン階層.
+	 * @param[in]  tracks    skeletonから作成したトラック.
+	 * @param[out] pose      ポーズ.
+	 * @return ジョイント数.
+	 */
+	int readJointValues (const CBoneSkeleton& skeleton, const CMotionFKTracks& tracks, CMotionFKPose& pose);
+
+	/**
+	 * チェインのジョイントのRotation値を、まとめてボーン/ボールジョイントに反映.
+	 * @param[in] skeleton  ボーン階層 (tracksの作成に使用したもの).
+	 * @param[in] chains    チェインの一覧.
+	 * @param[in] pose      solveChainsで計算したポーズ.
+	 * @return 反映したジョイント数.
+	 */
+	int commitRotations (const CBoneSkeleton& skeleton, const CMotionIKChains& chains, const CMotionFKPose& pose);
+}
+
+#endif
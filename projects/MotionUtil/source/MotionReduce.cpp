@@ -0,0 +1,250 @@
+﻿/**
+ * MotionGroupのキーフレームの削減.
+ */
+#include "MotionReduce.h"
+#include "MathUtil.h"
+#include "ParallelUtil.h"
+#include "ProfileUtil.h"
+#include "TraceUtil.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	/**
+	 * トラックごとの削減結果.
+	 */
+	class CMotionReduceTrackResult {
+	public:
+		int sourceKeysCount;
+		int keysCount;
+		float maxOffsetError;
+		float maxRotationError;
+		float maxWeightError;
+
+	public:
+		CMotionReduceTrackResult () : sourceKeysCount(0), keysCount(0), maxOffsetError(0.0f), maxRotationError(0.0f), maxWeightError(0.0f) { }
+	};
+
+	template<typename T> bool m_compareKeyFrameTime (const T& a, const T& b)
+	{
+		return a.timeSec < b.timeSec;
+	}
+
+	/**
+	 * 許容誤差に対する誤差の比率 (1.0を超える場合は許容誤差外).
+	 */
+	inline float m_errorRate (const float error, const float tolerance)
+	{
+		return error / std::max(tolerance, 1e-20f);
+	}
+
+	/**
+	 * Douglas-Peucker法で残すキーフレームを決める.
+	 * calcErrorRate(a, b, k)は、キーフレームaとbの補間でキーフレームkを再現した場合の誤差の比率を返す.
+	 * @param[in]  keysCou   キーフレーム数.
+	 * @param[out] keepList  キーフレームごとに残す場合は1.
+	 */
+	template<typename F> void m_selectKeyFrames (const int keysCou, const F& calcErrorRate, std::vector<char>& keepList)
+	{
+		keepList.assign(keysCou, 0);
+		if (keysCou <= 0) return;
+		keepList[0] = keepList[keysCou - 1] = 1;
+
+		std::vector< std::pair<int, int> > stack;
+		if (keysCou > 2) stack.push_back(std::make_pair(0, keysCou - 1));
+		while (!stack.empty()) {
+			const int a = stack.back().first;
+			const int b = stack.back().second;
+			stack.pop_back();
+
+			int maxK = -1;
+			float maxRate = 1.0f;
+			for (int k = a + 1; k < b; ++k) {
+				const float rate = calcErrorRate(a, b, k);
+				if (rate > maxRate) {
+					maxRate = rate;
+					maxK = k;
+				}
+			}
+			if (maxK < 0) continue;
+			keepList[maxK] = 1;
+			if (maxK - a > 1) stack.push_back(std::make_pair(a, maxK));
+			if (b - maxK > 1) stack.push_back(std::make_pair(maxK, b));
+		}
+	}
+
+	/**
+	 * 正規化し、前のキーフレームと内積が負にならないよう符号をそろえたRotation値 (MotionFK::setupTracksと同じ).
+	 */
+	void m_alignRotations (const std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>& keyFrames, std::vector<sxsdk::quaternion_class>& rotations)
+	{
+		rotations.resize(keyFrames.size());
+		for (size_t k = 0; k < keyFrames.size(); ++k) {
+			sxsdk::quaternion_class q = keyFrames[k].rotation;
+			const float len = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+			if (len > 0.0f) {
+				q.x /= len;
+				q.y /= len;
+				q.z /= len;
+				q.w /= len;
+			} else {
+				q = sxsdk::quaternion_class::identity;
+			}
+			if (k > 0) {
+				const sxsdk::quaternion_class& p = rotations[k - 1];
+				if (q.x * p.x + q.y * p.y + q.z * p.z + q.w * p.w < 0.0f) {
+					q.x = -q.x;
+					q.y = -q.y;
+					q.z = -q.z;
+					q.w = -q.w;
+				}
+			}
+			rotations[k] = q;
+		}
+	}
+
+	/**
+	 * ボーン/ボールジョイントの1つのトラックを削減.
+	 */
+	void m_reduceJointTrack (std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>& keyFrames, const CMotionReduceOptions& options, CMotionReduceTrackResult& result)
+	{
+		std::stable_sort(keyFrames.begin(), keyFrames.end(), m_compareKeyFrameTime<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>);
+		const int keysCou = (int)keyFrames.size();
+		result.sourceKeysCount = result.keysCount = keysCou;
+		if (keysCou <= 2) return;
+
+		std::vector<sxsdk::quaternion_class> rotations;
+		m_alignRotations(keyFrames, rotations);
+
+		// 同じ時間のキーフレームは補間できないため残す.
+		std::vector<char> keepList;
+		m_selectKeyFrames(keysCou, [&](const int a, const int b, const int k) -> float {
+			const float dt = keyFrames[b].timeSec - keyFrames[a].timeSec;
+			if (!(dt > 0.0f)) return 2.0f;
+			const float rate = (keyFrames[k].timeSec - keyFrames[a].timeSec) / dt;
+			const sxsdk::vec3& o0 = keyFrames[a].offset;
+			const sxsdk::vec3 offset = o0 + (keyFrames[b].offset - o0) * rate;
+			const float offsetError = sxsdk::distance3(offset, keyFrames[k].offset);
+			const float rotationError = MathUtil::getRotationAngle(MotionFK::interpolateRotation(rotations[a], rotations[b], rate, options.interpolation), rotations[k]);
+			return std::max(m_errorRate(offsetError, options.offsetTolerance), m_errorRate(rotationError, options.rotationTolerance));
+		}, keepList);
+
+		// 省いたキーフレームの誤差を、残したキーフレームの補間で計算.
+		int a = 0;
+		for (int b = 1; b < keysCou; ++b) {
+			if (!keepList[b]) continue;
+			const float dt = keyFrames[b].timeSec - keyFrames[a].timeSec;
+			for (int k = a + 1; k < b && dt > 0.0f; ++k) {
+				const float rate = (keyFrames[k].timeSec - keyFrames[a].timeSec) / dt;
+				const sxsdk::vec3& o0 = keyFrames[a].offset;
+				const sxsdk::vec3 offset = o0 + (keyFrames[b].offset - o0) * rate;
+				result.maxOffsetError = std::max(result.maxOffsetError, sxsdk::distance3(offset, keyFrames[k].offset));
+				result.maxRotationError = std::max(result.maxRotationError,
+					MathUtil::getRotationAngle(MotionFK::interpolateRotation(rotations[a], rotations[b], rate, options.interpolation), rotations[k]));
+			}
+			a = b;
+		}
+
+		int dstCou = 0;
+		for (int k = 0; k < keysCou; ++k) {
+			if (keepList[k]) keyFrames[dstCou++] = keyFrames[k];
+		}
+		keyFrames.resize(dstCou);
+		result.keysCount = dstCou;
+	}
+
+	/**
+	 * Morph Targetsのウエイト値の1つのトラックを削減.
+	 */
+	void m_reduceMorphTrack (std::vector<MotionUtil::CMotionGroupKeyFrameMorphTargets>& keyFrames, const CMotionReduceOptions& options, CMotionReduceTrackResult& result)
+	{
+		std::stable_sort(keyFrames.begin(), keyFrames.end(), m_compareKeyFrameTime<MotionUtil::CMotionGroupKeyFrameMorphTargets>);
+		const int keysCou = (int)keyFrames.size();
+		result.sourceKeysCount = result.keysCount = keysCou;
+		if (keysCou <= 2) return;
+
+		std::vector<char> keepList;
+		m_selectKeyFrames(keysCou, [&](const int a, const int b, const int k) -> float {
+			const float dt = keyFrames[b].timeSec - keyFrames[a].timeSec;
+			if (!(dt > 0.0f)) return 2.0f;
+			const float rate = (keyFrames[k].timeSec - keyFrames[a].timeSec) / dt;
+			const float weight = keyFrames[a].weight + (keyFrames[b].weight - keyFrames[a].weight) * rate;
+			return m_errorRate(std::abs(weight - keyFrames[k].weight), options.weightTolerance);
+		}, keepList);
+
+		int a = 0;
+		for (int b = 1; b < keysCou; ++b) {
+			if (!keepList[b]) continue;
+			const float dt = keyFrames[b].timeSec - keyFrames[a].timeSec;
+			for (int k = a + 1; k < b && dt > 0.0f; ++k) {
+				const float rate = (keyFrames[k].timeSec - keyFrames[a].timeSec) / dt;
+				const float weight = keyFrames[a].weight + (keyFrames[b].weight - keyFrames[a].weight) * rate;
+				result.maxWeightError = std::max(result.maxWeightError, std::abs(weight - keyFrames[k].weight));
+			}
+			a = b;
+		}
+
+		int dstCou = 0;
+		for (int k = 0; k < keysCou; ++k) {
+			if (keepList[k]) keyFrames[dstCou++] = keyFrames[k];
+		}
+		keyFrames.resize(dstCou);
+		result.keysCount = dstCou;
+	}
+}
+
+//-------------------------------------------------.
+CMotionReduceReport::CMotionReduceReport ()
+{
+	clear();
+}
+
+void CMotionReduceReport::clear ()
+{
+	jointTracksCount = 0;
+	morphTracksCount = 0;
+	sourceKeysCount  = 0;
+	keysCount        = 0;
+	maxOffsetError   = 0.0f;
+	maxRotationError = 0.0f;
+	maxWeightError   = 0.0f;
+}
+
+//-------------------------------------------------.
+/**
+ * MotionGroupのすべてのトラックのキーフレームを削減.
+ * @return 省いたキーフレーム数.
+ */
+int MotionReduce::reduceKeyFrames (MotionUtil::CMotionGroup& motionGroup, const CMotionReduceOptions& options, CMotionReduceReport* report)
+{
+	CProfileScope profileScope(profile_motion_reduce);
+	CTraceScope traceScope("MotionReduce::reduceKeyFrames");
+
+	if (report) report->clear();
+	const int jointTracksCou = (int)motionGroup.jointKeyFrames.size();
+	const int morphTracksCou = (int)motionGroup.morphKeyFrames.size();
+	const int tracksCou = jointTracksCou + morphTracksCou;
+
+	std::vector<CMotionReduceTrackResult> trackResults(tracksCou);
+	const bool ret = ParallelUtil::parallelFor(tracksCou, [&](const int i) {
+		if (i < jointTracksCou) m_reduceJointTrack(motionGroup.jointKeyFrames[i], options, trackResults[i]);
+		else m_reduceMorphTrack(motionGroup.morphKeyFrames[i - jointTracksCou], options, trackResults[i]);
+	});
+	if (!ret) return -1;
+
+	CMotionReduceReport retReport;
+	retReport.jointTracksCount = jointTracksCou;
+	retReport.morphTracksCount = morphTracksCou;
+	for (int i = 0; i < tracksCou; ++i) {
+		const CMotionReduceTrackResult& r = trackResults[i];
+		retReport.sourceKeysCount += r.sourceKeysCount;
+		retReport.keysCount       += r.keysCount;
+		retReport.maxOffsetError   = std::max(retReport.maxOffsetError, r.maxOffsetError);
+		retReport.maxRotationError = std::max(retReport.maxRotationError, r.maxRotationError);
+		retReport.maxWeightError   = std::max(retReport.maxWeightError, r.maxWeightError);
+	}
+	traceScope.setEndArg("keys", (long long)retReport.keysCount);
+	if (report) *report = retReport;
+	return retReport.sourceKeysCount - retReport.keysCount;
+}
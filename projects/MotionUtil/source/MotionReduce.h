@@ -0,0 +1,63 @@
+﻿/**
+ * MotionGroupのキーフレームの削減.
+ * モーションキャプチャのように毎フレームにキーフレームを持つトラックから、
+ * 前後の残したキーフレームの補間で許容誤差以内に再現できるキーフレームを省く.
+ */
+#ifndef _MOTIONREDUCE_H
+#define _MOTIONREDUCE_H
+
+#include "GlobalHeader.h"
+#include "MotionData.h"
+#include "MotionFK.h"
+
+/**
+ * キーフレームの削減の指定.
+ */
+class CMotionReduceOptions
+{
+public:
+	float offsetTolerance;					// Offset値の許容誤差 (距離).
+	float rotationTolerance;				// Rotation値の許容誤差 (ラジアン).
+	float weightTolerance;					// Morph Targetsのウエイト値の許容誤差.
+	MOTION_ROTATION_INTERPOLATION interpolation;	// 再現に使用する回転の補間方法 (MotionFK::evaluateと同じ指定とすること).
+
+public:
+	CMotionReduceOptions () : offsetTolerance(0.001f), rotationTolerance(0.001f), weightTolerance(0.001f), interpolation(motion_rotation_nlerp) { }
+};
+
+/**
+ * キーフレームの削減結果.
+ */
+class CMotionReduceReport
+{
+public:
+	int jointTracksCount;					// ボーン/ボールジョイントのトラック数.
+	int morphTracksCount;					// Morph Targetsのウエイト値のトラック数.
+	int sourceKeysCount;					// 削減前のキーフレーム数.
+	int keysCount;							// 削減後のキーフレーム数.
+	float maxOffsetError;					// 省いたキーフレームでのOffset値の誤差の最大.
+	float maxRotationError;					// 省いたキーフレームでのRotation値の誤差の最大 (ラジアン).
+	float maxWeightError;					// 省いたキーフレームでのウエイト値の誤差の最大.
+
+public:
+	CMotionReduceReport ();
+
+	void clear ();
+};
+
+namespace MotionReduce
+{
+	/**
+	 * MotionGroupのすべてのトラックのキーフレームを削減.
+	 * トラックごとに、先頭と末尾のキーフレームを残し、誤差が最大となるキーフレームを許容誤差以内となるまで追加する (Douglas-Peucker法).
+	 * Offset値は線形補間、Rotation値はMotionFK::interpolateRotation、ウエイト値はMotionUtil::evaluateMorphWeightと同じ計算で再現する.
+	 * トラックは複数スレッドで並列に処理する.
+	 * @param[in,out] motionGroup  対象のMotionGroup (キーフレームは時間順に並べ替える).
+	 * @param[in]     options      削減の指定.
+	 * @param[out]    report       削減結果 (NULLの場合は返さない).
+	 * @return 省いたキーフレーム数 (処理中に失敗した場合は-1、削減できなかったトラックは元のキーフレームのまま残る).
+	 */
+	int reduceKeyFrames (MotionUtil::CMotionGroup& motionGroup, const CMotionReduceOptions& options, CMotionReduceReport* report = NULL);
+}
+
+#endif
@@ -0,0 +1,377 @@
+﻿/**
+ * 異なるボーン階層間でのモーションの移し替え (リターゲット).
+ */
+#include "MotionRetarget.h"
+#include "BoneSkeleton.h"
+#include "MathUtil.h"
+#include "MotionCodec.h"
+#include "ParallelUtil.h"
+#include "ProfileUtil.h"
+#include "StreamCodec.h"
+#include "StreamCtrl.h"
+#include "TraceUtil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctype.h>
+#include <map>
+
+namespace {
+	const int RETARGET_FRAMES_BLOCK_SIZE = 16;		// 1スレッドでまとめて計算する時間の数.
+	const int RETARGET_MIN_PARALLEL_BLOCKS = 2;		// このブロック数未満の場合は、スレッドを使用しない.
+
+	/**
+	 * 対応に使用する名前.
+	 * 名前空間の接頭辞("ns:"や"group|")を除き、英数字のみを小文字にして残す.
+	 */
+	std::string m_normalizeName (const std::string& name)
+	{
+		const size_t pos = name.find_last_of(":|");
+		const size_t start = (pos == std::string::npos) ? 0 : (pos + 1);
+		std::string ret;
+		ret.reserve(name.size() - start);
+		for (size_t i = start; i < name.size(); ++i) {
+			const unsigned char c = (unsigned char)name[i];
+			if (c < 0x80 && isalnum(c)) ret.push_back((char)tolower(c));
+			else if (c >= 0x80) ret.push_back((char)c);		// マルチバイト文字はそのまま比較する.
+		}
+		return ret;
+	}
+
+	std::string m_getName (const CBoneSkeleton& skeleton, const int index)
+	{
+		try {
+			const char* name = skeleton.getShape(index)->get_name();
+			if (name) return std::string(name);
+		} catch (...) { }
+		return std::string();
+	}
+
+	/**
+	 * シーケンスOff時の、ローカルからワールドへの変換行列.
+	 */
+	void m_calcBindWorldMatrices (const CBoneSkeleton& skeleton, std::vector<sxsdk::mat4>& worldMatrices)
+	{
+		const int n = skeleton.getBonesCount();
+		const std::vector<int>& parents = skeleton.getParents();
+		const std::vector<sxsdk::mat4>& localMatrices = skeleton.getLocalMatrices();
+		worldMatrices.resize(n);
+		for (int i = 0; i < n; ++i) {
+			worldMatrices[i] = localMatrices[i] * ((parents[i] >= 0) ? worldMatrices[ parents[i] ] : skeleton.getRootLocalToWorldMatrix());
+		}
+	}
+
+	/**
+	 * ジョイントごとの子のジョイント番号 (並び順).
+	 */
+	void m_getChildren (const CBoneSkeleton& skeleton, std::vector< std::vector<int> >& children)
+	{
+		const std::vector<int>& parents = skeleton.getParents();
+		children.assign(skeleton.getBonesCount(), std::vector<int>());
+		for (int i = 0; i < skeleton.getBonesCount(); ++i) {
+			if (parents[i] >= 0) children[ parents[i] ].push_back(i);
+		}
+	}
+
+	/**
+	 * 正規化した名前からジョイント番号 (重複する名前は-1).
+	 */
+	void m_getNamesMap (const CBoneSkeleton& skeleton, std::map<std::string, int>& namesMap)
+	{
+		namesMap.clear();
+		for (int i = 0; i < skeleton.getBonesCount(); ++i) {
+			const std::string name = m_normalizeName(m_getName(skeleton, i));
+			if (name.empty()) continue;
+			std::map<std::string, int>::iterator it = namesMap.find(name);
+			if (it == namesMap.end()) namesMap[name] = i;
+			else it->second = -1;
+		}
+	}
+}
+
+CMotionRetargetMap::CMotionRetargetMap ()
+{
+	clear();
+}
+
+void CMotionRetargetMap::clear ()
+{
+	sourceJointsCount = targetJointsCount = 0;
+	sourceSignature = targetSignature = overridesSignature = 0;
+	offsetScale = 1.0f;
+	sourceIndices.clear();
+	corrections.clear();
+}
+
+/**
+ * 移し元のジョイントが対応する、移し先のジョイント数.
+ */
+int CMotionRetargetMap::getMappedCount () const
+{
+	int cou = 0;
+	for (size_t i = 0; i < sourceIndices.size(); ++i) {
+		if (sourceIndices[i] >= 0) cou++;
+	}
+	return cou;
+}
+
+//-------------------------------------------------.
+/**
+ * ボーン階層のシグネチャを計算.
+ */
+unsigned int MotionRetarget::calcSkeletonSignature (const CBoneSkeleton& skeleton)
+{
+	const int n = skeleton.getBonesCount();
+	unsigned int crc = StreamCodec::calcCRC32C(&n, sizeof(int));
+	if (n <= 0) return crc;
+	crc = StreamCodec::calcCRC32C(&skeleton.getParents()[0], sizeof(int) * n, crc);
+	crc = StreamCodec::calcCRC32C(&skeleton.getLocalMatrices()[0], sizeof(sxsdk::mat4) * n, crc);
+	for (int i = 0; i < n; ++i) {
+		const std::string name = m_getName(skeleton, i);
+		crc = StreamCodec::calcCRC32C(name.c_str(), name.size() + 1, crc);
+	}
+	return crc;
+}
+
+/**
+ * 対応の指定のシグネチャを計算.
+ */
+unsigned int MotionRetarget::calcOverridesSignature (const std::vector<CMotionRetargetOverride>& overrides)
+{
+	unsigned int crc = 0;
+	for (size_t i = 0; i < overrides.size(); ++i) {
+		crc = StreamCodec::calcCRC32C(overrides[i].targetName.c_str(), overrides[i].targetName.size() + 1, crc);
+		crc = StreamCodec::calcCRC32C(overrides[i].sourceName.c_str(), overrides[i].sourceName.size() + 1, crc);
+	}
+	return crc;
+}
+
+/**
+ * 2つのボーン階層のジョイントの対応と、シーケンスOff時の姿勢の補正を計算.
+ * @return 対応するジョイント数.
+ */
+int MotionRetarget::buildMapping (const CBoneSkeleton& sourceSkeleton, const CBoneSkeleton& targetSkeleton, const std::vector<CMotionRetargetOverride>& overrides, CMotionRetargetMap& map)
+{
+	map.clear();
+	const int srcCou = sourceSkeleton.getBonesCount();
+	const int dstCou = targetSkeleton.getBonesCount();
+	map.sourceJointsCount  = srcCou;
+	map.targetJointsCount  = dstCou;
+	map.sourceSignature    = calcSkeletonSignature(sourceSkeleton);
+	map.targetSignature    = calcSkeletonSignature(targetSkeleton);
+	map.overridesSignature = calcOverridesSignature(overrides);
+	map.sourceIndices.assign(dstCou, -1);
+	map.corrections.assign(dstCou, sxsdk::quaternion_class::identity);
+	if (srcCou <= 0 || dstCou <= 0) return 0;
+
+	std::map<std::string, int> srcNamesMap, dstNamesMap;
+	m_getNamesMap(sourceSkeleton, srcNamesMap);
+	m_getNamesMap(targetSkeleton, dstNamesMap);
+
+	// 指定による対応 (指定のないジョイントは-1、対応させないジョイントは-2).
+	std::vector<int>& indices = map.sourceIndices;
+	std::vector<bool> usedF(srcCou, false);
+	for (size_t i = 0; i < overrides.size(); ++i) {
+		std::map<std::string, int>::const_iterator itDst = dstNamesMap.find(m_normalizeName(overrides[i].targetName));
+		if (itDst == dstNamesMap.end() || itDst->second < 0) continue;
+		int srcIndex = -2;
+		if (!overrides[i].sourceName.empty()) {
+			std::map<std::string, int>::const_iterator itSrc = srcNamesMap.find(m_normalizeName(overrides[i].sourceName));
+			if (itSrc == srcNamesMap.end() || itSrc->second < 0) continue;
+			srcIndex = itSrc->second;
+			usedF[srcIndex] = true;
+		}
+		indices[itDst->second] = srcIndex;
+	}
+
+	// 名前による対応.
+	for (std::map<std::string, int>::const_iterator itDst = dstNamesMap.begin(); itDst != dstNamesMap.end(); ++itDst) {
+		if (itDst->second < 0 || indices[itDst->second] != -1) continue;
+		std::map<std::string, int>::const_iterator itSrc = srcNamesMap.find(itDst->first);
+		if (itSrc == srcNamesMap.end() || itSrc->second < 0 || usedF[itSrc->second]) continue;
+		indices[itDst->second] = itSrc->second;
+		usedF[itSrc->second] = true;
+	}
+
+	// 階層による対応.
+	// ボーンルート同士と、対応済みの親の子の数が同じ場合は並び順で対応させる (親は子より前にあるため、1回で子孫までたどれる).
+	if (indices[0] == -1 && !usedF[0]) {
+		indices[0] = 0;
+		usedF[0] = true;
+	}
+	{
+		std::vector< std::vector<int> > srcChildren, dstChildren;
+		m_getChildren(sourceSkeleton, srcChildren);
+		m_getChildren(targetSkeleton, dstChildren);
+		for (int j = 0; j < dstCou; ++j) {
+			const int s = indices[j];
+			if (s < 0 || srcChildren[s].size() != dstChildren[j].size()) continue;
+			for (size_t c = 0; c < dstChildren[j].size(); ++c) {
+				const int dstChild = dstChildren[j][c];
+				const int srcChild = srcChildren[s][c];
+				if (indices[dstChild] != -1 || usedF[srcChild]) continue;
+				indices[dstChild] = srcChild;
+				usedF[srcChild] = true;
+			}
+		}
+	}
+	for (int j = 0; j < dstCou; ++j) indices[j] = std::max(-1, indices[j]);
+
+	// シーケンスOff時のワールドでの向きの差と、対応する親からの距離の合計の比.
+	std::vector<sxsdk::mat4> srcWorldMatrices, dstWorldMatrices;
+	m_calcBindWorldMatrices(sourceSkeleton, srcWorldMatrices);
+	m_calcBindWorldMatrices(targetSkeleton, dstWorldMatrices);
+	const std::vector<int>& dstParents = targetSkeleton.getParents();
+	double srcLength = 0.0, dstLength = 0.0;
+	int cou = 0;
+	for (int j = 0; j < dstCou; ++j) {
+		const int s = indices[j];
+		if (s < 0) continue;
+		const sxsdk::quaternion_class srcQ = MathUtil::matrixToQuaternion(srcWorldMatrices[s]);
+		const sxsdk::quaternion_class dstQ = MathUtil::matrixToQuaternion(dstWorldMatrices[j]);
+		// 保存したものを読み込んだ場合と結果が同じになるよう、保存する形式で量子化しておく.
+		unsigned char packed[MotionCodec::PACKED_ROTATION_SIZE];
+		MotionCodec::packRotation(MathUtil::multiplyQuaternion(MathUtil::conjugateQuaternion(srcQ), dstQ), packed);
+		map.corrections[j] = MotionCodec::unpackRotation(packed);
+		cou++;
+
+		const int p = dstParents[j];
+		if (p >= 0 && indices[p] >= 0) {
+			srcLength += (double)sxsdk::distance3(MathUtil::getMatrixPosition(srcWorldMatrices[s]), MathUtil::getMatrixPosition(srcWorldMatrices[ indices[p] ]));
+			dstLength += (double)sxsdk::distance3(MathUtil::getMatrixPosition(dstWorldMatrices[j]), MathUtil::getMatrixPosition(dstWorldMatrices[p]));
+		}
+	}
+	if (srcLength > 0.0 && dstLength > 0.0) map.offsetScale = (float)(dstLength / srcLength);
+
+	return cou;
+}
+
+/**
+ * 移し先のボーンルートに保存された対応と補正を使用し、ボーン階層または指定が変更されている場合は計算して保存し直す.
+ * @return 対応するジョイント数.
+ */
+int MotionRetarget::setupMapping (const CBoneSkeleton& sourceSkeleton, const CBoneSkeleton& targetSkeleton, const std::vector<CMotionRetargetOverride>& overrides, CMotionRetargetMap& map, bool* cachedF)
+{
+	if (cachedF) *cachedF = false;
+	if (targetSkeleton.getBonesCount() <= 0) {
+		return buildMapping(sourceSkeleton, targetSkeleton, overrides, map);
+	}
+
+	sxsdk::shape_class& boneRoot = *targetSkeleton.getShape(0);
+	if (StreamCtrl::readRetargetMapping(boneRoot, map)) {
+		if (map.sourceJointsCount == sourceSkeleton.getBonesCount() && map.targetJointsCount == targetSkeleton.getBonesCount() &&
+			map.overridesSignature == calcOverridesSignature(overrides) &&
+			map.sourceSignature == calcSkeletonSignature(sourceSkeleton) && map.targetSignature == calcSkeletonSignature(targetSkeleton)) {
+			if (cachedF) *cachedF = true;
+			return map.getMappedCount();
+		}
+	}
+
+	const int cou = buildMapping(sourceSkeleton, targetSkeleton, overrides, map);
+	StreamCtrl::writeRetargetMapping(boneRoot, map);
+	return cou;
+}
+
+/**
+ * 1つのジョイントのRotation値を移し替え.
+ * 補正をcとして、c^-1 * rotation * c とする.
+ */
+sxsdk::quaternion_class MotionRetarget::retargetRotation (const sxsdk::quaternion_class& correction, const sxsdk::quaternion_class& rotation)
+{
+	return MathUtil::multiplyQuaternion(MathUtil::multiplyQuaternion(MathUtil::conjugateQuaternion(correction), rotation), correction);
+}
+
+/**
+ * 1つのジョイントのOffset値を移し替え.
+ */
+sxsdk::vec3 MotionRetarget::retargetOffset (const sxsdk::quaternion_class& correction, const float offsetScale, const sxsdk::vec3& offset)
+{
+	return (offset * MathUtil::quaternionToMatrix(MathUtil::conjugateQuaternion(correction))) * offsetScale;
+}
+
+/**
+ * 複数の時間での、移し先のジョイントのOffset値とRotation値を計算.
+ * @return 計算した時間の数.
+ */
+int MotionRetarget::transferFrames (const CMotionRetargetMap& map, const CMotionFKTracks& sourceTracks, const std::vector<float>& times, std::vector<sxsdk::vec3>& offsets, std::vector<sxsdk::quaternion_class>& rotations, const MOTION_ROTATION_INTERPOLATION interpolation)
+{
+	CProfileScope profileScope(profile_motion_retarget);
+	CTraceScope traceScope("MotionRetarget::transferFrames", "frames", (long long)times.size());
+
+	const int framesCou = (int)times.size();
+	const int n = map.targetJointsCount;
+	offsets.clear();
+	rotations.clear();
+	if (framesCou <= 0 || n <= 0 || sourceTracks.jointsCount != map.sourceJointsCount) return 0;
+	if ((int)map.sourceIndices.size() != n || (int)map.corrections.size() != n) return 0;
+
+	// Offset値の回転と倍率は、ジョイントごとに1つの行列にまとめる.
+	std::vector<sxsdk::mat4> offsetMatrices(n, sxsdk::mat4::identity);
+	std::vector<sxsdk::quaternion_class> invCorrections(n, sxsdk::quaternion_class::identity);
+	for (int j = 0; j < n; ++j) {
+		if (map.sourceIndices[j] < 0 || map.sourceIndices[j] >= sourceTracks.jointsCount) continue;
+		invCorrections[j] = MathUtil::conjugateQuaternion(map.corrections[j]);
+		offsetMatrices[j] = MathUtil::quaternionToMatrix(invCorrections[j]) * sxsdk::mat4::scale(sxsdk::vec3(map.offsetScale, map.offsetScale, map.offsetScale));
+	}
+
+	offsets.resize((size_t)framesCou * (size_t)n);
+	rotations.resize((size_t)framesCou * (size_t)n);
+	const int blocksCou = (framesCou + RETARGET_FRAMES_BLOCK_SIZE - 1) / RETARGET_FRAMES_BLOCK_SIZE;
+	const bool ret = ParallelUtil::parallelFor(blocksCou, [&](const int blockIndex) {
+		CMotionFKPose pose;
+		const int fEnd = std::min(framesCou, (blockIndex + 1) * RETARGET_FRAMES_BLOCK_SIZE);
+		for (int f = blockIndex * RETARGET_FRAMES_BLOCK_SIZE; f < fEnd; ++f) {
+			MotionFK::sampleKeyFrames(sourceTracks, times[f], pose, interpolation);
+			sxsdk::vec3* dstOffsets = &offsets[(size_t)f * (size_t)n];
+			sxsdk::quaternion_class* dstRotations = &rotations[(size_t)f * (size_t)n];
+			for (int j = 0; j < n; ++j) {
+				const int s = map.sourceIndices[j];
+				if (s < 0 || s >= sourceTracks.jointsCount) {
+					dstOffsets[j] = sxsdk::vec3(0, 0, 0);
+					dstRotations[j] = sxsdk::quaternion_class::identity;
+					continue;
+				}
+				dstOffsets[j] = pose.offsets[s] * offsetMatrices[j];
+				dstRotations[j] = MathUtil::multiplyQuaternion(MathUtil::multiplyQuaternion(invCorrections[j], pose.rotations[s]), map.corrections[j]);
+			}
+		}
+	}, RETARGET_MIN_PARALLEL_BLOCKS);
+	if (!ret) {
+		offsets.clear();
+		rotations.clear();
+		return 0;
+	}
+
+	return framesCou;
+}
+
+/**
+ * 複数の時間で移し替えた、移し先のボーン階層のMotionGroupを作成.
+ * @return キーフレームを持つジョイント数.
+ */
+int MotionRetarget::transferMotionGroup (const CMotionRetargetMap& map, const CMotionFKTracks& sourceTracks, const CBoneSkeleton& targetSkeleton, const std::vector<float>& times, MotionUtil::CMotionGroup& motionGroup, const MOTION_ROTATION_INTERPOLATION interpolation)
+{
+	motionGroup.clear();
+	const int n = map.targetJointsCount;
+	if (targetSkeleton.getBonesCount() != n) return 0;
+
+	std::vector<sxsdk::vec3> offsets;
+	std::vector<sxsdk::quaternion_class> rotations;
+	const int framesCou = transferFrames(map, sourceTracks, times, offsets, rotations, interpolation);
+	if (framesCou <= 0) return 0;
+
+	for (int j = 0; j < n; ++j) {
+		if (map.sourceIndices[j] < 0) continue;
+		motionGroup.shapes.push_back(targetSkeleton.getShape(j));
+		motionGroup.jointKeyFrames.push_back(std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>(framesCou));
+		std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>& keyFrames = motionGroup.jointKeyFrames.back();
+		for (int f = 0; f < framesCou; ++f) {
+			MotionUtil::CMotionGroupKeyFrameBallBoneJoint& key = keyFrames[f];
+			key.type     = MotionUtil::keyframe_type_ball_bone_joint;
+			key.timeSec  = times[f];
+			key.offset   = offsets[(size_t)f * (size_t)n + j];
+			key.rotation = rotations[(size_t)f * (size_t)n + j];
+		}
+	}
+	return (int)motionGroup.shapes.size();
+}
@@ -0,0 +1,136 @@
+﻿/**
+ * 異なるボーン階層間でのモーションの移し替え (リターゲット).
+ * 移し元と移し先のジョイントの対応(名前、階層の位置、指定による上書き)と、シーケンスOff時の姿勢の違いを補正する回転を1度だけ計算し、
+ * 複数の時間のOffset値とRotation値を、複数スレッドで並列に変換する.
+ * 対応と補正はボーンルートのstreamに保存し、同じボーン階層間では計算を省略できる.
+ */
+#ifndef _MOTIONRETARGET_H
+#define _MOTIONRETARGET_H
+
+#include "GlobalHeader.h"
+#include "MotionData.h"
+#include "MotionFK.h"
+
+#include <string>
+#include <vector>
+
+class CBoneSkeleton;
+
+/**
+ * ジョイントの対応の指定 (名前や階層での対応より優先する).
+ */
+class CMotionRetargetOverride
+{
+public:
+	std::string targetName;					// 移し先のジョイントの名前.
+	std::string sourceName;					// 移し元のジョイントの名前 (空の場合は対応させない).
+
+public:
+	CMotionRetargetOverride () { }
+	CMotionRetargetOverride (const std::string& _targetName, const std::string& _sourceName) : targetName(_targetName), sourceName(_sourceName) { }
+};
+
+/**
+ * ジョイントの対応と、シーケンスOff時の姿勢の補正.
+ * 配列は移し先のボーン階層(CBoneSkeleton)のジョイント順.
+ */
+class CMotionRetargetMap
+{
+public:
+	int sourceJointsCount;								// 移し元のジョイント数.
+	int targetJointsCount;								// 移し先のジョイント数.
+	unsigned int sourceSignature;						// 移し元のボーン階層のシグネチャ (calcSkeletonSignature).
+	unsigned int targetSignature;						// 移し先のボーン階層のシグネチャ.
+	unsigned int overridesSignature;					// 対応の指定のシグネチャ (calcOverridesSignature).
+	float offsetScale;									// Offset値の倍率 (ボーンの長さの比).
+
+	std::vector<int> sourceIndices;						// 移し先のジョイントごとの、移し元のジョイント番号 (対応しない場合は-1).
+	std::vector<sxsdk::quaternion_class> corrections;	// 移し先のジョイントごとの、シーケンスOff時のワールドでの向きの差 (移し元の向きの逆 * 移し先の向き、保存する48bitの形式で量子化済み).
+
+public:
+	CMotionRetargetMap ();
+
+	void clear ();
+
+	/**
+	 * 移し元のジョイントが対応する、移し先のジョイント数.
+	 */
+	int getMappedCount () const;
+};
+
+namespace MotionRetarget
+{
+	/**
+	 * ボーン階層のシグネチャを計算.
+	 * ジョイント数、親のジョイント番号、名前、シーケンスOff時のボーンの変換行列から計算する.
+	 */
+	unsigned int calcSkeletonSignature (const CBoneSkeleton& skeleton);
+
+	/**
+	 * 対応の指定のシグネチャを計算.
+	 */
+	unsigned int calcOverridesSignature (const std::vector<CMotionRetargetOverride>& overrides);
+
+	/**
+	 * 2つのボーン階層のジョイントの対応と、シーケンスOff時の姿勢の補正を計算.
+	 * 移し先のジョイントごとに、指定による対応、名前(名前空間の接頭辞、大文字/小文字、英数字以外の文字を除く)の一致、
+	 * 対応済みの親の子の並び順(子の数が同じ場合)の順に対応を決める. 名前が重複するジョイントは名前では対応させない.
+	 * @param[in]  sourceSkeleton  移し元のボーン階層.
+	 * @param[in]  targetSkeleton  移し先のボーン階層.
+	 * @param[in]  overrides       対応の指定.
+	 * @param[out] map             ジョイントの対応と補正.
+	 * @return 対応するジョイント数.
+	 */
+	int buildMapping (const CBoneSkeleton& sourceSkeleton, const CBoneSkeleton& targetSkeleton, const std::vector<CMotionRetargetOverride>& overrides, CMotionRetargetMap& map);
+
+	/**
+	 * 移し先のボーンルートに保存された対応と補正を使用し、ボーン階層または指定が変更されている場合は計算して保存し直す.
+	 * @param[in]  sourceSkeleton  移し元のボーン階層.
+	 * @param[in]  targetSkeleton  移し先のボーン階層 (ボーンルートに対応と補正を保存する).
+	 * @param[in]  overrides       対応の指定.
+	 * @param[out] map             ジョイントの対応と補正.
+	 * @param[out] cachedF         保存されていたものを使用した場合はtrue (NULLの場合は返さない).
+	 * @return 対応するジョイント数.
+	 */
+	int setupMapping (const CBoneSkeleton& sourceSkeleton, const CBoneSkeleton& targetSkeleton, const std::vector<CMotionRetargetOverride>& overrides, CMotionRetargetMap& map, bool* cachedF = NULL);
+
+	/**
+	 * 1つのジョイントのRotation値を移し替え.
+	 * シーケンスOff時の姿勢からのワールドでの回転が、移し元と同じになるRotation値を返す.
+	 */
+	sxsdk::quaternion_class retargetRotation (const sxsdk::quaternion_class& correction, const sxsdk::quaternion_class& rotation);
+
+	/**
+	 * 1つのジョイントのOffset値を移し替え.
+	 * ワールドでの移動の向きが移し元と同じで、長さがoffsetScale倍となるOffset値を返す.
+	 */
+	sxsdk::vec3 retargetOffset (const sxsdk::quaternion_class& correction, const float offsetScale, const sxsdk::vec3& offset);
+
+	/**
+	 * 複数の時間での、移し先のジョイントのOffset値とRotation値を計算.
+	 * 時間を一定数ずつに分けて、複数スレッドで並列に計算する. 対応しないジョイントは、移動なしと単位クォータニオンとなる.
+	 * @param[in]  map            ジョイントの対応と補正.
+	 * @param[in]  sourceTracks   移し元のトラック (MotionFK::setupTracksで作成したもの).
+	 * @param[in]  times          秒単位の時間.
+	 * @param[out] offsets        時間ごとに、移し先のジョイント数分のOffset値 (時間の数 x 移し先のジョイント数).
+	 * @param[out] rotations      時間ごとに、移し先のジョイント数分のRotation値.
+	 * @param[in]  interpolation  回転の補間方法.
+	 * @return 計算した時間の数 (移し元のジョイント数がmapと異なる場合、計算中に失敗した場合は0).
+	 */
+	int transferFrames (const CMotionRetargetMap& map, const CMotionFKTracks& sourceTracks, const std::vector<float>& times, std::vector<sxsdk::vec3>& offsets, std::vector<sxsdk::quaternion_class>& rotations, const MOTION_ROTATION_INTERPOLATION interpolation = motion_rotation_nlerp);
+
+	/**
+	 * 複数の時間で移し替えた、移し先のボーン階層のMotionGroupを作成.
+	 * 移し元のジョイントが対応するジョイントごとに、時間ごとのキーフレームを持つ (MotionReduce::reduceKeyFramesで削減できる).
+	 * @param[in]  map            ジョイントの対応と補正.
+	 * @param[in]  sourceTracks   移し元のトラック.
+	 * @param[in]  targetSkeleton 移し先のボーン階層.
+	 * @param[in]  times          秒単位の時間 (時間順).
+	 * @param[out] motionGroup    移し先のMotionGroup.
+	 * @param[in]  interpolation  回転の補間方法.
+	 * @return キーフレームを持つジョイント数.
+	 */
+	int transferMotionGroup (const CMotionRetargetMap& map, const CMotionFKTracks& sourceTracks, const CBoneSkeleton& targetSkeleton, const std::vector<float>& times, MotionUtil::CMotionGroup& motionGroup, const MOTION_ROTATION_INTERPOLATION interpolation = motion_rotation_nlerp);
+}
+
+#endif
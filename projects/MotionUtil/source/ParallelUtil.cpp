@@ -0,0 +1,86 @@
+﻿/**
+ * 並列処理用の関数.
+ * std::threadを使用し、インデックス範囲を複数スレッドで分担して処理する.
+ */
+#include "ParallelUtil.h"
+#include "TraceUtil.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+	std::atomic<int> g_maxThreadsCount(0);		// 使用するスレッド数の上限 (0の場合はCPUのコア数).
+}
+
+/**
+ * 使用するスレッド数を取得.
+ */
+int ParallelUtil::getThreadsCount ()
+{
+	int count = (int)std::thread::hardware_concurrency();
+	if (count <= 0) count = 1;
+	const int maxCount = g_maxThreadsCount.load();
+	if (maxCount > 0) count = std::min(count, maxCount);
+	return count;
+}
+
+/**
+ * 使用するスレッド数の上限を指定 (0の場合はCPUのコア数).
+ */
+void ParallelUtil::setMaxThreadsCount (const int count)
+{
+	g_maxThreadsCount.store(std::max(0, count));
+}
+
+/**
+ * 0 - (count - 1)のインデックスについて、funcを並列に呼び出す.
+ * すべての呼び出しが終わるまで戻らない。funcは異なるインデックスで同時に呼ばれるため、スレッドセーフであること.
+ * @return すべてのインデックスでfuncが例外を投げずに終了した場合はtrue.
+ */
+bool ParallelUtil::parallelFor (const int count, const std::function<void (int)>& func, const int minCount)
+{
+	if (count <= 0) return true;
+
+	const int threadsCou = std::min(getThreadsCount(), count);
+	if (threadsCou <= 1 || count < minCount) {
+		for (int i = 0; i < count; ++i) {
+			try {
+				func(i);
+			} catch (...) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// 処理するインデックスを各スレッドで順に取り出す.
+	// 例外が投げられた場合は、以降のインデックスを取り出さない.
+	std::atomic<int> nextIndex(0);
+	std::atomic<bool> failed(false);
+	std::function<void ()> worker = [&]() {
+		CTraceScope traceScope("ParallelUtil::parallelFor", "count", count);
+		while (!failed.load()) {
+			const int i = nextIndex.fetch_add(1);
+			if (i >= count) break;
+			try {
+				func(i);
+			} catch (...) {
+				failed.store(true);
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	try {
+		for (int i = 0; i < threadsCou - 1; ++i) threads.push_back(std::thread(worker));
+	} catch (...) { }
+
+	// 呼び出し元のスレッドも処理に加わる.
+	worker();
+
+	for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+
+	return !failed.load();
+}
@@ -0,0 +1,35 @@
+﻿/**
+ * 並列処理用の関数.
+ * std::threadを使用し、インデックス範囲を複数スレッドで分担して処理する.
+ */
+#ifndef _PARALLELUTIL_H
+#define _PARALLELUTIL_H
+
+#include "GlobalHeader.h"
+
+#include <functional>
+
+namespace ParallelUtil {
+	/**
+	 * 使用するスレッド数を取得.
+	 */
+	int getThreadsCount ();
+
+	/**
+	 * 使用するスレッド数の上限を指定 (0の場合はCPUのコア数).
+	 */
+	void setMaxThreadsCount (const int count);
+
+	/**
+	 * 0 - (count - 1)のインデックスについて、funcを並列に呼び出す.
+	 * すべての呼び出しが終わるまで戻らない。funcは異なるインデックスで同時に呼ばれるため、スレッドセーフであること.
+	 * funcが例外を投げた場合は、まだ呼び出していないインデックスは処理せずにfalseを返す (結果は途中までしか書き込まれていないため、呼び出し側で失敗とすること).
+	 * @param[in] count     要素数.
+	 * @param[in] func      各インデックスで呼ばれる関数.
+	 * @param[in] minCount  この要素数未満の場合は、スレッドを使用せずに処理する.
+	 * @return すべてのインデックスでfuncが例外を投げずに終了した場合はtrue.
+	 */
+	bool parallelFor (const int count, const std::function<void (int)>& func, const int minCount = 2);
+}
+
+#endif
@@ -0,0 +1,157 @@
+﻿/**
+ * 処理時間の計測用.
+ * 処理ごとに呼び出し回数/処理時間/入出力バイト数を集計する.
+ */
+#include "ProfileUtil.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+	/**
+	 * 1つの処理の集計.
+	 * 複数スレッドから同時に加算されるため、atomicで保持.
+	 */
+	class CProfileCounter
+	{
+	public:
+		std::atomic<long long> calls;			// 呼び出し回数.
+		std::atomic<long long> bytes;			// 入出力のバイト数.
+		std::atomic<long long> totalTime;		// 処理時間の合計 (ナノ秒).
+		std::atomic<long long> maxTime;			// 1回の呼び出しの最大処理時間 (ナノ秒).
+
+	public:
+		CProfileCounter () : calls(0), bytes(0), totalTime(0), maxTime(0) { }
+
+		void clear () {
+			calls = 0;
+			bytes = 0;
+			totalTime = 0;
+			maxTime = 0;
+		}
+	};
+
+	CProfileCounter g_counters[profile_counters_count];
+
+	const char* g_counterNames[profile_counters_count] = {
+		"StreamCtrl::read",
+		"StreamCtrl::write",
+		"CMorphTargetsCtrl::updateMesh",
+		"CMorphTargetsCtrl::m_updateMeshVertices",
+		"CBSPPoint::build",
+		"CBSPPoint::searchVertices",
+		"CCalcMeshTransform::calcMeshTransform",
+		"CMorphTargetsCtrl::pushAllWeight",
+		"CMorphTargetsCtrl::popAllWeight",
+		"MeshUtil::readMeshVertices",
+		"CMeshVerticesBuffer::write",
+		"MorphTargetsSceneEval::updateMeshes",
+		"CBoneSkeleton::build",
+		"CBoneSkeleton::commit",
+		"SkinDeform::deformVertices",
+		"SkinWeights::readSkinWeights",
+		"MotionFK::evaluateFrames",
+		"MotionReduce::reduceKeyFrames",
+		"MotionBlend::evaluateCharacters",
+		"MotionIK::solveChains",
+		"MotionRetarget::transferFrames",
+	};
+}
+
+std::atomic<bool> ProfileUtil::g_enabled(false);
+
+/**
+ * 計測の有効/無効を指定.
+ */
+void ProfileUtil::setEnabled (const bool enabled)
+{
+	g_enabled.store(enabled);
+}
+
+/**
+ * 集計をすべてクリア.
+ */
+void ProfileUtil::reset ()
+{
+	for (int i = 0; i < profile_counters_count; ++i) g_counters[i].clear();
+}
+
+/**
+ * 1回の呼び出しの処理時間(ナノ秒)を加算.
+ */
+void ProfileUtil::addTime (const PROFILE_COUNTER_TYPE type, const long long nanoSec)
+{
+	if (type < 0 || type >= profile_counters_count) return;
+	CProfileCounter& counter = g_counters[type];
+	counter.calls.fetch_add(1, std::memory_order_relaxed);
+	counter.totalTime.fetch_add(nanoSec, std::memory_order_relaxed);
+
+	long long maxTime = counter.maxTime.load(std::memory_order_relaxed);
+	while (nanoSec > maxTime && !counter.maxTime.compare_exchange_weak(maxTime, nanoSec, std::memory_order_relaxed)) { }
+}
+
+/**
+ * 入出力のバイト数を加算.
+ */
+void ProfileUtil::addBytes (const PROFILE_COUNTER_TYPE type, const long long bytes)
+{
+	if (!isEnabled()) return;
+	if (type < 0 || type >= profile_counters_count) return;
+	g_counters[type].bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+/**
+ * 計測対象の名前を取得.
+ */
+const char* ProfileUtil::getCounterName (const PROFILE_COUNTER_TYPE type)
+{
+	if (type < 0 || type >= profile_counters_count) return "";
+	return g_counterNames[type];
+}
+
+/**
+ * 集計結果を取得.
+ */
+bool ProfileUtil::getCounter (const PROFILE_COUNTER_TYPE type, CProfileCounterData& data)
+{
+	if (type < 0 || type >= profile_counters_count) return false;
+	const CProfileCounter& counter = g_counters[type];
+
+	memset(data.name, 0, sizeof(data.name));
+	strncpy(data.name, g_counterNames[type], sizeof(data.name) - 1);
+	data.calls     = counter.calls.load();
+	data.bytes     = counter.bytes.load();
+	data.totalTime = (double)counter.totalTime.load() * 1e-6;
+	data.maxTime   = (double)counter.maxTime.load() * 1e-6;
+	return true;
+}
+
+/**
+ * 集計結果をJSON形式でファイルに出力.
+ * @param[in] fileName  出力ファイル名 (UTF-8).
+ */
+bool ProfileUtil::writeJSON (const char* fileName)
+{
+	if (!fileName || fileName[0] == '\0') return false;
+
+	FILE* fp = fopen(fileName, "wb");
+	if (!fp) return false;
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"enabled\": %s,\n", isEnabled() ? "true" : "false");
+	fprintf(fp, "  \"counters\": [\n");
+	for (int i = 0; i < profile_counters_count; ++i) {
+		CProfileCounterData data;
+		getCounter((PROFILE_COUNTER_TYPE)i, data);
+		const double averageTime = (data.calls > 0) ? (data.totalTime / (double)data.calls) : 0.0;
+
+		fprintf(fp, "    {\"name\": \"%s\", \"calls\": %lld, \"bytes\": %lld, \"total_ms\": %.6f, \"average_ms\": %.6f, \"max_ms\": %.6f}%s\n",
+			data.name, data.calls, data.bytes, data.totalTime, averageTime, data.maxTime, (i + 1 < profile_counters_count) ? "," : "");
+	}
+	fprintf(fp, "  ]\n");
+	fprintf(fp, "}\n");
+
+	const bool ret = (ferror(fp) == 0);
+	fclose(fp);
+	return ret;
+}
@@ -0,0 +1,114 @@
+﻿/**
+ * 処理時間の計測用.
+ * 処理ごとに呼び出し回数/処理時間/入出力バイト数を集計する.
+ * 計測が無効の場合は、フラグの判定のみを行う.
+ */
+#ifndef _PROFILEUTIL_H
+#define _PROFILEUTIL_H
+
+#include "GlobalHeader.h"
+#include "MotionExternalAccess.h"
+
+#include <atomic>
+#include <chrono>
+
+/**
+ * 計測対象の処理.
+ * 追加する場合は末尾(profile_counters_countの前)に追加し、ProfileUtil.cppの名前の一覧も更新すること.
+ */
+enum PROFILE_COUNTER_TYPE {
+	profile_stream_read = 0,				// StreamCtrlでのstreamの読み込み (readMorphTargetsLayout/readMorphTargetsBase/readMorphTargetVertices/readMotionData/readRetargetMapping).
+	profile_stream_write,					// StreamCtrlでのstreamへの保存 (writeMorphTargetsData/writeMorphTargetsWeights/writeMotionData/writeRetargetMapping).
+	profile_update_mesh,					// CMorphTargetsCtrl::updateMesh.
+	profile_update_mesh_vertices,			// CMorphTargetsCtrl::m_updateMeshVertices.
+	profile_bsp_build,						// CBSPPoint::build.
+	profile_bsp_search,						// CBSPPoint::searchVertices.
+	profile_calc_mesh_transform,			// CCalcMeshTransform::calcMeshTransform.
+	profile_push_all_weight,				// CMorphTargetsCtrl::pushAllWeight.
+	profile_pop_all_weight,					// CMorphTargetsCtrl::popAllWeight.
+	profile_mesh_read,						// MeshUtil::readMeshVertices (CMeshVerticesBuffer::read).
+	profile_mesh_write,						// CMeshVerticesBuffer::write.
+	profile_scene_eval,						// MorphTargetsSceneEval::updateMeshes.
+	profile_bone_skeleton_build,			// CBoneSkeleton::build.
+	profile_bone_skeleton_commit,			// CBoneSkeleton::commit.
+	profile_skin_deform,					// SkinDeform::deformVertices.
+	profile_skin_weights_read,				// SkinWeights::readSkinWeights.
+	profile_motion_fk_eval,					// MotionFK::evaluateFrames.
+	profile_motion_reduce,					// MotionReduce::reduceKeyFrames.
+	profile_motion_blend,					// MotionBlend::evaluateCharacters.
+	profile_motion_ik_solve,				// MotionIK::solveChains.
+	profile_motion_retarget,				// MotionRetarget::transferFrames.
+
+	profile_counters_count					// 計測対象の数.
+};
+
+namespace ProfileUtil {
+	extern std::atomic<bool> g_enabled;		// 計測が有効か.
+
+	/**
+	 * 計測が有効か.
+	 */
+	inline bool isEnabled () { return g_enabled.load(std::memory_order_relaxed); }
+
+	/**
+	 * 計測の有効/無効を指定.
+	 */
+	void setEnabled (const bool enabled);
+
+	/**
+	 * 集計をすべてクリア.
+	 */
+	void reset ();
+
+	/**
+	 * 1回の呼び出しの処理時間(ナノ秒)を加算.
+	 */
+	void addTime (const PROFILE_COUNTER_TYPE type, const long long nanoSec);
+
+	/**
+	 * 入出力のバイト数を加算.
+	 */
+	void addBytes (const PROFILE_COUNTER_TYPE type, const long long bytes);
+
+	/**
+	 * 計測対象の名前を取得.
+	 */
+	const char* getCounterName (const PROFILE_COUNTER_TYPE type);
+
+	/**
+	 * 集計結果を取得.
+	 */
+	bool getCounter (const PROFILE_COUNTER_TYPE type, CProfileCounterData& data);
+
+	/**
+	 * 集計結果をJSON形式でファイルに出力.
+	 * @param[in] fileName  出力ファイル名 (UTF-8).
+	 */
+	bool writeJSON (const char* fileName);
+}
+
+/**
+ * スコープ内の処理時間を計測.
+ * 計測が無効の場合は、コンストラクタでフラグを判定するのみ.
+ */
+class CProfileScope
+{
+private:
+	PROFILE_COUNTER_TYPE m_type;
+	bool m_enabled;
+	std::chrono::steady_clock::time_point m_startTime;
+
+public:
+	CProfileScope (const PROFILE_COUNTER_TYPE type) : m_type(type), m_enabled(ProfileUtil::isEnabled()) {
+		if (m_enabled) m_startTime = std::chrono::steady_clock::now();
+	}
+
+	~CProfileScope () {
+		if (m_enabled) {
+			const long long nanoSec = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+			ProfileUtil::addTime(m_type, nanoSec);
+		}
+	}
+};
+
+#endif
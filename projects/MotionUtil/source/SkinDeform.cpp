@@ -0,0 +1,393 @@
+﻿/**
+ * ボーンによるスキン変形 (Linear Blend Skinning / Dual Quaternion Skinning).
+ */
+#include "SkinDeform.h"
+#include "BoneSkeleton.h"
+#include "MathUtil.h"
+#include "ParallelUtil.h"
+#include "ProfileUtil.h"
+#include "TraceUtil.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	const int SKIN_BLOCK_SIZE = 256;			// まとめて変形する頂点数.
+	const int SKIN_MIN_PARALLEL_BLOCKS = 4;		// このブロック数未満の場合は、スレッドを使用しない.
+
+	/**
+	 * 変形の入出力.
+	 * ボーンごとの行列は、行列(3x4 : 回転/スケールの3x3 + 移動)またはデュアルクォータニオン(実部4 + 双対部4)の配列.
+	 */
+	class CSkinDeformContext {
+	public:
+		const CSkinInfluences* influences;
+		const std::vector<sxsdk::vec3>* vertices;
+		const std::vector<sxsdk::vec3>* normals;
+		std::vector<sxsdk::vec3>* dstVertices;
+		std::vector<sxsdk::vec3>* dstNormals;
+		std::vector<float> jointValues;			// ボーンごとの行列またはデュアルクォータニオン.
+	};
+
+	/**
+	 * 行列を、3x4の行列(行ベクトル形式)の12要素に変換.
+	 */
+	void m_matrixToFloat12 (const sxsdk::mat4& m, float* v)
+	{
+		for (int i = 0; i < 4; ++i) {
+			v[i * 3 + 0] = m[i][0];
+			v[i * 3 + 1] = m[i][1];
+			v[i * 3 + 2] = m[i][2];
+		}
+	}
+
+	/**
+	 * 行列を、デュアルクォータニオンの8要素(実部w,x,y,z、双対部w,x,y,z)に変換.
+	 * 回転/スケールの3x3の各行を正規化してスケールを除く.
+	 */
+	void m_matrixToDualQuaternion (const sxsdk::mat4& m, float* dq)
+	{
+		const sxsdk::quaternion_class q = MathUtil::matrixToQuaternion(m);
+		const float w = q.w, x = q.x, y = q.y, z = q.z;
+
+		// 双対部 = 0.5 * (0, t) * 実部.
+		const float tx = m[3][0], ty = m[3][1], tz = m[3][2];
+		dq[0] = w;
+		dq[1] = x;
+		dq[2] = y;
+		dq[3] = z;
+		dq[4] = -0.5f * (tx * x + ty * y + tz * z);
+		dq[5] =  0.5f * (w * tx + ty * z - tz * y);
+		dq[6] =  0.5f * (w * ty + tz * x - tx * z);
+		dq[7] =  0.5f * (w * tz + tx * y - ty * x);
+	}
+
+	/**
+	 * ブロック内の頂点座標を、成分ごとの配列に取り出す.
+	 */
+	void m_loadBlock (const std::vector<sxsdk::vec3>& src, const int start, const int cou, float* x, float* y, float* z)
+	{
+		for (int i = 0; i < cou; ++i) {
+			const sxsdk::vec3& v = src[start + i];
+			x[i] = v.x;
+			y[i] = v.y;
+			z[i] = v.z;
+		}
+	}
+
+	/**
+	 * 成分ごとの配列から、ブロック内の頂点座標に格納.
+	 * @param[in] normalizeF  正規化して格納.
+	 */
+	void m_storeBlock (std::vector<sxsdk::vec3>& dst, const int start, const int cou, const float* x, const float* y, const float* z, const bool normalizeF)
+	{
+		if (normalizeF) {
+			for (int i = 0; i < cou; ++i) {
+				const float len2 = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+				const float d = (len2 > 0.0f) ? (1.0f / std::sqrt(len2)) : 0.0f;
+				dst[start + i] = sxsdk::vec3(x[i] * d, y[i] * d, z[i] * d);
+			}
+		} else {
+			for (int i = 0; i < cou; ++i) dst[start + i] = sxsdk::vec3(x[i], y[i], z[i]);
+		}
+	}
+
+	/**
+	 * 1ブロックの頂点を、行列の線形補間で変形.
+	 * 頂点ごとの行列の合成(影響数が頂点ごとに異なる)と、合成した行列による変換(成分ごとの配列で一括)に分けて計算する.
+	 */
+	void m_deformBlockLinear (const CSkinDeformContext& context, const int start, const int cou)
+	{
+		const CSkinInfluences& influences = *context.influences;
+		const float* jointMats = &context.jointValues[0];
+
+		float b[12][SKIN_BLOCK_SIZE];
+		float rest[SKIN_BLOCK_SIZE];
+		for (int k = 0; k < 12; ++k) std::fill(b[k], b[k] + cou, 0.0f);
+		std::fill(rest, rest + cou, 1.0f);
+
+		for (int i = 0; i < cou; ++i) {
+			const int iEnd = influences.getEnd(start + i);
+			for (int j = influences.getBegin(start + i); j < iEnd; ++j) {
+				const float w = influences.weights[j];
+				if (w == 0.0f) continue;
+				const float* m = jointMats + influences.jointIndices[j] * 12;
+				for (int k = 0; k < 12; ++k) b[k][i] += w * m[k];
+				rest[i] -= w;
+			}
+		}
+
+		// ウエイト値の合計が1.0未満の場合は、残りを単位行列とする.
+		for (int i = 0; i < cou; ++i) {
+			const float r = std::max(0.0f, rest[i]);
+			b[0][i] += r;
+			b[4][i] += r;
+			b[8][i] += r;
+		}
+
+		// ox/oy/ozはcou個のみ書き込まれるが、コンパイラの未初期化の警告を避けるため0で初期化する.
+		float x[SKIN_BLOCK_SIZE], y[SKIN_BLOCK_SIZE], z[SKIN_BLOCK_SIZE];
+		float ox[SKIN_BLOCK_SIZE] = {}, oy[SKIN_BLOCK_SIZE] = {}, oz[SKIN_BLOCK_SIZE] = {};
+		m_loadBlock(*context.vertices, start, cou, x, y, z);
+		for (int i = 0; i < cou; ++i) {
+			ox[i] = x[i] * b[0][i] + y[i] * b[3][i] + z[i] * b[6][i] + b[9][i];
+			oy[i] = x[i] * b[1][i] + y[i] * b[4][i] + z[i] * b[7][i] + b[10][i];
+			oz[i] = x[i] * b[2][i] + y[i] * b[5][i] + z[i] * b[8][i] + b[11][i];
+		}
+		m_storeBlock(*context.dstVertices, start, cou, ox, oy, oz, false);
+
+		// 法線は、合成した行列の回転/スケール部分(3x3)の逆転置行列で変換して正規化.
+		// 正規化するため、逆行列の代わりに余因子行列を使い、行列式が負の場合(反転)のみ向きを戻す.
+		if (context.normals) {
+			m_loadBlock(*context.normals, start, cou, x, y, z);
+			for (int i = 0; i < cou; ++i) {
+				const float c0 = b[4][i] * b[8][i] - b[5][i] * b[7][i];
+				const float c1 = b[5][i] * b[6][i] - b[3][i] * b[8][i];
+				const float c2 = b[3][i] * b[7][i] - b[4][i] * b[6][i];
+				const float c3 = b[2][i] * b[7][i] - b[1][i] * b[8][i];
+				const float c4 = b[0][i] * b[8][i] - b[2][i] * b[6][i];
+				const float c5 = b[1][i] * b[6][i] - b[0][i] * b[7][i];
+				const float c6 = b[1][i] * b[5][i] - b[2][i] * b[4][i];
+				const float c7 = b[2][i] * b[3][i] - b[0][i] * b[5][i];
+				const float c8 = b[0][i] * b[4][i] - b[1][i] * b[3][i];
+				const float s  = (b[0][i] * c0 + b[1][i] * c1 + b[2][i] * c2 < 0.0f) ? -1.0f : 1.0f;
+				ox[i] = (x[i] * c0 + y[i] * c3 + z[i] * c6) * s;
+				oy[i] = (x[i] * c1 + y[i] * c4 + z[i] * c7) * s;
+				oz[i] = (x[i] * c2 + y[i] * c5 + z[i] * c8) * s;
+			}
+			m_storeBlock(*context.dstNormals, start, cou, ox, oy, oz, true);
+		}
+	}
+
+	/**
+	 * 1ブロックの頂点を、デュアルクォータニオンの補間で変形.
+	 * 補間するデュアルクォータニオンは、先頭の影響の実部と同じ向き(内積が正)にそろえる.
+	 */
+	void m_deformBlockDualQuaternion (const CSkinDeformContext& context, const int start, const int cou)
+	{
+		const CSkinInfluences& influences = *context.influences;
+		const float* jointDQs = &context.jointValues[0];
+
+		float q[8][SKIN_BLOCK_SIZE];
+		for (int k = 0; k < 8; ++k) std::fill(q[k], q[k] + cou, 0.0f);
+
+		for (int i = 0; i < cou; ++i) {
+			const int iEnd = influences.getEnd(start + i);
+			const float* ref = NULL;
+			float rest = 1.0f;
+			for (int j = influences.getBegin(start + i); j < iEnd; ++j) {
+				const float w = influences.weights[j];
+				if (w == 0.0f) continue;
+				const float* dq = jointDQs + influences.jointIndices[j] * 8;
+				if (!ref) ref = dq;
+				const float dot = dq[0] * ref[0] + dq[1] * ref[1] + dq[2] * ref[2] + dq[3] * ref[3];
+				const float sw = (dot < 0.0f) ? -w : w;
+				for (int k = 0; k < 8; ++k) q[k][i] += sw * dq[k];
+				rest -= w;
+			}
+
+			// ウエイト値の合計が1.0未満の場合は、残りを単位デュアルクォータニオンとする.
+			if (rest > 0.0f) q[0][i] += (ref && ref[0] < 0.0f) ? -rest : rest;
+		}
+
+		// 実部の長さで正規化.
+		for (int i = 0; i < cou; ++i) {
+			const float len2 = q[0][i] * q[0][i] + q[1][i] * q[1][i] + q[2][i] * q[2][i] + q[3][i] * q[3][i];
+			const float d = (len2 > 0.0f) ? (1.0f / std::sqrt(len2)) : 0.0f;
+			for (int k = 0; k < 8; ++k) q[k][i] *= d;
+			q[0][i] = (len2 > 0.0f) ? q[0][i] : 1.0f;
+		}
+
+		// p' = p + 2 * r x (r x p + w * p) + t.
+		// t = 2 * (w * d - dw * r + r x d).
+		float x[SKIN_BLOCK_SIZE], y[SKIN_BLOCK_SIZE], z[SKIN_BLOCK_SIZE];
+		float ox[SKIN_BLOCK_SIZE] = {}, oy[SKIN_BLOCK_SIZE] = {}, oz[SKIN_BLOCK_SIZE] = {};
+		m_loadBlock(*context.vertices, start, cou, x, y, z);
+		for (int i = 0; i < cou; ++i) {
+			const float w = q[0][i], rx = q[1][i], ry = q[2][i], rz = q[3][i];
+			const float dw = q[4][i], dx = q[5][i], dy = q[6][i], dz = q[7][i];
+			const float cx = ry * z[i] - rz * y[i] + w * x[i];
+			const float cy = rz * x[i] - rx * z[i] + w * y[i];
+			const float cz = rx * y[i] - ry * x[i] + w * z[i];
+			const float tx = 2.0f * (w * dx - dw * rx + ry * dz - rz * dy);
+			const float ty = 2.0f * (w * dy - dw * ry + rz * dx - rx * dz);
+			const float tz = 2.0f * (w * dz - dw * rz + rx * dy - ry * dx);
+			ox[i] = x[i] + 2.0f * (ry * cz - rz * cy) + tx;
+			oy[i] = y[i] + 2.0f * (rz * cx - rx * cz) + ty;
+			oz[i] = z[i] + 2.0f * (rx * cy - ry * cx) + tz;
+		}
+		m_storeBlock(*context.dstVertices, start, cou, ox, oy, oz, false);
+
+		// 法線は回転のみで変換する (デュアルクォータニオンはスケールを含まないため、逆転置行列と同じ).
+		if (context.normals) {
+			m_loadBlock(*context.normals, start, cou, x, y, z);
+			for (int i = 0; i < cou; ++i) {
+				const float w = q[0][i], rx = q[1][i], ry = q[2][i], rz = q[3][i];
+				const float cx = ry * z[i] - rz * y[i] + w * x[i];
+				const float cy = rz * x[i] - rx * z[i] + w * y[i];
+				const float cz = rx * y[i] - ry * x[i] + w * z[i];
+				ox[i] = x[i] + 2.0f * (ry * cz - rz * cy);
+				oy[i] = y[i] + 2.0f * (rz * cx - rx * cz);
+				oz[i] = z[i] + 2.0f * (rx * cy - ry * cx);
+			}
+			m_storeBlock(*context.dstNormals, start, cou, ox, oy, oz, true);
+		}
+	}
+}
+
+//-------------------------------------------------.
+CSkinInfluences::CSkinInfluences ()
+{
+	clear();
+}
+
+void CSkinInfluences::clear ()
+{
+	verticesCount = 0;
+	fixedCount    = 0;
+	offsets.clear();
+	offsets.push_back(0);
+	jointIndices.clear();
+	weights.clear();
+}
+
+/**
+ * CSR形式で、頂点を追加.
+ */
+void CSkinInfluences::appendVertex (const int count, const int* jointIndices, const float* weights)
+{
+	for (int i = 0; i < count; ++i) {
+		this->jointIndices.push_back(jointIndices[i]);
+		this->weights.push_back(weights[i]);
+	}
+	offsets.push_back((int)this->jointIndices.size());
+	verticesCount++;
+}
+
+/**
+ * 頂点ごとの影響数の最大.
+ */
+int CSkinInfluences::getMaxInfluencesCount () const
+{
+	if (fixedCount > 0) return fixedCount;
+	int maxCou = 0;
+	for (int i = 0; i < verticesCount; ++i) maxCou = std::max(maxCou, offsets[i + 1] - offsets[i]);
+	return maxCou;
+}
+
+/**
+ * 頂点ごとにウエイト値の大きい順にcount個を残した、固定形式に変換.
+ * 省いた影響のウエイト値は、残した影響に比率で割り振る (ウエイト値の合計は変わらない).
+ */
+void CSkinInfluences::toFixed (const int count, CSkinInfluences& dst) const
+{
+	const int fixedCou = std::max(1, count);
+	dst.clear();
+	dst.verticesCount = verticesCount;
+	dst.fixedCount    = fixedCou;
+	dst.offsets.clear();
+	dst.jointIndices.assign((size_t)verticesCount * fixedCou, 0);
+	dst.weights.assign((size_t)verticesCount * fixedCou, 0.0f);
+
+	std::vector< std::pair<float, int> > list;
+	for (int i = 0; i < verticesCount; ++i) {
+		list.clear();
+		float sumW = 0.0f;
+		const int iEnd = getEnd(i);
+		for (int j = getBegin(i); j < iEnd; ++j) {
+			if (weights[j] == 0.0f) continue;
+			list.push_back(std::make_pair(-weights[j], jointIndices[j]));
+			sumW += weights[j];
+		}
+		const int cou = std::min(fixedCou, (int)list.size());
+		if (cou <= 0) continue;
+		if ((int)list.size() > cou) std::partial_sort(list.begin(), list.begin() + cou, list.end());
+
+		float keptW = 0.0f;
+		for (int j = 0; j < cou; ++j) keptW -= list[j].first;
+		const float scale = (keptW != 0.0f) ? (sumW / keptW) : 1.0f;
+		for (int j = 0; j < cou; ++j) {
+			dst.jointIndices[i * fixedCou + j] = list[j].second;
+			dst.weights[i * fixedCou + j]      = -list[j].first * scale;
+		}
+	}
+}
+
+//-------------------------------------------------.
+/**
+ * ボーン階層から、ボーンごとのスキン変形の行列を計算.
+ * シーケンスOff時のボーンの変換行列(bone->get_matrix())をバインドポーズ、形状の変換行列を現在のポーズとする.
+ */
+void SkinDeform::calcSkinningMatrices (const CBoneSkeleton& skeleton, std::vector<sxsdk::mat4>& matrices)
+{
+	const int bonesCou = skeleton.getBonesCount();
+	const std::vector<int>& parents = skeleton.getParents();
+	const std::vector<sxsdk::mat4>& localMatrices = skeleton.getLocalMatrices();
+	const std::vector<sxsdk::mat4>& worldMatrices = skeleton.getWorldMatrices();
+
+	// 親は子より前にあるため、先頭から順にバインドポーズのワールド変換行列を計算できる.
+	std::vector<sxsdk::mat4> bindMatrices(bonesCou);
+	matrices.resize(bonesCou);
+	for (int i = 0; i < bonesCou; ++i) {
+		const sxsdk::mat4& parentM = (parents[i] >= 0) ? bindMatrices[ parents[i] ] : skeleton.getRootLocalToWorldMatrix();
+		bindMatrices[i] = localMatrices[i] * parentM;
+		matrices[i] = inv(bindMatrices[i]) * worldMatrices[i];
+	}
+}
+
+/**
+ * 頂点座標(と法線)をスキン変形.
+ * 頂点を一定数ずつのブロックに分けて、複数スレッドで並列に計算する.
+ * @return 頂点数とボーン番号が正しい場合はtrue.
+ */
+bool SkinDeform::deformVertices (const SKIN_DEFORM_TYPE type, const std::vector<sxsdk::mat4>& matrices, const CSkinInfluences& influences,
+	const std::vector<sxsdk::vec3>& vertices, std::vector<sxsdk::vec3>& dstVertices,
+	const std::vector<sxsdk::vec3>* normals, std::vector<sxsdk::vec3>* dstNormals)
+{
+	CProfileScope profileScope(profile_skin_deform);
+	CTraceScope traceScope("SkinDeform::deformVertices", "vertices", (long long)vertices.size(), "joints", (long long)matrices.size());
+
+	const int vCou = (int)vertices.size();
+	const int jointsCou = (int)matrices.size();
+	if (influences.verticesCount != vCou || &dstVertices == &vertices) return false;
+	if (normals && (!dstNormals || (int)normals->size() != vCou || dstNormals == normals)) return false;
+	if (influences.jointIndices.size() != influences.weights.size()) return false;
+	if (influences.fixedCount <= 0 && (int)influences.offsets.size() != vCou + 1) return false;
+	if (influences.fixedCount > 0 && influences.jointIndices.size() != (size_t)vCou * influences.fixedCount) return false;
+	for (size_t i = 0; i < influences.jointIndices.size(); ++i) {
+		if (influences.jointIndices[i] < 0 || influences.jointIndices[i] >= jointsCou) return false;
+	}
+
+	dstVertices.resize(vCou);
+	if (normals) dstNormals->resize(vCou);
+	if (vCou <= 0) return true;
+
+	try {
+		CSkinDeformContext context;
+		context.influences  = &influences;
+		context.vertices    = &vertices;
+		context.normals     = normals;
+		context.dstVertices = &dstVertices;
+		context.dstNormals  = dstNormals;
+
+		// ボーンごとの行列またはデュアルクォータニオンは、先にまとめて変換しておく.
+		const int valuesCou = (type == skin_deform_dual_quaternion) ? 8 : 12;
+		context.jointValues.resize(std::max(1, jointsCou) * valuesCou, 0.0f);
+		for (int i = 0; i < jointsCou; ++i) {
+			if (type == skin_deform_dual_quaternion) m_matrixToDualQuaternion(matrices[i], &context.jointValues[i * valuesCou]);
+			else m_matrixToFloat12(matrices[i], &context.jointValues[i * valuesCou]);
+		}
+
+		const int blocksCou = (vCou + SKIN_BLOCK_SIZE - 1) / SKIN_BLOCK_SIZE;
+		const bool ret = ParallelUtil::parallelFor(blocksCou, [&](int blockIndex) {
+			const int start = blockIndex * SKIN_BLOCK_SIZE;
+			const int cou   = std::min(SKIN_BLOCK_SIZE, vCou - start);
+			if (type == skin_deform_dual_quaternion) m_deformBlockDualQuaternion(context, start, cou);
+			else m_deformBlockLinear(context, start, cou);
+		}, SKIN_MIN_PARALLEL_BLOCKS);
+
+		return ret;
+	} catch (...) { }
+
+	return false;
+}
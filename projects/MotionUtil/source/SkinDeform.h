@@ -0,0 +1,97 @@
+﻿/**
+ * ボーンによるスキン変形 (Linear Blend Skinning / Dual Quaternion Skinning).
+ * SDKの関数は呼ばないため、プレビューやエクスポートでの変形をメインスレッド以外でも計算できる.
+ * 入力の頂点座標には、CMorphTargetsCtrl::calcMeshVerticesでのMorph Targetsの変形結果をそのまま渡せる.
+ */
+#ifndef _SKINDEFORM_H
+#define _SKINDEFORM_H
+
+#include "GlobalHeader.h"
+
+#include <vector>
+
+class CBoneSkeleton;
+
+/**
+ * スキン変形の種類.
+ */
+enum SKIN_DEFORM_TYPE {
+	skin_deform_linear = 0,					// 行列の線形補間 (Linear Blend Skinning).
+	skin_deform_dual_quaternion,			// デュアルクォータニオンの補間 (Dual Quaternion Skinning). 行列のスケールは無視する.
+};
+
+/**
+ * 頂点ごとのボーンの影響.
+ * 頂点ごとに影響数が異なるCSR形式と、頂点ごとに一定数(ウエイト値0で埋める)の固定形式を持つ.
+ * ウエイト値の合計が1.0未満の場合、残りは変形前の位置のままとなる (影響を持たない頂点は変形しない).
+ */
+class CSkinInfluences
+{
+public:
+	int verticesCount;						// 頂点数.
+	int fixedCount;							// 固定形式での頂点ごとの影響数 (0の場合はCSR形式).
+	std::vector<int> offsets;				// CSR形式での頂点ごとの先頭位置 (頂点数 + 1個).
+	std::vector<int> jointIndices;			// ボーン番号 (スキン変形の行列の番号).
+	std::vector<float> weights;				// ウエイト値.
+
+public:
+	CSkinInfluences ();
+
+	void clear ();
+
+	/**
+	 * CSR形式で、頂点を追加.
+	 * @param[in] count         影響数.
+	 * @param[in] jointIndices  ボーン番号.
+	 * @param[in] weights       ウエイト値.
+	 */
+	void appendVertex (const int count, const int* jointIndices, const float* weights);
+
+	/**
+	 * 頂点の影響の範囲 (jointIndices/weightsでの位置).
+	 */
+	int getBegin (const int vIndex) const { return fixedCount > 0 ? vIndex * fixedCount : offsets[vIndex]; }
+	int getEnd (const int vIndex) const { return fixedCount > 0 ? (vIndex + 1) * fixedCount : offsets[vIndex + 1]; }
+
+	/**
+	 * 頂点ごとの影響数の最大.
+	 */
+	int getMaxInfluencesCount () const;
+
+	/**
+	 * 頂点ごとにウエイト値の大きい順にcount個を残した、固定形式に変換.
+	 * 省いた影響のウエイト値は、残した影響に比率で割り振る (ウエイト値の合計は変わらない).
+	 * @param[in]  count  頂点ごとの影響数.
+	 * @param[out] dst    変換後の影響.
+	 */
+	void toFixed (const int count, CSkinInfluences& dst) const;
+};
+
+namespace SkinDeform
+{
+	/**
+	 * ボーン階層から、ボーンごとのスキン変形の行列を計算.
+	 * シーケンスOff時のボーンの変換行列(bone->get_matrix())をバインドポーズ、形状の変換行列を現在のポーズとする.
+	 * @param[in]  skeleton  ボーン階層.
+	 * @param[out] matrices  ボーンごとの (バインドポーズのワールド変換行列の逆行列 * 現在のポーズのワールド変換行列).
+	 */
+	void calcSkinningMatrices (const CBoneSkeleton& skeleton, std::vector<sxsdk::mat4>& matrices);
+
+	/**
+	 * 頂点座標(と法線)をスキン変形.
+	 * 頂点を一定数ずつのブロックに分けて、複数スレッドで並列に計算する.
+	 * @param[in]  type         スキン変形の種類.
+	 * @param[in]  matrices     ボーンごとのスキン変形の行列.
+	 * @param[in]  influences   頂点ごとのボーンの影響.
+	 * @param[in]  vertices     変形前の頂点座標.
+	 * @param[out] dstVertices  変形後の頂点座標 (verticesと同じ配列は指定できない).
+	 * @param[in]  normals      変形前の法線 (NULLの場合は法線を変形しない).
+	 * @param[out] dstNormals   変形後の法線 (正規化済み). 行列の線形補間では、合成した行列の逆転置行列で変換する.
+	 * @return 頂点数とボーン番号が正しい場合はtrue.
+	 */
+	bool deformVertices (const SKIN_DEFORM_TYPE type, const std::vector<sxsdk::mat4>& matrices, const CSkinInfluences& influences,
+		const std::vector<sxsdk::vec3>& vertices, std::vector<sxsdk::vec3>& dstVertices,
+		const std::vector<sxsdk::vec3>* normals = NULL, std::vector<sxsdk::vec3>* dstNormals = NULL);
+}
+
+#endif
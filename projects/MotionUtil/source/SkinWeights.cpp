@@ -0,0 +1,270 @@
+﻿/**
+ * ポリゴンメッシュのスキンのウエイト値の取得.
+ */
+#include "SkinWeights.h"
+#include "BoneSkeleton.h"
+#include "ProfileUtil.h"
+#include "SkinDeform.h"
+#include "TraceUtil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace {
+	/**
+	 * 1つの影響 (ボーン番号とウエイト値).
+	 */
+	class CSkinWeightEntry {
+	public:
+		int jointIndex;
+		float weight;
+
+	public:
+		CSkinWeightEntry (const int jointIndex = 0, const float weight = 0.0f) : jointIndex(jointIndex), weight(weight) { }
+
+		/**
+		 * ウエイト値の大きい順 (同じ場合はボーン番号の小さい順).
+		 */
+		bool operator < (const CSkinWeightEntry& e) const {
+			if (weight != e.weight) return weight > e.weight;
+			return jointIndex < e.jointIndex;
+		}
+	};
+
+	/**
+	 * 0.0 - 1.0のウエイト値を量子化.
+	 */
+	int m_quantizeWeight (const float w)
+	{
+		return std::min(65535, std::max(0, (int)std::floor(w * 65535.0f + 0.5f)));
+	}
+}
+
+//-------------------------------------------------.
+CSkinWeightStats::CSkinWeightStats ()
+{
+	clear();
+}
+
+void CSkinWeightStats::clear ()
+{
+	verticesCount         = 0;
+	jointsCount           = 0;
+	sourceInfluencesCount = 0;
+	influencesCount       = 0;
+	prunedCount           = 0;
+	setsCount             = 0;
+	sourceBytes           = 0;
+	tableBytes            = 0;
+	maxWeightError        = 0.0f;
+}
+
+//-------------------------------------------------.
+CSkinWeightTable::CSkinWeightTable ()
+{
+	clear();
+}
+
+void CSkinWeightTable::clear ()
+{
+	verticesCount = 0;
+	jointHandles.clear();
+	vertexSets.clear();
+	setOffsets.clear();
+	setOffsets.push_back(0);
+	jointIndices.clear();
+	weights.clear();
+}
+
+/**
+ * 表のバイト数.
+ */
+long long CSkinWeightTable::getBytes () const
+{
+	return (long long)jointHandles.size() * (long long)sizeof(void *)
+		+ (long long)vertexSets.size() * (long long)sizeof(int)
+		+ (long long)setOffsets.size() * (long long)sizeof(int)
+		+ (long long)jointIndices.size() * (long long)sizeof(unsigned short)
+		+ (long long)weights.size() * (long long)sizeof(unsigned short);
+}
+
+/**
+ * スキン変形用の、頂点ごとのCSR形式の影響に展開.
+ */
+void CSkinWeightTable::toInfluences (CSkinInfluences& influences) const
+{
+	influences.clear();
+	influences.offsets.reserve(verticesCount + 1);
+
+	std::vector<int> setJoints;
+	std::vector<float> setWeights;
+	for (int i = 0; i < verticesCount; ++i) {
+		const int setIndex = vertexSets[i];
+		if (setIndex < 0) {
+			influences.appendVertex(0, NULL, NULL);
+			continue;
+		}
+		setJoints.clear();
+		setWeights.clear();
+		for (int j = setOffsets[setIndex]; j < setOffsets[setIndex + 1]; ++j) {
+			setJoints.push_back((int)jointIndices[j]);
+			setWeights.push_back(toWeight(weights[j]));
+		}
+		influences.appendVertex((int)setJoints.size(), &setJoints[0], &setWeights[0]);
+	}
+}
+
+//-------------------------------------------------.
+/**
+ * ポリゴンメッシュのスキンのウエイト値を読み込み、表に変換.
+ * @return スキンを持つポリゴンメッシュの場合はtrue.
+ */
+bool SkinWeights::readSkinWeights (sxsdk::shape_class& shape, const CSkinWeightOptions& options, CSkinWeightTable& table, CSkinWeightStats* stats, const CBoneSkeleton* skeleton)
+{
+	CProfileScope profileScope(profile_skin_weights_read);
+	CTraceScope traceScope("SkinWeights::readSkinWeights", "shape", (long long)(size_t)shape.get_handle());
+
+	table.clear();
+	if (stats) stats->clear();
+	if (shape.get_type() != sxsdk::enums::polygon_mesh) return false;
+
+	CSkinWeightStats readStats;
+	try {
+		sxsdk::polygon_mesh_class& pMesh = shape.get_polygon_mesh();
+		if (pMesh.get_skin_type() == sxsdk::enums::no_skin) return false;
+
+		const int vCou = pMesh.get_total_number_of_control_points();
+		const int maxInfluencesCou = std::max(1, options.maxInfluences);
+		table.verticesCount = vCou;
+		table.vertexSets.resize(vCou, -1);
+
+		// ボーン形状のハンドルからボーン番号.
+		std::map<void *, int> jointsMap;
+		if (skeleton) {
+			for (int i = 0; i < skeleton->getBonesCount(); ++i) {
+				void* handle = skeleton->getShape(i)->get_handle();
+				jointsMap[handle] = i;
+				table.jointHandles.push_back(handle);
+			}
+		}
+
+		// 同じ影響のセットを共有するための、ボーン番号と(共有の許容誤差で丸めた)ウエイト値からセット番号.
+		const bool mergeF = (options.mergeTolerance >= 0.0f);
+		const int mergeStep = std::max(1, (int)(options.mergeTolerance * 65535.0f));
+		std::map<std::vector<unsigned int>, int> setsMap;
+		std::vector<unsigned int> setKey;
+
+		std::vector<CSkinWeightEntry> srcEntries;
+		std::vector<CSkinWeightEntry> entries;
+		std::vector<int> qWeights;
+		for (int i = 0; i < vCou; ++i) {
+			// 頂点のバインド情報を読み込み (同じボーンが複数ある場合は合計する).
+			srcEntries.clear();
+			sxsdk::skin_class& skin = pMesh.vertex(i).get_skin();
+			const int bindsCou = skin.get_number_of_binds();
+			for (int j = 0; j < bindsCou; ++j) {
+				const sxsdk::skin_bind_class& bind = skin.get_bind(j);
+				sxsdk::shape_class* pBoneShape = bind.get_shape();
+				const float w = bind.get_weight();
+				if (!pBoneShape || !(w > 0.0f)) continue;
+
+				void* handle = pBoneShape->get_handle();
+				std::map<void *, int>::const_iterator it = jointsMap.find(handle);
+				int jointIndex;
+				if (it != jointsMap.end()) {
+					jointIndex = it->second;
+				} else {
+					jointIndex = (int)table.jointHandles.size();
+					jointsMap[handle] = jointIndex;
+					table.jointHandles.push_back(handle);
+				}
+				size_t k = 0;
+				for (; k < srcEntries.size(); ++k) {
+					if (srcEntries[k].jointIndex == jointIndex) break;
+				}
+				if (k < srcEntries.size()) srcEntries[k].weight += w;
+				else srcEntries.push_back(CSkinWeightEntry(jointIndex, w));
+			}
+			readStats.sourceInfluencesCount += (int)srcEntries.size();
+			if (srcEntries.empty()) continue;
+
+			// ウエイト値の大きい順に最大影響数まで残し、省いた分を比率で割り振る.
+			float srcSum = 0.0f;
+			for (size_t j = 0; j < srcEntries.size(); ++j) srcSum += srcEntries[j].weight;
+			entries = srcEntries;
+			std::sort(entries.begin(), entries.end());
+			int keepCou = std::min((int)entries.size(), maxInfluencesCou);
+			while (keepCou > 1 && entries[keepCou - 1].weight < options.minWeight) keepCou--;
+			entries.resize(keepCou);
+			readStats.prunedCount += (int)srcEntries.size() - keepCou;
+
+			float keptSum = 0.0f;
+			for (int j = 0; j < keepCou; ++j) keptSum += entries[j].weight;
+			const float dstSum = options.normalizeToOne ? 1.0f : std::min(1.0f, srcSum);
+			const float scale = (keptSum > 0.0f) ? (dstSum / keptSum) : 0.0f;
+
+			// 量子化し、丸めによる合計のずれは最も大きいウエイト値で調整する.
+			qWeights.resize(keepCou);
+			int qSum = 0;
+			for (int j = 0; j < keepCou; ++j) {
+				qWeights[j] = m_quantizeWeight(entries[j].weight * scale);
+				qSum += qWeights[j];
+			}
+			qWeights[0] = std::min(65535, std::max(0, qWeights[0] + (m_quantizeWeight(dstSum) - qSum)));
+
+			// セットを共有するか.
+			int setIndex = -1;
+			if (mergeF) {
+				setKey.clear();
+				for (int j = 0; j < keepCou; ++j) {
+					setKey.push_back((unsigned int)entries[j].jointIndex);
+					setKey.push_back((unsigned int)((qWeights[j] + mergeStep / 2) / mergeStep));
+				}
+				std::map<std::vector<unsigned int>, int>::const_iterator it = setsMap.find(setKey);
+				if (it != setsMap.end()) setIndex = it->second;
+			}
+			if (setIndex < 0) {
+				setIndex = table.getSetsCount();
+				for (int j = 0; j < keepCou; ++j) {
+					table.jointIndices.push_back((unsigned short)entries[j].jointIndex);
+					table.weights.push_back((unsigned short)qWeights[j]);
+				}
+				table.setOffsets.push_back((int)table.jointIndices.size());
+				if (mergeF) setsMap[setKey] = setIndex;
+			}
+			table.vertexSets[i] = setIndex;
+			readStats.influencesCount += keepCou;
+
+			// 読み込んだウエイト値に対する誤差 (省いた影響は、そのウエイト値が誤差となる).
+			const int setStart = table.setOffsets[setIndex];
+			const int setEnd   = table.setOffsets[setIndex + 1];
+			for (size_t j = 0; j < srcEntries.size(); ++j) {
+				float w = 0.0f;
+				for (int k = setStart; k < setEnd; ++k) {
+					if ((int)table.jointIndices[k] == srcEntries[j].jointIndex) w = CSkinWeightTable::toWeight(table.weights[k]);
+				}
+				readStats.maxWeightError = std::max(readStats.maxWeightError, std::abs(w - srcEntries[j].weight));
+			}
+		}
+
+		// ボーン番号は16bitで保持する.
+		if (table.jointHandles.size() > 65536) {
+			table.clear();
+			return false;
+		}
+
+		readStats.verticesCount = vCou;
+		readStats.jointsCount   = (int)table.jointHandles.size();
+		readStats.setsCount     = table.getSetsCount();
+		readStats.sourceBytes   = (long long)(vCou + 1) * (long long)sizeof(int) + (long long)readStats.sourceInfluencesCount * (long long)(sizeof(int) + sizeof(float));
+		readStats.tableBytes    = table.getBytes();
+		traceScope.setEndArg("sets", (long long)readStats.setsCount);
+		if (stats) *stats = readStats;
+		return true;
+
+	} catch (...) { }
+
+	table.clear();
+	return false;
+}
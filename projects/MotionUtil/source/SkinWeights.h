@@ -0,0 +1,106 @@
+﻿/**
+ * ポリゴンメッシュのスキンのウエイト値の取得.
+ * 頂点ごとのバインド情報を1度だけ読み込み、影響数の制限/正規化/量子化を行ったコンパクトな表に変換する.
+ */
+#ifndef _SKINWEIGHTS_H
+#define _SKINWEIGHTS_H
+
+#include "GlobalHeader.h"
+
+#include <vector>
+
+class CBoneSkeleton;
+class CSkinInfluences;
+
+/**
+ * ウエイト値の変換の指定.
+ */
+class CSkinWeightOptions
+{
+public:
+	int maxInfluences;						// 頂点ごとの最大影響数 (ウエイト値の大きい順に残す).
+	float minWeight;						// このウエイト値未満の影響は省く.
+	bool normalizeToOne;					// ウエイト値の合計を1.0にする (falseの場合は、省く前の合計に合わせる).
+	float mergeTolerance;					// 影響するボーンが同じで、ウエイト値の差がこの値以内の頂点は影響のセットを共有する (負の場合は共有しない).
+
+public:
+	CSkinWeightOptions () : maxInfluences(4), minWeight(0.0f), normalizeToOne(false), mergeTolerance(0.0f) { }
+};
+
+/**
+ * 変換結果の統計情報.
+ */
+class CSkinWeightStats
+{
+public:
+	int verticesCount;						// 頂点数.
+	int jointsCount;						// 影響するボーン数.
+	int sourceInfluencesCount;				// 読み込んだ影響の数 (ウエイト値0は除く).
+	int influencesCount;					// 変換後の影響の数 (共有前の頂点ごとの合計).
+	int prunedCount;						// 省いた影響の数.
+	int setsCount;							// 影響のセットの数.
+	long long sourceBytes;					// 頂点ごとのCSR形式(int + float)で保持した場合のバイト数.
+	long long tableBytes;					// 変換後の表のバイト数.
+	float maxWeightError;					// 読み込んだウエイト値に対する、変換後のウエイト値の誤差の最大.
+
+public:
+	CSkinWeightStats ();
+
+	void clear ();
+};
+
+/**
+ * スキンのウエイト値の表.
+ * 影響のセット(ボーン番号と量子化したウエイト値の組)をCSR形式で持ち、頂点はセットの番号を参照する.
+ */
+class CSkinWeightTable
+{
+public:
+	int verticesCount;								// 頂点数.
+	std::vector<void *> jointHandles;				// ボーン番号ごとのボーン形状のハンドル.
+	std::vector<int> vertexSets;					// 頂点ごとの影響のセット番号 (影響を持たない場合は-1).
+	std::vector<int> setOffsets;					// セットごとの先頭位置 (セット数 + 1個).
+	std::vector<unsigned short> jointIndices;		// ボーン番号.
+	std::vector<unsigned short> weights;			// ウエイト値 (0 - 65535 で 0.0 - 1.0).
+
+public:
+	CSkinWeightTable ();
+
+	void clear ();
+
+	/**
+	 * セット数.
+	 */
+	int getSetsCount () const { return (int)setOffsets.size() - 1; }
+
+	/**
+	 * 表のバイト数.
+	 */
+	long long getBytes () const;
+
+	/**
+	 * 量子化したウエイト値を取得.
+	 */
+	static float toWeight (const unsigned short w) { return (float)w * (1.0f / 65535.0f); }
+
+	/**
+	 * スキン変形用の、頂点ごとのCSR形式の影響に展開.
+	 */
+	void toInfluences (CSkinInfluences& influences) const;
+};
+
+namespace SkinWeights
+{
+	/**
+	 * ポリゴンメッシュのスキンのウエイト値を読み込み、表に変換.
+	 * @param[in]  shape     対象のポリゴンメッシュ.
+	 * @param[in]  options   変換の指定.
+	 * @param[out] table     ウエイト値の表.
+	 * @param[out] stats     統計情報 (NULLの場合は返さない).
+	 * @param[in]  skeleton  ボーン階層 (NULLでない場合、ボーン番号をスナップショットの番号と同じにする).
+	 * @return スキンを持つポリゴンメッシュの場合はtrue.
+	 */
+	bool readSkinWeights (sxsdk::shape_class& shape, const CSkinWeightOptions& options, CSkinWeightTable& table, CSkinWeightStats* stats = NULL, const CBoneSkeleton* skeleton = NULL);
+}
+
+#endif
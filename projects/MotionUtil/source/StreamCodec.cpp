@@ -0,0 +1,289 @@
+﻿/**
+ * streamに保存する頂点情報の圧縮/展開.
+ */
+#include "StreamCodec.h"
+
+#include <algorithm>
+#include <string.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h>
+	#include <nmmintrin.h>
+	#define STREAMCODEC_CRC32C_X86
+	#define STREAMCODEC_CRC32C_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	#include <cpuid.h>
+	#include <nmmintrin.h>
+	#define STREAMCODEC_CRC32C_X86
+	#define STREAMCODEC_CRC32C_TARGET __attribute__((target("sse4.2")))
+#elif defined(__ARM_FEATURE_CRC32)
+	#include <arm_acle.h>
+	#define STREAMCODEC_CRC32C_ARM
+#endif
+
+namespace {
+	inline unsigned int m_floatToBits (const float v)
+	{
+		unsigned int u;
+		memcpy(&u, &v, sizeof(u));
+		return u;
+	}
+
+	inline float m_bitsToFloat (const unsigned int u)
+	{
+		float v;
+		memcpy(&v, &u, sizeof(v));
+		return v;
+	}
+
+	/**
+	 * 差分(符号付き)を、0に近いほど小さな値となる符号なし整数に変換 (ZigZag符号化).
+	 */
+	inline unsigned int m_zigzag (const unsigned int d)
+	{
+		return (d << 1) ^ (0u - (d >> 31));
+	}
+
+	inline unsigned int m_unzigzag (const unsigned int v)
+	{
+		return (v >> 1) ^ (0u - (v & 1));
+	}
+
+	inline void m_writeVarint (std::vector<unsigned char>& dst, unsigned int v)
+	{
+		while (v >= 0x80) {
+			dst.push_back((unsigned char)(v | 0x80));
+			v >>= 7;
+		}
+		dst.push_back((unsigned char)v);
+	}
+
+	inline bool m_readVarint (const unsigned char*& p, const unsigned char* pEnd, unsigned int& v)
+	{
+		v = 0;
+		for (int shift = 0; shift < 35 && p < pEnd; shift += 7) {
+			const unsigned char c = *p++;
+			v |= (unsigned int)(c & 0x7f) << shift;
+			if (!(c & 0x80)) return true;
+		}
+		return false;
+	}
+
+	/**
+	 * CRC32Cの計算用テーブル (8バイトずつ処理するため、8つのテーブルを持つ).
+	 */
+	class CCRC32CTable
+	{
+	public:
+		unsigned int table[8][256];
+
+	public:
+		CCRC32CTable ()
+		{
+			for (unsigned int i = 0; i < 256; ++i) {
+				unsigned int crc = i;
+				for (int j = 0; j < 8; ++j) crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+				table[0][i] = crc;
+			}
+			for (unsigned int i = 0; i < 256; ++i) {
+				for (int j = 1; j < 8; ++j) table[j][i] = (table[j - 1][i] >> 8) ^ table[0][table[j - 1][i] & 0xff];
+			}
+		}
+	};
+
+	unsigned int m_crc32cSoftware (unsigned int crc, const unsigned char* p, size_t size)
+	{
+		static const CCRC32CTable crcTable;
+		const unsigned int (*t)[256] = crcTable.table;
+
+		while (size >= 8) {
+			unsigned int lo, hi;
+			memcpy(&lo, p, 4);
+			memcpy(&hi, p + 4, 4);
+			lo ^= crc;
+			crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+			      t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+			p    += 8;
+			size -= 8;
+		}
+		while (size > 0) {
+			crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+			--size;
+		}
+		return crc;
+	}
+
+#if defined(STREAMCODEC_CRC32C_X86)
+	bool m_hasSSE42 ()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (info[2] & (1 << 20)) != 0;
+#else
+		unsigned int a, b, c, d;
+		if (!__get_cpuid(1, &a, &b, &c, &d)) return false;
+		return (c & bit_SSE4_2) != 0;
+#endif
+	}
+
+	STREAMCODEC_CRC32C_TARGET unsigned int m_crc32cHardware (unsigned int crc, const unsigned char* p, size_t size)
+	{
+#if defined(_M_X64) || defined(__x86_64__)
+		unsigned long long crc64 = crc;
+		while (size >= 8) {
+			unsigned long long v;
+			memcpy(&v, p, 8);
+			crc64 = _mm_crc32_u64(crc64, v);
+			p    += 8;
+			size -= 8;
+		}
+		crc = (unsigned int)crc64;
+#else
+		while (size >= 4) {
+			unsigned int v;
+			memcpy(&v, p, 4);
+			crc = _mm_crc32_u32(crc, v);
+			p    += 4;
+			size -= 4;
+		}
+#endif
+		while (size > 0) {
+			crc = _mm_crc32_u8(crc, *p++);
+			--size;
+		}
+		return crc;
+	}
+
+	const bool g_useHardwareCRC32C = m_hasSSE42();		// SSE4.2のCRC32命令を使用するか.
+
+#elif defined(STREAMCODEC_CRC32C_ARM)
+	unsigned int m_crc32cHardware (unsigned int crc, const unsigned char* p, size_t size)
+	{
+		while (size >= 8) {
+			unsigned long long v;
+			memcpy(&v, p, 8);
+			crc   = __crc32cd(crc, v);
+			p    += 8;
+			size -= 8;
+		}
+		while (size > 0) {
+			crc = __crc32cb(crc, *p++);
+			--size;
+		}
+		return crc;
+	}
+
+	const bool g_useHardwareCRC32C = true;
+#endif
+}
+
+/**
+ * 頂点インデックスを圧縮してdstの末尾に追加.
+ */
+void StreamCodec::encodeIndices (const int* src, const int count, std::vector<unsigned char>& dst)
+{
+	dst.reserve(dst.size() + count);
+	unsigned int prev = 0;
+	for (int i = 0; i < count; ++i) {
+		const unsigned int v = (unsigned int)src[i];
+		m_writeVarint(dst, m_zigzag(v - prev));
+		prev = v;
+	}
+}
+
+/**
+ * 頂点インデックスを展開.
+ */
+bool StreamCodec::decodeIndices (const unsigned char* src, const int size, const int count, int* dst)
+{
+	const unsigned char* p    = src;
+	const unsigned char* pEnd = src + size;
+	unsigned int prev = 0;
+	unsigned int d;
+	for (int i = 0; i < count; ++i) {
+		if (!m_readVarint(p, pEnd, d)) return false;
+		prev += m_unzigzag(d);
+		dst[i] = (int)prev;
+	}
+	return (p == pEnd);
+}
+
+/**
+ * 頂点座標を圧縮してdstの末尾に追加.
+ */
+void StreamCodec::encodeVertices (const sxsdk::vec3* src, const int count, const sxsdk::vec3* baseVertices, const int* vIndices, std::vector<unsigned char>& dst)
+{
+	dst.reserve(dst.size() + count * 3 * 2);
+	unsigned int prev[3] = {0, 0, 0};
+	for (int i = 0; i < count; ++i) {
+		const sxsdk::vec3& v = src[i];
+		if (baseVertices) {
+			const sxsdk::vec3& baseV = baseVertices[ vIndices[i] ];
+			prev[0] = m_floatToBits(baseV.x);
+			prev[1] = m_floatToBits(baseV.y);
+			prev[2] = m_floatToBits(baseV.z);
+		}
+		const unsigned int bits[3] = {m_floatToBits(v.x), m_floatToBits(v.y), m_floatToBits(v.z)};
+		for (int j = 0; j < 3; ++j) {
+			m_writeVarint(dst, m_zigzag(bits[j] - prev[j]));
+			prev[j] = bits[j];
+		}
+	}
+}
+
+/**
+ * 頂点座標を展開.
+ */
+bool StreamCodec::decodeVertices (const unsigned char* src, const int size, const int count, const sxsdk::vec3* baseVertices, const int baseCount, const int* vIndices, sxsdk::vec3* dst)
+{
+	const unsigned char* p    = src;
+	const unsigned char* pEnd = src + size;
+	unsigned int prev[3] = {0, 0, 0};
+	unsigned int d;
+	for (int i = 0; i < count; ++i) {
+		if (baseVertices) {
+			const int vIndex = vIndices[i];
+			if (vIndex < 0 || vIndex >= baseCount) return false;
+			const sxsdk::vec3& baseV = baseVertices[vIndex];
+			prev[0] = m_floatToBits(baseV.x);
+			prev[1] = m_floatToBits(baseV.y);
+			prev[2] = m_floatToBits(baseV.z);
+		}
+		for (int j = 0; j < 3; ++j) {
+			if (!m_readVarint(p, pEnd, d)) return false;
+			prev[j] += m_unzigzag(d);
+		}
+		dst[i] = sxsdk::vec3(m_bitsToFloat(prev[0]), m_bitsToFloat(prev[1]), m_bitsToFloat(prev[2]));
+	}
+	return (p == pEnd);
+}
+
+/**
+ * CRC32C (Castagnoli) を計算.
+ */
+unsigned int StreamCodec::calcCRC32C (const void* data, const size_t size, const unsigned int crc)
+{
+	const unsigned char* p = (const unsigned char *)data;
+#if defined(STREAMCODEC_CRC32C_X86) || defined(STREAMCODEC_CRC32C_ARM)
+	if (g_useHardwareCRC32C) return ~m_crc32cHardware(~crc, p, size);
+#endif
+	return ~m_crc32cSoftware(~crc, p, size);
+}
+
+/**
+ * 頂点インデックスがすべて minValue - maxValue の範囲内か.
+ */
+bool StreamCodec::checkIndicesRange (const int* indices, const int count, const int minValue, const int maxValue)
+{
+	if (count <= 0) return true;
+
+	// 自動ベクトル化されるように、分岐を持たないループで最小値/最大値を求める.
+	int minV = indices[0];
+	int maxV = indices[0];
+	for (int i = 1; i < count; ++i) {
+		minV = std::min(minV, indices[i]);
+		maxV = std::max(maxV, indices[i]);
+	}
+	return (minV >= minValue && maxV <= maxValue);
+}
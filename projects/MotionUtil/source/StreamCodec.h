@@ -0,0 +1,75 @@
+﻿/**
+ * streamに保存する頂点情報の圧縮/展開.
+ * 頂点インデックスは1つ前の値との差分、頂点座標はfloatのビット列の予測値との差分を.
+ * ZigZag符号化した可変長整数(7ビットごと)として格納する。可逆で、展開後の値は元の値と一致する.
+ * また、streamの破損を検出するためのCRC32Cと、頂点インデックスの範囲チェックを行う.
+ */
+#ifndef _STREAMCODEC_H
+#define _STREAMCODEC_H
+
+#include "GlobalHeader.h"
+
+#include <vector>
+
+namespace StreamCodec
+{
+	/**
+	 * 頂点インデックスを圧縮してdstの末尾に追加.
+	 * @param[in]  src    頂点インデックス.
+	 * @param[in]  count  要素数.
+	 * @param[out] dst    圧縮したバイト列が追加される.
+	 */
+	void encodeIndices (const int* src, const int count, std::vector<unsigned char>& dst);
+
+	/**
+	 * 頂点インデックスを展開.
+	 * @param[in]  src    圧縮したバイト列.
+	 * @param[in]  size   srcのバイト数.
+	 * @param[in]  count  要素数.
+	 * @param[out] dst    count個の頂点インデックスが格納される.
+	 * @return バイト列が不正な場合はfalse.
+	 */
+	bool decodeIndices (const unsigned char* src, const int size, const int count, int* dst);
+
+	/**
+	 * 頂点座標を圧縮してdstの末尾に追加.
+	 * baseVertices/vIndicesを指定した場合は、対応するベースの頂点座標との差分を格納する (Targetの頂点用).
+	 * 指定しない場合は、1つ前の頂点座標との差分を格納する (ベースの頂点用).
+	 * @param[in]  src           頂点座標.
+	 * @param[in]  count         要素数.
+	 * @param[in]  baseVertices  ベースの頂点座標 (NULLの場合は使用しない).
+	 * @param[in]  vIndices      srcの各頂点に対応するベースの頂点インデックス.
+	 * @param[out] dst           圧縮したバイト列が追加される.
+	 */
+	void encodeVertices (const sxsdk::vec3* src, const int count, const sxsdk::vec3* baseVertices, const int* vIndices, std::vector<unsigned char>& dst);
+
+	/**
+	 * 頂点座標を展開.
+	 * @param[in]  src           圧縮したバイト列.
+	 * @param[in]  size          srcのバイト数.
+	 * @param[in]  count         要素数.
+	 * @param[in]  baseVertices  圧縮時に指定したベースの頂点座標 (NULLの場合は使用しない).
+	 * @param[in]  baseCount     ベースの頂点数 (vIndicesの範囲チェック用).
+	 * @param[in]  vIndices      各頂点に対応するベースの頂点インデックス.
+	 * @param[out] dst           count個の頂点座標が格納される.
+	 * @return バイト列または頂点インデックスが不正な場合はfalse.
+	 */
+	bool decodeVertices (const unsigned char* src, const int size, const int count, const sxsdk::vec3* baseVertices, const int baseCount, const int* vIndices, sxsdk::vec3* dst);
+
+	/**
+	 * CRC32C (Castagnoli) を計算.
+	 * SSE4.2またはARMv8のCRC32命令が使用できる場合はそれを使用する.
+	 * @param[in] data  データ.
+	 * @param[in] size  バイト数.
+	 * @param[in] crc   続けて計算する場合は、前のデータでのCRC32C.
+	 */
+	unsigned int calcCRC32C (const void* data, const size_t size, const unsigned int crc = 0);
+
+	/**
+	 * 頂点インデックスがすべて minValue - maxValue の範囲内か.
+	 * 要素ごとに分岐せず、最小値/最大値を求めてから比較する.
+	 */
+	bool checkIndicesRange (const int* indices, const int count, const int minValue, const int maxValue);
+}
+
+#endif
@@ -2,6 +2,231 @@
  * streamに情報を保存.
  */
 #include "StreamCtrl.h"
+#include "StreamCodec.h"
+#include "BoneSkeleton.h"
+#include "MorphTargetsRegistry.h"
+#include "MotionCodec.h"
+#include "ProfileUtil.h"
+#include "TraceUtil.h"
+
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <map>
+#include <string>
+
+/*
+	Morph Targets情報のstreamの構成 (ver.0x105 - ).
+	[ヘッダ]
+		int    version
+		int    serial             保存ごとに変わる値.
+		int    orgVerticesCount   ベースの頂点数.
+		int    targetsCount       Target数.
+		int    baseOffset         ベースの頂点座標の位置.
+		int    baseSize           ベースの頂点座標のバイト数.
+		int    baseCrc            ベースの頂点座標のCRC32C.
+		int    symmetryOffset     対称マップの位置.
+		int    symmetrySize       対称マップのバイト数.
+		int    symmetryCrc        対称マップのCRC32C.
+		int    encoding           頂点の形式 (MORPH_TARGETS_STREAM_ENCODING).
+	[Targetの配置表] (Targetごとに184バイト)
+		char   name[128]
+		float  weight
+		int    verticesCount
+		int    geometryOffset     頂点インデックス、頂点座標の順に格納された位置.
+		int    indicesSize        頂点インデックスのバイト数.
+		int    verticesSize       頂点座標のバイト数.
+		int    geometryCrc        頂点インデックスと頂点座標のCRC32C.
+		float  deltaMin[3]        ベースの頂点座標からの移動量のバウンディングボックスの最小値.
+		float  deltaMax[3]        移動量のバウンディングボックスの最大値.
+		float  maxDeltaLength     移動量の長さの最大値.
+		int    nonZeroCount       移動量が0でない頂点数.
+	[ベースの頂点座標]
+	[Targetごとの頂点インデックスと頂点座標]
+	[対称マップ] (ver.0x101と同じ形式)
+
+	名前とウエイト値はヘッダと配置表のみで取得でき、頂点は必要になったときに位置を指定して読み込む.
+	encodingがmorph_stream_encoding_rawの場合は、int/floatをそのまま格納する.
+	morph_stream_encoding_deltaの場合はStreamCodecで圧縮し、Targetの頂点座標はベースの頂点座標との差分とする.
+
+	CRC32Cは、圧縮時はstream上のバイト列、無圧縮時は読み込んだint/float配列(頂点インデックス、頂点座標の順)に対して計算する.
+	対称マップは、要素数から頂点インデックスの配列までを順に計算する.
+	ウエイト値はwriteMorphTargetsWeightsでstream上を直接書き換えるため、名前とウエイト値はCRC32Cの対象外.
+	移動量の統計は頂点を読み込まずに参照するためのもので、CRC32Cの対象外とし、頂点を読み込んだ時点で計算し直す.
+
+	ver.0x104は移動量の統計を持たない(配置表は152バイト)形式で、統計は頂点を読み込んだ時点で計算する.
+	ver.0x103はbaseCrc/symmetrySize/symmetryCrc、geometryCrcを持たない(ヘッダは32バイト、配置表は148バイト)形式.
+	ver.0x102はさらにbaseSize/encoding、indicesSize/verticesSizeを持たない(ヘッダは24バイト、配置表は140バイト)無圧縮の形式.
+	CRC32Cを持たない形式は、サイズと頂点インデックスの範囲のみチェックする.
+*/
+
+/*
+	MotionGroup情報のstreamの構成 (ver.0x101 - ).
+	[ヘッダ]
+		int    version
+		int    jointTracksCount   ボーン/ボールジョイントのトラック数.
+		int    morphTracksCount   Morph Targetsのウエイト値のトラック数.
+		int    keysCount          全トラックのキーフレーム数 (読み込み時に、トラックのキーフレーム数の合計と一致するかチェックする).
+		int    tracksSize         トラックのバイト数.
+		int    tracksCrc          トラックのCRC32C.
+		int    jointsCount        保存時のボーンルート以下のジョイント数.
+		int    skeletonSignature  保存時のボーン階層のシグネチャ (MotionRetarget::calcSkeletonSignature).
+	[ボーン/ボールジョイントのトラック]
+		varint jointIndex         ボーンルート以下のボーン階層(CBoneSkeleton)での番号.
+		varint nameLength
+		char   name[nameLength]   ジョイントの名前.
+		                          以降はMotionCodec::encodeJointKeyFramesの形式.
+	[Morph Targetsのウエイト値のトラック]
+		varint nameLength
+		char   name[nameLength]   対象形状の名前.
+		varint targetIndex        Target番号.
+		                          以降はMotionCodec::encodeMorphKeyFramesの形式.
+
+	トラックはメモリ上で量子化してから1回で書き込み、読み込みも1回で行う.
+	読み込み時のボーン階層のジョイント数かシグネチャが保存時と異なる場合は、番号のジョイントの名前が保存時と同じ場合はその番号のまま、
+	異なる場合はボーン階層内で同じ名前のジョイントが1つだけある場合にそのジョイントに対応させる (対応しないトラックは読み込まない).
+
+	ver.0x100はjointsCount/skeletonSignatureとジョイント名を持たない(ヘッダは24バイト)形式で、番号のみで対応させる.
+*/
+
+/*
+	リターゲット情報のstreamの構成 (ver.0x100 - ).
+	[ヘッダ]
+		int    version
+		int    sourceJointsCount    移し元のジョイント数.
+		int    targetJointsCount    移し先のジョイント数.
+		int    sourceSignature      移し元のボーン階層のシグネチャ.
+		int    targetSignature      移し先のボーン階層のシグネチャ.
+		int    overridesSignature   対応の指定のシグネチャ.
+		float  offsetScale          Offset値の倍率.
+		int    mappingSize          対応と補正のバイト数.
+		int    mappingCrc           対応と補正のCRC32C.
+	[対応と補正] (移し先のジョイントごと)
+		varint sourceIndex          移し元のジョイント番号 + 1 (対応しない場合は0).
+		byte   correction[6]        補正の回転 (MotionCodec::packRotationの形式、対応する場合のみ).
+*/
+
+namespace {
+	const int STREAM_HEADER_SIZE_102       = (int)(sizeof(int) * 6);						// ヘッダのサイズ (ver.0x102).
+	const int STREAM_TARGET_TABLE_SIZE_102 = (int)(128 + sizeof(float) + sizeof(int) * 2);	// Targetごとの配置表のサイズ (ver.0x102).
+	const int STREAM_HEADER_SIZE_103       = (int)(sizeof(int) * 8);						// ヘッダのサイズ (ver.0x103).
+	const int STREAM_TARGET_TABLE_SIZE_103 = (int)(128 + sizeof(float) + sizeof(int) * 4);	// Targetごとの配置表のサイズ (ver.0x103).
+	const int STREAM_HEADER_SIZE           = (int)(sizeof(int) * 11);						// ヘッダのサイズ (ver.0x104 - ).
+	const int STREAM_TARGET_TABLE_SIZE_104 = (int)(128 + sizeof(float) + sizeof(int) * 5);	// Targetごとの配置表のサイズ (ver.0x104).
+	const int STREAM_TARGET_TABLE_SIZE     = STREAM_TARGET_TABLE_SIZE_104 + (int)(sizeof(float) * 7 + sizeof(int));	// Targetごとの配置表のサイズ (ver.0x105 - ).
+	const int STREAM_SYMMETRY_HEADER_SIZE  = (int)(sizeof(int) * 3 + sizeof(float) * 2);	// 対称マップの頂点インデックスより前のサイズ.
+
+	const int MOTION_STREAM_HEADER_SIZE_100 = (int)(sizeof(int) * 6);						// MotionGroup情報のヘッダのサイズ (ver.0x100).
+	const int MOTION_STREAM_HEADER_SIZE    = (int)(sizeof(int) * 8);						// MotionGroup情報のヘッダのサイズ (ver.0x101 - ).
+	const int RETARGET_STREAM_HEADER_SIZE  = (int)(sizeof(int) * 8 + sizeof(float));		// リターゲット情報のヘッダのサイズ.
+
+	std::atomic<int> g_streamSerial((int)time(NULL));	// 保存ごとに変わる値.
+
+	/**
+	 * 形状以下を再帰的にたどり、ポリゴンメッシュを名前ごとに格納.
+	 * 同じ名前のポリゴンメッシュが複数ある場合は、どれに対応するか決められないためNULLとする.
+	 */
+	void m_findPolygonMeshes (sxsdk::shape_class* shape, std::map<std::string, sxsdk::shape_class *>& meshes)
+	{
+		if (shape->get_type() == sxsdk::enums::polygon_mesh) {
+			const std::string name(shape->get_name());
+			std::map<std::string, sxsdk::shape_class *>::iterator it = meshes.find(name);
+			if (it == meshes.end()) meshes[name] = shape;
+			else it->second = NULL;
+		}
+		if (shape->has_son()) {
+			sxsdk::shape_class* pShape = shape->get_son();
+			while (pShape->has_bro()) {
+				pShape = pShape->get_bro();
+				m_findPolygonMeshes(pShape, meshes);
+			}
+		}
+	}
+
+	/**
+	 * 対称マップのバイト数.
+	 * @param[in] cou  対称マップの要素数 (保存しない場合は0).
+	 */
+	int m_getSymmetryMapSize (const int cou)
+	{
+		return (cou > 0) ? (STREAM_SYMMETRY_HEADER_SIZE + (int)sizeof(int) * cou) : (int)sizeof(int);
+	}
+
+	/**
+	 * 対称マップのCRC32Cを計算.
+	 * @param[in] cou  対称マップの要素数 (保存しない場合は0).
+	 */
+	unsigned int m_calcSymmetryMapCRC (const CMorphTargetsSymmetryMap& symmetryMap, const int cou)
+	{
+		unsigned int crc = StreamCodec::calcCRC32C(&cou, sizeof(int));
+		if (cou > 0) {
+			const int iHash = (int)symmetryMap.baseHash;
+			crc = StreamCodec::calcCRC32C(&symmetryMap.axis, sizeof(int), crc);
+			crc = StreamCodec::calcCRC32C(&symmetryMap.center, sizeof(float), crc);
+			crc = StreamCodec::calcCRC32C(&symmetryMap.tolerance, sizeof(float), crc);
+			crc = StreamCodec::calcCRC32C(&iHash, sizeof(int), crc);
+			crc = StreamCodec::calcCRC32C(&symmetryMap.mirrorIndices[0], sizeof(int) * cou, crc);
+		}
+		return crc;
+	}
+
+	/**
+	 * 無圧縮の頂点インデックスと頂点座標のCRC32Cを計算.
+	 */
+	unsigned int m_calcRawGeometryCRC (const int* vIndices, const sxsdk::vec3* vertices, const int cou)
+	{
+		if (cou <= 0) return 0;
+		const unsigned int crc = StreamCodec::calcCRC32C(vIndices, sizeof(int) * cou);
+		return StreamCodec::calcCRC32C(vertices, sizeof(sxsdk::vec3) * cou, crc);
+	}
+
+	/**
+	 * 対称マップを書き込み.
+	 * @param[in] cou  対称マップの要素数 (保存しない場合は0).
+	 */
+	void m_writeSymmetryMap (sxsdk::stream_interface* stream, const CMorphTargetsSymmetryMap& symmetryMap, const int cou)
+	{
+		stream->write_int(cou);
+		if (cou > 0) {
+			stream->write_int(symmetryMap.axis);
+			stream->write_float(symmetryMap.center);
+			stream->write_float(symmetryMap.tolerance);
+			stream->write_int((int)symmetryMap.baseHash);
+			for (int i = 0; i < cou; ++i) {
+				stream->write_int(symmetryMap.mirrorIndices[i]);
+			}
+		}
+	}
+
+	/**
+	 * 対称マップを読み込み.
+	 * 要素数がmaxSizeバイトに収まらない場合、軸や頂点インデックスが範囲外の場合は例外を投げる.
+	 * @return 対称マップの要素数.
+	 */
+	int m_readSymmetryMap (sxsdk::stream_interface* stream, CMorphTargetsSymmetryMap& symmetryMap, const int maxSize)
+	{
+		symmetryMap.clear();
+		int cou;
+		stream->read_int(cou);
+		if (cou < 0 || (cou > 0 && cou > (maxSize - STREAM_SYMMETRY_HEADER_SIZE) / (int)sizeof(int))) throw "invalid symmetry map";
+		if (cou > 0) {
+			int iHash;
+			stream->read_int(symmetryMap.axis);
+			stream->read_float(symmetryMap.center);
+			stream->read_float(symmetryMap.tolerance);
+			stream->read_int(iHash);
+			symmetryMap.baseHash = (unsigned int)iHash;
+			if (symmetryMap.axis < 0 || symmetryMap.axis > 2) throw "invalid symmetry map";
+
+			symmetryMap.mirrorIndices.resize(cou);
+			for (int i = 0; i < cou; ++i) {
+				stream->read_int(symmetryMap.mirrorIndices[i]);
+			}
+			if (!StreamCodec::checkIndicesRange(&symmetryMap.mirrorIndices[0], cou, -1, cou - 1)) throw "invalid symmetry map";
+		}
+		return cou;
+	}
+}
 
 /**
  * Morph Targets情報を削除.
@@ -11,6 +236,7 @@ void StreamCtrl::removeMorphTargetsData (sxsdk::shape_class& shape)
 	try {
 		shape.delete_attribute_with_uuid(MORPH_TARGETS_STREAM_ID);
 	} catch (...) { }
+	MorphTargetsRegistry::getRegistry().removeShape(shape.get_handle());
 }
 
 /**
@@ -18,60 +244,218 @@ void StreamCtrl::removeMorphTargetsData (sxsdk::shape_class& shape)
  */
 void StreamCtrl::writeMorphTargetsData (sxsdk::shape_class& shape, const CMorphTargetsCtrl& data)
 {
+	CProfileScope profileScope(profile_stream_write);
+	CTraceScope traceScope("StreamCtrl::writeMorphTargetsData", "handle", (long long)(size_t)shape.get_handle(), "vertices", (long long)data.getOrgVerticesCount());
+
+	// 遅延読み込み中の頂点は、streamを書き換える前にすべて読み込んでおく.
+	// 読み込めなかった頂点がある場合は、stream上の情報を失わないように保存しない.
+	if (!data.loadAllVertices()) return;
+
 	try {
+		const std::vector<sxsdk::vec3>& orgVertices = data.getOrgVertices();
+		const int versCou    = (int)orgVertices.size();
+		const int targetsCou = data.getTargetsCount();
+
+		std::vector<int> targetVersCou(targetsCou, 0);
+		for (int loop = 0; loop < targetsCou; ++loop) {
+			const CMorphTargetsData& morphD = data.getMorphTargetData(loop);
+			targetVersCou[loop] = (int)std::min(morphD.vIndices.size(), morphD.vertices.size());
+		}
+
+		// 圧縮する場合は、先に頂点を圧縮してサイズを求める.
+		// Targetの頂点座標はベースの頂点座標との差分とするため、範囲外の頂点インデックスがある場合は圧縮しない.
+		MORPH_TARGETS_STREAM_ENCODING encoding = data.getStreamEncoding();
+		if (encoding == morph_stream_encoding_delta) {
+			for (int loop = 0; loop < targetsCou; ++loop) {
+				const CMorphTargetsData& morphD = data.getMorphTargetData(loop);
+				if (targetVersCou[loop] > 0 && !StreamCodec::checkIndicesRange(&morphD.vIndices[0], targetVersCou[loop], 0, versCou - 1)) {
+					encoding = morph_stream_encoding_raw;
+					break;
+				}
+			}
+		}
+		std::vector<unsigned char> baseBuff;
+		std::vector< std::vector<unsigned char> > targetBuffs;
+		std::vector<int> indicesSizes(targetsCou, 0);
+		std::vector<int> verticesSizes(targetsCou, 0);
+		std::vector<unsigned int> geometryCrcs(targetsCou, 0);
+		int baseSize = (int)(sizeof(float) * 3) * versCou;
+		unsigned int baseCrc = 0;
+		if (encoding == morph_stream_encoding_delta) {
+			if (versCou > 0) StreamCodec::encodeVertices(&orgVertices[0], versCou, NULL, NULL, baseBuff);
+			baseSize = (int)baseBuff.size();
+			if (baseSize > 0) baseCrc = StreamCodec::calcCRC32C(&baseBuff[0], baseBuff.size());
+
+			targetBuffs.resize(targetsCou);
+			for (int loop = 0; loop < targetsCou; ++loop) {
+				const CMorphTargetsData& morphD = data.getMorphTargetData(loop);
+				const int cou = targetVersCou[loop];
+				if (cou <= 0) continue;
+				std::vector<unsigned char>& buff = targetBuffs[loop];
+				StreamCodec::encodeIndices(&morphD.vIndices[0], cou, buff);
+				indicesSizes[loop] = (int)buff.size();
+				StreamCodec::encodeVertices(&morphD.vertices[0], cou, &orgVertices[0], &morphD.vIndices[0], buff);
+				verticesSizes[loop] = (int)buff.size() - indicesSizes[loop];
+				geometryCrcs[loop]  = StreamCodec::calcCRC32C(&buff[0], buff.size());
+			}
+		} else {
+			if (versCou > 0) baseCrc = StreamCodec::calcCRC32C(&orgVertices[0], sizeof(sxsdk::vec3) * versCou);
+			for (int loop = 0; loop < targetsCou; ++loop) {
+				const CMorphTargetsData& morphD = data.getMorphTargetData(loop);
+				const int cou = targetVersCou[loop];
+				indicesSizes[loop]  = (int)sizeof(int) * cou;
+				verticesSizes[loop] = (int)(sizeof(float) * 3) * cou;
+				if (cou > 0) geometryCrcs[loop] = m_calcRawGeometryCRC(&morphD.vIndices[0], &morphD.vertices[0], cou);
+			}
+		}
+
+		// 対称マップ.
+		const CMorphTargetsSymmetryMap& symmetryMap = data.getSymmetryMap();
+		const int symmetryCou = symmetryMap.isValid(orgVertices) ? (int)symmetryMap.mirrorIndices.size() : 0;
+		const int symmetrySize = m_getSymmetryMapSize(symmetryCou);
+		const unsigned int symmetryCrc = m_calcSymmetryMapCRC(symmetryMap, symmetryCou);
+
+		// 各セクションの位置を計算.
+		const int baseOffset = STREAM_HEADER_SIZE + STREAM_TARGET_TABLE_SIZE * targetsCou;
+		std::vector<int> geometryOffsets(targetsCou, 0);
+		int pos = baseOffset + baseSize;
+		for (int loop = 0; loop < targetsCou; ++loop) {
+			geometryOffsets[loop] = pos;
+			pos += indicesSizes[loop] + verticesSizes[loop];
+		}
+		const int symmetryOffset = pos;
+
 		compointer<sxsdk::stream_interface> stream(shape.create_attribute_stream_interface_with_uuid(MORPH_TARGETS_STREAM_ID));
 		if (!stream) return;
 
 		stream->set_size(0);
 		stream->set_pointer(0);
 
-		int iVersion = MORPH_TARGETS_STREAM_VERSION;
-		stream->write_int(iVersion);
+		// ヘッダ.
+		stream->write_int(MORPH_TARGETS_STREAM_VERSION);
+		stream->write_int(++g_streamSerial);
+		stream->write_int(versCou);
+		stream->write_int(targetsCou);
+		stream->write_int(baseOffset);
+		stream->write_int(baseSize);
+		stream->write_int((int)baseCrc);
+		stream->write_int(symmetryOffset);
+		stream->write_int(symmetrySize);
+		stream->write_int((int)symmetryCrc);
+		stream->write_int((int)encoding);
 
-		const std::vector<sxsdk::vec3>& orgVertices = data.getOrgVertices();
-		{
-			const int cou = (int)orgVertices.size();
-			stream->write_int(cou);
-			for (int i = 0; i < cou; ++i) {
-				stream->write_float(orgVertices[i].x);
-				stream->write_float(orgVertices[i].y);
-				stream->write_float(orgVertices[i].z);
-			}
-		}
+		// Targetの配置表.
 		{
 			char szName[130];
-			const int targetsCou = data.getTargetsCount();
-			stream->write_int(targetsCou);
 			for (int loop = 0; loop < targetsCou; ++loop) {
 				const CMorphTargetsData& morphD = data.getMorphTargetData(loop);
 				memset(szName, 0, 128);
-				strcpy(szName, morphD.name.c_str());
+				strncpy(szName, morphD.name.c_str(), 127);
 				stream->write(128, szName);
+				stream->write_float(morphD.weight);
+				stream->write_int(targetVersCou[loop]);
+				stream->write_int(geometryOffsets[loop]);
+				stream->write_int(indicesSizes[loop]);
+				stream->write_int(verticesSizes[loop]);
+				stream->write_int((int)geometryCrcs[loop]);
 
-				{
-					const int cou = (int)morphD.vIndices.size();
-					stream->write_int(cou);
-					for (int i = 0; i < cou; ++i) {
-						stream->write_int(morphD.vIndices[i]);
-					}
+				// 移動量の統計 (ver.0x105 - ).
+				CMorphTargetsDeltaStats deltaStats;
+				if (targetVersCou[loop] > 0) deltaStats = data.getTargetDeltaStats(loop);
+				stream->write_float(deltaStats.deltaMin.x);
+				stream->write_float(deltaStats.deltaMin.y);
+				stream->write_float(deltaStats.deltaMin.z);
+				stream->write_float(deltaStats.deltaMax.x);
+				stream->write_float(deltaStats.deltaMax.y);
+				stream->write_float(deltaStats.deltaMax.z);
+				stream->write_float(deltaStats.maxDeltaLength);
+				stream->write_int(deltaStats.nonZeroCount);
+			}
+		}
+
+		if (encoding == morph_stream_encoding_delta) {
+			// ベースの頂点座標.
+			if (!baseBuff.empty()) stream->write((int)baseBuff.size(), &baseBuff[0]);
+
+			// Targetごとの頂点インデックスと頂点座標.
+			for (int loop = 0; loop < targetsCou; ++loop) {
+				const std::vector<unsigned char>& buff = targetBuffs[loop];
+				if (!buff.empty()) stream->write((int)buff.size(), &buff[0]);
+			}
+
+		} else {
+			// ベースの頂点座標.
+			for (int i = 0; i < versCou; ++i) {
+				stream->write_float(orgVertices[i].x);
+				stream->write_float(orgVertices[i].y);
+				stream->write_float(orgVertices[i].z);
+			}
+
+			// Targetごとの頂点インデックスと頂点座標.
+			for (int loop = 0; loop < targetsCou; ++loop) {
+				const CMorphTargetsData& morphD = data.getMorphTargetData(loop);
+				const int cou = targetVersCou[loop];
+				for (int i = 0; i < cou; ++i) {
+					stream->write_int(morphD.vIndices[i]);
 				}
-				{
-					const int cou = (int)morphD.vertices.size();
-					stream->write_int(cou);
-					for (int i = 0; i < cou; ++i) {
-						stream->write_float(morphD.vertices[i].x);
-						stream->write_float(morphD.vertices[i].y);
-						stream->write_float(morphD.vertices[i].z);
-					}
+				for (int i = 0; i < cou; ++i) {
+					stream->write_float(morphD.vertices[i].x);
+					stream->write_float(morphD.vertices[i].y);
+					stream->write_float(morphD.vertices[i].z);
 				}
-
-				stream->write_float(morphD.weight);
 			}
 		}
 
+		// 対称マップ (ver.0x101 - ).
+		m_writeSymmetryMap(stream, symmetryMap, symmetryCou);
+
+		ProfileUtil::addBytes(profile_stream_write, (long long)stream->get_pointer());
+		traceScope.setEndArg("bytes", (long long)stream->get_pointer());
+
+		// シーン内のMorph Targets情報を持つ形状の一覧を更新.
+		MorphTargetsRegistry::getRegistry().updateShape(shape, targetsCou, versCou);
+
 	} catch (...) { }
 }
 
+/**
+ * Morph Targets情報のうち、ウエイト値のみをstream上で書き換え.
+ * streamに保存されている構成がdataと一致しない場合はfalseを返す (writeMorphTargetsDataで保存し直すこと).
+ */
+bool StreamCtrl::writeMorphTargetsWeights (sxsdk::shape_class& shape, const CMorphTargetsCtrl& data)
+{
+	CProfileScope profileScope(profile_stream_write);
+	CTraceScope traceScope("StreamCtrl::writeMorphTargetsWeights", "handle", (long long)(size_t)shape.get_handle(), "targets", (long long)data.getTargetsCount());
+
+	try {
+		// 頂点数とTargetの構成は、配置表と頂点数のみで比較する (頂点は読み込まない).
+		CMorphTargetsStreamLayout layout;
+		if (!readMorphTargetsLayout(shape, layout)) return false;
+		if (layout.hasEmptyTargets) return false;
+		if (layout.orgVerticesCount != data.getOrgVerticesCount()) return false;
+
+		const int targetsCou = data.getTargetsCount();
+		if (layout.getTargetsCount() != targetsCou) return false;
+		for (int loop = 0; loop < targetsCou; ++loop) {
+			if (layout.verticesCounts[loop] != data.getTargetVerticesCount(loop)) return false;
+		}
+
+		compointer<sxsdk::stream_interface> stream(shape.get_attribute_stream_interface_with_uuid(MORPH_TARGETS_STREAM_ID));
+		if (!stream) return false;
+
+		for (int loop = 0; loop < targetsCou; ++loop) {
+			stream->set_pointer(layout.weightOffsets[loop]);
+			stream->write_float(data.getTargetWeight(loop));
+		}
+		ProfileUtil::addBytes(profile_stream_write, (long long)(sizeof(float) * targetsCou));
+		traceScope.setEndArg("bytes", (long long)(sizeof(float) * targetsCou));
+		return true;
+
+	} catch (...) { }
+
+	return false;
+}
+
 /**
  * Morph Targets情報を持つか.
  */
@@ -97,76 +481,752 @@ bool StreamCtrl::hasMorphTargetsData (sxsdk::shape_class& shape)
 
 /**
  * Morph Targets情報を読み込み.
+ * 名前とウエイト値のみを読み込み、頂点は必要になった時点で読み込まれる.
  */
-bool StreamCtrl::readMorphTargetsData (sxsdk::shape_class& shape, CMorphTargetsCtrl& data)
+bool StreamCtrl::readMorphTargetsData (sxsdk::shape_class& shape, CMorphTargetsCtrl& data, const bool loadVertices)
 {
+	CTraceScope traceScope("StreamCtrl::readMorphTargetsData", "handle", (long long)(size_t)shape.get_handle());
+
 	data.clear();
 
+	CMorphTargetsStreamLayout layout;
+	if (!readMorphTargetsLayout(shape, layout)) return false;
+	data.setupStreamLayout(&shape, layout);
+	traceScope.setEndArg("targets", (long long)layout.getTargetsCount());
+
+	if (loadVertices) return data.loadAllVertices();
+	return true;
+}
+
+/**
+ * Morph Targets情報のstream上の配置を読み込み (頂点は読み込まない).
+ * ver.0x100/0x101では、頂点を持たないTargetは除外される.
+ */
+bool StreamCtrl::readMorphTargetsLayout (sxsdk::shape_class& shape, CMorphTargetsStreamLayout& layout)
+{
+	CProfileScope profileScope(profile_stream_read);
+
+	layout.clear();
 	if (shape.get_type() != sxsdk::enums::polygon_mesh) return false;
 
 	try {
 		compointer<sxsdk::stream_interface> stream(shape.get_attribute_stream_interface_with_uuid(MORPH_TARGETS_STREAM_ID));
 		if (!stream) return false;
 
+		const int streamSize = stream->get_size();
 		stream->set_pointer(0);
 
 		int iVersion;
 		stream->read_int(iVersion);
+		if (iVersion < MORPH_TARGETS_STREAM_VERSION_100 || iVersion > MORPH_TARGETS_STREAM_VERSION) return false;
 
-		data.setupShape(&shape);
-		
-		std::vector<sxsdk::vec3> orgVertices;
-		{
-			int cou;
-			stream->read_int(cou);
-			if (cou > 0) orgVertices.resize(cou);
-			for (int i = 0; i < cou; ++i) {
-				stream->read_float(orgVertices[i].x);
-				stream->read_float(orgVertices[i].y);
-				stream->read_float(orgVertices[i].z);
-			}
-		}
-		data.setOrgVertices(orgVertices);
-		
-		{
-			char szName[130];
-			int targetsCou;
+		layout.version    = iVersion;
+		layout.streamSize = streamSize;
+
+		char szName[130];
+		szName[128] = szName[129] = '\0';
+		int readBytes = (int)sizeof(int);
+
+		if (iVersion >= MORPH_TARGETS_STREAM_VERSION_102) {
+			// ver.0x102は無圧縮で、頂点のバイト数は頂点数から求める.
+			const bool hasSizes    = (iVersion >= MORPH_TARGETS_STREAM_VERSION_103);
+			const bool hasChecksum   = (iVersion >= MORPH_TARGETS_STREAM_VERSION_104);
+			const bool hasDeltaStats = (iVersion >= MORPH_TARGETS_STREAM_VERSION_105);
+			const int headerSize     = hasChecksum ? STREAM_HEADER_SIZE : (hasSizes ? STREAM_HEADER_SIZE_103 : STREAM_HEADER_SIZE_102);
+			const int tableSize      = hasDeltaStats ? STREAM_TARGET_TABLE_SIZE : (hasChecksum ? STREAM_TARGET_TABLE_SIZE_104 : (hasSizes ? STREAM_TARGET_TABLE_SIZE_103 : STREAM_TARGET_TABLE_SIZE_102));
+
+			int targetsCou, iCrc;
+			stream->read_int(layout.serial);
+			stream->read_int(layout.orgVerticesCount);
 			stream->read_int(targetsCou);
+			stream->read_int(layout.baseOffset);
+			if (hasSizes) stream->read_int(layout.baseSize);
+			if (hasChecksum) {
+				stream->read_int(iCrc);
+				layout.baseCrc = (unsigned int)iCrc;
+			}
+			stream->read_int(layout.symmetryOffset);
+			if (hasChecksum) {
+				stream->read_int(layout.symmetrySize);
+				stream->read_int(iCrc);
+				layout.symmetryCrc = (unsigned int)iCrc;
+			}
+			if (hasSizes) stream->read_int(layout.encoding);
+			layout.hasChecksum   = hasChecksum;
+			layout.hasDeltaStats = hasDeltaStats;
+
+			// 頂点数は、1頂点あたりの最小のバイト数(無圧縮で12バイト、圧縮時は3バイト)がstreamに収まる範囲とする.
+			// 以降のサイズの計算でオーバーフローしないように、先に要素数をチェックする.
+			if (layout.encoding != morph_stream_encoding_raw && layout.encoding != morph_stream_encoding_delta) throw "invalid header";
+			const int minVertexSize = (layout.encoding == morph_stream_encoding_raw) ? (int)(sizeof(float) * 3) : 3;
+			if (layout.orgVerticesCount < 0 || layout.orgVerticesCount > streamSize / minVertexSize) throw "invalid header";
+			if (targetsCou < 0 || targetsCou > (streamSize - headerSize) / tableSize) throw "invalid header";
+			if (!hasSizes) layout.baseSize = (int)(sizeof(float) * 3) * layout.orgVerticesCount;
+
+			const int tableEnd = headerSize + tableSize * targetsCou;
+			if (layout.baseSize < minVertexSize * layout.orgVerticesCount) throw "invalid header";
+			if (layout.encoding == morph_stream_encoding_raw && layout.baseSize != (int)(sizeof(float) * 3) * layout.orgVerticesCount) throw "invalid header";
+			if (layout.baseOffset < tableEnd || layout.baseSize > streamSize - layout.baseOffset) throw "invalid header";
+			if (layout.symmetryOffset < tableEnd || layout.symmetryOffset > streamSize) throw "invalid header";
+			if (hasChecksum && (layout.symmetrySize < (int)sizeof(int) || layout.symmetrySize > streamSize - layout.symmetryOffset)) throw "invalid header";
+
 			for (int loop = 0; loop < targetsCou; ++loop) {
+				float weight;
+				int vCou, geometryOffset;
+				int indicesSize = 0, verticesSize = 0;
+				int geometryCrc = 0;
 				stream->read(128, szName);
+				stream->read_float(weight);
+				stream->read_int(vCou);
+				stream->read_int(geometryOffset);
+				if (hasSizes) {
+					stream->read_int(indicesSize);
+					stream->read_int(verticesSize);
+				}
+				if (hasChecksum) stream->read_int(geometryCrc);
 
-				std::vector<sxsdk::vec3> vList;
-				std::vector<int> vIndices;
-				int cou;
-				{
-					stream->read_int(cou);
-					if (cou > 0) vIndices.resize(cou);
-					for (int i = 0; i < cou; ++i) {
-						stream->read_int(vIndices[i]);
-					}
+				CMorphTargetsDeltaStats deltaStats;
+				if (hasDeltaStats) {
+					stream->read_float(deltaStats.deltaMin.x);
+					stream->read_float(deltaStats.deltaMin.y);
+					stream->read_float(deltaStats.deltaMin.z);
+					stream->read_float(deltaStats.deltaMax.x);
+					stream->read_float(deltaStats.deltaMax.y);
+					stream->read_float(deltaStats.deltaMax.z);
+					stream->read_float(deltaStats.maxDeltaLength);
+					stream->read_int(deltaStats.nonZeroCount);
 				}
-				{
-					stream->read_int(cou);
-					if (cou > 0) vList.resize(cou);
-					for (int i = 0; i < cou; ++i) {
-						stream->read_float(vList[i].x);
-						stream->read_float(vList[i].y);
-						stream->read_float(vList[i].z);
+
+				// 頂点を持たないTarget (頂点の対応付け直しで移動する頂点がなくなったもの) も、Targetの番号を変えないため保持する.
+				if (vCou < 0) throw "invalid target";
+				if (vCou == 0) {
+					indicesSize = verticesSize = 0;
+					geometryOffset = tableEnd;
+				} else {
+					// 1頂点あたり、頂点インデックスと頂点座標で無圧縮で16バイト、圧縮時は4バイト以上.
+					if (vCou > streamSize / (minVertexSize + ((layout.encoding == morph_stream_encoding_raw) ? (int)sizeof(int) : 1))) throw "invalid target";
+					if (!hasSizes) {
+						indicesSize  = (int)sizeof(int) * vCou;
+						verticesSize = (int)(sizeof(float) * 3) * vCou;
 					}
+					if (layout.encoding == morph_stream_encoding_raw) {
+						if (indicesSize != (int)sizeof(int) * vCou || verticesSize != (int)(sizeof(float) * 3) * vCou) throw "invalid target";
+					} else {
+						if (indicesSize < vCou || verticesSize < minVertexSize * vCou) throw "invalid target";
+					}
+					if (geometryOffset < tableEnd || (long long)geometryOffset + indicesSize + verticesSize > (long long)streamSize) throw "invalid target";
 				}
+
+				// 移動量の統計は、頂点数と値の範囲のみチェックする (NaNの場合も除外される).
+				if (hasDeltaStats) {
+					if (deltaStats.nonZeroCount < 0 || deltaStats.nonZeroCount > vCou || !(deltaStats.maxDeltaLength >= 0.0f)) throw "invalid target";
+					if (!(deltaStats.deltaMin.x <= deltaStats.deltaMax.x && deltaStats.deltaMin.y <= deltaStats.deltaMax.y && deltaStats.deltaMin.z <= deltaStats.deltaMax.z)) throw "invalid target";
+				}
+
+				layout.names.push_back(szName);
+				layout.weights.push_back(weight);
+				layout.verticesCounts.push_back(vCou);
+				layout.indicesOffsets.push_back(geometryOffset);
+				layout.verticesOffsets.push_back(geometryOffset + indicesSize);
+				layout.indicesSizes.push_back(indicesSize);
+				layout.verticesSizes.push_back(verticesSize);
+				layout.weightOffsets.push_back(headerSize + tableSize * loop + 128);
+				layout.geometryCrcs.push_back((unsigned int)geometryCrc);
+				layout.deltaStats.push_back(deltaStats);
+			}
+			readBytes = tableEnd;
+
+		} else {
+			// ver.0x100/0x101では、頂点数を読みながら頂点をスキップして位置を求める.
+			int cou, targetsCou;
+			stream->read_int(cou);
+			if (cou < 0 || cou > streamSize / (int)(sizeof(float) * 3)) throw "invalid header";
+			layout.orgVerticesCount = cou;
+			layout.baseOffset       = (int)sizeof(int) * 2;
+			layout.baseSize         = (int)(sizeof(float) * 3) * cou;
+
+			int pos = layout.baseOffset + (int)(sizeof(float) * 3) * cou;
+			if (pos + (int)sizeof(int) > streamSize) throw "invalid header";
+			stream->set_pointer(pos);
+			stream->read_int(targetsCou);
+			pos += (int)sizeof(int);
+
+			for (int loop = 0; loop < targetsCou; ++loop) {
+				int iCou, vCou;
 				float weight;
+				stream->set_pointer(pos);
+				stream->read(128, szName);
+				stream->read_int(iCou);
+				if (iCou < 0 || iCou > streamSize / (int)sizeof(int)) throw "invalid target";
+				const int indicesOffset = pos + 128 + (int)sizeof(int);
+				pos = indicesOffset + (int)sizeof(int) * iCou;
+				if (pos + (int)sizeof(int) > streamSize) throw "invalid target";
+
+				stream->set_pointer(pos);
+				stream->read_int(vCou);
+				if (vCou < 0 || vCou > streamSize / (int)(sizeof(float) * 3)) throw "invalid target";
+				const int verticesOffset = pos + (int)sizeof(int);
+				pos = verticesOffset + (int)(sizeof(float) * 3) * vCou;
+				if (pos + (int)sizeof(float) > streamSize) throw "invalid target";
+
+				stream->set_pointer(pos);
 				stream->read_float(weight);
+				const int weightOffset = pos;
+				pos += (int)sizeof(float);
+				readBytes += 128 + (int)(sizeof(int) * 2 + sizeof(float));
+
+				// 頂点を持たない、または頂点インデックスと頂点座標の数が異なるTargetは読み込み時に除外される.
+				if (vCou == 0 || iCou != vCou) {
+					layout.hasEmptyTargets = true;
+					continue;
+				}
+				layout.names.push_back(szName);
+				layout.weights.push_back(weight);
+				layout.verticesCounts.push_back(vCou);
+				layout.indicesOffsets.push_back(indicesOffset);
+				layout.verticesOffsets.push_back(verticesOffset);
+				layout.indicesSizes.push_back((int)sizeof(int) * iCou);
+				layout.verticesSizes.push_back((int)(sizeof(float) * 3) * vCou);
+				layout.weightOffsets.push_back(weightOffset);
+			}
+			readBytes += (int)(sizeof(int) * 2);
+			layout.symmetryOffset = (iVersion >= MORPH_TARGETS_STREAM_VERSION_101) ? pos : -1;
+		}
+		ProfileUtil::addBytes(profile_stream_read, (long long)readBytes);
+		return true;
+
+	} catch (...) { }
+
+	layout.clear();
+	return false;
+}
+
+/**
+ * streamがlayoutを読み込んだ時点から変更されていないか.
+ * ウエイト値のみの書き換えでは、サイズと保存ごとに変わる値は変わらない.
+ */
+bool StreamCtrl::checkMorphTargetsLayout (sxsdk::shape_class& shape, const CMorphTargetsStreamLayout& layout)
+{
+	if (!layout.isValid()) return false;
+
+	try {
+		compointer<sxsdk::stream_interface> stream(shape.get_attribute_stream_interface_with_uuid(MORPH_TARGETS_STREAM_ID));
+		if (!stream) return false;
+		if (stream->get_size() != layout.streamSize) return false;
+
+		stream->set_pointer(0);
+		int iVersion;
+		stream->read_int(iVersion);
+		if (iVersion != layout.version) return false;
+
+		if (iVersion >= MORPH_TARGETS_STREAM_VERSION_102) {
+			int serial;
+			stream->read_int(serial);
+			if (serial != layout.serial) return false;
+		}
+		return true;
+
+	} catch (...) { }
+
+	return false;
+}
+
+/**
+ * layoutの位置から、ベースの頂点座標と対称マップを読み込み.
+ * 対称マップを持たない、または読み込めない場合はsymmetryMapはクリアされる.
+ * CRC32Cが一致しない場合は、破損しているとしてfalseを返す.
+ */
+bool StreamCtrl::readMorphTargetsBase (sxsdk::shape_class& shape, const CMorphTargetsStreamLayout& layout, std::vector<sxsdk::vec3>& orgVertices, CMorphTargetsSymmetryMap& symmetryMap)
+{
+	CProfileScope profileScope(profile_stream_read);
+	CTraceScope traceScope("StreamCtrl::readMorphTargetsBase", "handle", (long long)(size_t)shape.get_handle(), "vertices", (long long)layout.orgVerticesCount);
+
+	orgVertices.clear();
+	symmetryMap.clear();
+	if (!layout.isValid()) return false;
+
+	try {
+		compointer<sxsdk::stream_interface> stream(shape.get_attribute_stream_interface_with_uuid(MORPH_TARGETS_STREAM_ID));
+		if (!stream) return false;
+
+		const int cou = layout.orgVerticesCount;
+		orgVertices.resize(cou);
+		stream->set_pointer(layout.baseOffset);
+		if (layout.encoding == morph_stream_encoding_delta) {
+			// 圧縮されたバイト列をまとめて読み込み、orgVerticesに直接展開.
+			std::vector<unsigned char> buff(layout.baseSize);
+			if (!buff.empty()) stream->read(layout.baseSize, &buff[0]);
+			if (layout.hasChecksum && (buff.empty() ? 0 : StreamCodec::calcCRC32C(&buff[0], buff.size())) != layout.baseCrc) throw "checksum mismatch";
+			if (cou > 0 && !StreamCodec::decodeVertices(&buff[0], layout.baseSize, cou, NULL, 0, NULL, &orgVertices[0])) throw "invalid base";
+		} else {
+			for (int i = 0; i < cou; ++i) {
+				stream->read_float(orgVertices[i].x);
+				stream->read_float(orgVertices[i].y);
+				stream->read_float(orgVertices[i].z);
+			}
+			if (layout.hasChecksum && (cou > 0 ? StreamCodec::calcCRC32C(&orgVertices[0], sizeof(sxsdk::vec3) * cou) : 0) != layout.baseCrc) throw "checksum mismatch";
+		}
+		long long readBytes = (long long)layout.baseSize;
+
+		// 対称マップ (ver.0x101 - ).
+		// ベースの頂点座標と一致しない場合、読み込めない場合、CRC32Cが一致しない場合は破棄される (Morph Targets情報は有効とする).
+		if (layout.symmetryOffset >= 0) {
+			try {
+				const int maxSize = layout.hasChecksum ? layout.symmetrySize : (layout.streamSize - layout.symmetryOffset);
+				stream->set_pointer(layout.symmetryOffset);
+				const int symmetryCou = m_readSymmetryMap(stream, symmetryMap, maxSize);
+				if (layout.hasChecksum) {
+					if (m_getSymmetryMapSize(symmetryCou) != layout.symmetrySize) throw "invalid symmetry map";
+					if (m_calcSymmetryMapCRC(symmetryMap, symmetryCou) != layout.symmetryCrc) throw "checksum mismatch";
+				}
+				readBytes += (long long)(stream->get_pointer() - layout.symmetryOffset);
+			} catch (...) {
+				symmetryMap.clear();
+			}
+		}
+		ProfileUtil::addBytes(profile_stream_read, readBytes);
+		traceScope.setEndArg("bytes", readBytes);
+		return true;
+
+	} catch (...) { }
+
+	orgVertices.clear();
+	return false;
+}
+
+/**
+ * layoutの位置から、指定のTargetの頂点インデックスと頂点座標を読み込み.
+ * CRC32Cが一致しない場合、頂点インデックスがベースの頂点数の範囲外の場合は、破損しているとしてfalseを返す.
+ */
+bool StreamCtrl::readMorphTargetVertices (sxsdk::shape_class& shape, const CMorphTargetsStreamLayout& layout, const int tIndex, const std::vector<sxsdk::vec3>& orgVertices, std::vector<int>& vIndices, std::vector<sxsdk::vec3>& vertices)
+{
+	CProfileScope profileScope(profile_stream_read);
+	CTraceScope traceScope("StreamCtrl::readMorphTargetVertices", "handle", (long long)(size_t)shape.get_handle(), "index", (long long)tIndex);
+
+	vIndices.clear();
+	vertices.clear();
+	if (tIndex < 0 || tIndex >= layout.getTargetsCount()) return false;
+
+	try {
+		compointer<sxsdk::stream_interface> stream(shape.get_attribute_stream_interface_with_uuid(MORPH_TARGETS_STREAM_ID));
+		if (!stream) return false;
+
+		const int cou = layout.verticesCounts[tIndex];
+		if (cou == 0) return true;
+		vIndices.resize(cou);
+		vertices.resize(cou);
+		if (layout.encoding == morph_stream_encoding_delta) {
+			// 頂点インデックスと頂点座標は連続して格納されているため、まとめて読み込んで直接展開.
+			// 頂点座標は、ベースの頂点座標との差分.
+			if (orgVertices.empty() || (int)orgVertices.size() != layout.orgVerticesCount) return false;
+			const int indicesSize  = layout.indicesSizes[tIndex];
+			const int verticesSize = layout.verticesSizes[tIndex];
+			std::vector<unsigned char> buff(indicesSize + verticesSize);
+			if (buff.empty()) return false;
+			stream->set_pointer(layout.indicesOffsets[tIndex]);
+			stream->read((int)buff.size(), &buff[0]);
+			if (layout.hasChecksum && StreamCodec::calcCRC32C(&buff[0], buff.size()) != layout.geometryCrcs[tIndex]) throw "checksum mismatch";
+			if (!StreamCodec::decodeIndices(&buff[0], indicesSize, cou, &vIndices[0])) throw "invalid indices";
+			if (!StreamCodec::checkIndicesRange(&vIndices[0], cou, 0, layout.orgVerticesCount - 1)) throw "invalid indices";
+			if (!StreamCodec::decodeVertices(&buff[indicesSize], verticesSize, cou, &orgVertices[0], (int)orgVertices.size(), &vIndices[0], &vertices[0])) throw "invalid vertices";
+		} else {
+			stream->set_pointer(layout.indicesOffsets[tIndex]);
+			for (int i = 0; i < cou; ++i) {
+				stream->read_int(vIndices[i]);
+			}
+			stream->set_pointer(layout.verticesOffsets[tIndex]);
+			for (int i = 0; i < cou; ++i) {
+				stream->read_float(vertices[i].x);
+				stream->read_float(vertices[i].y);
+				stream->read_float(vertices[i].z);
+			}
+			if (layout.hasChecksum && m_calcRawGeometryCRC(&vIndices[0], &vertices[0], cou) != layout.geometryCrcs[tIndex]) throw "checksum mismatch";
+
+			// 範囲外の頂点インデックスは、メッシュの更新時に範囲外アクセスとなるため読み込まない.
+			if (!StreamCodec::checkIndicesRange(&vIndices[0], cou, 0, layout.orgVerticesCount - 1)) throw "invalid indices";
+		}
+		const long long readBytes = (long long)(layout.indicesSizes[tIndex] + layout.verticesSizes[tIndex]);
+		ProfileUtil::addBytes(profile_stream_read, readBytes);
+		traceScope.setEndArg("bytes", readBytes);
+		return true;
+
+	} catch (...) { }
+
+	vIndices.clear();
+	vertices.clear();
+	return false;
+}
+
+
+/**
+ * MotionGroup情報をボーンルートに保存.
+ * @return 保存したバイト数 (保存できなかった場合は0).
+ */
+int StreamCtrl::writeMotionData (sxsdk::shape_class& boneRoot, const MotionUtil::CMotionGroup& motionGroup)
+{
+	CProfileScope profileScope(profile_stream_write);
+	CTraceScope traceScope("StreamCtrl::writeMotionData", "handle", (long long)(size_t)boneRoot.get_handle());
+
+	try {
+		// ジョイントの形状のハンドルから、ボーン階層での番号.
+		CBoneSkeleton skeleton;
+		skeleton.build(&boneRoot);
+		std::map<void *, int> jointsMap;
+		for (int i = 0; i < skeleton.getBonesCount(); ++i) jointsMap[ skeleton.getShape(i)->get_handle() ] = i;
+
+		// トラックを量子化.
+		std::vector<unsigned char> buff;
+		int jointTracksCou = 0;
+		int keysCou = 0;
+		const int jointGroupCou = (int)std::min(motionGroup.shapes.size(), motionGroup.jointKeyFrames.size());
+		for (int i = 0; i < jointGroupCou; ++i) {
+			if (!motionGroup.shapes[i]) continue;
+			std::map<void *, int>::const_iterator it = jointsMap.find(motionGroup.shapes[i]->get_handle());
+			if (it == jointsMap.end()) continue;
+			const std::string name(motionGroup.shapes[i]->get_name());
+			MotionCodec::writeVarint(buff, (unsigned int)it->second);
+			MotionCodec::writeVarint(buff, (unsigned int)name.size());
+			buff.insert(buff.end(), name.begin(), name.end());
+			MotionCodec::encodeJointKeyFrames(motionGroup.jointKeyFrames[i], buff);
+			keysCou += (int)motionGroup.jointKeyFrames[i].size();
+			jointTracksCou++;
+		}
+
+		const int morphTracksCou = (int)std::min(motionGroup.morphKeyFrames.size(), std::min(motionGroup.morphShapes.size(), motionGroup.morphTargetIndices.size()));
+		for (int i = 0; i < morphTracksCou; ++i) {
+			const std::string name = motionGroup.morphShapes[i] ? std::string(motionGroup.morphShapes[i]->get_name()) : std::string();
+			MotionCodec::writeVarint(buff, (unsigned int)name.size());
+			buff.insert(buff.end(), name.begin(), name.end());
+			MotionCodec::writeVarint(buff, (unsigned int)std::max(0, motionGroup.morphTargetIndices[i]));
+			MotionCodec::encodeMorphKeyFrames(motionGroup.morphKeyFrames[i], buff);
+			keysCou += (int)motionGroup.morphKeyFrames[i].size();
+		}
+		const unsigned int crc = buff.empty() ? 0 : StreamCodec::calcCRC32C(&buff[0], buff.size());
 
-				if (cou > 0) {
-					const int tIndex = data.appendTargetVertices(szName, vIndices, vList);
-					data.setTargetWeight(tIndex, weight);
+		compointer<sxsdk::stream_interface> stream(boneRoot.create_attribute_stream_interface_with_uuid(MOTION_DATA_STREAM_ID));
+		if (!stream) return 0;
+
+		stream->set_size(0);
+		stream->set_pointer(0);
+		stream->write_int(MOTION_DATA_STREAM_VERSION);
+		stream->write_int(jointTracksCou);
+		stream->write_int(morphTracksCou);
+		stream->write_int(keysCou);
+		stream->write_int((int)buff.size());
+		stream->write_int((int)crc);
+		stream->write_int(skeleton.getBonesCount());
+		stream->write_int((int)MotionRetarget::calcSkeletonSignature(skeleton));
+		if (!buff.empty()) stream->write((int)buff.size(), &buff[0]);
+
+		const int writeBytes = stream->get_pointer();
+		ProfileUtil::addBytes(profile_stream_write, (long long)writeBytes);
+		traceScope.setEndArg("bytes", (long long)writeBytes);
+		return writeBytes;
+
+	} catch (...) { }
+
+	return 0;
+}
+
+/**
+ * ボーンルートからMotionGroup情報を読み込み.
+ */
+bool StreamCtrl::readMotionData (sxsdk::shape_class& boneRoot, MotionUtil::CMotionGroup& motionGroup)
+{
+	CProfileScope profileScope(profile_stream_read);
+	CTraceScope traceScope("StreamCtrl::readMotionData", "handle", (long long)(size_t)boneRoot.get_handle());
+
+	motionGroup.clear();
+
+	try {
+		compointer<sxsdk::stream_interface> stream(boneRoot.get_attribute_stream_interface_with_uuid(MOTION_DATA_STREAM_ID));
+		if (!stream) return false;
+
+		const int streamSize = stream->get_size();
+		stream->set_pointer(0);
+
+		int iVersion, jointTracksCou, morphTracksCou, keysCou, tracksSize, iCrc;
+		stream->read_int(iVersion);
+		if (iVersion < MOTION_DATA_STREAM_VERSION_100 || iVersion > MOTION_DATA_STREAM_VERSION) return false;
+		stream->read_int(jointTracksCou);
+		stream->read_int(morphTracksCou);
+		stream->read_int(keysCou);
+		stream->read_int(tracksSize);
+		stream->read_int(iCrc);
+
+		// ver.0x100は、保存時のボーン階層の情報を持たない.
+		const bool hasJointNames = (iVersion >= MOTION_DATA_STREAM_VERSION_101);
+		const int headerSize = hasJointNames ? MOTION_STREAM_HEADER_SIZE : MOTION_STREAM_HEADER_SIZE_100;
+		int jointsCou = -1, iSignature = 0;
+		if (hasJointNames) {
+			stream->read_int(jointsCou);
+			stream->read_int(iSignature);
+		}
+
+		// トラックごとに最低3バイト(番号、キーフレーム数、キーフレームの範囲)を持つ.
+		if (keysCou < 0 || tracksSize < 0 || tracksSize > streamSize - headerSize) throw "invalid header";
+		if (jointTracksCou < 0 || morphTracksCou < 0 || jointTracksCou > tracksSize / 3 || morphTracksCou > tracksSize / 3) throw "invalid header";
+
+		std::vector<unsigned char> buff(tracksSize);
+		if (tracksSize > 0) stream->read(tracksSize, &buff[0]);
+		if ((tracksSize > 0 ? StreamCodec::calcCRC32C(&buff[0], buff.size()) : 0) != (unsigned int)iCrc) throw "checksum mismatch";
+		const unsigned char* src = buff.empty() ? NULL : &buff[0];
+
+		CBoneSkeleton skeleton;
+		skeleton.build(&boneRoot);
+		const int bonesCou = skeleton.getBonesCount();
+
+		// ボーン階層が保存時から変わっている場合は、ジョイント名で対応させ直す (同じ名前のジョイントが複数ある場合は-1).
+		const bool sameSkeleton = !hasJointNames || (jointsCou == bonesCou && (unsigned int)iSignature == MotionRetarget::calcSkeletonSignature(skeleton));
+		std::map<std::string, int> jointNamesMap;
+		if (!sameSkeleton) {
+			for (int i = 0; i < bonesCou; ++i) {
+				const std::string name(skeleton.getShape(i)->get_name());
+				std::map<std::string, int>::iterator it = jointNamesMap.find(name);
+				if (it == jointNamesMap.end()) jointNamesMap[name] = i;
+				else it->second = -1;
+			}
+		}
+
+		int pos = 0;
+		unsigned int v;
+		long long decodedKeysCou = 0;
+		std::vector<char> jointUsed(bonesCou, 0);
+		std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint> jointKeyFrames;
+		for (int i = 0; i < jointTracksCou; ++i) {
+			if (!MotionCodec::readVarint(src, tracksSize, pos, v)) throw "invalid track";
+			int jIndex = (v < (unsigned int)bonesCou) ? (int)v : -1;
+			if (hasJointNames) {
+				if (!MotionCodec::readVarint(src, tracksSize, pos, v) || v > (unsigned int)(tracksSize - pos)) throw "invalid track";
+				const std::string name((const char *)src + pos, (size_t)v);
+				pos += (int)v;
+				if (!sameSkeleton && (jIndex < 0 || name != skeleton.getShape(jIndex)->get_name())) {
+					std::map<std::string, int>::const_iterator it = jointNamesMap.find(name);
+					jIndex = (it != jointNamesMap.end()) ? it->second : -1;
 				}
 			}
+			if (!MotionCodec::decodeJointKeyFrames(src, tracksSize, pos, jointKeyFrames)) throw "invalid track";
+			decodedKeysCou += (long long)jointKeyFrames.size();
+			if (jIndex < 0 || jointUsed[jIndex]) continue;
+			jointUsed[jIndex] = 1;
+			motionGroup.shapes.push_back(skeleton.getShape(jIndex));
+			motionGroup.jointKeyFrames.push_back(std::vector<MotionUtil::CMotionGroupKeyFrameBallBoneJoint>());
+			motionGroup.jointKeyFrames.back().swap(jointKeyFrames);
+		}
+
+		std::map<std::string, sxsdk::shape_class *> meshes;
+		if (morphTracksCou > 0) {
+			compointer<sxsdk::scene_interface> scene(boneRoot.get_scene_interface());
+			if (scene) m_findPolygonMeshes(&scene->get_shape(), meshes);
 		}
+		for (int i = 0; i < morphTracksCou; ++i) {
+			if (!MotionCodec::readVarint(src, tracksSize, pos, v) || v > (unsigned int)(tracksSize - pos)) throw "invalid track";
+			const std::string name((const char *)src + pos, (size_t)v);
+			pos += (int)v;
+			if (!MotionCodec::readVarint(src, tracksSize, pos, v)) throw "invalid track";
+			std::map<std::string, sxsdk::shape_class *>::const_iterator it = meshes.find(name);
+			motionGroup.morphShapes.push_back((!name.empty() && it != meshes.end()) ? it->second : NULL);
+			motionGroup.morphTargetIndices.push_back((int)v);
+			motionGroup.morphKeyFrames.push_back(std::vector<MotionUtil::CMotionGroupKeyFrameMorphTargets>());
+			if (!MotionCodec::decodeMorphKeyFrames(src, tracksSize, pos, motionGroup.morphKeyFrames.back())) throw "invalid track";
+			decodedKeysCou += (long long)motionGroup.morphKeyFrames.back().size();
+		}
+		if (decodedKeysCou != (long long)keysCou) throw "invalid header";
+
+		const long long readBytes = (long long)(headerSize + tracksSize);
+		ProfileUtil::addBytes(profile_stream_read, readBytes);
+		traceScope.setEndArg("bytes", readBytes);
 		return true;
 
 	} catch (...) { }
 
+	motionGroup.clear();
 	return false;
 }
 
+/**
+ * MotionGroup情報を持つか.
+ */
+bool StreamCtrl::hasMotionData (sxsdk::shape_class& shape)
+{
+	try {
+		compointer<sxsdk::stream_interface> stream(shape.get_attribute_stream_interface_with_uuid(MOTION_DATA_STREAM_ID));
+		if (!stream) return false;
+
+		stream->set_pointer(0);
+
+		int iVersion;
+		stream->read_int(iVersion);
+
+		return (iVersion >= MOTION_DATA_STREAM_VERSION_100 && iVersion <= MOTION_DATA_STREAM_VERSION);
+
+	} catch (...) { }
+
+	return false;
+}
+
+/**
+ * MotionGroup情報を削除.
+ */
+void StreamCtrl::removeMotionData (sxsdk::shape_class& shape)
+{
+	try {
+		shape.delete_attribute_with_uuid(MOTION_DATA_STREAM_ID);
+	} catch (...) { }
+}
+
+/**
+ * リターゲットのジョイントの対応と補正を、移し先のボーンルートに保存.
+ * @return 保存したバイト数 (保存できなかった場合は0).
+ */
+int StreamCtrl::writeRetargetMapping (sxsdk::shape_class& boneRoot, const CMotionRetargetMap& map)
+{
+	CProfileScope profileScope(profile_stream_write);
+	CTraceScope traceScope("StreamCtrl::writeRetargetMapping", "handle", (long long)(size_t)boneRoot.get_handle());
+
+	try {
+		const int n = map.targetJointsCount;
+		if (n < 0 || (int)map.sourceIndices.size() != n || (int)map.corrections.size() != n) return 0;
+
+		std::vector<unsigned char> buff;
+		buff.reserve((size_t)n * (size_t)(1 + MotionCodec::PACKED_ROTATION_SIZE));
+		for (int j = 0; j < n; ++j) {
+			const int s = map.sourceIndices[j];
+			if (s < 0 || s >= map.sourceJointsCount) {
+				MotionCodec::writeVarint(buff, 0);
+				continue;
+			}
+			MotionCodec::writeVarint(buff, (unsigned int)(s + 1));
+			const size_t pos = buff.size();
+			buff.resize(pos + MotionCodec::PACKED_ROTATION_SIZE);
+			MotionCodec::packRotation(map.corrections[j], &buff[pos]);
+		}
+		const unsigned int crc = buff.empty() ? 0 : StreamCodec::calcCRC32C(&buff[0], buff.size());
+
+		compointer<sxsdk::stream_interface> stream(boneRoot.create_attribute_stream_interface_with_uuid(MOTION_RETARGET_STREAM_ID));
+		if (!stream) return 0;
+
+		stream->set_size(0);
+		stream->set_pointer(0);
+		stream->write_int(MOTION_RETARGET_STREAM_VERSION);
+		stream->write_int(map.sourceJointsCount);
+		stream->write_int(n);
+		stream->write_int((int)map.sourceSignature);
+		stream->write_int((int)map.targetSignature);
+		stream->write_int((int)map.overridesSignature);
+		stream->write_float(map.offsetScale);
+		stream->write_int((int)buff.size());
+		stream->write_int((int)crc);
+		if (!buff.empty()) stream->write((int)buff.size(), &buff[0]);
+
+		const int writeBytes = stream->get_pointer();
+		ProfileUtil::addBytes(profile_stream_write, (long long)writeBytes);
+		traceScope.setEndArg("bytes", (long long)writeBytes);
+		return writeBytes;
+
+	} catch (...) { }
+
+	return 0;
+}
+
+/**
+ * ボーンルートからリターゲットのジョイントの対応と補正を読み込み.
+ */
+bool StreamCtrl::readRetargetMapping (sxsdk::shape_class& boneRoot, CMotionRetargetMap& map)
+{
+	CProfileScope profileScope(profile_stream_read);
+	CTraceScope traceScope("StreamCtrl::readRetargetMapping", "handle", (long long)(size_t)boneRoot.get_handle());
+
+	map.clear();
+
+	try {
+		compointer<sxsdk::stream_interface> stream(boneRoot.get_attribute_stream_interface_with_uuid(MOTION_RETARGET_STREAM_ID));
+		if (!stream) return false;
+
+		const int streamSize = stream->get_size();
+		if (streamSize < RETARGET_STREAM_HEADER_SIZE) return false;
+		stream->set_pointer(0);
+
+		int iVersion, sourceJointsCou, targetJointsCou, iSourceSignature, iTargetSignature, iOverridesSignature, mappingSize, iCrc;
+		float offsetScale;
+		stream->read_int(iVersion);
+		if (iVersion < MOTION_RETARGET_STREAM_VERSION_100 || iVersion > MOTION_RETARGET_STREAM_VERSION) return false;
+		stream->read_int(sourceJointsCou);
+		stream->read_int(targetJointsCou);
+		stream->read_int(iSourceSignature);
+		stream->read_int(iTargetSignature);
+		stream->read_int(iOverridesSignature);
+		stream->read_float(offsetScale);
+		stream->read_int(mappingSize);
+		stream->read_int(iCrc);
+
+		// ジョイントごとに最低1バイト(移し元のジョイント番号)を持つ.
+		if (mappingSize < 0 || mappingSize > streamSize - RETARGET_STREAM_HEADER_SIZE) throw "invalid header";
+		if (sourceJointsCou < 0 || targetJointsCou < 0 || targetJointsCou > mappingSize || !(offsetScale > 0.0f)) throw "invalid header";
+
+		std::vector<unsigned char> buff(mappingSize);
+		if (mappingSize > 0) stream->read(mappingSize, &buff[0]);
+		if ((mappingSize > 0 ? StreamCodec::calcCRC32C(&buff[0], buff.size()) : 0) != (unsigned int)iCrc) throw "checksum mismatch";
+		const unsigned char* src = buff.empty() ? NULL : &buff[0];
+
+		map.sourceJointsCount  = sourceJointsCou;
+		map.targetJointsCount  = targetJointsCou;
+		map.sourceSignature    = (unsigned int)iSourceSignature;
+		map.targetSignature    = (unsigned int)iTargetSignature;
+		map.overridesSignature = (unsigned int)iOverridesSignature;
+		map.offsetScale        = offsetScale;
+		map.sourceIndices.assign(targetJointsCou, -1);
+		map.corrections.assign(targetJointsCou, sxsdk::quaternion_class::identity);
+
+		int pos = 0;
+		unsigned int v;
+		for (int j = 0; j < targetJointsCou; ++j) {
+			if (!MotionCodec::readVarint(src, mappingSize, pos, v) || v > (unsigned int)sourceJointsCou) throw "invalid mapping";
+			if (v == 0) continue;
+			if (pos + MotionCodec::PACKED_ROTATION_SIZE > mappingSize) throw "invalid mapping";
+			map.sourceIndices[j] = (int)v - 1;
+			map.corrections[j] = MotionCodec::unpackRotation(src + pos);
+			pos += MotionCodec::PACKED_ROTATION_SIZE;
+		}
+
+		const long long readBytes = (long long)(RETARGET_STREAM_HEADER_SIZE + mappingSize);
+		ProfileUtil::addBytes(profile_stream_read, readBytes);
+		traceScope.setEndArg("bytes", readBytes);
+		return true;
+
+	} catch (...) { }
+
+	map.clear();
+	return false;
+}
+
+/**
+ * リターゲットのジョイントの対応と補正を持つか.
+ */
+bool StreamCtrl::hasRetargetMapping (sxsdk::shape_class& shape)
+{
+	try {
+		compointer<sxsdk::stream_interface> stream(shape.get_attribute_stream_interface_with_uuid(MOTION_RETARGET_STREAM_ID));
+		if (!stream) return false;
+
+		stream->set_pointer(0);
+
+		int iVersion;
+		stream->read_int(iVersion);
+
+		return (iVersion >= MOTION_RETARGET_STREAM_VERSION_100 && iVersion <= MOTION_RETARGET_STREAM_VERSION);
+
+	} catch (...) { }
+
+	return false;
+}
+
+/**
+ * リターゲットのジョイントの対応と補正を削除.
+ */
+void StreamCtrl::removeRetargetMapping (sxsdk::shape_class& shape)
+{
+	try {
+		shape.delete_attribute_with_uuid(MOTION_RETARGET_STREAM_ID);
+	} catch (...) { }
+}
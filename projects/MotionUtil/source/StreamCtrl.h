@@ -7,6 +7,8 @@
 
 #include "GlobalHeader.h"
 #include "MorphTargetsCtrl.h"
+#include "MotionData.h"
+#include "MotionRetarget.h"
 
 namespace StreamCtrl
 {
@@ -15,10 +17,42 @@ namespace StreamCtrl
 	 */
 	void writeMorphTargetsData (sxsdk::shape_class& shape, const CMorphTargetsCtrl& data);
 
+	/**
+	 * Morph Targets情報のうち、ウエイト値のみをstream上で書き換え.
+	 * streamに保存されている構成がdataと一致しない場合はfalseを返す (writeMorphTargetsDataで保存し直すこと).
+	 */
+	bool writeMorphTargetsWeights (sxsdk::shape_class& shape, const CMorphTargetsCtrl& data);
+
 	/**
 	 * Morph Targets情報を読み込み.
+	 * 名前とウエイト値のみを読み込み、頂点は必要になった時点で読み込まれる.
+	 * @param[in]  loadVertices  すべての頂点もここで読み込む場合はtrue.
+	 */
+	bool readMorphTargetsData (sxsdk::shape_class& shape, CMorphTargetsCtrl& data, const bool loadVertices = false);
+
+	/**
+	 * Morph Targets情報のstream上の配置を読み込み (頂点は読み込まない).
+	 * ver.0x100/0x101では、頂点を持たないTargetは除外される.
+	 */
+	bool readMorphTargetsLayout (sxsdk::shape_class& shape, CMorphTargetsStreamLayout& layout);
+
+	/**
+	 * streamがlayoutを読み込んだ時点から変更されていないか.
+	 */
+	bool checkMorphTargetsLayout (sxsdk::shape_class& shape, const CMorphTargetsStreamLayout& layout);
+
+	/**
+	 * layoutの位置から、ベースの頂点座標と対称マップを読み込み.
+	 * 対称マップを持たない、または読み込めない場合はsymmetryMapはクリアされる.
+	 */
+	bool readMorphTargetsBase (sxsdk::shape_class& shape, const CMorphTargetsStreamLayout& layout, std::vector<sxsdk::vec3>& orgVertices, CMorphTargetsSymmetryMap& symmetryMap);
+
+	/**
+	 * layoutの位置から、指定のTargetの頂点インデックスと頂点座標を読み込み.
+	 * @param[in] tIndex       layout上のTarget番号.
+	 * @param[in] orgVertices  ベースの頂点座標 (圧縮されている場合に使用).
 	 */
-	bool readMorphTargetsData (sxsdk::shape_class& shape, CMorphTargetsCtrl& data);
+	bool readMorphTargetVertices (sxsdk::shape_class& shape, const CMorphTargetsStreamLayout& layout, const int tIndex, const std::vector<sxsdk::vec3>& orgVertices, std::vector<int>& vIndices, std::vector<sxsdk::vec3>& vertices);
 
 	/**
 	 * Morph Targets情報を持つか.
@@ -29,6 +63,59 @@ namespace StreamCtrl
 	 * Morph Targets情報を削除.
 	 */
 	void removeMorphTargetsData (sxsdk::shape_class& shape);
+
+	/**
+	 * MotionGroup情報をボーンルートに保存.
+	 * ジョイントはボーンルート以下のボーン階層での番号と名前、Morph Targetsの対象形状は名前で保存する.
+	 * ボーン階層のジョイント数とシグネチャ(MotionRetarget::calcSkeletonSignature)も保存する.
+	 * ボーンルート以下にないジョイントのトラックは保存しない.
+	 * @param[in] boneRoot     保存先のボーンルート.
+	 * @param[in] motionGroup  保存するMotionGroup.
+	 * @return 保存したバイト数 (保存できなかった場合は0).
+	 */
+	int writeMotionData (sxsdk::shape_class& boneRoot, const MotionUtil::CMotionGroup& motionGroup);
+
+	/**
+	 * ボーンルートからMotionGroup情報を読み込み.
+	 * ボーン階層が保存時から変わっている場合(ジョイント数かシグネチャが異なる場合)は、ジョイント名で対応させ直す.
+	 * 番号のジョイントの名前が異なり、同じ名前のジョイントが1つだけ存在しないトラックは読み込まない.
+	 * Morph Targetsの対象形状は、シーン内の同じ名前のポリゴンメッシュとする (見つからない場合、同じ名前のポリゴンメッシュが複数ある場合はNULL).
+	 */
+	bool readMotionData (sxsdk::shape_class& boneRoot, MotionUtil::CMotionGroup& motionGroup);
+
+	/**
+	 * MotionGroup情報を持つか.
+	 */
+	bool hasMotionData (sxsdk::shape_class& shape);
+
+	/**
+	 * MotionGroup情報を削除.
+	 */
+	void removeMotionData (sxsdk::shape_class& shape);
+
+	/**
+	 * リターゲットのジョイントの対応と補正を、移し先のボーンルートに保存.
+	 * @param[in] boneRoot  保存先のボーンルート.
+	 * @param[in] map       保存する対応と補正.
+	 * @return 保存したバイト数 (保存できなかった場合は0).
+	 */
+	int writeRetargetMapping (sxsdk::shape_class& boneRoot, const CMotionRetargetMap& map);
+
+	/**
+	 * ボーンルートからリターゲットのジョイントの対応と補正を読み込み.
+	 * ボーン階層が保存時と同じかは、mapのシグネチャで確認すること.
+	 */
+	bool readRetargetMapping (sxsdk::shape_class& boneRoot, CMotionRetargetMap& map);
+
+	/**
+	 * リターゲットのジョイントの対応と補正を持つか.
+	 */
+	bool hasRetargetMapping (sxsdk::shape_class& shape);
+
+	/**
+	 * リターゲットのジョイントの対応と補正を削除.
+	 */
+	void removeRetargetMapping (sxsdk::shape_class& shape);
 }
 
 #endif
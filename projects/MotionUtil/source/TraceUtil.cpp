@@ -0,0 +1,292 @@
+﻿/**
+ * 処理のタイムラインの記録用.
+ * 処理の開始/終了をスレッドごとのリングバッファに記録し、Chrome trace形式(JSON)で出力する.
+ */
+#include "TraceUtil.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+
+namespace {
+	const int TRACE_DEFAULT_BUFFER_SIZE = 65536;		// スレッドごとに保持するイベント数 (デフォルト).
+
+	/**
+	 * 1つのイベント.
+	 */
+	class CTraceEvent
+	{
+	public:
+		const char* name;								// イベント名.
+		char phase;										// 'B' : 開始、'E' : 終了、'i' : 単発.
+		long long timeStamp;							// 記録開始からの時間 (ナノ秒).
+		int argsCount;									// 引数の数.
+		const char* argNames[TRACE_EVENT_ARGS_MAX];		// 引数名.
+		long long argValues[TRACE_EVENT_ARGS_MAX];		// 引数の値.
+
+	public:
+		CTraceEvent () : name(NULL), phase('i'), timeStamp(0), argsCount(0) { }
+	};
+
+	/**
+	 * 1つのスレッドのリングバッファ.
+	 * スレッドの終了後は、別のスレッドで再利用される.
+	 */
+	class CTraceBuffer
+	{
+	public:
+		std::mutex mutex;								// 出力時との排他用.
+		std::vector<CTraceEvent> events;				// リングバッファ.
+		long long writeCount;							// これまでに記録したイベント数.
+		int threadIndex;								// 出力時のスレッド番号.
+		bool inUse;										// スレッドが使用中か.
+
+	public:
+		CTraceBuffer () : writeCount(0), threadIndex(0), inUse(false) { }
+	};
+
+	std::mutex g_buffersMutex;							// g_buffersの排他用.
+	std::vector<CTraceBuffer *> g_buffers;				// すべてのスレッドのバッファ (プラグインの終了まで保持).
+	int g_bufferSize = TRACE_DEFAULT_BUFFER_SIZE;
+
+	const std::chrono::steady_clock::time_point g_startTime = std::chrono::steady_clock::now();
+
+	/**
+	 * スレッドごとのバッファの割り当て.
+	 */
+	class CTraceThreadSlot
+	{
+	public:
+		CTraceBuffer* buffer;
+
+	public:
+		CTraceThreadSlot () : buffer(NULL) { }
+		~CTraceThreadSlot () {
+			if (buffer) {
+				std::lock_guard<std::mutex> lock(g_buffersMutex);
+				buffer->inUse = false;
+			}
+		}
+	};
+
+	thread_local CTraceThreadSlot g_threadSlot;
+
+	/**
+	 * カレントスレッドのバッファを取得.
+	 */
+	CTraceBuffer* getThreadBuffer ()
+	{
+		if (g_threadSlot.buffer) return g_threadSlot.buffer;
+
+		std::lock_guard<std::mutex> lock(g_buffersMutex);
+		CTraceBuffer* buffer = NULL;
+		for (size_t i = 0; i < g_buffers.size(); ++i) {
+			if (!g_buffers[i]->inUse) {
+				buffer = g_buffers[i];
+				break;
+			}
+		}
+		if (!buffer) {
+			buffer = new CTraceBuffer();
+			buffer->threadIndex = (int)g_buffers.size() + 1;
+			g_buffers.push_back(buffer);
+		}
+		buffer->inUse = true;
+		g_threadSlot.buffer = buffer;
+		return buffer;
+	}
+
+	void recordEvent (const char* name, const char phase, const int argsCount, const char* const* argNames, const long long* argValues)
+	{
+		const long long timeStamp = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_startTime).count();
+
+		CTraceBuffer* buffer = getThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer->mutex);
+		if (buffer->events.empty()) buffer->events.resize(g_bufferSize);
+
+		CTraceEvent& event = buffer->events[(size_t)(buffer->writeCount % (long long)buffer->events.size())];
+		event.name      = name;
+		event.phase     = phase;
+		event.timeStamp = timeStamp;
+		event.argsCount = std::min(std::max(argsCount, 0), TRACE_EVENT_ARGS_MAX);
+		for (int i = 0; i < event.argsCount; ++i) {
+			event.argNames[i]  = argNames[i];
+			event.argValues[i] = argValues[i];
+		}
+		buffer->writeCount++;
+	}
+
+	/**
+	 * JSON用に文字列をエスケープして出力.
+	 */
+	void writeJSONString (FILE* fp, const char* str)
+	{
+		fputc('"', fp);
+		for (const char* p = str; p && *p; ++p) {
+			const unsigned char c = (unsigned char)(*p);
+			if (c == '"' || c == '\\') fprintf(fp, "\\%c", c);
+			else if (c < 0x20) fprintf(fp, "\\u%04x", c);
+			else fputc(c, fp);
+		}
+		fputc('"', fp);
+	}
+}
+
+std::atomic<bool> TraceUtil::g_enabled(false);
+
+/**
+ * 記録の有効/無効を指定.
+ */
+void TraceUtil::setEnabled (const bool enabled)
+{
+	g_enabled.store(enabled);
+}
+
+/**
+ * スレッドごとに保持するイベント数を指定 (これを超えると古いものから上書きされる).
+ * 記録済みのイベントはクリアされる.
+ */
+void TraceUtil::setBufferSize (const int eventsCount)
+{
+	std::lock_guard<std::mutex> lock(g_buffersMutex);
+	g_bufferSize = std::max(16, eventsCount);
+	for (size_t i = 0; i < g_buffers.size(); ++i) {
+		std::lock_guard<std::mutex> bufferLock(g_buffers[i]->mutex);
+		g_buffers[i]->events.clear();
+		g_buffers[i]->writeCount = 0;
+	}
+}
+
+/**
+ * 記録済みのイベントをクリア.
+ */
+void TraceUtil::clear ()
+{
+	std::lock_guard<std::mutex> lock(g_buffersMutex);
+	for (size_t i = 0; i < g_buffers.size(); ++i) {
+		std::lock_guard<std::mutex> bufferLock(g_buffers[i]->mutex);
+		g_buffers[i]->writeCount = 0;
+	}
+}
+
+/**
+ * 処理の開始を記録.
+ */
+void TraceUtil::beginEvent (const char* name, const int argsCount, const char* const* argNames, const long long* argValues)
+{
+	if (!isEnabled()) return;
+	recordEvent(name, 'B', argsCount, argNames, argValues);
+}
+
+/**
+ * 処理の終了を記録.
+ * 記録中に無効にされた場合も開始イベントと対になるように、有効/無効に関わらず記録する.
+ */
+void TraceUtil::endEvent (const char* name, const int argsCount, const char* const* argNames, const long long* argValues)
+{
+	recordEvent(name, 'E', argsCount, argNames, argValues);
+}
+
+/**
+ * 単発のイベント(UIの操作など)を記録.
+ */
+void TraceUtil::instantEvent (const char* name, const char* argName1, const long long argValue1, const char* argName2, const long long argValue2)
+{
+	if (!isEnabled()) return;
+	const char* argNames[2] = {argName1, argName2};
+	const long long argValues[2] = {argValue1, argValue2};
+	recordEvent(name, 'i', argName2 ? 2 : (argName1 ? 1 : 0), argNames, argValues);
+}
+
+/**
+ * 記録したイベントをChrome trace形式(JSON)でファイルに出力.
+ * リングバッファで上書きされて開始イベントが失われた終了イベントは出力しない.
+ * @param[in] fileName  出力ファイル名 (UTF-8).
+ */
+bool TraceUtil::writeJSON (const char* fileName)
+{
+	if (!fileName || fileName[0] == '\0') return false;
+
+	FILE* fp = fopen(fileName, "wb");
+	if (!fp) return false;
+
+	fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	bool first = true;
+
+	std::lock_guard<std::mutex> lock(g_buffersMutex);
+	for (size_t bLoop = 0; bLoop < g_buffers.size(); ++bLoop) {
+		CTraceBuffer& buffer = *(g_buffers[bLoop]);
+		std::lock_guard<std::mutex> bufferLock(buffer.mutex);
+		if (buffer.writeCount == 0 || buffer.events.empty()) continue;
+
+		fprintf(fp, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"MotionUtil thread %d\"}}", first ? "" : ",\n", buffer.threadIndex, buffer.threadIndex);
+		first = false;
+
+		const long long bufferSize = (long long)buffer.events.size();
+		const long long startIndex = std::max(0LL, buffer.writeCount - bufferSize);
+		int depth = 0;
+		for (long long i = startIndex; i < buffer.writeCount; ++i) {
+			const CTraceEvent& event = buffer.events[(size_t)(i % bufferSize)];
+			if (event.phase == 'E') {
+				if (depth <= 0) continue;
+				depth--;
+			} else if (event.phase == 'B') {
+				depth++;
+			}
+
+			fprintf(fp, ",\n{\"name\": ");
+			writeJSONString(fp, event.name);
+			fprintf(fp, ", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d", event.phase, (double)event.timeStamp * 1e-3, buffer.threadIndex);
+			if (event.phase == 'i') fprintf(fp, ", \"s\": \"t\"");
+			if (event.argsCount > 0) {
+				fprintf(fp, ", \"args\": {");
+				for (int j = 0; j < event.argsCount; ++j) {
+					if (j > 0) fprintf(fp, ", ");
+					writeJSONString(fp, event.argNames[j]);
+					fprintf(fp, ": %lld", event.argValues[j]);
+				}
+				fprintf(fp, "}");
+			}
+			fprintf(fp, "}");
+		}
+	}
+	fprintf(fp, "\n]}\n");
+
+	const bool ret = (ferror(fp) == 0);
+	fclose(fp);
+	return ret;
+}
+
+//---------------------------------------------------------------.
+/**
+ * スコープの開始時に開始イベントを記録.
+ */
+CTraceScope::CTraceScope (const char* name, const char* argName1, const long long argValue1, const char* argName2, const long long argValue2) : m_name(name), m_enabled(TraceUtil::isEnabled()), m_endArgsCount(0)
+{
+	if (!m_enabled) return;
+	const char* argNames[2] = {argName1, argName2};
+	const long long argValues[2] = {argValue1, argValue2};
+	TraceUtil::beginEvent(m_name, argName2 ? 2 : (argName1 ? 1 : 0), argNames, argValues);
+}
+
+/**
+ * スコープの終了時に終了イベントを記録.
+ */
+CTraceScope::~CTraceScope ()
+{
+	if (!m_enabled) return;
+	TraceUtil::endEvent(m_name, m_endArgsCount, m_endArgNames, m_endArgValues);
+}
+
+/**
+ * 終了イベントの引数を追加.
+ */
+void CTraceScope::setEndArg (const char* argName, const long long argValue)
+{
+	if (!m_enabled || m_endArgsCount >= TRACE_EVENT_ARGS_MAX) return;
+	m_endArgNames[m_endArgsCount]  = argName;
+	m_endArgValues[m_endArgsCount] = argValue;
+	m_endArgsCount++;
+}
@@ -0,0 +1,78 @@
+﻿/**
+ * 処理のタイムラインの記録用.
+ * 処理の開始/終了をスレッドごとのリングバッファに記録し、Chrome trace形式(JSON)で出力する.
+ * 出力したファイルは、chrome://tracingやPerfetto UIで表示できる.
+ */
+#ifndef _TRACEUTIL_H
+#define _TRACEUTIL_H
+
+#include "GlobalHeader.h"
+
+#include <atomic>
+
+#define TRACE_EVENT_ARGS_MAX 3				// 1つのイベントで保持できる引数の最大数.
+
+namespace TraceUtil {
+	extern std::atomic<bool> g_enabled;		// 記録が有効か.
+
+	/**
+	 * 記録が有効か.
+	 */
+	inline bool isEnabled () { return g_enabled.load(std::memory_order_relaxed); }
+
+	/**
+	 * 記録の有効/無効を指定.
+	 */
+	void setEnabled (const bool enabled);
+
+	/**
+	 * スレッドごとに保持するイベント数を指定 (これを超えると古いものから上書きされる).
+	 * 記録済みのイベントはクリアされる.
+	 */
+	void setBufferSize (const int eventsCount);
+
+	/**
+	 * 記録済みのイベントをクリア.
+	 */
+	void clear ();
+
+	/**
+	 * 処理の開始/終了、単発のイベントを記録.
+	 * name/argNameは文字列リテラルなど、出力時まで有効な文字列を渡すこと.
+	 * endEventは、beginEventを記録した場合のみ呼ぶこと (有効/無効の判定は行わない).
+	 */
+	void beginEvent (const char* name, const int argsCount = 0, const char* const* argNames = NULL, const long long* argValues = NULL);
+	void endEvent (const char* name, const int argsCount = 0, const char* const* argNames = NULL, const long long* argValues = NULL);
+	void instantEvent (const char* name, const char* argName1 = NULL, const long long argValue1 = 0, const char* argName2 = NULL, const long long argValue2 = 0);
+
+	/**
+	 * 記録したイベントをChrome trace形式(JSON)でファイルに出力.
+	 * @param[in] fileName  出力ファイル名 (UTF-8).
+	 */
+	bool writeJSON (const char* fileName);
+}
+
+/**
+ * スコープ内の処理を開始/終了イベントとして記録.
+ * 終了時にのみ分かる値(書き込んだバイト数など)は、setEndArgで指定する.
+ */
+class CTraceScope
+{
+private:
+	const char* m_name;
+	bool m_enabled;
+	int m_endArgsCount;
+	const char* m_endArgNames[TRACE_EVENT_ARGS_MAX];
+	long long m_endArgValues[TRACE_EVENT_ARGS_MAX];
+
+public:
+	CTraceScope (const char* name, const char* argName1 = NULL, const long long argValue1 = 0, const char* argName2 = NULL, const long long argValue2 = 0);
+	~CTraceScope ();
+
+	/**
+	 * 終了イベントの引数を追加.
+	 */
+	void setEndArg (const char* argName, const long long argValue);
+};
+
+#endif
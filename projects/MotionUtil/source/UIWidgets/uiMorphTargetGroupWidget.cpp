@@ -22,7 +22,7 @@ CUISliderWidget::CUISliderWidget (sxsdk::window_interface &parent, const int con
  */
 void CUISliderWidget::changedValue (float value, bool dragged)
 {
-	m_pParent->changeWeight(value);
+	m_pParent->changeWeight(value, dragged);
 }
 
 /**
@@ -108,10 +108,11 @@ void CUIMorphTargetGroupWidget::setSelect (const bool selectF, const bool update
 
 /**
  * ウエイト値が変更された場合に呼ばれる.
+ * @param[in] dragged  スライダでドラッグ中はtrue.
  */
-void CUIMorphTargetGroupWidget::changeWeight (const float weight)
+void CUIMorphTargetGroupWidget::changeWeight (const float weight, const bool dragged)
 {
-	m_morphTargetsWidget->changedWeightValue(m_index, weight);
+	m_morphTargetsWidget->changedWeightValue(m_index, weight, dragged);
 }
 
 /**
@@ -140,8 +140,9 @@ public:
 
 	/**
 	 * ウエイト値が変更された場合に呼ばれる.
+	 * @param[in] dragged  スライダでドラッグ中はtrue.
 	 */
-	void changeWeight (const float weight);
+	void changeWeight (const float weight, const bool dragged = false);
 
 	/**
 	 * ウエイト値を変更.
@@ -8,6 +8,8 @@
 
 #include "../MeshUtil.h"
 #include "../StreamCtrl.h"
+#include "../MorphTargetsUndo.h"
+#include "../TraceUtil.h"
 
 /**
  * @param[in] pParent      CMorphWindowInterfaceのポインタ.
@@ -156,13 +158,24 @@ void CUIMorphTargetsWidget::m_updateUI ()
  * Weight値が変更された場合に呼ばれるイベント.
  * @param[in] index   Weightリストでの番号.
  * @param[in] weight  Weight値.
+ * @param[in] dragged スライダでドラッグ中はtrue.
  */
-void CUIMorphTargetsWidget::changedWeightValue (const int index, const float weight)
+void CUIMorphTargetsWidget::changedWeightValue (const int index, const float weight, const bool dragged)
 {
 	// ウエイト値を変更.
+	TraceUtil::instantEvent("CUIMorphTargetsWidget::changedWeightValue", "index", index, "dragged", dragged ? 1 : 0);
+
 	CMorphTargetsCtrl& morphD = m_morphWindow->getMorphTargetsCtrl();
+	const float oldWeight = morphD.getTargetWeight(index);
 	morphD.setTargetWeight(index, weight);
 
+	// UNDO用に記録。ドラッグ中の変更は1つにまとめ、スライダを離した時点で結合を打ち切る.
+	if (morphD.getTargetShape()) {
+		CMorphTargetsUndoJournal& journal = MorphTargetsUndo::getJournal();
+		journal.recordWeight(morphD.getTargetShape()->get_handle(), index, oldWeight, morphD.getTargetWeight(index), dragged);
+		if (!dragged) journal.sealWeightChange();
+	}
+
 	// Morph情報を更新.
 	//m_morphWindow->setNeedUpdateMorph();
 	m_morphWindow->updateMorph();
@@ -185,6 +198,9 @@ void CUIMorphTargetsWidget::changedSelect (const int index)
 		morphD.setSelectTargetIndex(index);
 
 		this->invalidate();
+
+		// 選択に応じてボタンの状態を更新.
+		m_morphWindow->updateButtonsUI();
 	}
 }
 
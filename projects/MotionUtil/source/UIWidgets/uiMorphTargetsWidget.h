@@ -74,8 +74,9 @@ public:
 	 * Weight値が変更された場合に呼ばれるイベント.
 	 * @param[in] index   Weightリストでの番号.
 	 * @param[in] weight  Weight値.
+	 * @param[in] dragged スライダでドラッグ中はtrue.
 	 */
-	void changedWeightValue (const int index, const float weight);
+	void changedWeightValue (const int index, const float weight, const bool dragged = false);
 
 	/**
 	 * 選択が変更された場合の呼ばれるイベント.